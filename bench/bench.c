@@ -0,0 +1,782 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <getopt.h>
+#include <malloc.h>
+#include <time.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "hash_table.h"
+#include "file_utils.h"
+#include "block_store.h"
+#include "bloom.h"
+#include "casefold.h"
+#include "stream_lookup.h"
+#include "version.h"
+
+#define BENCH_CORE_OPS 20
+#define BENCH_PAIR_SAMPLES 2048
+
+// Everything one child process reports back for a single dictionary size
+typedef struct {
+    uint64_t entries;
+    uint64_t terms;
+    long file_bytes;
+    long store_bytes;        // definitions.wtfb built from the same dictionary
+    uint32_t store_blocks;
+    uint64_t store_open_bytes;   // header + index
+    double store_hit_bytes;      // average bytes read per lookup
+    double store_miss_bytes;
+    uint64_t bloom_bytes;        // filter in front of the table, at WTF_BLOOM_FPR
+    double bloom_estimated_fpr;
+    double bloom_observed_fpr;   // misses the filter let through
+    uint64_t table_heap_bytes;   // heap held by one loaded table
+    uint64_t intern_strings;     // keys and values inserted
+    uint64_t intern_unique;      // distinct ones the table's pool stores
+    uint64_t intern_bytes_in;    // what a copy of each would take
+    uint64_t intern_bytes_stored;
+    uint64_t compressed_heap_bytes;   // the same table after hash_table_compress()
+    long peak_rss_kb;
+    int op_count;
+    BenchOpResult ops[BENCH_CORE_OPS];
+} CoreSizeResult;
+
+typedef struct {
+    char *term;
+    char *definition;
+} BenchPair;
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+        "Usage: %s [suite] [options]\n"
+        "\n"
+        "Suites:\n"
+        "  core              time loaders, lookups, save, teardown and the block store (default)\n"
+        "  gen               only write a synthetic dictionary (--out required)\n"
+        "  startup           exec --binary and --baseline repeatedly, compare wall time\n"
+        "  find              trigram index vs a parallel scan for `wtf find` (sizes count terms)\n"
+        "  phonetic          phonetic key throughput, index build and sound-alike lookups\n"
+        "                    (sizes count terms)\n"
+        "  writers           --writers processes appending to and removing from one file\n"
+        "                    (sizes count records per writer)\n"
+        "  sync              concurrent invocations racing for one sync (sizes count invocations)\n"
+        "  ratelimit         hosts behind one address checking for updates against a rate\n"
+        "                    limited stand-in API, run with --binary (sizes count hosts)\n"
+        "  resume            `wtf sync` resuming downloads a stand-in cuts off partway, run\n"
+        "                    with --binary (sizes count entries)\n"
+        "  codecs            transfer size and decode CPU time per Content-Encoding, plus\n"
+        "                    `wtf sync` with each given --binary (sizes count entries)\n"
+        "  netsync           every phase of `wtf sync` and its peak RSS against a local\n"
+        "                    stand-in over shaped links, run with --binary (sizes count entries)\n"
+        "\n"
+        "Options:\n"
+        "  --sizes N,N,...   dictionary sizes in entries (default 10000,100000,1000000)\n"
+        "  --entries N       entries for the gen suite (default 10000)\n"
+        "  --term-len N      average term length (default 8)\n"
+        "  --def-len N       average definition length (default 60)\n"
+        "  --defs-per-term N definitions per distinct term (default 2)\n"
+        "  --variant-rate P  probability of an extra case variant per term (default 0.1)\n"
+        "  --shared-def-rate P  probability a definition is one of 64 stock ones (default 0.1)\n"
+        "  --case-mix L,T,U  weights for lower/Title/UPPER primary keys (default 6,3,1)\n"
+        "  --buckets N       hash table size (default 100, as in main())\n"
+        "  --samples N       max samples per lookup op (default 1000)\n"
+        "  --reps N          max repetitions of load/save (default 5)\n"
+        "  --budget-ms N     time budget per op (default 1000)\n"
+        "  --seed N          generator seed\n"
+        "  --tmpdir DIR      scratch directory (default /tmp)\n"
+        "  --binary PATH     wtf binary for process-level suites\n"
+        "  --baseline PATH   second binary to compare against\n"
+        "  --args \"ARGS\"     arguments for those binaries (default --version)\n"
+        "  --writers N       concurrent writers for the writers suite (default 64)\n"
+        "  --out FILE        write JSON (or the gen dictionary) to FILE\n",
+        prog);
+}
+
+static int parse_sizes(const char *arg, BenchOptions *opt) {
+    char *copy = strdup(arg);
+    if (!copy) return 0;
+    opt->size_count = 0;
+    for (char *tok = strtok(copy, ","); tok && opt->size_count < BENCH_MAX_SIZES;
+         tok = strtok(NULL, ",")) {
+        char *end;
+        double value = strtod(tok, &end);
+        if (*end == 'k' || *end == 'K') value *= 1e3;
+        else if (*end == 'm' || *end == 'M') value *= 1e6;
+        if (value >= 1) opt->sizes[opt->size_count++] = (size_t)value;
+    }
+    free(copy);
+    return opt->size_count > 0;
+}
+
+static int parse_case_mix(const char *arg, BenchDictConfig *cfg) {
+    double l, t, u;
+    if (sscanf(arg, "%lf,%lf,%lf", &l, &t, &u) != 3) return 0;
+    cfg->case_lower = l;
+    cfg->case_title = t;
+    cfg->case_upper = u;
+    return 1;
+}
+
+// Read every 100th line of the dictionary into removed.txt and keep a sample of
+// term:definition pairs (half removed, half live) for is_definition_removed().
+static size_t build_removed_file(const char *dict_path, const char *removed_path,
+                                 BenchPair *pairs, size_t max_pairs) {
+    FILE *in = fopen(dict_path, "r");
+    FILE *out = fopen(removed_path, "w");
+    if (!in || !out) {
+        if (in) fclose(in);
+        if (out) fclose(out);
+        return 0;
+    }
+
+    char line[256];
+    size_t lineno = 0;
+    size_t pair_count = 0;
+    while (fgets(line, sizeof(line), in)) {
+        int removed = (lineno % 100) == 0;
+        int sampled = (lineno % 50) == 0;
+        if (removed) fputs(line, out);
+        if (sampled && pair_count < max_pairs) {
+            char *sep = strchr(line, ':');
+            char *nl = strchr(line, '\n');
+            if (sep) {
+                if (nl) *nl = '\0';
+                *sep = '\0';
+                pairs[pair_count].term = strdup(line);
+                pairs[pair_count].definition = strdup(sep + 1);
+                if (pairs[pair_count].term && pairs[pair_count].definition) {
+                    pair_count++;
+                } else {
+                    free(pairs[pair_count].term);
+                    free(pairs[pair_count].definition);
+                }
+            }
+        }
+        lineno++;
+    }
+
+    fclose(in);
+    fclose(out);
+    return pair_count;
+}
+
+static void run_core_size(const BenchOptions *opt, size_t entries, CoreSizeResult *res) {
+    char dict_path[512], removed_path[512], save_path[512], store_path[512];
+    snprintf(dict_path, sizeof(dict_path), "%s/wtf_bench_%d_dict.txt", opt->tmpdir, (int)getpid());
+    snprintf(removed_path, sizeof(removed_path), "%s/wtf_bench_%d_removed.txt", opt->tmpdir, (int)getpid());
+    snprintf(save_path, sizeof(save_path), "%s/wtf_bench_%d_save.txt", opt->tmpdir, (int)getpid());
+    snprintf(store_path, sizeof(store_path), "%s/wtf_bench_%d_dict.wtfb", opt->tmpdir, (int)getpid());
+
+    memset(res, 0, sizeof(*res));
+    res->entries = entries;
+
+    BenchDictConfig cfg = opt->dict;
+    cfg.entries = entries;
+    BenchTermSet terms = {0};
+    if (!bench_generate_dictionary(dict_path, &cfg, &terms)) {
+        fprintf(stderr, "bench: could not write %s\n", dict_path);
+        return;
+    }
+    res->terms = terms.count;
+    res->file_bytes = bench_file_size(dict_path);
+
+    BenchPair *pairs = calloc(BENCH_PAIR_SAMPLES, sizeof(BenchPair));
+    size_t pair_count = pairs ? build_removed_file(dict_path, removed_path, pairs, BENCH_PAIR_SAMPLES) : 0;
+
+    BenchSamples load, teardown, hit, view_hit, miss, removed_check, save;
+    bench_samples_init(&load);
+    bench_samples_init(&view_hit);
+    bench_samples_init(&teardown);
+    bench_samples_init(&hit);
+    bench_samples_init(&miss);
+    bench_samples_init(&removed_check);
+    bench_samples_init(&save);
+
+    // load_definitions + teardown, keeping the last table for the queries
+    HashTable *table = NULL;
+    uint64_t started = bench_now_ns();
+    while (bench_should_continue(opt, started, load.count, (size_t)opt->max_reps)) {
+        if (table) {
+            uint64_t t0 = bench_now_ns();
+            free_hash_table(table);
+            bench_samples_add(&teardown, bench_now_ns() - t0);
+        }
+        size_t heap_before = mallinfo2().uordblks;
+        table = create_hash_table(opt->buckets);
+        if (!table) break;
+        uint64_t t0 = bench_now_ns();
+        load_definitions(dict_path, table);
+        bench_samples_add(&load, bench_now_ns() - t0);
+        size_t heap_after = mallinfo2().uordblks;
+        res->table_heap_bytes = heap_after > heap_before ? heap_after - heap_before : 0;
+    }
+    if (table) {
+        res->intern_strings = table->strings.interned;
+        res->intern_unique = table->strings.unique;
+        res->intern_bytes_in = table->strings.bytes_in;
+        res->intern_bytes_stored = table->strings.bytes_stored;
+    }
+
+    HashTable *removed = create_hash_table(opt->buckets);
+    if (removed) load_definitions(removed_path, removed);
+
+    uint64_t rng = opt->dict.seed ^ 0x9e3779b97f4a7c15ULL;
+    char query[256];
+
+    // Hits, asked for in a random case so both lookup passes are exercised
+    started = bench_now_ns();
+    while (table && terms.count > 0 &&
+           bench_should_continue(opt, started, hit.count, (size_t)opt->max_samples)) {
+        const char *term = terms.terms[bench_rand(&rng) % terms.count];
+        bench_apply_case(query, term, (int)(bench_rand(&rng) % 3));
+        uint64_t t0 = bench_now_ns();
+        DefinitionList *list = hash_table_lookup_all(table, query);
+        bench_samples_add(&hit, bench_now_ns() - t0);
+        free_definition_list(list);
+    }
+
+    // Same hits through the borrowed view, which copies no strings
+    started = bench_now_ns();
+    while (table && terms.count > 0 &&
+           bench_should_continue(opt, started, view_hit.count, (size_t)opt->max_samples)) {
+        const char *term = terms.terms[bench_rand(&rng) % terms.count];
+        bench_apply_case(query, term, (int)(bench_rand(&rng) % 3));
+        LookupResult view;
+        lookup_result_init(&view);
+        uint64_t t0 = bench_now_ns();
+        hash_table_lookup_view(table, query, &view);
+        bench_samples_add(&view_hit, bench_now_ns() - t0);
+        lookup_result_free(&view);
+    }
+
+    // Misses: the generator never emits '_' so these terms cannot exist
+    started = bench_now_ns();
+    while (table && bench_should_continue(opt, started, miss.count, (size_t)opt->max_samples)) {
+        snprintf(query, sizeof(query), "miss_%llu", (unsigned long long)(bench_rand(&rng) % 1000000));
+        uint64_t t0 = bench_now_ns();
+        DefinitionList *list = hash_table_lookup_all(table, query);
+        bench_samples_add(&miss, bench_now_ns() - t0);
+        free_definition_list(list);
+    }
+
+    // Bloom filter over the table's terms, then the same misses with it in front
+    BenchSamples bloom_build_samples, bloom_miss;
+    bench_samples_init(&bloom_build_samples);
+    bench_samples_init(&bloom_miss);
+    BloomKeys keys = {0};
+    for (int b = 0; table && b < table->size; b++) {
+        for (HashNode *node = table->table[b]; node; node = node->next) {
+            bloom_keys_add(&keys, bloom_hash(node->key));
+        }
+    }
+    BloomFilter filter = {0};
+    started = bench_now_ns();
+    while (table && bench_should_continue(opt, started, bloom_build_samples.count, (size_t)opt->max_reps)) {
+        bloom_free(&filter);
+        uint64_t t0 = bench_now_ns();
+        if (!bloom_build(&filter, &keys, bloom_target_fpr())) break;
+        bench_samples_add(&bloom_build_samples, bench_now_ns() - t0);
+    }
+    uint64_t false_positives = 0;
+    started = bench_now_ns();
+    while (filter.bits && bench_should_continue(opt, started, bloom_miss.count, (size_t)opt->max_samples)) {
+        snprintf(query, sizeof(query), "miss_%llu", (unsigned long long)(bench_rand(&rng) % 1000000));
+        LookupResult view;
+        lookup_result_init(&view);
+        uint64_t t0 = bench_now_ns();
+        if (bloom_maybe_contains(&filter, bloom_hash(query))) {
+            hash_table_lookup_view(table, query, &view);
+            false_positives++;
+        }
+        bench_samples_add(&bloom_miss, bench_now_ns() - t0);
+        lookup_result_free(&view);
+    }
+    if (filter.bits) {
+        res->bloom_bytes = (uint64_t)filter.block_count * BLOOM_BLOCK_BYTES;
+        res->bloom_estimated_fpr = bloom_estimated_fpr(&filter, keys.count);
+        res->bloom_observed_fpr = bloom_miss.count ? (double)false_positives / (double)bloom_miss.count : 0.0;
+    }
+    bloom_free(&filter);
+    bloom_keys_free(&keys);
+
+    started = bench_now_ns();
+    while (removed && pair_count > 0 &&
+           bench_should_continue(opt, started, removed_check.count, (size_t)opt->max_samples)) {
+        BenchPair *p = &pairs[bench_rand(&rng) % pair_count];
+        uint64_t t0 = bench_now_ns();
+        is_definition_removed(p->term, p->definition, removed);
+        bench_samples_add(&removed_check, bench_now_ns() - t0);
+    }
+
+    started = bench_now_ns();
+    while (table && bench_should_continue(opt, started, save.count, (size_t)opt->max_reps)) {
+        uint64_t t0 = bench_now_ns();
+        save_definitions(save_path, table);
+        bench_samples_add(&save, bench_now_ns() - t0);
+    }
+
+    if (table) {
+        uint64_t t0 = bench_now_ns();
+        free_hash_table(table);
+        bench_samples_add(&teardown, bench_now_ns() - t0);
+    }
+    free_hash_table(removed);
+
+    // The table a resident process keeps: definitions FSST-encoded, decoded
+    // only for the matches a lookup returns
+    BenchSamples compress, compressed_hit, decode;
+    bench_samples_init(&compress);
+    bench_samples_init(&compressed_hit);
+    bench_samples_init(&decode);
+    HashTable *compressed = NULL;
+    started = bench_now_ns();
+    while (bench_should_continue(opt, started, compress.count, (size_t)opt->max_reps)) {
+        free_hash_table(compressed);
+        size_t heap_before = mallinfo2().uordblks;
+        compressed = create_hash_table(opt->buckets);
+        if (!compressed) break;
+        load_definitions(dict_path, compressed);
+        uint64_t t0 = bench_now_ns();
+        int ok = hash_table_compress(compressed);
+        bench_samples_add(&compress, bench_now_ns() - t0);
+        size_t heap_after = mallinfo2().uordblks;
+        res->compressed_heap_bytes = heap_after > heap_before ? heap_after - heap_before : 0;
+        if (!ok) break;
+    }
+
+    started = bench_now_ns();
+    while (compressed && compressed->codec && terms.count > 0 &&
+           bench_should_continue(opt, started, compressed_hit.count, (size_t)opt->max_samples)) {
+        const char *term = terms.terms[bench_rand(&rng) % terms.count];
+        bench_apply_case(query, term, (int)(bench_rand(&rng) % 3));
+        LookupResult view;
+        lookup_result_init(&view);
+        uint64_t t0 = bench_now_ns();
+        hash_table_lookup_view(compressed, query, &view);
+        bench_samples_add(&compressed_hit, bench_now_ns() - t0);
+        lookup_result_free(&view);
+    }
+
+    // One definition per sample, walking the whole table so few are cached
+    double decoded_bytes = 0;
+    char decoded[1024];
+    int bucket = 0;
+    HashNode *node = NULL;
+    started = bench_now_ns();
+    while (compressed && compressed->codec && compressed->strings.unique > 0 &&
+           bench_should_continue(opt, started, decode.count, (size_t)opt->max_samples)) {
+        node = node ? node->next : NULL;
+        while (!node) node = compressed->table[bucket++ % compressed->size];
+        uint64_t t0 = bench_now_ns();
+        size_t len = fsst_decode(compressed->codec, node->value, decoded, sizeof(decoded));
+        bench_samples_add(&decode, bench_now_ns() - t0);
+        decoded_bytes += (double)len;
+    }
+    free_hash_table(compressed);
+
+    // One-shot lookups scanning the text file, as `wtf is` does without a block store
+    BenchSamples stream_hit, stream_miss;
+    bench_samples_init(&stream_hit);
+    bench_samples_init(&stream_miss);
+    StreamLookup stream;
+    stream_lookup_init(&stream, removed_path);
+    stream_lookup_add_file(&stream, dict_path);
+    started = bench_now_ns();
+    while (terms.count > 0 && bench_should_continue(opt, started, stream_hit.count, (size_t)opt->max_samples)) {
+        const char *term = terms.terms[bench_rand(&rng) % terms.count];
+        bench_apply_case(query, term, (int)(bench_rand(&rng) % 3));
+        LookupResult view;
+        lookup_result_init(&view);
+        uint64_t t0 = bench_now_ns();
+        stream_lookup_view(&stream, query, &view);
+        bench_samples_add(&stream_hit, bench_now_ns() - t0);
+        lookup_result_free(&view);
+    }
+    started = bench_now_ns();
+    while (bench_should_continue(opt, started, stream_miss.count, (size_t)opt->max_samples)) {
+        snprintf(query, sizeof(query), "miss_%llu", (unsigned long long)(bench_rand(&rng) % 1000000));
+        LookupResult view;
+        lookup_result_init(&view);
+        uint64_t t0 = bench_now_ns();
+        stream_lookup_view(&stream, query, &view);
+        bench_samples_add(&stream_miss, bench_now_ns() - t0);
+        lookup_result_free(&view);
+    }
+    stream_lookup_free(&stream);
+
+    // Block store: footprint, build time and what a single lookup pulls from disk
+    BenchSamples store_build, store_open, store_hit, store_miss;
+    bench_samples_init(&store_build);
+    bench_samples_init(&store_open);
+    bench_samples_init(&store_hit);
+    bench_samples_init(&store_miss);
+
+    started = bench_now_ns();
+    while (bench_should_continue(opt, started, store_build.count, (size_t)opt->max_reps)) {
+        uint64_t t0 = bench_now_ns();
+        if (!block_store_build_from_text(dict_path, store_path)) break;
+        bench_samples_add(&store_build, bench_now_ns() - t0);
+    }
+    res->store_bytes = bench_file_size(store_path);
+
+    BlockStore *store = NULL;
+    uint64_t open_bytes = 0;
+    started = bench_now_ns();
+    while (store_build.count > 0 &&
+           bench_should_continue(opt, started, store_open.count, (size_t)opt->max_samples)) {
+        block_store_close(store);
+        uint64_t t0 = bench_now_ns();
+        store = block_store_open(store_path);
+        bench_samples_add(&store_open, bench_now_ns() - t0);
+        if (!store) break;
+        open_bytes = store->bytes_read;
+    }
+    if (store) res->store_blocks = store->block_count;
+
+    uint64_t hit_bytes = 0, miss_bytes = 0;
+    started = bench_now_ns();
+    while (store && terms.count > 0 &&
+           bench_should_continue(opt, started, store_hit.count, (size_t)opt->max_samples)) {
+        const char *term = terms.terms[bench_rand(&rng) % terms.count];
+        bench_apply_case(query, term, (int)(bench_rand(&rng) % 3));
+        LookupResult view;
+        lookup_result_init(&view);
+        uint64_t before = store->bytes_read;
+        uint64_t t0 = bench_now_ns();
+        block_store_lookup_view(store, query, &view);
+        lookup_result_free(&view);
+        bench_samples_add(&store_hit, bench_now_ns() - t0);
+        hit_bytes += store->bytes_read - before;
+    }
+
+    started = bench_now_ns();
+    while (store && bench_should_continue(opt, started, store_miss.count, (size_t)opt->max_samples)) {
+        snprintf(query, sizeof(query), "miss_%llu", (unsigned long long)(bench_rand(&rng) % 1000000));
+        LookupResult view;
+        lookup_result_init(&view);
+        uint64_t before = store->bytes_read;
+        uint64_t t0 = bench_now_ns();
+        block_store_lookup_view(store, query, &view);
+        lookup_result_free(&view);
+        bench_samples_add(&store_miss, bench_now_ns() - t0);
+        miss_bytes += store->bytes_read - before;
+    }
+    block_store_close(store);
+    res->store_open_bytes = open_bytes;
+    res->store_hit_bytes = store_hit.count ? (double)hit_bytes / (double)store_hit.count : 0.0;
+    res->store_miss_bytes = store_miss.count ? (double)miss_bytes / (double)store_miss.count : 0.0;
+
+    // Case folding throughput: every term as generated (ASCII), then the same
+    // terms wrapped in accented and Greek capitals so the table path runs
+    BenchSamples fold_ascii, fold_utf8;
+    bench_samples_init(&fold_ascii);
+    bench_samples_init(&fold_utf8);
+    double ascii_bytes = 0, utf8_bytes = 0;
+    char (*wrapped)[CASEFOLD_SIZE(256)] = terms.count ? malloc(terms.count * sizeof(*wrapped)) : NULL;
+    for (size_t t = 0; wrapped && t < terms.count; t++) {
+        snprintf(wrapped[t], sizeof(wrapped[t]), "\xc3\x84%.200s\xce\xa3\xce\xa5\xce\x9d", terms.terms[t]);
+        ascii_bytes += (double)strlen(terms.terms[t]);
+        utf8_bytes += (double)strlen(wrapped[t]);
+    }
+    char folded[CASEFOLD_SIZE(256)];
+    started = bench_now_ns();
+    while (wrapped && bench_should_continue(opt, started, fold_ascii.count, (size_t)opt->max_reps)) {
+        uint64_t t0 = bench_now_ns();
+        for (size_t t = 0; t < terms.count; t++) casefold(terms.terms[t], folded, sizeof(folded));
+        bench_samples_add(&fold_ascii, bench_now_ns() - t0);
+    }
+    started = bench_now_ns();
+    while (wrapped && bench_should_continue(opt, started, fold_utf8.count, (size_t)opt->max_reps)) {
+        uint64_t t0 = bench_now_ns();
+        for (size_t t = 0; t < terms.count; t++) casefold(wrapped[t], folded, sizeof(folded));
+        bench_samples_add(&fold_utf8, bench_now_ns() - t0);
+    }
+    free(wrapped);
+
+    res->peak_rss_kb = bench_peak_rss_kb();
+
+    double file_bytes = res->file_bytes > 0 ? (double)res->file_bytes : 0.0;
+    bench_op_result(&res->ops[res->op_count++], "load_definitions", &load, file_bytes);
+    bench_op_result(&res->ops[res->op_count++], "hash_table_lookup_all_hit", &hit, 0);
+    bench_op_result(&res->ops[res->op_count++], "hash_table_lookup_view_hit", &view_hit, 0);
+    bench_op_result(&res->ops[res->op_count++], "hash_table_lookup_all_miss", &miss, 0);
+    bench_op_result(&res->ops[res->op_count++], "bloom_build", &bloom_build_samples, 0);
+    bench_op_result(&res->ops[res->op_count++], "bloom_lookup_miss", &bloom_miss, 0);
+    bench_op_result(&res->ops[res->op_count++], "is_definition_removed", &removed_check, 0);
+    bench_op_result(&res->ops[res->op_count++], "save_definitions", &save, file_bytes);
+    bench_op_result(&res->ops[res->op_count++], "teardown", &teardown, 0);
+    bench_op_result(&res->ops[res->op_count++], "hash_table_compress", &compress, 0);
+    bench_op_result(&res->ops[res->op_count++], "hash_table_lookup_view_hit_compressed", &compressed_hit, 0);
+    bench_op_result(&res->ops[res->op_count++], "fsst_decode", &decode,
+                    decode.count ? decoded_bytes / (double)decode.count : 0.0);
+    bench_op_result(&res->ops[res->op_count++], "block_store_build", &store_build,
+                    res->store_bytes > 0 ? (double)res->store_bytes : 0.0);
+    bench_op_result(&res->ops[res->op_count++], "block_store_open", &store_open, (double)open_bytes);
+    bench_op_result(&res->ops[res->op_count++], "block_store_lookup_hit", &store_hit, res->store_hit_bytes);
+    bench_op_result(&res->ops[res->op_count++], "block_store_lookup_miss", &store_miss, res->store_miss_bytes);
+    bench_op_result(&res->ops[res->op_count++], "stream_lookup_hit", &stream_hit, file_bytes);
+    bench_op_result(&res->ops[res->op_count++], "stream_lookup_miss", &stream_miss, file_bytes);
+    bench_op_result(&res->ops[res->op_count++], "casefold_ascii", &fold_ascii, ascii_bytes);
+    bench_op_result(&res->ops[res->op_count++], "casefold_utf8", &fold_utf8, utf8_bytes);
+
+    bench_samples_free(&load);
+    bench_samples_free(&teardown);
+    bench_samples_free(&compress);
+    bench_samples_free(&compressed_hit);
+    bench_samples_free(&decode);
+    bench_samples_free(&hit);
+    bench_samples_free(&view_hit);
+    bench_samples_free(&miss);
+    bench_samples_free(&bloom_build_samples);
+    bench_samples_free(&bloom_miss);
+    bench_samples_free(&removed_check);
+    bench_samples_free(&save);
+    bench_samples_free(&store_build);
+    bench_samples_free(&store_open);
+    bench_samples_free(&store_hit);
+    bench_samples_free(&store_miss);
+    bench_samples_free(&stream_hit);
+    bench_samples_free(&stream_miss);
+    bench_samples_free(&fold_ascii);
+    bench_samples_free(&fold_utf8);
+    for (size_t i = 0; i < pair_count; i++) {
+        free(pairs[i].term);
+        free(pairs[i].definition);
+    }
+    free(pairs);
+    bench_term_set_free(&terms);
+
+    unlink(dict_path);
+    unlink(removed_path);
+    unlink(save_path);
+    unlink(store_path);
+    // and the indexes written beside the store
+    char index_path[600];
+    if (block_store_trigram_path(store_path, index_path, sizeof(index_path))) unlink(index_path);
+    if (block_store_phonetic_path(store_path, index_path, sizeof(index_path))) unlink(index_path);
+}
+
+// Each size runs in its own child so peak RSS is not inherited from larger runs
+int bench_suite_core(const BenchOptions *opt, BenchJson *j) {
+    bench_json_begin_array(j, "results");
+    for (int i = 0; i < opt->size_count; i++) {
+        int fds[2];
+        if (pipe(fds) != 0) return 0;
+
+        pid_t pid = fork();
+        if (pid < 0) return 0;
+        if (pid == 0) {
+            CoreSizeResult res;
+            close(fds[0]);
+            run_core_size(opt, opt->sizes[i], &res);
+            ssize_t n = write(fds[1], &res, sizeof(res));
+            close(fds[1]);
+            _exit(n == (ssize_t)sizeof(res) ? 0 : 1);
+        }
+
+        close(fds[1]);
+        CoreSizeResult res;
+        ssize_t got = 0;
+        while (got < (ssize_t)sizeof(res)) {
+            ssize_t n = read(fds[0], (char *)&res + got, sizeof(res) - (size_t)got);
+            if (n <= 0) break;
+            got += n;
+        }
+        close(fds[0]);
+        waitpid(pid, NULL, 0);
+        if (got != (ssize_t)sizeof(res)) {
+            fprintf(stderr, "bench: run for %zu entries failed\n", opt->sizes[i]);
+            continue;
+        }
+
+        bench_json_begin_object(j, NULL);
+        bench_json_uint(j, "entries", res.entries);
+        bench_json_uint(j, "terms", res.terms);
+        bench_json_uint(j, "file_bytes", (uint64_t)(res.file_bytes > 0 ? res.file_bytes : 0));
+        bench_json_uint(j, "store_bytes", (uint64_t)(res.store_bytes > 0 ? res.store_bytes : 0));
+        bench_json_uint(j, "store_blocks", res.store_blocks);
+        bench_json_uint(j, "store_open_bytes", res.store_open_bytes);
+        bench_json_number(j, "store_hit_bytes_per_lookup", res.store_hit_bytes);
+        bench_json_number(j, "store_miss_bytes_per_lookup", res.store_miss_bytes);
+        bench_json_uint(j, "bloom_bytes", res.bloom_bytes);
+        bench_json_number(j, "bloom_estimated_fpr", res.bloom_estimated_fpr);
+        bench_json_number(j, "bloom_observed_fpr", res.bloom_observed_fpr);
+        bench_json_uint(j, "table_heap_bytes", res.table_heap_bytes);
+        bench_json_uint(j, "intern_strings", res.intern_strings);
+        bench_json_uint(j, "intern_unique", res.intern_unique);
+        bench_json_uint(j, "intern_bytes_in", res.intern_bytes_in);
+        bench_json_uint(j, "intern_bytes_stored", res.intern_bytes_stored);
+        bench_json_uint(j, "intern_bytes_saved", res.intern_bytes_in - res.intern_bytes_stored);
+        bench_json_uint(j, "compressed_table_heap_bytes", res.compressed_heap_bytes);
+        bench_json_number(j, "table_bytes_per_entry", res.entries ? (double)res.table_heap_bytes / (double)res.entries : 0.0);
+        bench_json_number(j, "compressed_table_bytes_per_entry",
+                          res.entries ? (double)res.compressed_heap_bytes / (double)res.entries : 0.0);
+        bench_json_uint(j, "peak_rss_kb", (uint64_t)(res.peak_rss_kb > 0 ? res.peak_rss_kb : 0));
+        bench_json_begin_object(j, "ops");
+        for (int k = 0; k < res.op_count; k++) {
+            bench_json_op(j, &res.ops[k]);
+        }
+        bench_json_end_object(j);
+        bench_json_end_object(j);
+        fflush(j->out);
+    }
+    bench_json_end_array(j);
+    return 1;
+}
+
+static void write_config(BenchJson *j, const BenchOptions *opt) {
+    bench_json_begin_object(j, "config");
+    bench_json_uint(j, "term_len", (uint64_t)opt->dict.term_len);
+    bench_json_uint(j, "def_len", (uint64_t)opt->dict.def_len);
+    bench_json_uint(j, "defs_per_term", (uint64_t)opt->dict.defs_per_term);
+    bench_json_number(j, "variant_rate", opt->dict.variant_rate);
+    bench_json_number(j, "shared_def_rate", opt->dict.shared_def_rate);
+    bench_json_number(j, "case_lower", opt->dict.case_lower);
+    bench_json_number(j, "case_title", opt->dict.case_title);
+    bench_json_number(j, "case_upper", opt->dict.case_upper);
+    bench_json_uint(j, "buckets", (uint64_t)opt->buckets);
+    bench_json_uint(j, "seed", opt->dict.seed);
+    bench_json_end_object(j);
+}
+
+int main(int argc, char *argv[]) {
+    BenchOptions opt;
+    memset(&opt, 0, sizeof(opt));
+    bench_dict_config_defaults(&opt.dict);
+    opt.buckets = 100;
+    opt.max_samples = 1000;
+    opt.max_reps = 5;
+    opt.budget_ms = 1000;
+    opt.tmpdir = "/tmp";
+    opt.args = "--version";
+    opt.writers = 64;
+    parse_sizes("10000,100000,1000000", &opt);
+
+    const char *suite = "core";
+    const char *out_path = NULL;
+    if (argc > 1 && argv[1][0] != '-') {
+        suite = argv[1];
+        argv++;
+        argc--;
+    }
+
+    static const struct option long_opts[] = {
+        {"sizes", required_argument, 0, 's'},
+        {"entries", required_argument, 0, 'e'},
+        {"term-len", required_argument, 0, 't'},
+        {"def-len", required_argument, 0, 'd'},
+        {"defs-per-term", required_argument, 0, 'p'},
+        {"variant-rate", required_argument, 0, 'v'},
+        {"shared-def-rate", required_argument, 0, 'D'},
+        {"case-mix", required_argument, 0, 'c'},
+        {"buckets", required_argument, 0, 'b'},
+        {"samples", required_argument, 0, 'n'},
+        {"reps", required_argument, 0, 'r'},
+        {"budget-ms", required_argument, 0, 'm'},
+        {"seed", required_argument, 0, 'S'},
+        {"tmpdir", required_argument, 0, 'T'},
+        {"out", required_argument, 0, 'o'},
+        {"binary", required_argument, 0, 'B'},
+        {"baseline", required_argument, 0, 'L'},
+        {"args", required_argument, 0, 'A'},
+        {"writers", required_argument, 0, 'W'},
+        {"help", no_argument, 0, 'h'},
+        {0, 0, 0, 0}
+    };
+
+    int c;
+    while ((c = getopt_long(argc, argv, "h", long_opts, NULL)) != -1) {
+        switch (c) {
+            case 's':
+                if (!parse_sizes(optarg, &opt)) {
+                    fprintf(stderr, "bench: invalid --sizes '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'e': opt.dict.entries = (size_t)strtoull(optarg, NULL, 10); break;
+            case 't': opt.dict.term_len = atoi(optarg); break;
+            case 'd': opt.dict.def_len = atoi(optarg); break;
+            case 'p': opt.dict.defs_per_term = atoi(optarg); break;
+            case 'v': opt.dict.variant_rate = atof(optarg); break;
+            case 'D': opt.dict.shared_def_rate = atof(optarg); break;
+            case 'c':
+                if (!parse_case_mix(optarg, &opt.dict)) {
+                    fprintf(stderr, "bench: invalid --case-mix '%s'\n", optarg);
+                    return 2;
+                }
+                break;
+            case 'b': opt.buckets = atoi(optarg) > 0 ? atoi(optarg) : 100; break;
+            case 'n': opt.max_samples = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+            case 'r': opt.max_reps = atoi(optarg) > 0 ? atoi(optarg) : 1; break;
+            case 'm': opt.budget_ms = atoi(optarg); break;
+            case 'S': opt.dict.seed = strtoull(optarg, NULL, 0); break;
+            case 'T': opt.tmpdir = optarg; break;
+            case 'o': out_path = optarg; break;
+            case 'B': opt.binary = optarg; break;
+            case 'L': opt.baseline = optarg; break;
+            case 'A': opt.args = optarg; break;
+            case 'W': opt.writers = atoi(optarg); break;
+            case 'h':
+            default:
+                usage(argv[0]);
+                return c == 'h' ? 0 : 2;
+        }
+    }
+
+    if (strcmp(suite, "gen") == 0) {
+        if (!out_path) {
+            fprintf(stderr, "bench: gen needs --out FILE\n");
+            return 2;
+        }
+        return bench_generate_dictionary(out_path, &opt.dict, NULL) ? 0 : 1;
+    }
+
+    FILE *out = stdout;
+    if (out_path) {
+        out = fopen(out_path, "w");
+        if (!out) {
+            perror(out_path);
+            return 1;
+        }
+    }
+
+    BenchJson j;
+    bench_json_init(&j, out);
+    bench_json_begin_object(&j, NULL);
+    bench_json_string(&j, "suite", suite);
+    bench_json_string(&j, "wtf_version", WTF_VERSION);
+    bench_json_uint(&j, "timestamp", (uint64_t)time(NULL));
+    write_config(&j, &opt);
+
+    int ok;
+    if (strcmp(suite, "core") == 0) {
+        ok = bench_suite_core(&opt, &j);
+    } else if (strcmp(suite, "startup") == 0) {
+        ok = bench_suite_startup(&opt, &j);
+    } else if (strcmp(suite, "find") == 0) {
+        ok = bench_suite_find(&opt, &j);
+    } else if (strcmp(suite, "phonetic") == 0) {
+        ok = bench_suite_phonetic(&opt, &j);
+    } else if (strcmp(suite, "writers") == 0) {
+        ok = bench_suite_writers(&opt, &j);
+    } else if (strcmp(suite, "sync") == 0) {
+        ok = bench_suite_sync(&opt, &j);
+    } else if (strcmp(suite, "ratelimit") == 0) {
+        ok = bench_suite_ratelimit(&opt, &j);
+    } else if (strcmp(suite, "resume") == 0) {
+        ok = bench_suite_resume(&opt, &j);
+    } else if (strcmp(suite, "codecs") == 0) {
+        ok = bench_suite_codecs(&opt, &j);
+    } else if (strcmp(suite, "netsync") == 0) {
+        ok = bench_suite_netsync(&opt, &j);
+    } else {
+        fprintf(stderr, "bench: unknown suite '%s'\n", suite);
+        ok = 0;
+    }
+
+    bench_json_end_object(&j);
+    if (out != stdout) fclose(out);
+    return ok ? 0 : 1;
+}
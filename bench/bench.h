@@ -0,0 +1,180 @@
+#ifndef WTF_BENCH_H
+#define WTF_BENCH_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/types.h>
+
+// Collected latency samples for a single operation (nanoseconds)
+typedef struct {
+    uint64_t *ns;
+    size_t count;
+    size_t capacity;
+} BenchSamples;
+
+// Knobs for the synthetic dictionary generator
+typedef struct {
+    size_t entries;          // total term:definition lines to write
+    int term_len;            // average term length in characters
+    int def_len;             // average definition length in characters
+    int defs_per_term;       // definitions written per distinct term
+    double variant_rate;     // probability a term also appears in another case
+    double shared_def_rate;  // probability a definition is one of a few stock ones
+    double case_lower;       // weights for the case of the primary key
+    double case_title;
+    double case_upper;
+    uint64_t seed;
+} BenchDictConfig;
+
+// Distinct terms written by the generator, kept for building queries
+typedef struct {
+    char **terms;
+    size_t count;
+    size_t capacity;
+} BenchTermSet;
+
+// Minimal streaming JSON writer
+typedef struct {
+    FILE *out;
+    int depth;
+    int need_comma[32];
+} BenchJson;
+
+// Summary of one timed operation, small enough to pass through a pipe
+typedef struct {
+    char name[40];
+    uint64_t samples;
+    uint64_t p50_ns;
+    uint64_t p99_ns;
+    double mean_ns;
+    double bytes_per_op;
+} BenchOpResult;
+
+#define BENCH_MAX_SIZES 16
+
+// Command line options shared by every suite
+typedef struct {
+    size_t sizes[BENCH_MAX_SIZES];
+    int size_count;
+    BenchDictConfig dict;
+    int buckets;             // hash table size, main() uses 100
+    int max_samples;         // upper bound on samples per lookup-style op
+    int max_reps;            // upper bound on repetitions of load/save
+    int budget_ms;           // time budget per op before sampling stops
+    const char *tmpdir;
+    const char *binary;      // wtf binaries exec'd by the process-level suites
+    const char *baseline;
+    const char *args;        // arguments passed to them, space separated
+    int writers;             // concurrent processes in the writers suite
+} BenchOptions;
+
+// What the stand-in HTTP server has answered, shared with the process that started it
+typedef struct {
+    uint64_t probes;         // connectivity probes (HEAD /)
+    uint64_t api_requests;   // contents API requests, refused ones included
+    uint64_t rate_limited;   // refused with 403 and X-RateLimit-Remaining: 0
+    uint64_t errors;         // answered with error_status
+    uint64_t downloads;      // dictionary downloads
+    uint64_t bytes_sent;     // download body bytes
+    uint64_t ranges;         // downloads answered 206 from a Range request
+    uint64_t dropped;        // downloads cut off after drop_after bytes
+    uint64_t fallbacks;      // downloads sent gzip because encoding was not accepted
+} BenchHttpCounters;
+
+// A stand-in for api.github.com and raw.githubusercontent.com
+typedef struct {
+    const char *body;        // the definitions.txt served
+    size_t body_len;
+    char sha[41];            // blob id the API reports; "" for body's own
+    int rate_limit;          // API requests per window, 0 for no limit
+    int rate_window;         // window length in seconds
+    int error_status;        // answer API requests with this status instead, 0 for none
+    size_t drop_after;       // close download connections after this many body bytes...
+    int drops;               // ...this many times
+    int ignore_range;        // answer Range requests with the whole body
+    const char *encoding;    // download Content-Encoding for clients accepting it, NULL for gzip
+    int chunked;             // send the download with Transfer-Encoding: chunked
+    int latency_ms;          // delay before answering each request
+    double bandwidth;        // download bytes per second, 0 for no limit
+} BenchHttpConfig;
+
+typedef struct {
+    pid_t pid;
+    int port;
+    char api_base[64];       // for WTF_API_BASE
+    char raw_base[64];       // for WTF_RAW_BASE
+    BenchHttpCounters *counters;
+} BenchHttpServer;
+
+// One wtf process started by bench_run_wtf()
+typedef struct {
+    const char *trace;       // WTF_TRACE file for the run, NULL for none
+    uint64_t wall_ns;
+    uint64_t cpu_ns;         // user + system
+    long peak_rss_kb;
+} BenchRun;
+
+// Timing and memory
+uint64_t bench_now_ns(void);
+long bench_peak_rss_kb(void);
+
+// Samples
+void bench_samples_init(BenchSamples *s);
+void bench_samples_add(BenchSamples *s, uint64_t ns);
+uint64_t bench_samples_percentile(BenchSamples *s, double pct);
+double bench_samples_mean(const BenchSamples *s);
+void bench_samples_free(BenchSamples *s);
+
+// Random numbers (xorshift64*)
+uint64_t bench_rand(uint64_t *state);
+double bench_rand_unit(uint64_t *state);
+
+// Synthetic dictionaries
+void bench_dict_config_defaults(BenchDictConfig *cfg);
+int bench_generate_dictionary(const char *path, const BenchDictConfig *cfg, BenchTermSet *terms);
+void bench_term_set_free(BenchTermSet *set);
+void bench_apply_case(char *dst, const char *src, int variant);
+long bench_file_size(const char *path);
+
+// JSON output
+void bench_json_init(BenchJson *j, FILE *out);
+void bench_json_begin_object(BenchJson *j, const char *key);
+void bench_json_end_object(BenchJson *j);
+void bench_json_begin_array(BenchJson *j, const char *key);
+void bench_json_end_array(BenchJson *j);
+void bench_json_number(BenchJson *j, const char *key, double value);
+void bench_json_uint(BenchJson *j, const char *key, uint64_t value);
+void bench_json_string(BenchJson *j, const char *key, const char *value);
+void bench_json_samples(BenchJson *j, const char *key, BenchSamples *s, double bytes_per_op);
+void bench_op_result(BenchOpResult *r, const char *name, BenchSamples *s, double bytes_per_op);
+void bench_json_op(BenchJson *j, const BenchOpResult *r);
+
+// Stand-in HTTP server, run in a child process
+int bench_http_start(BenchHttpServer *server, const BenchHttpConfig *config);
+void bench_http_stop(BenchHttpServer *server);
+unsigned char *bench_gzip(const char *body, size_t len, size_t *out_len);
+unsigned char *bench_encode(const char *encoding, const char *body, size_t len, size_t *out_len);
+
+// Throwaway homes for the suites that run wtf against the stand-in
+int bench_host_create(const char *home);
+void bench_host_remove(const char *home);
+int bench_run_wtf(const char *binary, const char *home, const BenchHttpServer *server,
+                  const char *const args[], BenchRun *run);
+
+// Sampling loop helper: keep going while under budget and sample cap
+int bench_should_continue(const BenchOptions *opt, uint64_t started_ns, size_t samples, size_t cap);
+
+// Suites
+int bench_suite_core(const BenchOptions *opt, BenchJson *j);
+int bench_suite_startup(const BenchOptions *opt, BenchJson *j);
+int bench_suite_find(const BenchOptions *opt, BenchJson *j);
+int bench_suite_phonetic(const BenchOptions *opt, BenchJson *j);
+int bench_suite_writers(const BenchOptions *opt, BenchJson *j);
+int bench_suite_sync(const BenchOptions *opt, BenchJson *j);
+int bench_suite_ratelimit(const BenchOptions *opt, BenchJson *j);
+int bench_suite_resume(const BenchOptions *opt, BenchJson *j);
+int bench_suite_codecs(const BenchOptions *opt, BenchJson *j);
+int bench_suite_netsync(const BenchOptions *opt, BenchJson *j);
+
+#endif
@@ -0,0 +1,166 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "content_decoder.h"
+#include "network_sync.h"
+
+#define CODEC_CHUNK (16 * 1024)   // what curl typically hands the write callback
+#define CODEC_SYNC_RUNS 3
+
+static const char *const encodings[] = {"identity", "gzip", "zstd", "br"};
+#define ENCODING_COUNT (int)(sizeof(encodings) / sizeof(encodings[0]))
+
+static uint64_t cpu_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static int count_decoded(void *arg, const char *data, size_t len) {
+    (void)data;
+    *(size_t *)arg += len;
+    return 1;
+}
+
+// Decode body in CODEC_CHUNK pieces, as it would arrive; returns the bytes out
+static size_t decode_all(const char *encoding, const unsigned char *body, size_t len) {
+    ContentDecoder decoder;
+    if (!content_decoder_init(&decoder, encoding)) return 0;
+    size_t out = 0;
+    for (size_t off = 0; off < len; off += CODEC_CHUNK) {
+        size_t n = len - off < CODEC_CHUNK ? len - off : CODEC_CHUNK;
+        if (!content_decoder_feed(&decoder, body + off, n, count_decoded, &out)) {
+            out = 0;
+            break;
+        }
+    }
+    // A plain body has no end marker to check
+    if (!decoder.done && decoder.kind != DECODER_IDENTITY) out = 0;
+    content_decoder_free(&decoder);
+    return out;
+}
+
+static const char *const sync_args[] = {"sync", "--force", NULL};
+
+// `wtf sync --force` against a stand-in serving encoding, CODEC_SYNC_RUNS times
+static int run_syncs(const BenchOptions *opt, BenchJson *j, const char *encoding, const char *dir,
+                     const char *dict, size_t dict_len) {
+    BenchHttpConfig config;
+    memset(&config, 0, sizeof(config));
+    config.body = dict;
+    config.body_len = dict_len;
+    config.encoding = encoding;
+    BenchHttpServer server;
+    if (!bench_http_start(&server, &config)) return 0;
+
+    char home[600], wtf_dir[700];
+    snprintf(home, sizeof(home), "%s/host", dir);
+    snprintf(wtf_dir, sizeof(wtf_dir), "%s/.wtf", home);
+    BenchSamples wall, cpu;
+    bench_samples_init(&wall);
+    bench_samples_init(&cpu);
+    int ok = 1;
+    for (int i = 0; ok && i < CODEC_SYNC_RUNS; i++) {
+        BenchRun run = {0};
+        ok = bench_host_create(home) && bench_run_wtf(opt->binary, home, &server, sync_args, &run);
+        SyncMetadata metadata;
+        load_sync_metadata(wtf_dir, &metadata);
+        ok = ok && metadata.last_sha[0];
+        bench_host_remove(home);
+        if (ok) {
+            bench_samples_add(&wall, run.wall_ns);
+            bench_samples_add(&cpu, run.cpu_ns);
+        }
+    }
+    BenchHttpCounters served = *server.counters;
+    bench_http_stop(&server);
+
+    if (ok) {
+        // A binary built without this decoder does not ask for it
+        bench_json_string(j, "served", served.fallbacks ? "gzip" : encoding);
+        bench_json_uint(j, "sync_bytes_sent", served.bytes_sent / CODEC_SYNC_RUNS);
+        bench_json_samples(j, "sync_wall", &wall, 0);
+        bench_json_samples(j, "sync_cpu", &cpu, 0);
+    }
+    bench_samples_free(&wall);
+    bench_samples_free(&cpu);
+    return ok;
+}
+
+// Per size (dictionary entries), per Content-Encoding: the transfer size, the
+// CPU time to decode it in 16 KB chunks through the sync pipeline's decoders,
+// and with --binary, whole `wtf sync --force` runs against a stand-in serving
+// that encoding
+int bench_suite_codecs(const BenchOptions *opt, BenchJson *j) {
+    char dir[512], dict_path[600];
+    snprintf(dir, sizeof(dir), "%s/wtf_bench_codecs_%d", opt->tmpdir, (int)getpid());
+    if (mkdir(dir, 0755) != 0) return 0;
+
+    int ok = 1;
+    bench_json_begin_array(j, "results");
+    for (int i = 0; ok && i < opt->size_count; i++) {
+        BenchDictConfig cfg = opt->dict;
+        cfg.entries = opt->sizes[i];
+        snprintf(dict_path, sizeof(dict_path), "%s/definitions.txt", dir);
+        long dict_len = bench_generate_dictionary(dict_path, &cfg, NULL) ? bench_file_size(dict_path) : -1;
+        char *dict = dict_len > 0 ? malloc((size_t)dict_len) : NULL;
+        FILE *f = dict ? fopen(dict_path, "r") : NULL;
+        ok = f && fread(dict, 1, (size_t)dict_len, f) == (size_t)dict_len;
+        if (f) fclose(f);
+        unlink(dict_path);
+
+        bench_json_begin_object(j, NULL);
+        bench_json_uint(j, "entries", (uint64_t)opt->sizes[i]);
+        bench_json_uint(j, "body_bytes", (uint64_t)(dict_len > 0 ? dict_len : 0));
+        for (int e = 0; ok && e < ENCODING_COUNT; e++) {
+            const char *encoding = encodings[e];
+            bench_json_begin_object(j, encoding);
+            size_t encoded_len = 0;
+            uint64_t t0 = cpu_now_ns();
+            unsigned char *encoded = bench_encode(encoding, dict, (size_t)dict_len, &encoded_len);
+            uint64_t encode_ns = cpu_now_ns() - t0;
+            ContentDecoder probe;
+            int decodable = content_decoder_init(&probe, encoding);
+            content_decoder_free(&probe);
+            if (!encoded || !decodable) {
+                // Built without this codec's library
+                bench_json_uint(j, "available", 0);
+                bench_json_end_object(j);
+                free(encoded);
+                continue;
+            }
+            bench_json_uint(j, "available", 1);
+            bench_json_uint(j, "transfer_bytes", encoded_len);
+            bench_json_number(j, "ratio", (double)dict_len / (double)encoded_len);
+            bench_json_number(j, "encode_cpu_ms", (double)encode_ns / 1e6);
+
+            BenchSamples decode;
+            bench_samples_init(&decode);
+            uint64_t started = bench_now_ns();
+            while (ok && bench_should_continue(opt, started, decode.count, (size_t)opt->max_reps)) {
+                uint64_t c0 = cpu_now_ns();
+                ok = decode_all(encoding, encoded, encoded_len) == (size_t)dict_len;
+                bench_samples_add(&decode, cpu_now_ns() - c0);
+            }
+            if (ok) {
+                bench_json_samples(j, "decode_cpu", &decode, 0);
+                bench_json_number(j, "decode_mb_per_cpu_s",
+                                  (double)dict_len / 1e6 / ((double)bench_samples_percentile(&decode, 50) / 1e9));
+            }
+            bench_samples_free(&decode);
+            free(encoded);
+            if (ok && opt->binary) ok = run_syncs(opt, j, encoding, dir, dict, (size_t)dict_len);
+            bench_json_end_object(j);
+        }
+        bench_json_end_object(j);
+        free(dict);
+    }
+    bench_json_end_array(j);
+
+    rmdir(dir);
+    return ok;
+}
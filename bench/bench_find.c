@@ -0,0 +1,193 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include "bench.h"
+#include "trigram.h"
+
+#define FIND_MAX_THREADS 64
+#define FIND_QUERIES 64
+
+// One slice of the brute-force scan
+typedef struct {
+    const TrigramIndex *index;
+    const char *glob;
+    uint32_t first;
+    uint32_t last;
+    size_t matches;
+} ScanSlice;
+
+static void *scan_slice(void *arg) {
+    ScanSlice *slice = arg;
+    for (uint32_t id = slice->first; id < slice->last; id++) {
+        if (trigram_glob_match(slice->glob, trigram_index_term(slice->index, id))) slice->matches++;
+    }
+    return NULL;
+}
+
+// The baseline: match pattern against every term, split across threads
+static size_t parallel_scan(const TrigramIndex *index, const char *pattern, int threads) {
+    char glob[512];
+    if (!trigram_pattern_normalize(pattern, glob, sizeof(glob))) return 0;
+
+    pthread_t ids[FIND_MAX_THREADS];
+    int created[FIND_MAX_THREADS] = {0};
+    ScanSlice slices[FIND_MAX_THREADS];
+    uint32_t per = index->term_count / (uint32_t)threads + 1;
+    for (int t = 0; t < threads; t++) {
+        uint32_t first = per * (uint32_t)t;
+        slices[t] = (ScanSlice){index, glob, first < index->term_count ? first : index->term_count, 0, 0};
+        slices[t].last = first + per < index->term_count ? first + per : index->term_count;
+        if (t > 0) created[t] = pthread_create(&ids[t], NULL, scan_slice, &slices[t]) == 0;
+    }
+    scan_slice(&slices[0]);
+
+    size_t total = slices[0].matches;
+    for (int t = 1; t < threads; t++) {
+        if (created[t]) {
+            pthread_join(ids[t], NULL);
+        } else {
+            scan_slice(&slices[t]);
+        }
+        total += slices[t].matches;
+    }
+    return total;
+}
+
+static size_t index_search(const TrigramIndex *index, const char *pattern) {
+    TrigramMatches matches = {0};
+    int found = trigram_index_search(index, pattern, &matches);
+    trigram_matches_free(&matches);
+    return found > 0 ? (size_t)found : 0;
+}
+
+// Substrings of real terms (3-5 characters, mostly hits) and globs built from
+// a term's ends, e.g. "abc*x9z"; both have a 3-character run for the index
+static void make_queries(const TrigramIndex *index, char substrings[][16], char globs[][16], uint64_t *rng) {
+    for (int q = 0; q < FIND_QUERIES; q++) {
+        const char *term = trigram_index_term(index, (uint32_t)(bench_rand(rng) % index->term_count));
+        size_t len = strlen(term);
+        size_t want = 3 + (size_t)(bench_rand(rng) % 3);
+        if (want > len) want = len;
+        size_t start = len > want ? (size_t)(bench_rand(rng) % (len - want + 1)) : 0;
+        snprintf(substrings[q], 16, "%.*s", (int)want, term + start);
+        if (len >= 6) {
+            snprintf(globs[q], 16, "%.3s*%s", term, term + len - 3);
+        } else {
+            snprintf(globs[q], 16, "%s*", term);
+        }
+    }
+}
+
+typedef struct {
+    const char *name;
+    int indexed;
+    int glob;
+} FindOp;
+
+// Per size: build the index over `size` generated terms, then time each query
+// set through the index and through a parallel scan of every term
+int bench_suite_find(const BenchOptions *opt, BenchJson *j) {
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    int threads = cpus < 1 ? 1 : (cpus > FIND_MAX_THREADS ? FIND_MAX_THREADS : (int)cpus);
+
+    bench_json_uint(j, "threads", (uint64_t)threads);
+    bench_json_begin_array(j, "results");
+    for (int i = 0; i < opt->size_count; i++) {
+        char dict_path[512];
+        snprintf(dict_path, sizeof(dict_path), "%s/wtf_bench_find_%d.txt", opt->tmpdir, (int)getpid());
+        BenchDictConfig cfg = opt->dict;
+        cfg.entries = opt->sizes[i];
+        cfg.defs_per_term = 1;
+        BenchTermSet terms = {0};
+        if (!bench_generate_dictionary(dict_path, &cfg, &terms)) {
+            fprintf(stderr, "bench: could not write %s\n", dict_path);
+            bench_term_set_free(&terms);
+            return 0;
+        }
+        unlink(dict_path);
+
+        BenchSamples build;
+        bench_samples_init(&build);
+        TrigramIndex *index = NULL;
+        uint64_t started = bench_now_ns();
+        while (bench_should_continue(opt, started, build.count, (size_t)opt->max_reps)) {
+            TrigramBuilder builder;
+            trigram_builder_init(&builder);
+            uint64_t t0 = bench_now_ns();
+            for (size_t t = 0; t < terms.count; t++) trigram_builder_add(&builder, terms.terms[t]);
+            TrigramIndex *built = trigram_builder_build(&builder);
+            bench_samples_add(&build, bench_now_ns() - t0);
+            trigram_builder_free(&builder);
+            trigram_index_free(index);
+            index = built;
+        }
+        bench_term_set_free(&terms);
+        if (!index || index->term_count == 0) {
+            fprintf(stderr, "bench: could not build the trigram index for %zu terms\n", opt->sizes[i]);
+            trigram_index_free(index);
+            bench_samples_free(&build);
+            return 0;
+        }
+
+        static char substrings[FIND_QUERIES][16], globs[FIND_QUERIES][16];
+        uint64_t rng = opt->dict.seed ? opt->dict.seed : 1;
+        make_queries(index, substrings, globs, &rng);
+
+        // Both paths must agree before their timings mean anything
+        uint64_t mismatches = 0, matched = 0;
+        for (int q = 0; q < FIND_QUERIES; q++) {
+            size_t a = index_search(index, substrings[q]);
+            size_t b = index_search(index, globs[q]);
+            mismatches += (a != parallel_scan(index, substrings[q], threads));
+            mismatches += (b != parallel_scan(index, globs[q], threads));
+            matched += a + b;
+        }
+
+        static const FindOp ops[] = {
+            {"index_substring", 1, 0},
+            {"scan_substring", 0, 0},
+            {"index_glob", 1, 1},
+            {"scan_glob", 0, 1},
+        };
+        BenchOpResult results[5];
+        bench_op_result(&results[0], "trigram_build", &build, 0);
+        bench_samples_free(&build);
+        for (int o = 0; o < 4; o++) {
+            BenchSamples s;
+            bench_samples_init(&s);
+            started = bench_now_ns();
+            for (int q = 0; bench_should_continue(opt, started, s.count, (size_t)opt->max_samples); q++) {
+                const char *pattern = ops[o].glob ? globs[q % FIND_QUERIES] : substrings[q % FIND_QUERIES];
+                uint64_t t0 = bench_now_ns();
+                if (ops[o].indexed) {
+                    index_search(index, pattern);
+                } else {
+                    parallel_scan(index, pattern, threads);
+                }
+                bench_samples_add(&s, bench_now_ns() - t0);
+            }
+            bench_op_result(&results[o + 1], ops[o].name, &s, 0);
+            bench_samples_free(&s);
+        }
+
+        bench_json_begin_object(j, NULL);
+        bench_json_uint(j, "terms", index->term_count);
+        bench_json_uint(j, "trigrams", index->gram_count);
+        bench_json_uint(j, "postings", index->posting_count);
+        bench_json_uint(j, "index_bytes", (uint64_t)index->size);
+        bench_json_number(j, "matches_per_query", (double)matched / (2.0 * FIND_QUERIES));
+        bench_json_uint(j, "mismatches", mismatches);
+        bench_json_number(j, "substring_speedup", results[1].p50_ns ? (double)results[2].p50_ns / (double)results[1].p50_ns : 0.0);
+        bench_json_number(j, "glob_speedup", results[3].p50_ns ? (double)results[4].p50_ns / (double)results[3].p50_ns : 0.0);
+        bench_json_begin_object(j, "ops");
+        for (int o = 0; o < 5; o++) bench_json_op(j, &results[o]);
+        bench_json_end_object(j);
+        bench_json_end_object(j);
+        fflush(j->out);
+        trigram_index_free(index);
+    }
+    bench_json_end_array(j);
+    return 1;
+}
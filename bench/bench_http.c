@@ -0,0 +1,402 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "sha1.h"
+#ifdef WTF_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef WTF_HAVE_BROTLI
+#include <brotli/encode.h>
+#endif
+
+#define BENCH_ZSTD_LEVEL 19       // a static file is compressed once, so at the top levels
+#define BENCH_BROTLI_QUALITY 11
+#define BENCH_HTTP_SLICE (16 * 1024)   // body bytes per send, and per chunk when chunked
+
+// gzip body as raw.githubusercontent.com sends it (Content-Encoding: gzip)
+unsigned char *bench_gzip(const char *body, size_t len, size_t *out_len) {
+    z_stream strm;
+    memset(&strm, 0, sizeof(strm));
+    if (deflateInit2(&strm, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 16 + MAX_WBITS, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return NULL;
+    }
+    size_t cap = deflateBound(&strm, (uLong)len);
+    unsigned char *out = malloc(cap);
+    if (!out) {
+        deflateEnd(&strm);
+        return NULL;
+    }
+    strm.next_in = (Bytef *)body;
+    strm.avail_in = (uInt)len;
+    strm.next_out = out;
+    strm.avail_out = (uInt)cap;
+    int ret = deflate(&strm, Z_FINISH);
+    *out_len = cap - strm.avail_out;
+    deflateEnd(&strm);
+    if (ret != Z_STREAM_END) {
+        free(out);
+        return NULL;
+    }
+    return out;
+}
+
+// body in encoding ("identity", "gzip", "zstd" or "br"); NULL when this build
+// cannot produce it
+unsigned char *bench_encode(const char *encoding, const char *body, size_t len, size_t *out_len) {
+    if (strcmp(encoding, "identity") == 0) {
+        unsigned char *out = malloc(len ? len : 1);
+        if (!out) return NULL;
+        memcpy(out, body, len);
+        *out_len = len;
+        return out;
+    }
+    if (strcmp(encoding, "gzip") == 0) return bench_gzip(body, len, out_len);
+#ifdef WTF_HAVE_ZSTD
+    if (strcmp(encoding, "zstd") == 0) {
+        size_t cap = ZSTD_compressBound(len);
+        unsigned char *out = malloc(cap);
+        if (!out) return NULL;
+        size_t n = ZSTD_compress(out, cap, body, len, BENCH_ZSTD_LEVEL);
+        if (ZSTD_isError(n)) {
+            free(out);
+            return NULL;
+        }
+        *out_len = n;
+        return out;
+    }
+#endif
+#ifdef WTF_HAVE_BROTLI
+    if (strcmp(encoding, "br") == 0) {
+        size_t cap = BrotliEncoderMaxCompressedSize(len);
+        unsigned char *out = cap ? malloc(cap) : NULL;
+        if (!out) return NULL;
+        *out_len = cap;
+        if (!BrotliEncoderCompress(BENCH_BROTLI_QUALITY, BROTLI_DEFAULT_WINDOW, BROTLI_MODE_TEXT, len,
+                                   (const uint8_t *)body, out_len, out)) {
+            free(out);
+            return NULL;
+        }
+        return out;
+    }
+#endif
+    return NULL;
+}
+
+static int send_all(int fd, const void *data, size_t len) {
+    const char *p = data;
+    while (len > 0) {
+        ssize_t n = send(fd, p, len, MSG_NOSIGNAL);
+        if (n <= 0) return 0;
+        p += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+static void respond(int fd, int status, const char *reason, const char *extra_headers,
+                    const void *body, size_t len, int head_only) {
+    char header[1024];
+    int n = snprintf(header, sizeof(header),
+                     "HTTP/1.1 %d %s\r\nContent-Length: %zu\r\nConnection: close\r\n%s\r\n",
+                     status, reason, len, extra_headers ? extra_headers : "");
+    if (send_all(fd, header, (size_t)n) && !head_only && len > 0) send_all(fd, body, len);
+}
+
+static void sleep_ns(uint64_t ns) {
+    struct timespec ts = {(time_t)(ns / 1000000000ull), (long)(ns % 1000000000ull)};
+    while (nanosleep(&ts, &ts) != 0) {}
+}
+
+// Send a download body in BENCH_HTTP_SLICE pieces, as HTTP chunks when the
+// config asks for them, no faster than its bandwidth. complete ends a chunked
+// body; without it the connection just stops, as if it dropped.
+static int send_body(int fd, const BenchHttpConfig *config, const unsigned char *data, size_t len, int complete) {
+    uint64_t started = bench_now_ns();
+    for (size_t off = 0; off < len; off += BENCH_HTTP_SLICE) {
+        size_t n = len - off < BENCH_HTTP_SLICE ? len - off : BENCH_HTTP_SLICE;
+        char size_line[32];
+        int size_len = snprintf(size_line, sizeof(size_line), "%zx\r\n", n);
+        if (config->chunked && !send_all(fd, size_line, (size_t)size_len)) return 0;
+        if (!send_all(fd, data + off, n)) return 0;
+        if (config->chunked && !send_all(fd, "\r\n", 2)) return 0;
+        if (config->bandwidth > 0) {
+            uint64_t due = (uint64_t)((double)(off + n) / config->bandwidth * 1e9);
+            uint64_t elapsed = bench_now_ns() - started;
+            if (due > elapsed) sleep_ns(due - elapsed);
+        }
+    }
+    return !config->chunked || !complete || send_all(fd, "0\r\n\r\n", 5);
+}
+
+typedef struct {
+    const BenchHttpConfig *config;
+    BenchHttpCounters *counters;
+    const unsigned char *gzipped;
+    size_t gzipped_len;
+    const unsigned char *encoded;   // in config->encoding, NULL for gzip only
+    size_t encoded_len;
+    time_t window_reset;   // X-RateLimit-Reset of the current window
+    int window_used;       // API requests answered in it
+    int drops_left;        // downloads still to cut off
+} ServerState;
+
+// Copy the value of request header name into value; 0 if it is not there
+static int request_header(const char *request, const char *name, char *value, size_t size) {
+    size_t name_len = strlen(name);
+    for (const char *line = strstr(request, "\r\n"); line; line = strstr(line, "\r\n")) {
+        line += 2;
+        if (strncasecmp(line, name, name_len) != 0 || line[name_len] != ':') continue;
+        const char *p = line + name_len + 1;
+        while (*p == ' ') p++;
+        size_t n = strcspn(p, "\r\n");
+        if (n >= size) n = size - 1;
+        memcpy(value, p, n);
+        value[n] = '\0';
+        return 1;
+    }
+    return 0;
+}
+
+// True if the Accept-Encoding list names encoding
+static int accepts(const char *accept, const char *encoding) {
+    size_t len = strlen(encoding);
+    for (const char *p = accept; *p; p += strcspn(p, ",")) {
+        p += strspn(p, ", ");
+        if (strncasecmp(p, encoding, len) == 0 && strchr(",; ", p[len])) return 1;
+    }
+    return 0;
+}
+
+// The body in config->encoding when the client accepts it, in gzip otherwise,
+// or the rest of it from a "Range: bytes=N-" request. "identity" goes to every
+// client, as a response without Content-Encoding. The ETag is strong and per
+// encoding, so If-Range holds while the body does.
+static void serve_raw(int fd, ServerState *state, const char *request, int head_only) {
+    const BenchHttpConfig *config = state->config;
+    char etag[64], value[128], headers[256], content_encoding[48] = "";
+    const char *encoding = "gzip";
+    const unsigned char *body = state->gzipped;
+    size_t body_len = state->gzipped_len;
+    if (state->encoded) {
+        int plain = strcmp(config->encoding, "identity") == 0;
+        if (plain || (request_header(request, "Accept-Encoding", value, sizeof(value)) &&
+                      accepts(value, config->encoding))) {
+            encoding = config->encoding;
+            body = state->encoded;
+            body_len = state->encoded_len;
+        } else {
+            state->counters->fallbacks++;
+        }
+    }
+    snprintf(etag, sizeof(etag), "\"%s-%s\"", config->sha, encoding);
+    if (strcmp(encoding, "identity") != 0) {
+        snprintf(content_encoding, sizeof(content_encoding), "Content-Encoding: %s\r\n", encoding);
+    }
+    size_t start = 0;
+    if (!config->ignore_range && request_header(request, "Range", value, sizeof(value)) &&
+        strncmp(value, "bytes=", 6) == 0) {
+        char if_range[128];
+        size_t from = (size_t)strtoull(value + 6, NULL, 10);
+        int same = !request_header(request, "If-Range", if_range, sizeof(if_range)) || strcmp(if_range, etag) == 0;
+        if (same && from < body_len) start = from;
+    }
+
+    state->counters->downloads++;
+    size_t len = body_len - start;
+    if (start > 0) {
+        state->counters->ranges++;
+        snprintf(headers, sizeof(headers), "%sETag: %s\r\nContent-Range: bytes %zu-%zu/%zu\r\n",
+                 content_encoding, etag, start, body_len - 1, body_len);
+    } else {
+        snprintf(headers, sizeof(headers), "%sETag: %s\r\nAccept-Ranges: bytes\r\n", content_encoding, etag);
+    }
+    char header[512], length[64];
+    if (config->chunked) {
+        snprintf(length, sizeof(length), "Transfer-Encoding: chunked");
+    } else {
+        snprintf(length, sizeof(length), "Content-Length: %zu", len);
+    }
+    int n = snprintf(header, sizeof(header), "HTTP/1.1 %d %s\r\n%s\r\nConnection: close\r\n%s\r\n",
+                     start > 0 ? 206 : 200, start > 0 ? "Partial Content" : "OK", length, headers);
+    if (!send_all(fd, header, (size_t)n) || head_only) return;
+
+    // A connection that dies partway, as on a flaky link
+    size_t sent = len;
+    if (state->drops_left > 0 && config->drop_after < len) {
+        state->drops_left--;
+        state->counters->dropped++;
+        sent = config->drop_after;
+    }
+    if (send_body(fd, config, body + start, sent, sent == len)) state->counters->bytes_sent += sent;
+}
+
+// Contents API: the dictionary's blob id and size, within the rate limit
+static void serve_contents(int fd, ServerState *state, int head_only) {
+    const BenchHttpConfig *config = state->config;
+    time_t now = time(NULL);
+    if (now >= state->window_reset) {
+        state->window_reset = now + config->rate_window;
+        state->window_used = 0;
+    }
+    state->counters->api_requests++;
+
+    char headers[256];
+    if (config->rate_limit > 0 && state->window_used >= config->rate_limit) {
+        static const char refused[] = "{\"message\":\"API rate limit exceeded\"}";
+        state->counters->rate_limited++;
+        snprintf(headers, sizeof(headers),
+                 "X-RateLimit-Limit: %d\r\nX-RateLimit-Remaining: 0\r\nX-RateLimit-Reset: %ld\r\n",
+                 config->rate_limit, (long)state->window_reset);
+        respond(fd, 403, "Forbidden", headers, refused, sizeof(refused) - 1, head_only);
+        return;
+    }
+    if (config->error_status) {
+        static const char failed[] = "{\"message\":\"Server Error\"}";
+        state->counters->errors++;
+        respond(fd, config->error_status, "Error", NULL, failed, sizeof(failed) - 1, head_only);
+        return;
+    }
+
+    state->window_used++;
+    headers[0] = '\0';
+    if (config->rate_limit > 0) {
+        snprintf(headers, sizeof(headers),
+                 "X-RateLimit-Limit: %d\r\nX-RateLimit-Remaining: %d\r\nX-RateLimit-Reset: %ld\r\n",
+                 config->rate_limit, config->rate_limit - state->window_used, (long)state->window_reset);
+    }
+    char json[256];
+    int n = snprintf(json, sizeof(json), "{\"name\":\"definitions.txt\",\"sha\":\"%s\",\"size\":%zu}",
+                     config->sha, config->body_len);
+    respond(fd, 200, "OK", headers, json, (size_t)n, head_only);
+}
+
+static void serve_connection(int fd, ServerState *state) {
+    char request[4096];
+    size_t len = 0;
+    while (len < sizeof(request) - 1) {
+        ssize_t n = recv(fd, request + len, sizeof(request) - 1 - len, 0);
+        if (n <= 0) return;
+        len += (size_t)n;
+        request[len] = '\0';
+        if (strstr(request, "\r\n\r\n")) break;
+    }
+
+    char method[8], path[1024];
+    if (sscanf(request, "%7s %1023s", method, path) != 2) return;
+    int head_only = strcmp(method, "HEAD") == 0;
+    // Round trip and server time before the first response byte
+    if (state->config->latency_ms > 0) sleep_ns((uint64_t)state->config->latency_ms * 1000000ull);
+
+    if (strstr(path, "/contents/")) {
+        serve_contents(fd, state, head_only);
+    } else if (strncmp(path, "/raw/", 5) == 0) {
+        serve_raw(fd, state, request, head_only);
+    } else {
+        // The connectivity probe
+        state->counters->probes++;
+        respond(fd, 200, "OK", NULL, NULL, 0, head_only);
+    }
+}
+
+// Start the stand-in on an ephemeral 127.0.0.1 port. Returns 0 on failure.
+int bench_http_start(BenchHttpServer *server, const BenchHttpConfig *config) {
+    memset(server, 0, sizeof(*server));
+    server->pid = -1;
+
+    // The API reports the blob id of what the raw URL serves
+    char sha[SHA1_HEX_SIZE];
+    if (!config->sha[0]) {
+        Sha1 ctx;
+        unsigned char digest[SHA1_DIGEST_SIZE];
+        git_blob_sha1_begin(&ctx, config->body_len);
+        sha1_update(&ctx, config->body, config->body_len);
+        sha1_final(&ctx, digest);
+        sha1_hex(digest, sha);
+    }
+
+    size_t gzipped_len = 0, encoded_len = 0;
+    unsigned char *gzipped = bench_gzip(config->body, config->body_len, &gzipped_len);
+    if (!gzipped) return 0;
+    unsigned char *encoded = NULL;
+    if (config->encoding && strcmp(config->encoding, "gzip") != 0) {
+        encoded = bench_encode(config->encoding, config->body, config->body_len, &encoded_len);
+        if (!encoded) {
+            free(gzipped);
+            return 0;
+        }
+    }
+
+    int listener = socket(AF_INET, SOCK_STREAM, 0);
+    struct sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t addr_len = sizeof(addr);
+    if (listener < 0 || bind(listener, (struct sockaddr *)&addr, sizeof(addr)) != 0 ||
+        listen(listener, 64) != 0 || getsockname(listener, (struct sockaddr *)&addr, &addr_len) != 0) {
+        if (listener >= 0) close(listener);
+        free(gzipped);
+        free(encoded);
+        return 0;
+    }
+    server->port = ntohs(addr.sin_port);
+    snprintf(server->api_base, sizeof(server->api_base), "http://127.0.0.1:%d", server->port);
+    snprintf(server->raw_base, sizeof(server->raw_base), "http://127.0.0.1:%d/raw", server->port);
+
+    server->counters = mmap(NULL, sizeof(BenchHttpCounters), PROT_READ | PROT_WRITE,
+                            MAP_SHARED | MAP_ANONYMOUS, -1, 0);
+    if (server->counters == MAP_FAILED) {
+        server->counters = NULL;
+        close(listener);
+        free(gzipped);
+        free(encoded);
+        return 0;
+    }
+    memset(server->counters, 0, sizeof(BenchHttpCounters));
+
+    pid_t pid = fork();
+    if (pid == 0) {
+        BenchHttpConfig served = *config;
+        if (!served.sha[0]) memcpy(served.sha, sha, sizeof(served.sha));
+        ServerState state = {&served, server->counters, gzipped, gzipped_len, encoded, encoded_len, 0, 0, served.drops};
+        // One connection at a time: every client sends one request and closes
+        for (;;) {
+            int fd = accept(listener, NULL, NULL);
+            if (fd < 0) continue;
+            serve_connection(fd, &state);
+            close(fd);
+        }
+    }
+    close(listener);
+    free(gzipped);
+    free(encoded);
+    if (pid < 0) {
+        munmap(server->counters, sizeof(BenchHttpCounters));
+        server->counters = NULL;
+        return 0;
+    }
+    server->pid = pid;
+    return 1;
+}
+
+void bench_http_stop(BenchHttpServer *server) {
+    if (server->pid > 0) {
+        kill(server->pid, SIGKILL);
+        waitpid(server->pid, NULL, 0);
+    }
+    if (server->counters) munmap(server->counters, sizeof(BenchHttpCounters));
+    memset(server, 0, sizeof(*server));
+    server->pid = -1;
+}
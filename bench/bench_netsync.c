@@ -0,0 +1,150 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "network_sync.h"
+
+#define NETSYNC_RUNS 3
+
+// The link between wtf and the stand-in
+typedef struct {
+    const char *name;
+    int chunked;
+    int latency_ms;
+    double bandwidth;     // bytes per second, 0 for no limit
+} NetProfile;
+
+static const NetProfile profiles[] = {
+    {"loopback", 0, 0, 0},
+    {"chunked", 1, 0, 0},
+    {"broadband", 1, 20, 50e6 / 8},
+    {"slow_vpn", 1, 150, 2e6 / 8},
+};
+#define PROFILE_COUNT (int)(sizeof(profiles) / sizeof(profiles[0]))
+
+// check_and_sync phases, as WTF_TRACE names them. net_decompress runs inside
+// net_download, once per chunk.
+static const char *const phases[] = {
+    "net_probe", "net_check_updates", "net_download", "net_decompress", "net_write", "net_reload",
+};
+#define PHASE_COUNT (int)(sizeof(phases) / sizeof(phases[0]))
+
+static const char *const sync_args[] = {"sync", "--force", NULL};
+
+// Nanoseconds WTF_TRACE recorded for phase, 0 if it did not run
+static uint64_t trace_phase_ns(const char *trace, const char *phase) {
+    char key[64];
+    snprintf(key, sizeof(key), "\"%s\":{", phase);
+    const char *p = strstr(trace, key);
+    p = p ? strstr(p, "\"ns\":") : NULL;
+    return p ? strtoull(p + 5, NULL, 10) : 0;
+}
+
+// Every phase's time from the trace at path; 0 if the download never ran
+static int read_phases(const char *path, uint64_t phase_ns[PHASE_COUNT]) {
+    char trace[8192];
+    FILE *f = fopen(path, "r");
+    size_t n = f ? fread(trace, 1, sizeof(trace) - 1, f) : 0;
+    if (f) fclose(f);
+    trace[n] = '\0';
+    for (int i = 0; i < PHASE_COUNT; i++) phase_ns[i] = trace_phase_ns(trace, phases[i]);
+    return phase_ns[2] > 0;
+}
+
+static int run_profile(const BenchOptions *opt, BenchJson *j, const NetProfile *profile, const char *dir,
+                       const char *dict, size_t dict_len) {
+    BenchHttpConfig config;
+    memset(&config, 0, sizeof(config));
+    config.body = dict;
+    config.body_len = dict_len;
+    config.chunked = profile->chunked;
+    config.latency_ms = profile->latency_ms;
+    config.bandwidth = profile->bandwidth;
+    BenchHttpServer server;
+    if (!bench_http_start(&server, &config)) return 0;
+
+    char home[600], wtf_dir[700], trace_path[800];
+    snprintf(home, sizeof(home), "%s/host", dir);
+    snprintf(wtf_dir, sizeof(wtf_dir), "%s/.wtf", home);
+    snprintf(trace_path, sizeof(trace_path), "%s/trace.jsonl", wtf_dir);
+    BenchSamples samples[PHASE_COUNT], wall;
+    for (int i = 0; i < PHASE_COUNT; i++) bench_samples_init(&samples[i]);
+    bench_samples_init(&wall);
+    long peak_rss = 0;
+    int ok = 1;
+    for (int r = 0; ok && r < NETSYNC_RUNS; r++) {
+        uint64_t phase_ns[PHASE_COUNT];
+        BenchRun run = {0};
+        run.trace = trace_path;
+        ok = bench_host_create(home) && bench_run_wtf(opt->binary, home, &server, sync_args, &run) &&
+             read_phases(trace_path, phase_ns);
+        SyncMetadata metadata;
+        load_sync_metadata(wtf_dir, &metadata);
+        ok = ok && metadata.last_sha[0];
+        bench_host_remove(home);
+        if (!ok) break;
+        for (int i = 0; i < PHASE_COUNT; i++) bench_samples_add(&samples[i], phase_ns[i]);
+        bench_samples_add(&wall, run.wall_ns);
+        if (run.peak_rss_kb > peak_rss) peak_rss = run.peak_rss_kb;
+    }
+    BenchHttpCounters served = *server.counters;
+    bench_http_stop(&server);
+
+    if (ok) {
+        bench_json_begin_object(j, profile->name);
+        bench_json_uint(j, "chunked", (uint64_t)profile->chunked);
+        bench_json_uint(j, "latency_ms", (uint64_t)profile->latency_ms);
+        bench_json_number(j, "bandwidth_bytes_per_s", profile->bandwidth);
+        bench_json_uint(j, "bytes_sent", served.bytes_sent / NETSYNC_RUNS);
+        for (int i = 0; i < PHASE_COUNT; i++) bench_json_samples(j, phases[i], &samples[i], 0);
+        bench_json_samples(j, "wall", &wall, 0);
+        bench_json_uint(j, "peak_rss_kb", (uint64_t)peak_rss);
+        bench_json_end_object(j);
+        fflush(j->out);
+    }
+    for (int i = 0; i < PHASE_COUNT; i++) bench_samples_free(&samples[i]);
+    bench_samples_free(&wall);
+    return ok;
+}
+
+// Per size (dictionary entries), per link profile: `wtf sync --force` into an
+// empty home against the stand-in, NETSYNC_RUNS times, with every phase of
+// check_and_sync timed through WTF_TRACE and the peak RSS of the process
+int bench_suite_netsync(const BenchOptions *opt, BenchJson *j) {
+    if (!opt->binary) {
+        fprintf(stderr, "bench: netsync needs --binary\n");
+        return 0;
+    }
+    char dir[512], dict_path[600];
+    snprintf(dir, sizeof(dir), "%s/wtf_bench_netsync_%d", opt->tmpdir, (int)getpid());
+    if (mkdir(dir, 0755) != 0) return 0;
+
+    int ok = 1;
+    bench_json_begin_array(j, "results");
+    for (int i = 0; ok && i < opt->size_count; i++) {
+        BenchDictConfig cfg = opt->dict;
+        cfg.entries = opt->sizes[i];
+        snprintf(dict_path, sizeof(dict_path), "%s/definitions.txt", dir);
+        long dict_len = bench_generate_dictionary(dict_path, &cfg, NULL) ? bench_file_size(dict_path) : -1;
+        char *dict = dict_len > 0 ? malloc((size_t)dict_len) : NULL;
+        FILE *f = dict ? fopen(dict_path, "r") : NULL;
+        ok = f && fread(dict, 1, (size_t)dict_len, f) == (size_t)dict_len;
+        if (f) fclose(f);
+        unlink(dict_path);
+
+        bench_json_begin_object(j, NULL);
+        bench_json_uint(j, "entries", (uint64_t)opt->sizes[i]);
+        bench_json_uint(j, "body_bytes", (uint64_t)(dict_len > 0 ? dict_len : 0));
+        for (int p = 0; ok && p < PROFILE_COUNT; p++) {
+            ok = run_profile(opt, j, &profiles[p], dir, dict, (size_t)dict_len);
+        }
+        bench_json_end_object(j);
+        free(dict);
+    }
+    bench_json_end_array(j);
+
+    rmdir(dir);
+    return ok;
+}
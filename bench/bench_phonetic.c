@@ -0,0 +1,165 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <unistd.h>
+#include "bench.h"
+#include "trigram.h"
+#include "phonetic.h"
+
+#define PHONETIC_QUERIES 256
+
+// A lower-case misspelling that should sound the same: one of a, o and u
+// swapped for another, or a last l, m, n or r doubled. Other vowels and
+// letters change how their neighbours read ("ce" against "ca").
+static void misspell(const char *term, char *out, size_t size, uint64_t *rng) {
+    static const char vowels[] = "aou";
+    snprintf(out, size, "%s", term);
+    size_t len = strlen(out);
+    for (size_t i = 0; i < len; i++) out[i] = (char)tolower((unsigned char)out[i]);
+    size_t start = (size_t)(bench_rand(rng) % len);
+    for (size_t k = 0; k < len; k++) {
+        size_t i = (start + k) % len;
+        if (i > 0 && out[i - 1] != 'i' && strchr(vowels, out[i])) {
+            out[i] = vowels[(strchr(vowels, out[i]) - vowels + 1 + bench_rand(rng) % 2) % 3];
+            return;
+        }
+    }
+    if (len > 0 && len + 2 <= size && strchr("lmnr", out[len - 1])) {
+        out[len] = out[len - 1];
+        out[len + 1] = '\0';
+    }
+}
+
+// Candidates filed under any of word's keys; *found set when id is one of them
+static size_t candidates(const PhoneticIndex *index, const char *word, uint32_t id, int *found) {
+    uint64_t keys[2];
+    int key_count = phonetic_keys(word, keys);
+    size_t total = 0;
+    for (int k = 0; k < key_count; k++) {
+        const uint32_t *ids;
+        uint32_t count = phonetic_index_lookup(index, keys[k], &ids);
+        for (uint32_t i = 0; found && i < count; i++) {
+            if (ids[i] == id) *found = 1;
+        }
+        total += count;
+    }
+    return total;
+}
+
+// Per size: phonetic keys for `size` generated terms, a pass at a time; the
+// index build over their trigram index; and lookups of misspelled terms, which
+// must all find the term they came from (recall 1)
+int bench_suite_phonetic(const BenchOptions *opt, BenchJson *j) {
+    bench_json_begin_array(j, "results");
+    for (int i = 0; i < opt->size_count; i++) {
+        char dict_path[512];
+        snprintf(dict_path, sizeof(dict_path), "%s/wtf_bench_phonetic_%d.txt", opt->tmpdir, (int)getpid());
+        BenchDictConfig cfg = opt->dict;
+        cfg.entries = opt->sizes[i];
+        cfg.defs_per_term = 1;
+        BenchTermSet terms = {0};
+        if (!bench_generate_dictionary(dict_path, &cfg, &terms)) {
+            fprintf(stderr, "bench: could not write %s\n", dict_path);
+            bench_term_set_free(&terms);
+            return 0;
+        }
+        unlink(dict_path);
+
+        TrigramBuilder builder;
+        trigram_builder_init(&builder);
+        for (size_t t = 0; t < terms.count; t++) trigram_builder_add(&builder, terms.terms[t]);
+        TrigramIndex *trigrams = trigram_builder_build(&builder);
+        trigram_builder_free(&builder);
+        if (!trigrams || trigrams->term_count == 0) {
+            fprintf(stderr, "bench: could not index %zu terms\n", opt->sizes[i]);
+            trigram_index_free(trigrams);
+            bench_term_set_free(&terms);
+            return 0;
+        }
+
+        // Every term's keys, one sample per pass over all of them
+        BenchSamples keys;
+        bench_samples_init(&keys);
+        uint64_t checksum = 0, with_alternate = 0;
+        uint64_t started = bench_now_ns();
+        while (bench_should_continue(opt, started, keys.count, (size_t)opt->max_reps)) {
+            with_alternate = 0;
+            uint64_t t0 = bench_now_ns();
+            for (size_t t = 0; t < terms.count; t++) {
+                uint64_t k[2] = {0, 0};
+                int n = phonetic_keys(terms.terms[t], k);
+                checksum += k[0] ^ k[1];
+                with_alternate += n == 2;
+            }
+            bench_samples_add(&keys, bench_now_ns() - t0);
+        }
+        bench_term_set_free(&terms);
+
+        BenchSamples build;
+        bench_samples_init(&build);
+        PhoneticIndex *index = NULL;
+        started = bench_now_ns();
+        while (bench_should_continue(opt, started, build.count, (size_t)opt->max_reps)) {
+            uint64_t t0 = bench_now_ns();
+            PhoneticIndex *built = phonetic_index_build(trigrams);
+            bench_samples_add(&build, bench_now_ns() - t0);
+            phonetic_index_free(index);
+            index = built;
+        }
+        if (!index) {
+            fprintf(stderr, "bench: could not build the phonetic index for %zu terms\n", opt->sizes[i]);
+            trigram_index_free(trigrams);
+            bench_samples_free(&keys);
+            bench_samples_free(&build);
+            return 0;
+        }
+
+        static char queries[PHONETIC_QUERIES][64];
+        static uint32_t sources[PHONETIC_QUERIES];
+        uint64_t rng = opt->dict.seed ? opt->dict.seed : 1;
+        uint64_t recalled = 0, candidate_total = 0;
+        for (int q = 0; q < PHONETIC_QUERIES; q++) {
+            sources[q] = (uint32_t)(bench_rand(&rng) % trigrams->term_count);
+            misspell(trigram_index_term(trigrams, sources[q]), queries[q], sizeof(queries[q]), &rng);
+            int found = 0;
+            candidate_total += candidates(index, queries[q], sources[q], &found);
+            recalled += (uint64_t)found;
+        }
+
+        BenchSamples lookup;
+        bench_samples_init(&lookup);
+        started = bench_now_ns();
+        for (int q = 0; bench_should_continue(opt, started, lookup.count, (size_t)opt->max_samples); q++) {
+            uint64_t t0 = bench_now_ns();
+            candidates(index, queries[q % PHONETIC_QUERIES], 0, NULL);
+            bench_samples_add(&lookup, bench_now_ns() - t0);
+        }
+
+        uint64_t pass_ns = bench_samples_percentile(&keys, 50);
+        bench_json_begin_object(j, NULL);
+        bench_json_uint(j, "terms", trigrams->term_count);
+        bench_json_uint(j, "keys", index->key_count);
+        bench_json_uint(j, "postings", index->posting_count);
+        bench_json_uint(j, "index_bytes", (uint64_t)index->size);
+        bench_json_number(j, "alternate_rate", (double)with_alternate / (double)trigrams->term_count);
+        bench_json_number(j, "keys_per_s", pass_ns ? (double)trigrams->term_count * 1e9 / (double)pass_ns : 0.0);
+        bench_json_number(j, "ns_per_term", (double)pass_ns / (double)trigrams->term_count);
+        bench_json_number(j, "recall", (double)recalled / PHONETIC_QUERIES);
+        bench_json_number(j, "candidates_per_query", (double)candidate_total / PHONETIC_QUERIES);
+        bench_json_uint(j, "checksum", checksum);
+        bench_json_samples(j, "key_pass", &keys, 0);
+        bench_json_samples(j, "index_build", &build, 0);
+        bench_json_samples(j, "lookup", &lookup, 0);
+        bench_json_end_object(j);
+        fflush(j->out);
+
+        bench_samples_free(&keys);
+        bench_samples_free(&build);
+        bench_samples_free(&lookup);
+        phonetic_index_free(index);
+        trigram_index_free(trigrams);
+    }
+    bench_json_end_array(j);
+    return 1;
+}
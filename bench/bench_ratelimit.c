@@ -0,0 +1,185 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "network_sync.h"
+
+#define RATELIMIT_RUNS 5          // invocations per host
+#define RATELIMIT_QUOTA 60        // GitHub's unauthenticated limit per hour
+#define RATELIMIT_WINDOW 3600
+#define RATELIMIT_ENTRIES 2000    // the dictionary every host syncs
+
+// How the stand-in answers the update check
+typedef struct {
+    const char *name;
+    int rate_limit;
+    int error_status;
+} RateScenario;
+
+static const RateScenario scenarios[] = {
+    {"rate_limited", RATELIMIT_QUOTA, 0},
+    {"server_errors", 0, 502},
+};
+#define RATE_SCENARIO_COUNT (int)(sizeof(scenarios) / sizeof(scenarios[0]))
+
+static int write_file(const char *path, const char *data, size_t len) {
+    FILE *f = fopen(path, "w");
+    if (!f) return 0;
+    int ok = fwrite(data, 1, len, f) == len;
+    return fclose(f) == 0 && ok;
+}
+
+// A host's ~/.wtf: the served dictionary, and a sync.meta that makes the check due
+static int seed_host(const char *home, const char *dict, size_t dict_len) {
+    char path[700];
+    if (!bench_host_create(home)) return 0;
+    snprintf(path, sizeof(path), "%s/.wtf/res/definitions.txt", home);
+    if (!write_file(path, dict, dict_len)) return 0;
+    snprintf(path, sizeof(path), "%s/.wtf/res/added.txt", home);
+    if (!write_file(path, "", 0)) return 0;
+    snprintf(path, sizeof(path), "%s/.wtf/res/removed.txt", home);
+    if (!write_file(path, "", 0)) return 0;
+    snprintf(path, sizeof(path), "%s/.wtf/%s", home, SYNC_METADATA_FILE);
+    return write_file(path, "0 -", 3);
+}
+
+static int run_scenario(const BenchOptions *opt, BenchJson *j, const RateScenario *scenario, int hosts,
+                        const char *dir, const char *dict, size_t dict_len, const char *term) {
+    BenchHttpConfig config;
+    memset(&config, 0, sizeof(config));
+    config.body = dict;
+    config.body_len = dict_len;
+    config.rate_limit = scenario->rate_limit;
+    config.rate_window = RATELIMIT_WINDOW;
+    config.error_status = scenario->error_status;
+    BenchHttpServer server;
+    if (!bench_http_start(&server, &config)) return 0;
+
+    char home[600];
+    int ok = 1;
+    for (int h = 0; ok && h < hosts; h++) {
+        snprintf(home, sizeof(home), "%s/host%d", dir, h);
+        ok = seed_host(home, dict, dict_len);
+    }
+
+    // Hosts take turns, as jobs on a build farm behind one address would
+    BenchSamples checked, skipped;
+    bench_samples_init(&checked);
+    bench_samples_init(&skipped);
+    const char *const args[] = {"is", term, NULL};
+    uint64_t failed = 0;
+    for (int r = 0; ok && r < RATELIMIT_RUNS; r++) {
+        for (int h = 0; h < hosts; h++) {
+            snprintf(home, sizeof(home), "%s/host%d", dir, h);
+            uint64_t before = server.counters->probes + server.counters->api_requests;
+            BenchRun run = {0};
+            if (!bench_run_wtf(opt->binary, home, &server, args, &run)) {
+                failed++;
+                continue;
+            }
+            bool contacted = server.counters->probes + server.counters->api_requests != before;
+            bench_samples_add(contacted ? &checked : &skipped, run.wall_ns);
+        }
+    }
+
+    // Where each host that did not get through scheduled its next check
+    time_t now = time(NULL);
+    uint64_t synced = 0, waiting = 0;
+    long wait_min = -1, wait_max = -1;
+    for (int h = 0; ok && h < hosts; h++) {
+        snprintf(home, sizeof(home), "%s/host%d/.wtf", dir, h);
+        SyncMetadata metadata;
+        load_sync_metadata(home, &metadata);
+        if (metadata.last_sha[0]) synced++;
+        if (metadata.next_check > now) {
+            long wait = (long)(metadata.next_check - now);
+            waiting++;
+            if (wait_min < 0 || wait < wait_min) wait_min = wait;
+            if (wait > wait_max) wait_max = wait;
+        }
+    }
+
+    BenchHttpCounters served = *server.counters;
+    bench_http_stop(&server);
+    for (int h = 0; h < hosts; h++) {
+        snprintf(home, sizeof(home), "%s/host%d", dir, h);
+        bench_host_remove(home);
+    }
+    if (!ok) {
+        bench_samples_free(&checked);
+        bench_samples_free(&skipped);
+        return 0;
+    }
+
+    // A client that does not schedule checks asks again on every invocation
+    // until it gets through
+    uint64_t unscheduled = synced + (hosts - synced) * RATELIMIT_RUNS;
+    bench_json_begin_object(j, scenario->name);
+    bench_json_uint(j, "invocations", (uint64_t)hosts * RATELIMIT_RUNS);
+    bench_json_uint(j, "invocations_checked", checked.count);
+    bench_json_uint(j, "invocations_skipped", skipped.count);
+    bench_json_uint(j, "invocations_failed", failed);
+    bench_json_uint(j, "probes", served.probes);
+    bench_json_uint(j, "api_requests", served.api_requests);
+    bench_json_uint(j, "api_requests_unscheduled", unscheduled);
+    bench_json_uint(j, "refused_rate_limit", served.rate_limited);
+    bench_json_uint(j, "refused_error", served.errors);
+    bench_json_uint(j, "downloads", served.downloads);
+    bench_json_uint(j, "hosts_synced", synced);
+    bench_json_uint(j, "hosts_waiting", waiting);
+    bench_json_number(j, "next_check_min_s", (double)wait_min);
+    bench_json_number(j, "next_check_max_s", (double)wait_max);
+    bench_json_samples(j, "checked_wall", &checked, 0);
+    bench_json_samples(j, "skipped_wall", &skipped, 0);
+    bench_json_end_object(j);
+    bench_samples_free(&checked);
+    bench_samples_free(&skipped);
+    fflush(j->out);
+    return 1;
+}
+
+// Per size (hosts behind one address): every host finds its update check due
+// and runs `wtf is` RATELIMIT_RUNS times against a stand-in API that allows
+// RATELIMIT_QUOTA checks an hour, or fails every one. Hosts that were refused
+// should wait for the reset (or back off) instead of asking again each time.
+int bench_suite_ratelimit(const BenchOptions *opt, BenchJson *j) {
+    if (!opt->binary) {
+        fprintf(stderr, "bench: ratelimit needs --binary\n");
+        return 0;
+    }
+    char dir[512], dict_path[600];
+    snprintf(dir, sizeof(dir), "%s/wtf_bench_ratelimit_%d", opt->tmpdir, (int)getpid());
+    if (mkdir(dir, 0755) != 0) return 0;
+
+    BenchDictConfig cfg = opt->dict;
+    cfg.entries = RATELIMIT_ENTRIES;
+    snprintf(dict_path, sizeof(dict_path), "%s/definitions.txt", dir);
+    BenchTermSet terms = {0};
+    long dict_len = bench_generate_dictionary(dict_path, &cfg, &terms) ? bench_file_size(dict_path) : -1;
+    char *dict = dict_len > 0 ? malloc((size_t)dict_len) : NULL;
+    FILE *f = dict ? fopen(dict_path, "r") : NULL;
+    int ok = f && fread(dict, 1, (size_t)dict_len, f) == (size_t)dict_len && terms.count > 0;
+    if (f) fclose(f);
+    unlink(dict_path);
+
+    bench_json_uint(j, "runs_per_host", RATELIMIT_RUNS);
+    bench_json_uint(j, "quota", RATELIMIT_QUOTA);
+    bench_json_begin_array(j, "results");
+    for (int i = 0; ok && i < opt->size_count; i++) {
+        bench_json_begin_object(j, NULL);
+        bench_json_uint(j, "hosts", (uint64_t)opt->sizes[i]);
+        for (int s = 0; ok && s < RATE_SCENARIO_COUNT; s++) {
+            ok = run_scenario(opt, j, &scenarios[s], (int)opt->sizes[i], dir, dict, (size_t)dict_len, terms.terms[0]);
+        }
+        bench_json_end_object(j);
+    }
+    bench_json_end_array(j);
+
+    free(dict);
+    bench_term_set_free(&terms);
+    rmdir(dir);
+    return ok;
+}
@@ -0,0 +1,154 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "bench.h"
+#include "network_sync.h"
+#include "sha1.h"
+
+#define RESUME_MAX_ATTEMPTS 10
+
+// How the stand-in's download connections fail
+typedef struct {
+    const char *name;
+    int drops;            // connections cut off
+    int drop_percent;     // after this much of the gzip body
+    int ignore_range;
+    int corrupt_partial;  // start from a partial body of this version that does not decode
+} ResumeScenario;
+
+static const ResumeScenario scenarios[] = {
+    {"one_drop_95", 1, 95, 0, 0},
+    {"flaky", 3, 30, 0, 0},
+    {"no_range", 1, 95, 1, 0},
+    {"corrupt_partial", 0, 0, 0, 1},
+};
+#define RESUME_SCENARIO_COUNT (int)(sizeof(scenarios) / sizeof(scenarios[0]))
+
+static const char *const sync_args[] = {"sync", "--force", NULL};
+
+// What an interrupted gzip download of dict would leave in wtf_dir, with
+// bytes that are not gzip in place of the body
+static int write_corrupt_partial(const char *wtf_dir, const char *dict, size_t dict_len) {
+    Sha1 ctx;
+    unsigned char digest[SHA1_DIGEST_SIZE];
+    char sha[SHA1_HEX_SIZE], path[800];
+    git_blob_sha1_begin(&ctx, dict_len);
+    sha1_update(&ctx, dict, dict_len);
+    sha1_final(&ctx, digest);
+    sha1_hex(digest, sha);
+
+    snprintf(path, sizeof(path), "%s/res/definitions.part.info", wtf_dir);
+    FILE *f = fopen(path, "w");
+    if (!f) return 0;
+    fprintf(f, "%s gzip -\n", sha);
+    if (fclose(f) != 0) return 0;
+
+    snprintf(path, sizeof(path), "%s/res/definitions.part", wtf_dir);
+    f = fopen(path, "w");
+    if (!f) return 0;
+    uint64_t rng = 1;
+    for (int i = 0; i < 4096; i++) fputc(i == 0 ? 0 : (int)(bench_rand(&rng) & 0xff), f);
+    return fclose(f) == 0;
+}
+
+static int run_scenario(const BenchOptions *opt, BenchJson *j, const ResumeScenario *scenario,
+                        const char *dir, const char *dict, size_t dict_len, size_t gzipped_len) {
+    BenchHttpConfig config;
+    memset(&config, 0, sizeof(config));
+    config.body = dict;
+    config.body_len = dict_len;
+    config.drops = scenario->drops;
+    config.drop_after = gzipped_len * (size_t)scenario->drop_percent / 100;
+    config.ignore_range = scenario->ignore_range;
+    BenchHttpServer server;
+    if (!bench_http_start(&server, &config)) return 0;
+
+    char home[600], wtf_dir[700];
+    snprintf(home, sizeof(home), "%s/host", dir);
+    snprintf(wtf_dir, sizeof(wtf_dir), "%s/.wtf", home);
+    int ok = bench_host_create(home);
+    if (ok && scenario->corrupt_partial) ok = write_corrupt_partial(wtf_dir, dict, dict_len);
+
+    // Run sync again after each failure, as someone on a flaky link would
+    int attempts = 0, synced = 0;
+    uint64_t t0 = bench_now_ns();
+    while (ok && !synced && attempts < RESUME_MAX_ATTEMPTS) {
+        attempts++;
+        ok = bench_run_wtf(opt->binary, home, &server, sync_args, NULL);
+        SyncMetadata metadata;
+        load_sync_metadata(wtf_dir, &metadata);
+        synced = metadata.last_sha[0] != '\0';
+    }
+    uint64_t wall = bench_now_ns() - t0;
+
+    BenchHttpCounters served = *server.counters;
+    bench_http_stop(&server);
+    bench_host_remove(home);
+    if (!ok) return 0;
+
+    // Starting over after every drop sends what each cut-off connection did
+    // and then the whole body
+    uint64_t restart_bytes = (uint64_t)served.dropped * config.drop_after + gzipped_len;
+    bench_json_begin_object(j, scenario->name);
+    bench_json_uint(j, "synced", (uint64_t)synced);
+    bench_json_uint(j, "attempts", (uint64_t)attempts);
+    bench_json_uint(j, "downloads", served.downloads);
+    bench_json_uint(j, "range_responses", served.ranges);
+    bench_json_uint(j, "dropped", served.dropped);
+    bench_json_uint(j, "bytes_sent", served.bytes_sent);
+    bench_json_uint(j, "retransferred", served.bytes_sent > gzipped_len ? served.bytes_sent - gzipped_len : 0);
+    bench_json_uint(j, "bytes_sent_restarting", restart_bytes);
+    bench_json_number(j, "wall_ms", (double)wall / 1e6);
+    bench_json_end_object(j);
+    fflush(j->out);
+    return synced;
+}
+
+// Per size (dictionary entries): `wtf sync --force` against a stand-in whose
+// download connections die partway, rerun until it succeeds. A resumed
+// download should send little more than the gzip body once, and a partial
+// body that does not decode should be started over.
+int bench_suite_resume(const BenchOptions *opt, BenchJson *j) {
+    if (!opt->binary) {
+        fprintf(stderr, "bench: resume needs --binary\n");
+        return 0;
+    }
+    char dir[512], dict_path[600];
+    snprintf(dir, sizeof(dir), "%s/wtf_bench_resume_%d", opt->tmpdir, (int)getpid());
+    if (mkdir(dir, 0755) != 0) return 0;
+
+    int ok = 1;
+    bench_json_begin_array(j, "results");
+    for (int i = 0; ok && i < opt->size_count; i++) {
+        BenchDictConfig cfg = opt->dict;
+        cfg.entries = opt->sizes[i];
+        snprintf(dict_path, sizeof(dict_path), "%s/definitions.txt", dir);
+        long dict_len = bench_generate_dictionary(dict_path, &cfg, NULL) ? bench_file_size(dict_path) : -1;
+        char *dict = dict_len > 0 ? malloc((size_t)dict_len) : NULL;
+        FILE *f = dict ? fopen(dict_path, "r") : NULL;
+        ok = f && fread(dict, 1, (size_t)dict_len, f) == (size_t)dict_len;
+        if (f) fclose(f);
+        unlink(dict_path);
+
+        size_t gzipped_len = 0;
+        unsigned char *gzipped = ok ? bench_gzip(dict, (size_t)dict_len, &gzipped_len) : NULL;
+        free(gzipped);
+        ok = ok && gzipped;
+
+        bench_json_begin_object(j, NULL);
+        bench_json_uint(j, "entries", (uint64_t)opt->sizes[i]);
+        bench_json_uint(j, "body_bytes", (uint64_t)(dict_len > 0 ? dict_len : 0));
+        bench_json_uint(j, "gzip_bytes", (uint64_t)gzipped_len);
+        for (int s = 0; ok && s < RESUME_SCENARIO_COUNT; s++) {
+            ok = run_scenario(opt, j, &scenarios[s], dir, dict, (size_t)dict_len, gzipped_len);
+        }
+        bench_json_end_object(j);
+        free(dict);
+    }
+    bench_json_end_array(j);
+
+    rmdir(dir);
+    return ok;
+}
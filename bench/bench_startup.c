@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <spawn.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "bench.h"
+
+#define STARTUP_MAX_ARGS 32
+
+extern char **environ;
+
+// Split opt->args on spaces into argv (binary first)
+static int build_argv(const char *binary, const char *args, char *buf, size_t buflen, char **argv) {
+    int argc = 0;
+    argv[argc++] = (char *)binary;
+    snprintf(buf, buflen, "%s", args ? args : "");
+    for (char *tok = strtok(buf, " "); tok && argc < STARTUP_MAX_ARGS - 1; tok = strtok(NULL, " ")) {
+        argv[argc++] = tok;
+    }
+    argv[argc] = NULL;
+    return argc;
+}
+
+// One fork+exec+wait with stdout/stderr discarded; returns wall time or 0 on failure
+static uint64_t time_one_run(char **argv, char **envp) {
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+
+    pid_t pid;
+    uint64_t t0 = bench_now_ns();
+    int rc = posix_spawn(&pid, argv[0], &actions, NULL, argv, envp);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) return 0;
+
+    int status;
+    waitpid(pid, &status, 0);
+    return bench_now_ns() - t0;
+}
+
+// Count the shared objects the dynamic loader maps, via LD_TRACE_LOADED_OBJECTS
+static int count_loaded_objects(const char *binary) {
+    int fds[2];
+    if (pipe(fds) != 0) return -1;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, fds[1], STDOUT_FILENO);
+    posix_spawn_file_actions_addclose(&actions, fds[0]);
+
+    char *argv[] = {(char *)binary, NULL};
+    char *envp[] = {"LD_TRACE_LOADED_OBJECTS=1", NULL};
+    pid_t pid;
+    int rc = posix_spawn(&pid, binary, &actions, NULL, argv, envp);
+    posix_spawn_file_actions_destroy(&actions);
+    close(fds[1]);
+    if (rc != 0) {
+        close(fds[0]);
+        return -1;
+    }
+
+    FILE *in = fdopen(fds[0], "r");
+    int count = 0;
+    char line[512];
+    while (in && fgets(line, sizeof(line), in)) {
+        if (strstr(line, "=>") || strstr(line, "ld-linux")) count++;
+    }
+    if (in) fclose(in);
+    waitpid(pid, NULL, 0);
+    return count;
+}
+
+static int run_binary(const BenchOptions *opt, BenchJson *j, const char *key, const char *binary,
+                      double *p50_out) {
+    char buf[1024];
+    char *argv[STARTUP_MAX_ARGS];
+    build_argv(binary, opt->args, buf, sizeof(buf), argv);
+
+    // Warm the page cache so both binaries are measured the same way
+    time_one_run(argv, environ);
+
+    BenchSamples samples;
+    bench_samples_init(&samples);
+    uint64_t started = bench_now_ns();
+    while (bench_should_continue(opt, started, samples.count, (size_t)opt->max_samples)) {
+        uint64_t ns = time_one_run(argv, environ);
+        if (ns == 0) {
+            fprintf(stderr, "bench: could not exec %s\n", binary);
+            bench_samples_free(&samples);
+            return 0;
+        }
+        bench_samples_add(&samples, ns);
+    }
+
+    bench_json_begin_object(j, key);
+    bench_json_string(j, "path", binary);
+    bench_json_uint(j, "shared_objects", (uint64_t)count_loaded_objects(binary));
+    bench_json_samples(j, "exec", &samples, 0);
+    bench_json_end_object(j);
+
+    *p50_out = (double)bench_samples_percentile(&samples, 50.0);
+    bench_samples_free(&samples);
+    return 1;
+}
+
+int bench_suite_startup(const BenchOptions *opt, BenchJson *j) {
+    if (!opt->binary) {
+        fprintf(stderr, "bench: startup needs --binary PATH\n");
+        return 0;
+    }
+
+    bench_json_string(j, "args", opt->args ? opt->args : "");
+    double p50 = 0.0, baseline_p50 = 0.0;
+    if (!run_binary(opt, j, "binary", opt->binary, &p50)) return 0;
+    if (opt->baseline) {
+        if (!run_binary(opt, j, "baseline", opt->baseline, &baseline_p50)) return 0;
+        bench_json_number(j, "p50_saved_ns", baseline_p50 - p50);
+        bench_json_number(j, "p50_ratio", p50 > 0 ? baseline_p50 / p50 : 0.0);
+    }
+    return 1;
+}
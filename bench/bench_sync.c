@@ -0,0 +1,204 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "network_sync.h"
+#include "sync_lock.h"
+
+#define SYNC_INVOCATIONS_MAX 1024
+#define SYNC_DOWNLOAD_MS 200   // stand-in for the check and download
+#define SYNC_STAGGER_US 2000   // invocation w starts w * this after the first
+
+// How each invocation coordinates: not at all (as before), like the update
+// check after `is` (skip when another process holds the lock), like `wtf sync`
+// (wait for it), or skipping while a hung holder sits on the lock
+typedef struct {
+    const char *name;
+    int locked;
+    int wait;
+    int hung_holder;
+} SyncMode;
+
+static const SyncMode modes[] = {
+    {"unlocked", 0, 0, 0},
+    {"locked_skip", 1, 0, 0},
+    {"locked_wait", 1, 1, 0},
+    {"locked_hung_holder", 1, 0, 1},
+};
+#define SYNC_MODE_COUNT (int)(sizeof(modes) / sizeof(modes[0]))
+
+// Invocation exit codes
+enum { INVOCATION_FRESH, INVOCATION_SYNCED, INVOCATION_SKIPPED, INVOCATION_WAITED, INVOCATION_FAILED };
+
+static void simulate_sync(const char *dir) {
+    for (int ms = 0; ms < SYNC_DOWNLOAD_MS; ms += 10) {
+        struct timespec tick = {0, 10 * 1000 * 1000};
+        nanosleep(&tick, NULL);
+        sync_lock_heartbeat();
+    }
+    SyncMetadata metadata = {0};
+    metadata.last_sync = time(NULL);
+    snprintf(metadata.last_sha, sizeof(metadata.last_sha), "%ld", (long)getpid());
+    save_sync_metadata(dir, &metadata);
+}
+
+// What main() does once SYNC_INTERVAL has run out
+static int run_invocation(const char *dir, const SyncMode *mode) {
+    SyncMetadata metadata;
+    load_sync_metadata(dir, &metadata);
+    if (time(NULL) - metadata.last_sync < SYNC_INTERVAL) return INVOCATION_FRESH;
+    if (!mode->locked) {
+        simulate_sync(dir);
+        return INVOCATION_SYNCED;
+    }
+
+    SyncLock lock;
+    if (!sync_lock_acquire(&lock, dir, mode->wait ? SYNC_LOCK_WAIT : 0)) {
+        return lock.busy ? INVOCATION_SKIPPED : INVOCATION_FAILED;
+    }
+    load_sync_metadata(dir, &metadata);
+    int due = time(NULL) - metadata.last_sync >= SYNC_INTERVAL;
+    if (due) simulate_sync(dir);
+    sync_lock_release(&lock);
+    return due ? INVOCATION_SYNCED : lock.waited ? INVOCATION_WAITED : INVOCATION_SKIPPED;
+}
+
+// A process holding the lock with a heartbeat ten minutes old, then doing nothing
+static pid_t start_hung_holder(const char *dir) {
+    int ready[2];
+    if (pipe(ready) != 0) return -1;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(ready[0]);
+        char path[4096], record[33];
+        snprintf(path, sizeof(path), "%s/%s", dir, SYNC_LOCK_FILE);
+        int fd = open(path, O_RDWR | O_CREAT, 0644);
+        if (fd < 0 || flock(fd, LOCK_EX) != 0) _exit(1);
+        snprintf(record, sizeof(record), "%-10ld %-20lld", (long)getpid(), (long long)(time(NULL) - 600));
+        record[31] = '\n';
+        if (pwrite(fd, record, 32, 0) != 32 || write(ready[1], "x", 1) != 1) _exit(1);
+        for (;;) pause();
+    }
+    close(ready[1]);
+    char c;
+    int ok = pid > 0 && read(ready[0], &c, 1) == 1;
+    close(ready[0]);
+    if (!ok && pid > 0) {
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+    }
+    return ok ? pid : -1;
+}
+
+typedef struct {
+    uint64_t counts[INVOCATION_FAILED + 1];
+    uint64_t rounds;
+} SyncCheck;
+
+// Every invocation waits on the pipe, then they start a few ms apart. Returns wall time or 0.
+static uint64_t run_round(const char *dir, const SyncMode *mode, int invocations, SyncCheck *check) {
+    SyncMetadata stale = {0};
+    save_sync_metadata(dir, &stale);
+    pid_t hung = mode->hung_holder ? start_hung_holder(dir) : 0;
+    if (hung < 0) return 0;
+
+    int go[2];
+    if (pipe(go) != 0) return 0;
+    pid_t pids[SYNC_INVOCATIONS_MAX];
+    int started = 0;
+    for (int w = 0; w < invocations; w++) {
+        pid_t pid = fork();
+        if (pid < 0) break;
+        if (pid == 0) {
+            char c;
+            close(go[1]);
+            while (read(go[0], &c, 1) > 0);
+            struct timespec stagger = {0, (long)w * SYNC_STAGGER_US * 1000L};
+            nanosleep(&stagger, NULL);
+            _exit(run_invocation(dir, mode));
+        }
+        pids[started++] = pid;
+    }
+    close(go[0]);
+    uint64_t t0 = bench_now_ns();
+    close(go[1]);
+    for (int w = 0; w < started; w++) {
+        int status = 0;
+        waitpid(pids[w], &status, 0);
+        int code = WIFEXITED(status) ? WEXITSTATUS(status) : INVOCATION_FAILED;
+        check->counts[code <= INVOCATION_FAILED ? code : INVOCATION_FAILED]++;
+    }
+    uint64_t elapsed = bench_now_ns() - t0;
+    if (hung > 0) {
+        kill(hung, SIGKILL);
+        waitpid(hung, NULL, 0);
+    }
+    check->rounds++;
+    return started == invocations ? elapsed : 0;
+}
+
+// Per size (invocations): start that many processes just after SYNC_INTERVAL
+// ran out and count how many of them sync. Only one should, however the
+// others coordinate.
+int bench_suite_sync(const BenchOptions *opt, BenchJson *j) {
+    char dir[512], path[600];
+    snprintf(dir, sizeof(dir), "%s/wtf_bench_sync_%d", opt->tmpdir, (int)getpid());
+    if (mkdir(dir, 0755) != 0) return 0;
+
+    bench_json_uint(j, "download_ms", SYNC_DOWNLOAD_MS);
+    bench_json_begin_array(j, "results");
+    for (int i = 0; i < opt->size_count; i++) {
+        int invocations = (int)opt->sizes[i];
+        if (invocations > SYNC_INVOCATIONS_MAX) invocations = SYNC_INVOCATIONS_MAX;
+        bench_json_begin_object(j, NULL);
+        bench_json_uint(j, "invocations", (uint64_t)invocations);
+        bench_json_begin_object(j, "modes");
+        for (int m = 0; m < SYNC_MODE_COUNT; m++) {
+            SyncCheck check;
+            memset(&check, 0, sizeof(check));
+            BenchSamples wall;
+            bench_samples_init(&wall);
+            uint64_t started = bench_now_ns();
+            while (bench_should_continue(opt, started, wall.count, (size_t)opt->max_reps)) {
+                uint64_t ns = run_round(dir, &modes[m], invocations, &check);
+                if (ns == 0) break;
+                bench_samples_add(&wall, ns);
+            }
+
+            BenchOpResult result;
+            bench_op_result(&result, modes[m].name, &wall, 0);
+            uint64_t syncs = check.counts[INVOCATION_SYNCED];
+            bench_json_begin_object(j, modes[m].name);
+            bench_json_uint(j, "samples", result.samples);
+            bench_json_uint(j, "p50_ns", result.p50_ns);
+            bench_json_uint(j, "p99_ns", result.p99_ns);
+            bench_json_number(j, "syncs_per_round", check.rounds ? (double)syncs / (double)check.rounds : 0.0);
+            bench_json_uint(j, "extra_syncs", syncs > check.rounds ? syncs - check.rounds : 0);
+            bench_json_uint(j, "missed_syncs", syncs < check.rounds ? check.rounds - syncs : 0);
+            bench_json_uint(j, "skipped", check.counts[INVOCATION_SKIPPED]);
+            bench_json_uint(j, "waited", check.counts[INVOCATION_WAITED]);
+            bench_json_uint(j, "fresh", check.counts[INVOCATION_FRESH]);
+            bench_json_uint(j, "failed", check.counts[INVOCATION_FAILED]);
+            bench_json_end_object(j);
+            bench_samples_free(&wall);
+            fflush(j->out);
+        }
+        bench_json_end_object(j);
+        bench_json_end_object(j);
+    }
+    bench_json_end_array(j);
+
+    snprintf(path, sizeof(path), "%s/%s", dir, SYNC_METADATA_FILE);
+    unlink(path);
+    snprintf(path, sizeof(path), "%s/%s", dir, SYNC_LOCK_FILE);
+    unlink(path);
+    rmdir(dir);
+    return 1;
+}
@@ -0,0 +1,455 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <fcntl.h>
+#include <ftw.h>
+#include <spawn.h>
+#include <unistd.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include "bench.h"
+
+#define BENCH_MAX_ARGS 16
+
+// Lines longer than this are truncated by load_definitions()
+#define BENCH_MAX_LINE 255
+
+static const char *bench_words[] = {
+    "a", "the", "protocol", "used", "for", "system", "network", "data", "of",
+    "service", "that", "manages", "open", "source", "kernel", "memory", "and",
+    "standard", "interface", "process", "file", "format", "language", "tool",
+    "distributed", "storage", "secure", "remote", "access", "command", "line"
+};
+#define BENCH_WORD_COUNT (sizeof(bench_words) / sizeof(bench_words[0]))
+
+uint64_t bench_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+long bench_peak_rss_kb(void) {
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0) return -1;
+    return ru.ru_maxrss;
+}
+
+void bench_samples_init(BenchSamples *s) {
+    s->ns = NULL;
+    s->count = 0;
+    s->capacity = 0;
+}
+
+void bench_samples_add(BenchSamples *s, uint64_t ns) {
+    if (s->count >= s->capacity) {
+        size_t new_capacity = s->capacity ? s->capacity * 2 : 64;
+        uint64_t *tmp = realloc(s->ns, new_capacity * sizeof(uint64_t));
+        if (!tmp) return;
+        s->ns = tmp;
+        s->capacity = new_capacity;
+    }
+    s->ns[s->count++] = ns;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a;
+    uint64_t y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile; sorts the samples in place
+uint64_t bench_samples_percentile(BenchSamples *s, double pct) {
+    if (s->count == 0) return 0;
+    qsort(s->ns, s->count, sizeof(uint64_t), compare_u64);
+    size_t rank = (size_t)((pct / 100.0) * (double)s->count + 0.999999);
+    if (rank == 0) rank = 1;
+    if (rank > s->count) rank = s->count;
+    return s->ns[rank - 1];
+}
+
+double bench_samples_mean(const BenchSamples *s) {
+    if (s->count == 0) return 0.0;
+    double total = 0.0;
+    for (size_t i = 0; i < s->count; i++) {
+        total += (double)s->ns[i];
+    }
+    return total / (double)s->count;
+}
+
+void bench_samples_free(BenchSamples *s) {
+    free(s->ns);
+    bench_samples_init(s);
+}
+
+uint64_t bench_rand(uint64_t *state) {
+    uint64_t x = *state;
+    x ^= x >> 12;
+    x ^= x << 25;
+    x ^= x >> 27;
+    *state = x;
+    return x * 0x2545F4914F6CDD1DULL;
+}
+
+double bench_rand_unit(uint64_t *state) {
+    return (double)(bench_rand(state) >> 11) / (double)(1ULL << 53);
+}
+
+void bench_dict_config_defaults(BenchDictConfig *cfg) {
+    cfg->entries = 10000;
+    cfg->term_len = 8;
+    cfg->def_len = 60;
+    cfg->defs_per_term = 2;
+    cfg->variant_rate = 0.1;
+    cfg->shared_def_rate = 0.1;
+    cfg->case_lower = 0.6;
+    cfg->case_title = 0.3;
+    cfg->case_upper = 0.1;
+    cfg->seed = 0x5eed;
+}
+
+// variant: 0 = lower, 1 = Title, 2 = UPPER
+void bench_apply_case(char *dst, const char *src, int variant) {
+    size_t i = 0;
+    for (; src[i]; i++) {
+        unsigned char c = (unsigned char)src[i];
+        if (variant == 2 || (variant == 1 && i == 0)) {
+            dst[i] = (char)toupper(c);
+        } else {
+            dst[i] = (char)tolower(c);
+        }
+    }
+    dst[i] = '\0';
+}
+
+static int pick_case(const BenchDictConfig *cfg, uint64_t *rng) {
+    double total = cfg->case_lower + cfg->case_title + cfg->case_upper;
+    if (total <= 0.0) return 0;
+    double r = bench_rand_unit(rng) * total;
+    if (r < cfg->case_lower) return 0;
+    if (r < cfg->case_lower + cfg->case_title) return 1;
+    return 2;
+}
+
+static int jitter_len(int avg, uint64_t *rng) {
+    int spread = avg / 4;
+    int len = avg;
+    if (spread > 0) {
+        len += (int)(bench_rand(rng) % (uint64_t)(2 * spread + 1)) - spread;
+    }
+    return len < 1 ? 1 : len;
+}
+
+static void random_term(char *buf, int len, uint64_t *rng) {
+    static const char alphabet[] = "abcdefghijklmnopqrstuvwxyz0123456789";
+    // Keep the first character alphabetic so case variants differ
+    buf[0] = alphabet[bench_rand(rng) % 26];
+    for (int i = 1; i < len; i++) {
+        buf[i] = alphabet[bench_rand(rng) % (sizeof(alphabet) - 1)];
+    }
+    buf[len] = '\0';
+}
+
+static void random_definition(char *buf, int len, uint64_t *rng) {
+    int pos = 0;
+    while (pos < len) {
+        const char *word = bench_words[bench_rand(rng) % BENCH_WORD_COUNT];
+        int wlen = (int)strlen(word);
+        if (pos + wlen + 1 > len) break;
+        if (pos > 0) buf[pos++] = ' ';
+        memcpy(buf + pos, word, wlen);
+        pos += wlen;
+    }
+    if (pos == 0) buf[pos++] = 'x';
+    buf[pos] = '\0';
+}
+
+// Real dictionaries repeat stock definitions ("Abbreviation of ...", a
+// variant's "See X"), so some lines reuse one of these instead
+#define BENCH_SHARED_DEFS 64
+
+static void pick_definition(char *buf, int len, char (*shared)[BENCH_MAX_LINE],
+                            const BenchDictConfig *cfg, uint64_t *rng) {
+    if (cfg->shared_def_rate > 0.0 && bench_rand_unit(rng) < cfg->shared_def_rate) {
+        strcpy(buf, shared[bench_rand(rng) % BENCH_SHARED_DEFS]);
+    } else {
+        random_definition(buf, len, rng);
+    }
+}
+
+static int term_set_add(BenchTermSet *set, const char *term) {
+    if (!set) return 1;
+    if (set->count >= set->capacity) {
+        size_t new_capacity = set->capacity ? set->capacity * 2 : 1024;
+        char **tmp = realloc(set->terms, new_capacity * sizeof(char *));
+        if (!tmp) return 0;
+        set->terms = tmp;
+        set->capacity = new_capacity;
+    }
+    set->terms[set->count] = strdup(term);
+    if (!set->terms[set->count]) return 0;
+    set->count++;
+    return 1;
+}
+
+// Write `cfg->entries` lines of "term:definition" to path.
+// The distinct (lowercase) terms are recorded in `terms` when it is non-NULL.
+int bench_generate_dictionary(const char *path, const BenchDictConfig *cfg, BenchTermSet *terms) {
+    FILE *f = fopen(path, "w");
+    if (!f) return 0;
+
+    uint64_t rng = cfg->seed ? cfg->seed : 1;
+    int term_len = cfg->term_len < 1 ? 1 : (cfg->term_len > 64 ? 64 : cfg->term_len);
+    int def_len = cfg->def_len < 1 ? 1 : (cfg->def_len > 160 ? 160 : cfg->def_len);
+    int defs_per_term = cfg->defs_per_term < 1 ? 1 : cfg->defs_per_term;
+
+    char term[BENCH_MAX_LINE];
+    char cased[BENCH_MAX_LINE];
+    char definition[BENCH_MAX_LINE];
+    size_t written = 0;
+
+    // Drawn from their own stream so the rate does not change the stock set
+    char shared[BENCH_SHARED_DEFS][BENCH_MAX_LINE];
+    uint64_t shared_rng = rng ^ 0x5ba7edULL;
+    for (int i = 0; i < BENCH_SHARED_DEFS; i++) {
+        random_definition(shared[i], jitter_len(def_len, &shared_rng), &shared_rng);
+    }
+
+    while (written < cfg->entries) {
+        random_term(term, jitter_len(term_len, &rng), &rng);
+        if (!term_set_add(terms, term)) {
+            fclose(f);
+            return 0;
+        }
+
+        int primary = pick_case(cfg, &rng);
+        for (int d = 0; d < defs_per_term && written < cfg->entries; d++) {
+            bench_apply_case(cased, term, primary);
+            pick_definition(definition, jitter_len(def_len, &rng), shared, cfg, &rng);
+            fprintf(f, "%s:%s\n", cased, definition);
+            written++;
+        }
+
+        if (written < cfg->entries && bench_rand_unit(&rng) < cfg->variant_rate) {
+            int variant = (primary + 1 + (int)(bench_rand(&rng) % 2)) % 3;
+            bench_apply_case(cased, term, variant);
+            pick_definition(definition, jitter_len(def_len, &rng), shared, cfg, &rng);
+            fprintf(f, "%s:%s\n", cased, definition);
+            written++;
+        }
+    }
+
+    return fclose(f) == 0;
+}
+
+void bench_term_set_free(BenchTermSet *set) {
+    if (!set) return;
+    for (size_t i = 0; i < set->count; i++) {
+        free(set->terms[i]);
+    }
+    free(set->terms);
+    set->terms = NULL;
+    set->count = 0;
+    set->capacity = 0;
+}
+
+long bench_file_size(const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return -1;
+    return (long)st.st_size;
+}
+
+void bench_json_init(BenchJson *j, FILE *out) {
+    j->out = out;
+    j->depth = 0;
+    memset(j->need_comma, 0, sizeof(j->need_comma));
+}
+
+static void json_string_literal(FILE *out, const char *s) {
+    fputc('"', out);
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            fputc('\\', out);
+            fputc(c, out);
+        } else if (c < 0x20) {
+            fprintf(out, "\\u%04x", c);
+        } else {
+            fputc(c, out);
+        }
+    }
+    fputc('"', out);
+}
+
+// Emit separator, indentation and (inside objects) the key
+static void json_prefix(BenchJson *j, const char *key) {
+    if (j->depth > 0) {
+        if (j->need_comma[j->depth]) fputc(',', j->out);
+        fputc('\n', j->out);
+        j->need_comma[j->depth] = 1;
+    }
+    for (int i = 0; i < j->depth; i++) fputs("  ", j->out);
+    if (key) {
+        json_string_literal(j->out, key);
+        fputs(": ", j->out);
+    }
+}
+
+void bench_json_begin_object(BenchJson *j, const char *key) {
+    json_prefix(j, key);
+    fputc('{', j->out);
+    j->depth++;
+    j->need_comma[j->depth] = 0;
+}
+
+void bench_json_end_object(BenchJson *j) {
+    j->depth--;
+    fputc('\n', j->out);
+    for (int i = 0; i < j->depth; i++) fputs("  ", j->out);
+    fputc('}', j->out);
+    if (j->depth == 0) fputc('\n', j->out);
+}
+
+void bench_json_begin_array(BenchJson *j, const char *key) {
+    json_prefix(j, key);
+    fputc('[', j->out);
+    j->depth++;
+    j->need_comma[j->depth] = 0;
+}
+
+void bench_json_end_array(BenchJson *j) {
+    j->depth--;
+    fputc('\n', j->out);
+    for (int i = 0; i < j->depth; i++) fputs("  ", j->out);
+    fputc(']', j->out);
+}
+
+void bench_json_number(BenchJson *j, const char *key, double value) {
+    json_prefix(j, key);
+    fprintf(j->out, "%.3f", value);
+}
+
+void bench_json_uint(BenchJson *j, const char *key, uint64_t value) {
+    json_prefix(j, key);
+    fprintf(j->out, "%llu", (unsigned long long)value);
+}
+
+void bench_json_string(BenchJson *j, const char *key, const char *value) {
+    json_prefix(j, key);
+    json_string_literal(j->out, value);
+}
+
+// Latency summary for one operation. bytes_per_op > 0 adds a MB/s figure.
+void bench_op_result(BenchOpResult *r, const char *name, BenchSamples *s, double bytes_per_op) {
+    memset(r, 0, sizeof(*r));
+    snprintf(r->name, sizeof(r->name), "%s", name);
+    r->samples = s->count;
+    r->p50_ns = bench_samples_percentile(s, 50.0);
+    r->p99_ns = bench_samples_percentile(s, 99.0);
+    r->mean_ns = bench_samples_mean(s);
+    r->bytes_per_op = bytes_per_op;
+}
+
+void bench_json_op(BenchJson *j, const BenchOpResult *r) {
+    bench_json_begin_object(j, r->name);
+    bench_json_uint(j, "samples", r->samples);
+    bench_json_uint(j, "p50_ns", r->p50_ns);
+    bench_json_uint(j, "p99_ns", r->p99_ns);
+    bench_json_number(j, "mean_ns", r->mean_ns);
+    bench_json_number(j, "ops_per_sec", r->mean_ns > 0 ? 1e9 / r->mean_ns : 0.0);
+    if (r->bytes_per_op > 0 && r->mean_ns > 0) {
+        bench_json_number(j, "mb_per_sec",
+                          (r->bytes_per_op / (1024.0 * 1024.0)) / (r->mean_ns / 1e9));
+    }
+    bench_json_end_object(j);
+}
+
+void bench_json_samples(BenchJson *j, const char *key, BenchSamples *s, double bytes_per_op) {
+    BenchOpResult r;
+    bench_op_result(&r, key, s, bytes_per_op);
+    bench_json_op(j, &r);
+}
+
+int bench_should_continue(const BenchOptions *opt, uint64_t started_ns, size_t samples, size_t cap) {
+    if (samples < 3) return 1;
+    if (samples >= cap) return 0;
+    return (bench_now_ns() - started_ns) < (uint64_t)opt->budget_ms * 1000000ULL;
+}
+
+// A host's home: ~/.wtf with an empty res/, so nothing local matches and a
+// sync downloads
+int bench_host_create(const char *home) {
+    char path[4096];
+    if (mkdir(home, 0755) != 0) return 0;
+    snprintf(path, sizeof(path), "%s/.wtf", home);
+    if (mkdir(path, 0755) != 0) return 0;
+    snprintf(path, sizeof(path), "%s/.wtf/res", home);
+    return mkdir(path, 0755) == 0;
+}
+
+static int remove_entry(const char *path, const struct stat *st, int type, struct FTW *ftw) {
+    (void)st;
+    (void)type;
+    (void)ftw;
+    remove(path);
+    return 0;
+}
+
+// home and whatever the runs left in it, partial downloads and traces included
+void bench_host_remove(const char *home) {
+    nftw(home, remove_entry, 16, FTW_DEPTH | FTW_PHYS);
+}
+
+// `wtf <args>` with home as its HOME, synced against server when non-NULL,
+// and no shared base. Output is discarded. Fills run (when non-NULL) and
+// returns 1 if the process ran and exited.
+int bench_run_wtf(const char *binary, const char *home, const BenchHttpServer *server,
+                  const char *const args[], BenchRun *run) {
+    char env_home[4200], env_api[96], env_raw[96], env_trace[4200];
+    char *envp[8];
+    int envc = 0;
+    snprintf(env_home, sizeof(env_home), "WTF_HOME=%s", home);
+    envp[envc++] = env_home;
+    envp[envc++] = "WTF_SYSTEM_DIR=/nonexistent";
+    envp[envc++] = "WTF_STATE_DIR=/nonexistent";
+    if (server) {
+        snprintf(env_api, sizeof(env_api), "WTF_API_BASE=%s", server->api_base);
+        snprintf(env_raw, sizeof(env_raw), "WTF_RAW_BASE=%s", server->raw_base);
+        envp[envc++] = env_api;
+        envp[envc++] = env_raw;
+    }
+    if (run && run->trace) {
+        snprintf(env_trace, sizeof(env_trace), "WTF_TRACE=%s", run->trace);
+        envp[envc++] = env_trace;
+    }
+    envp[envc] = NULL;
+
+    char *argv[BENCH_MAX_ARGS + 2];
+    int argc = 0;
+    argv[argc++] = (char *)binary;
+    for (int i = 0; args[i] && argc <= BENCH_MAX_ARGS; i++) argv[argc++] = (char *)args[i];
+    argv[argc] = NULL;
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_addopen(&actions, STDIN_FILENO, "/dev/null", O_RDONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDOUT_FILENO, "/dev/null", O_WRONLY, 0);
+    posix_spawn_file_actions_addopen(&actions, STDERR_FILENO, "/dev/null", O_WRONLY, 0);
+    pid_t pid;
+    uint64_t t0 = bench_now_ns();
+    int rc = posix_spawn(&pid, binary, &actions, NULL, argv, envp);
+    posix_spawn_file_actions_destroy(&actions);
+    if (rc != 0) return 0;
+    int status;
+    struct rusage ru;
+    if (wait4(pid, &status, 0, &ru) != pid || !WIFEXITED(status)) return 0;
+    if (run) {
+        run->wall_ns = bench_now_ns() - t0;
+        run->cpu_ns = (uint64_t)(ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000000ull +
+                      (uint64_t)(ru.ru_utime.tv_usec + ru.ru_stime.tv_usec) * 1000ull;
+        run->peak_rss_kb = ru.ru_maxrss;
+    }
+    return 1;
+}
@@ -0,0 +1,233 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include "bench.h"
+#include "store_writer.h"
+
+#define WRITERS_MAX 1024
+#define WRITERS_BATCH 16
+
+// How the children write: the old fopen("a") + shared /tmp temp file, or StoreWriter
+typedef struct {
+    const char *name;
+    int locked;
+    int batch;         // records per commit
+    int mixed;         // one writer in eight removes seeded records instead of appending
+} WriterMode;
+
+static const WriterMode modes[] = {
+    {"stdio_append", 0, 1, 0},
+    {"locked_append", 1, 1, 0},
+    {"locked_group_commit", 1, WRITERS_BATCH, 0},
+    {"stdio_mixed", 0, 1, 1},
+    {"locked_mixed", 1, 1, 1},
+};
+#define WRITER_MODE_COUNT (int)(sizeof(modes) / sizeof(modes[0]))
+
+typedef struct {
+    const char *path;
+    const char *legacy_temp;
+    const char *definition;
+    size_t records;
+    int writers;
+    int removers;
+} WriterRun;
+
+static int legacy_append(const char *path, const char *term, const char *definition) {
+    FILE *f = fopen(path, "a");
+    if (!f) return 0;
+    fprintf(f, "%s:%s\n", term, definition);
+    fclose(f);
+    return 1;
+}
+
+// remove_from_removed() as it was: one temp path shared by every process
+static int legacy_remove(const char *path, const char *temp_path, const char *line_wanted) {
+    FILE *in = fopen(path, "r");
+    if (!in) return 0;
+    FILE *temp = fopen(temp_path, "w");
+    if (!temp) {
+        fclose(in);
+        return 0;
+    }
+    char line[512];
+    int removed = 0;
+    while (fgets(line, sizeof(line), in)) {
+        if (strcmp(line, line_wanted) != 0) {
+            fputs(line, temp);
+        } else {
+            removed = 1;
+        }
+    }
+    fclose(in);
+    fclose(temp);
+    if (removed) return rename(temp_path, path) == 0;
+    remove(temp_path);
+    return 0;
+}
+
+static void run_appender(const WriterRun *run, const WriterMode *mode, int id) {
+    StoreWriter writer;
+    store_writer_init(&writer, run->path);
+    char term[64];
+    for (size_t r = 0; r < run->records; r++) {
+        snprintf(term, sizeof(term), "w%d_%zu", id, r);
+        if (!mode->locked) {
+            legacy_append(run->path, term, run->definition);
+            continue;
+        }
+        store_writer_add(&writer, term, run->definition);
+        if (writer.records >= (size_t)mode->batch || r + 1 == run->records) store_writer_commit(&writer);
+    }
+    store_writer_free(&writer);
+}
+
+static void run_remover(const WriterRun *run, const WriterMode *mode, int id) {
+    StoreWriter writer;
+    store_writer_init(&writer, run->path);
+    char term[64], line[512];
+    for (size_t r = 0; r < run->records; r++) {
+        snprintf(term, sizeof(term), "seed%d_%zu", id, r);
+        if (mode->locked) {
+            store_writer_add(&writer, term, run->definition);
+            store_writer_remove(&writer);
+        } else {
+            snprintf(line, sizeof(line), "%s:%s\n", term, run->definition);
+            legacy_remove(run->path, run->legacy_temp, line);
+        }
+    }
+    store_writer_free(&writer);
+}
+
+// Every child waits on the pipe so they all start together. Returns wall time or 0.
+static uint64_t run_writers(const WriterRun *run, const WriterMode *mode) {
+    int go[2];
+    if (pipe(go) != 0) return 0;
+    pid_t pids[WRITERS_MAX];
+    int started = 0;
+    for (int w = 0; w < run->writers; w++) {
+        pid_t pid = fork();
+        if (pid < 0) break;
+        if (pid == 0) {
+            char c;
+            close(go[1]);
+            while (read(go[0], &c, 1) > 0);
+            if (w < run->removers) {
+                run_remover(run, mode, w);
+            } else {
+                run_appender(run, mode, w);
+            }
+            _exit(0);
+        }
+        pids[started++] = pid;
+    }
+    close(go[0]);
+    uint64_t t0 = bench_now_ns();
+    close(go[1]);
+    for (int w = 0; w < started; w++) waitpid(pids[w], NULL, 0);
+    uint64_t elapsed = bench_now_ns() - t0;
+    return started == run->writers ? elapsed : 0;
+}
+
+typedef struct {
+    uint64_t torn_lines;     // not a whole record
+    uint64_t lost_appends;   // appended by a writer, missing from the file
+    uint64_t resurrected;    // removed by a remover, back in the file
+} WriterCheck;
+
+static int seed_file(const WriterRun *run) {
+    FILE *f = fopen(run->path, "w");
+    if (!f) return 0;
+    for (int w = 0; w < run->removers; w++) {
+        for (size_t r = 0; r < run->records; r++) fprintf(f, "seed%d_%zu:%s\n", w, r, run->definition);
+    }
+    return fclose(f) == 0;
+}
+
+static void check_file(const WriterRun *run, WriterCheck *check) {
+    FILE *f = fopen(run->path, "r");
+    uint64_t appended = 0, seeds = 0;
+    char line[1024];
+    size_t def_len = strlen(run->definition);
+    while (f && fgets(line, sizeof(line), f)) {
+        char *colon = strchr(line, ':');
+        size_t len = strlen(line);
+        int whole = colon && len > 0 && line[len - 1] == '\n' &&
+                    (size_t)(line + len - 1 - (colon + 1)) == def_len &&
+                    strncmp(colon + 1, run->definition, def_len) == 0;
+        if (!whole) {
+            check->torn_lines++;
+        } else if (strncmp(line, "seed", 4) == 0) {
+            seeds++;
+        } else {
+            appended++;
+        }
+    }
+    if (f) fclose(f);
+    uint64_t expected = (uint64_t)(run->writers - run->removers) * run->records;
+    check->lost_appends += appended < expected ? expected - appended : 0;
+    check->resurrected += seeds;
+}
+
+// Per size (records per writer): time `writers` processes appending to, and
+// in the mixed modes removing from, one file; then check nothing was torn or lost
+int bench_suite_writers(const BenchOptions *opt, BenchJson *j) {
+    int writers = opt->writers > 0 ? opt->writers : 64;
+    if (writers > WRITERS_MAX) writers = WRITERS_MAX;
+
+    char path[512], temp[512];
+    snprintf(path, sizeof(path), "%s/wtf_bench_writers_%d.txt", opt->tmpdir, (int)getpid());
+    snprintf(temp, sizeof(temp), "%s/wtf_bench_writers_%d.temp", opt->tmpdir, (int)getpid());
+    char *definition = malloc((size_t)opt->dict.def_len + 1);
+    if (!definition) return 0;
+    for (int i = 0; i < opt->dict.def_len; i++) definition[i] = (char)('a' + i % 26);
+    definition[opt->dict.def_len] = '\0';
+
+    bench_json_uint(j, "writers", (uint64_t)writers);
+    bench_json_uint(j, "batch", WRITERS_BATCH);
+    bench_json_begin_array(j, "results");
+    for (int i = 0; i < opt->size_count; i++) {
+        bench_json_begin_object(j, NULL);
+        bench_json_uint(j, "records_per_writer", opt->sizes[i]);
+        bench_json_begin_object(j, "modes");
+        for (int m = 0; m < WRITER_MODE_COUNT; m++) {
+            WriterRun run = {path, temp, definition, opt->sizes[i], writers, modes[m].mixed ? writers / 8 : 0};
+            WriterCheck check = {0, 0, 0};
+            BenchSamples wall;
+            bench_samples_init(&wall);
+            uint64_t started = bench_now_ns();
+            while (bench_should_continue(opt, started, wall.count, (size_t)opt->max_reps)) {
+                if (!seed_file(&run)) break;
+                uint64_t ns = run_writers(&run, &modes[m]);
+                if (ns == 0) break;
+                bench_samples_add(&wall, ns);
+                check_file(&run, &check);
+            }
+            unlink(path);
+            unlink(temp);
+
+            BenchOpResult result;
+            bench_op_result(&result, modes[m].name, &wall, 0);
+            double records = (double)run.writers * (double)run.records;
+            bench_json_begin_object(j, modes[m].name);
+            bench_json_uint(j, "samples", result.samples);
+            bench_json_uint(j, "p50_ns", result.p50_ns);
+            bench_json_uint(j, "p99_ns", result.p99_ns);
+            bench_json_number(j, "records_per_sec", result.mean_ns > 0 ? records / (result.mean_ns / 1e9) : 0.0);
+            bench_json_uint(j, "torn_lines", check.torn_lines);
+            bench_json_uint(j, "lost_appends", check.lost_appends);
+            bench_json_uint(j, "resurrected", check.resurrected);
+            bench_json_end_object(j);
+            bench_samples_free(&wall);
+            fflush(j->out);
+        }
+        bench_json_end_object(j);
+        bench_json_end_object(j);
+    }
+    bench_json_end_array(j);
+    free(definition);
+    return 1;
+}
@@ -15,11 +15,13 @@ echo "Version found: ${VERSION}"
 sed -e "s/@VERSION@/${VERSION}/g" "control.in" | awk 'NR > 1{print l} {l=$0} END{print l; print ""}' > "wtf_package/DEBIAN/control"
 
 rm -f wtf_package/usr/bin/*
-rm -f wtf_package/.wtf/res/*
+rm -f wtf_package/usr/lib/wtf/*
+rm -f wtf_package/usr/share/wtf/res/*
 
 # Create necessary directories if they don't exist
 mkdir -p wtf_package/usr/bin
-mkdir -p wtf_package/.wtf/res
+mkdir -p wtf_package/usr/lib/wtf
+mkdir -p wtf_package/usr/share/wtf/res
 
 # Build both architectures
 echo "Building AMD64 binary..."
@@ -33,13 +35,20 @@ cp build/wtf_amd64 wtf_package/usr/bin/
 cp build/wtf_i386 wtf_package/usr/bin/
 chmod +x wtf_package/usr/bin/wtf_*
 
-# Copy definitions file
+# Copy sync modules (loaded only when a sync runs)
+echo "Copying sync modules..."
+cp build/wtf_sync_amd64.so wtf_package/usr/lib/wtf/
+cp build/wtf_sync_i386.so wtf_package/usr/lib/wtf/
+
+# Copy definitions file (the seed of the base dictionary shared by every user)
 echo "Copying definitions file..."
-cp .wtf/res/definitions.txt wtf_package/.wtf/res/
+cp .wtf/res/definitions.txt wtf_package/usr/share/wtf/res/
 
 # Set correct permissions
 chmod 755 wtf_package/DEBIAN/postinst
 chmod 755 wtf_package/DEBIAN/prerm
+chmod 755 wtf_package/DEBIAN/postrm
+chmod 755 wtf_package/etc/cron.daily/wtf
 
 # Build the package
 echo "Building Debian package..."
@@ -0,0 +1,724 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <zlib.h>
+#include "block_store.h"
+#include "casefold.h"
+#include "stats.h"
+#include "sync_lock.h"
+
+static void put_u16(unsigned char *p, uint16_t v) {
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static void put_u32(unsigned char *p, uint32_t v) {
+    for (int i = 0; i < 4; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static void put_u64(unsigned char *p, uint64_t v) {
+    for (int i = 0; i < 8; i++) p[i] = (unsigned char)(v >> (8 * i));
+}
+
+static uint16_t get_u16(const unsigned char *p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get_u32(const unsigned char *p) {
+    uint32_t v = 0;
+    for (int i = 3; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+static uint64_t get_u64(const unsigned char *p) {
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; i--) v = (v << 8) | p[i];
+    return v;
+}
+
+// Compare a key of key_len bytes, folded the way the store was sorted, against
+// an already folded term
+static int compare_folded(const BlockStore *store, const char *key, size_t key_len, const char *folded) {
+    if (!store->ascii_folded) {
+        char buf[CASEFOLD_SIZE(256)];
+        if (casefold_n(key, key_len, buf, sizeof(buf)) >= sizeof(buf)) return 1;
+        return strcmp(buf, folded);
+    }
+    for (size_t i = 0; i < key_len; i++) {
+        unsigned char a = (unsigned char)key[i];
+        unsigned char b = (unsigned char)folded[i];
+        if (a >= 'A' && a <= 'Z') a = (unsigned char)(a + 32);
+        if (a != b) return (int)a - (int)b;
+    }
+    return folded[key_len] == '\0' ? 0 : -1;
+}
+
+static int read_at(BlockStore *store, void *buf, size_t len, uint64_t offset) {
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pread(store->fd, (char *)buf + done, len - done, (off_t)(offset + done));
+        if (n <= 0) return 0;
+        done += (size_t)n;
+    }
+    __atomic_fetch_add(&store->bytes_read, len, __ATOMIC_RELAXED);
+    if (wtf_stats_enabled) stats_note_read(len);
+    return 1;
+}
+
+// Map the filter section rather than reading it, so a lookup only faults in
+// the page holding its one 64-byte block
+static int map_bloom(BlockStore *store, uint64_t offset, uint32_t blocks, uint32_t k,
+                     size_t header_size, uint64_t index_offset) {
+    if (blocks == 0) return 1;  // written without a filter
+    uint64_t size = (uint64_t)blocks * BLOOM_BLOCK_BYTES;
+    if (k == 0 || k > BLOOM_MAX_K || offset < header_size ||
+        offset > index_offset || size > index_offset - offset) {
+        return 0;
+    }
+
+    long page = sysconf(_SC_PAGESIZE);
+    uint64_t start = offset - offset % (uint64_t)page;
+    size_t map_size = (size_t)(offset + size - start);
+    void *map = mmap(NULL, map_size, PROT_READ, MAP_SHARED, store->fd, (off_t)start);
+    if (map == MAP_FAILED) return 0;
+    store->bloom.map = map;
+    store->bloom.map_size = map_size;
+    store->bloom.bits = (uint8_t *)map + (offset - start);
+    store->bloom.block_count = blocks;
+    store->bloom.k = k;
+    return 1;
+}
+
+// Open a block store, reading only its header and mapping its filter; the
+// index is read by the first lookup the filter lets through. Returns NULL if
+// the file is missing or its header is malformed.
+BlockStore* block_store_open_lazy(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+
+    struct stat st;
+    BlockStore *store = wtf_calloc(1, sizeof(BlockStore));
+    if (!store || fstat(fd, &st) != 0) {
+        wtf_free(store);
+        close(fd);
+        return NULL;
+    }
+    store->fd = fd;
+    store->file_size = (uint64_t)st.st_size;
+    store->path = wtf_strdup(path);
+    if (!store->path) {
+        block_store_close(store);
+        return NULL;
+    }
+
+    unsigned char header[BLOCK_STORE_HEADER_SIZE];
+    if (store->file_size < BLOCK_STORE_HEADER_SIZE_V1 ||
+        !read_at(store, header, BLOCK_STORE_HEADER_SIZE_V1, 0) ||
+        memcmp(header, BLOCK_STORE_MAGIC, 4) != 0 ||
+        get_u32(header + 8) != BLOCK_STORE_CODEC_ZLIB) {
+        block_store_close(store);
+        return NULL;
+    }
+    uint32_t version = get_u32(header + 4);
+    size_t header_size = version == 1 ? BLOCK_STORE_HEADER_SIZE_V1 :
+                         version < 4 ? BLOCK_STORE_HEADER_SIZE_V2 : BLOCK_STORE_HEADER_SIZE;
+    if (version < 1 || version > BLOCK_STORE_VERSION ||
+        (version != 1 && (store->file_size < header_size ||
+                          !read_at(store, header + BLOCK_STORE_HEADER_SIZE_V1,
+                                   header_size - BLOCK_STORE_HEADER_SIZE_V1, BLOCK_STORE_HEADER_SIZE_V1)))) {
+        block_store_close(store);
+        return NULL;
+    }
+    store->ascii_folded = version < 3;
+    static const unsigned char unknown_source[SHA1_DIGEST_SIZE];
+    if (version >= 4 && memcmp(header + 56, unknown_source, SHA1_DIGEST_SIZE) != 0) {
+        sha1_hex(header + 56, store->source_sha);
+    }
+    store->block_count = get_u32(header + 12);
+    store->entry_count = get_u64(header + 16);
+    store->index_offset = get_u64(header + 24);
+    if (store->index_offset < header_size || store->index_offset > store->file_size ||
+        (version != 1 && !map_bloom(store, get_u64(header + 32), get_u32(header + 40),
+                                    get_u32(header + 44), header_size, store->index_offset))) {
+        block_store_close(store);
+        return NULL;
+    }
+    if (store->bloom.bits) {
+        store->bloom_terms = get_u64(header + 48);
+        if (wtf_stats_enabled) {
+            stats_note_bloom_filter(bloom_estimated_fpr(&store->bloom, (size_t)store->bloom_terms),
+                                    (size_t)store->bloom.block_count * BLOOM_BLOCK_BYTES);
+        }
+    }
+    return store;
+}
+
+// Read and parse the index. Returns 0 (and leaves the store without blocks)
+// if it is truncated or malformed.
+static int load_index(BlockStore *store) {
+    // The first terms are unpacked in place: each length prefix becomes the
+    // previous name's terminator, so one allocation holds every name
+    size_t index_size = (size_t)(store->file_size - store->index_offset);
+    unsigned char *index = wtf_malloc(index_size + 1);
+    BlockInfo *blocks = wtf_calloc(store->block_count ? store->block_count : 1, sizeof(BlockInfo));
+    if (!index || !blocks || !read_at(store, index, index_size, store->index_offset)) {
+        wtf_free(index);
+        wtf_free(blocks);
+        return 0;
+    }
+
+    size_t pos = 0;
+    uint32_t parsed = 0;
+    for (uint32_t i = 0; i < store->block_count; i++) {
+        if (pos + 18 > index_size) break;
+        BlockInfo *info = &blocks[i];
+        info->offset = get_u64(index + pos);
+        info->compressed_size = get_u32(index + pos + 8);
+        info->raw_size = get_u32(index + pos + 12);
+        uint16_t len = get_u16(index + pos + 16);
+        pos += 18;
+        if (pos + len > index_size) break;
+        memmove(index + pos - 1, index + pos, len);
+        index[pos - 1 + len] = '\0';
+        info->first = (const char *)(index + pos - 1);
+        pos += len;
+        parsed++;
+    }
+    if (parsed != store->block_count || pos != index_size) {
+        wtf_free(index);
+        wtf_free(blocks);
+        return 0;
+    }
+    store->blocks = blocks;
+    store->names = (char *)index;
+    return 1;
+}
+
+// Open a block store and read its index. Returns NULL if the file is missing or malformed.
+BlockStore* block_store_open(const char *path) {
+    BlockStore *store = block_store_open_lazy(path);
+    if (store && !load_index(store)) {
+        block_store_close(store);
+        return NULL;
+    }
+    return store;
+}
+
+void block_store_close(BlockStore *store) {
+    if (!store) return;
+    if (store->fd >= 0) close(store->fd);
+    bloom_free(&store->bloom);
+    trigram_index_free(store->trigrams);
+    phonetic_index_free(store->phonetics);
+    wtf_free(store->blocks);
+    wtf_free(store->names);
+    wtf_free(store->path);
+    wtf_free(store);
+}
+
+// Last block whose first term is <= folded, or -1 when folded sorts before everything
+static long find_block(const BlockStore *store, const char *folded) {
+    long lo = 0, hi = (long)store->block_count - 1, found = -1;
+    while (lo <= hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (strcmp(store->blocks[mid].first, folded) <= 0) {
+            found = mid;
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return found;
+}
+
+static char* read_block(BlockStore *store, const BlockInfo *info) {
+    STATS_BEGIN(started);
+    unsigned char *compressed = wtf_malloc(info->compressed_size ? info->compressed_size : 1);
+    char *raw = wtf_malloc((size_t)info->raw_size + 1);
+    if (!compressed || !raw ||
+        !read_at(store, compressed, info->compressed_size, info->offset)) {
+        wtf_free(compressed);
+        wtf_free(raw);
+        STATS_END(STAT_BLOCK_READ, started);
+        return NULL;
+    }
+
+    uLongf raw_len = info->raw_size;
+    int ret = uncompress((Bytef *)raw, &raw_len, compressed, info->compressed_size);
+    wtf_free(compressed);
+    STATS_END(STAT_BLOCK_READ, started);
+    if (ret != Z_OK || raw_len != info->raw_size) {
+        wtf_free(raw);
+        return NULL;
+    }
+    raw[raw_len] = '\0';
+    __atomic_fetch_add(&store->blocks_read, 1, __ATOMIC_RELAXED);
+    return raw;
+}
+
+// Append every definition for term (any case) to out, exact-case matches first
+// and, like the hash table, later lines before earlier ones. The matches point
+// into the decompressed block, which out takes ownership of.
+// Returns the number of definitions appended.
+int block_store_lookup_view(BlockStore *store, const char *term, LookupResult *out) {
+    if (!store || !term || !out) return 0;
+
+    char folded[CASEFOLD_SIZE(256)];
+    size_t len = strlen(term);
+    if (len >= 256) return 0;  // longer than any line load_definitions() accepts
+    if (store->ascii_folded) {
+        casefold_ascii(term, folded, sizeof(folded));
+    } else {
+        casefold(term, folded, sizeof(folded));
+    }
+
+    // A filter miss means no block can hold the term: skip the read entirely.
+    // Older stores hashed ASCII-folded terms, which only agree for ASCII input.
+    int filtered = store->bloom.bits != NULL && (!store->ascii_folded || casefold_is_ascii(term));
+    if (filtered) {
+        int maybe = bloom_maybe_contains(&store->bloom, bloom_hash(folded));
+        if (wtf_stats_enabled) stats_note_bloom_check(maybe);
+        if (!maybe) {
+            __atomic_fetch_add(&store->bloom_rejects, 1, __ATOMIC_RELAXED);
+            return 0;
+        }
+    }
+
+    if (!store->blocks && !load_index(store)) return 0;
+    long b = find_block(store, folded);
+    if (b < 0) {
+        if (filtered && wtf_stats_enabled) stats_note_bloom_false_positive();
+        return 0;
+    }
+    char *raw = read_block(store, &store->blocks[b]);
+    if (!raw) return 0;
+
+    // Split the matching run of lines in place
+    LookupResult run;
+    lookup_result_init(&run);
+    char *line = raw;
+    while (*line) {
+        char *end = strchr(line, '\n');
+        char *next = end ? end + 1 : line + strlen(line);
+        char *colon = memchr(line, ':', (size_t)(next - line));
+        if (colon) {
+            int cmp = compare_folded(store, line, (size_t)(colon - line), folded);
+            if (cmp > 0) break;
+            if (cmp == 0) {
+                *colon = '\0';
+                if (end) *end = '\0';
+                lookup_result_add(&run, line, colon + 1);
+            }
+        }
+        line = next;
+    }
+
+    int before = out->count;
+    for (int pass = 0; pass < 2; pass++) {
+        for (int i = run.count; i-- > 0;) {
+            int exact = strcmp(run.matches[i].key, term) == 0;
+            if ((pass == 0) == exact) {
+                lookup_result_add(out, run.matches[i].key, run.matches[i].definition);
+            }
+        }
+    }
+    lookup_result_free(&run);
+
+    if (out->count > before) {
+        lookup_result_keep(out, raw);
+    } else {
+        wtf_free(raw);
+        if (filtered && wtf_stats_enabled) stats_note_bloom_false_positive();
+    }
+    return out->count - before;
+}
+
+// Add every term in the store to builder, inflating each block in turn
+int block_store_collect_terms(BlockStore *store, TrigramBuilder *builder) {
+    if (!store->blocks && !load_index(store)) return 0;
+
+    for (uint32_t b = 0; b < store->block_count; b++) {
+        char *raw = read_block(store, &store->blocks[b]);
+        if (!raw) return 0;
+        char *line = raw;
+        int ok = 1;
+        while (*line && ok) {
+            char *end = strchr(line, '\n');
+            char *next = end ? end + 1 : line + strlen(line);
+            char *colon = memchr(line, ':', (size_t)(next - line));
+            if (colon) {
+                *colon = '\0';
+                ok = trigram_builder_add(builder, line);
+            }
+            line = next;
+        }
+        wtf_free(raw);
+        if (!ok) return 0;
+    }
+    return 1;
+}
+
+// store_path with its ".wtfb" swapped for extension (any other name gets it appended)
+static int sibling_path(const char *store_path, const char *extension, char *out, size_t size) {
+    size_t len = strlen(store_path);
+    size_t suffix = strlen(".wtfb");
+    if (len > suffix && strcmp(store_path + len - suffix, ".wtfb") == 0) {
+        return (size_t)snprintf(out, size, "%.*s%s", (int)(len - suffix), store_path, extension) < size;
+    }
+    return (size_t)snprintf(out, size, "%s%s", store_path, extension) < size;
+}
+
+// definitions.wtft beside a definitions.wtfb
+int block_store_trigram_path(const char *store_path, char *out, size_t size) {
+    return sibling_path(store_path, ".wtft", out, size);
+}
+
+// definitions.wtfp beside a definitions.wtfb
+int block_store_phonetic_path(const char *store_path, char *out, size_t size) {
+    return sibling_path(store_path, ".wtfp", out, size);
+}
+
+// The store's trigram index, mapped from the file written beside it. A store
+// without one (or whose term count disagrees, i.e. a stale file) is indexed
+// in memory by inflating every block. Returns NULL only on failure.
+TrigramIndex* block_store_trigram_index(BlockStore *store) {
+    if (store->trigrams) return store->trigrams;
+
+    char path[4096];
+    if (block_store_trigram_path(store->path, path, sizeof(path))) {
+        store->trigrams = trigram_index_open(path);
+    }
+    if (store->trigrams && store->bloom_terms && store->trigrams->term_count != store->bloom_terms) {
+        trigram_index_free(store->trigrams);
+        store->trigrams = NULL;
+    }
+    if (!store->trigrams) {
+        TrigramBuilder builder;
+        trigram_builder_init(&builder);
+        if (block_store_collect_terms(store, &builder)) {
+            store->trigrams = trigram_builder_build(&builder);
+        }
+        trigram_builder_free(&builder);
+    }
+    return store->trigrams;
+}
+
+// The store's phonetic index, mapped from the file written beside it, or
+// built over the trigram index when that file is missing or stale. Returns
+// NULL only on failure.
+PhoneticIndex* block_store_phonetic_index(BlockStore *store) {
+    if (store->phonetics) return store->phonetics;
+    TrigramIndex *terms = block_store_trigram_index(store);
+    if (!terms) return NULL;
+
+    char path[4096];
+    if (block_store_phonetic_path(store->path, path, sizeof(path))) {
+        store->phonetics = phonetic_index_open(path, terms);
+    }
+    if (!store->phonetics) store->phonetics = phonetic_index_build(terms);
+    return store->phonetics;
+}
+
+void block_builder_init(BlockBuilder *builder) {
+    memset(builder, 0, sizeof(*builder));
+}
+
+int block_builder_add(BlockBuilder *builder, const char *term, const char *definition) {
+    size_t term_len = strlen(term) + 1;
+    size_t def_len = strlen(definition) + 1;
+
+    if (builder->arena_size + term_len + def_len > builder->arena_capacity) {
+        size_t capacity = builder->arena_capacity ? builder->arena_capacity : 64 * 1024;
+        while (builder->arena_size + term_len + def_len > capacity) capacity *= 2;
+        char *arena = wtf_realloc(builder->arena, capacity);
+        if (!arena) return 0;
+        builder->arena = arena;
+        builder->arena_capacity = capacity;
+    }
+    if (builder->count == builder->capacity) {
+        size_t capacity = builder->capacity ? builder->capacity * 2 : 4096;
+        size_t *entries = wtf_realloc(builder->entries, capacity * sizeof(size_t));
+        if (!entries) return 0;
+        builder->entries = entries;
+        builder->capacity = capacity;
+    }
+
+    builder->entries[builder->count++] = builder->arena_size;
+    memcpy(builder->arena + builder->arena_size, term, term_len);
+    memcpy(builder->arena + builder->arena_size + term_len, definition, def_len);
+    builder->arena_size += term_len + def_len;
+    return 1;
+}
+
+// Parse one fgets()-sized piece exactly like load_definitions()
+static int builder_add_piece(BlockBuilder *builder, char *piece) {
+    char *save = NULL;
+    char *term = strtok_r(piece, ":", &save);
+    char *definition = strtok_r(NULL, "\n", &save);
+    if (term && definition) {
+        return block_builder_add(builder, term, definition);
+    }
+    return 1;
+}
+
+// Add raw definitions.txt bytes; lines may be split anywhere across calls
+int block_builder_feed(BlockBuilder *builder, const char *data, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        builder->pending[builder->pending_len++] = data[i];
+        if (data[i] == '\n' || builder->pending_len == sizeof(builder->pending) - 1) {
+            builder->pending[builder->pending_len] = '\0';
+            builder->pending_len = 0;
+            if (!builder_add_piece(builder, builder->pending)) return 0;
+        }
+    }
+    return 1;
+}
+
+// What qsort_r() hands compare_entries(). A large dictionary's sort takes
+// seconds, so the comparisons keep the sync lock's heartbeat going.
+typedef struct {
+    const char *arena;   // the builder's
+    size_t compares;
+} EntrySort;
+
+static int compare_entries(const void *a, const void *b, void *arg) {
+    size_t x = *(const size_t *)a;
+    size_t y = *(const size_t *)b;
+    EntrySort *sort = arg;
+    SYNC_LOCK_PULSE(++sort->compares);
+    int c = casefold_compare(sort->arena + x, sort->arena + y);
+    if (c != 0) return c;
+    // Arena offsets grow with insertion order, which keeps the sort stable
+    return (x > y) - (x < y);
+}
+
+static int same_folded(const char *a, const char *b) {
+    return casefold_equal(a, b);
+}
+
+static int write_all(FILE *f, const void *data, size_t len) {
+    return fwrite(data, 1, len, f) == len;
+}
+
+static int flush_block(FILE *f, const char *raw, size_t raw_len, uint64_t *offset,
+                       unsigned char **index, size_t *index_len, size_t *index_cap,
+                       const char *first, uint32_t *block_count) {
+    uLongf bound = compressBound((uLong)raw_len);
+    unsigned char *compressed = wtf_malloc(bound);
+    if (!compressed) return 0;
+    if (compress2(compressed, &bound, (const Bytef *)raw, (uLong)raw_len, Z_DEFAULT_COMPRESSION) != Z_OK ||
+        !write_all(f, compressed, bound)) {
+        wtf_free(compressed);
+        return 0;
+    }
+    wtf_free(compressed);
+
+    size_t first_len = casefold(first, NULL, 0);
+    if (first_len > 0xffff) first_len = 0xffff;
+    if (*index_len + 18 + first_len > *index_cap) {
+        size_t cap = *index_cap ? *index_cap * 2 : 4096;
+        while (*index_len + 18 + first_len > cap) cap *= 2;
+        unsigned char *grown = wtf_realloc(*index, cap);
+        if (!grown) return 0;
+        *index = grown;
+        *index_cap = cap;
+    }
+    unsigned char *entry = *index + *index_len;
+    put_u64(entry, *offset);
+    put_u32(entry + 8, (uint32_t)bound);
+    put_u32(entry + 12, (uint32_t)raw_len);
+    put_u16(entry + 16, (uint16_t)first_len);
+    char folded[CASEFOLD_SIZE(256)];
+    if (first_len < sizeof(folded)) {
+        casefold(first, folded, sizeof(folded));
+        memcpy(entry + 18, folded, first_len);
+    } else {
+        char *long_folded = wtf_malloc(first_len + 1);
+        if (!long_folded) return 0;
+        casefold(first, long_folded, first_len + 1);
+        memcpy(entry + 18, long_folded, first_len);
+        wtf_free(long_folded);
+    }
+    *index_len += 18 + first_len;
+    *offset += bound;
+    (*block_count)++;
+    return 1;
+}
+
+// Sort everything added so far and write it to path via a per-process temporary file.
+// All lines for one folded term always land in the same block.
+int block_builder_write(BlockBuilder *builder, const char *path) {
+    if (builder->pending_len > 0) {
+        builder->pending[builder->pending_len] = '\0';
+        builder->pending_len = 0;
+        if (!builder_add_piece(builder, builder->pending)) return 0;
+    }
+
+    EntrySort sort = {builder->arena, 0};
+    qsort_r(builder->entries, builder->count, sizeof(size_t), compare_entries, &sort);
+
+    char tmp_path[4096];
+    if ((size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid()) >= sizeof(tmp_path)) return 0;
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return 0;
+
+    // One filter entry per folded term, sized for WTF_BLOOM_FPR
+    size_t groups = 0;
+    for (size_t i = 0; i < builder->count; i++) {
+        const char *term = builder->arena + builder->entries[i];
+        if (i == 0 || !same_folded(term, builder->arena + builder->entries[i - 1])) groups++;
+    }
+    BloomFilter bloom;
+    if (!bloom_init(&bloom, groups, bloom_target_fpr())) {
+        fclose(f);
+        remove(tmp_path);
+        return 0;
+    }
+
+    unsigned char header[BLOCK_STORE_HEADER_SIZE] = {0};
+    char *raw = wtf_malloc(BLOCK_STORE_BLOCK_SIZE * 2);
+    size_t raw_cap = BLOCK_STORE_BLOCK_SIZE * 2;
+    size_t raw_len = 0;
+    unsigned char *index = NULL;
+    size_t index_len = 0, index_cap = 0;
+    uint64_t offset = BLOCK_STORE_HEADER_SIZE;
+    uint32_t block_count = 0;
+    const char *block_first = NULL;
+    const char *previous = NULL;
+    TrigramBuilder terms;
+    trigram_builder_init(&terms);
+    int ok = raw && write_all(f, header, sizeof(header));
+
+    for (size_t i = 0; ok && i < builder->count; i++) {
+        const char *term = builder->arena + builder->entries[i];
+        const char *definition = term + strlen(term) + 1;
+        SYNC_LOCK_PULSE(i);
+
+        // Only cut between groups so a lookup never needs a second block
+        if (raw_len >= BLOCK_STORE_BLOCK_SIZE && !same_folded(term, previous)) {
+            ok = flush_block(f, raw, raw_len, &offset, &index, &index_len, &index_cap,
+                             block_first, &block_count);
+            raw_len = 0;
+            if (!ok) break;
+        }
+        if (raw_len == 0) block_first = term;
+        if (!previous || !same_folded(term, previous)) bloom_add(&bloom, bloom_hash(term));
+        if (!trigram_builder_add(&terms, term)) {
+            ok = 0;
+            break;
+        }
+
+        size_t line_len = strlen(term) + 1 + strlen(definition) + 1;
+        if (raw_len + line_len > raw_cap) {
+            while (raw_len + line_len > raw_cap) raw_cap *= 2;
+            char *grown = wtf_realloc(raw, raw_cap);
+            if (!grown) {
+                ok = 0;
+                break;
+            }
+            raw = grown;
+        }
+        raw_len += (size_t)sprintf(raw + raw_len, "%s:%s\n", term, definition);
+        previous = term;
+    }
+    if (ok && raw_len > 0) {
+        ok = flush_block(f, raw, raw_len, &offset, &index, &index_len, &index_cap,
+                         block_first, &block_count);
+    }
+    uint64_t bloom_offset = offset;
+    size_t bloom_size = (size_t)bloom.block_count * BLOOM_BLOCK_BYTES;
+    if (ok) {
+        ok = write_all(f, bloom.bits, bloom_size);
+        offset += bloom_size;
+    }
+    if (ok && index_len > 0) {
+        ok = write_all(f, index, index_len);
+    }
+
+    memcpy(header, BLOCK_STORE_MAGIC, 4);
+    put_u32(header + 4, BLOCK_STORE_VERSION);
+    put_u32(header + 8, BLOCK_STORE_CODEC_ZLIB);
+    put_u32(header + 12, block_count);
+    put_u64(header + 16, (uint64_t)builder->count);
+    put_u64(header + 24, offset);
+    put_u64(header + 32, bloom_offset);
+    put_u32(header + 40, bloom.block_count);
+    put_u32(header + 44, bloom.k);
+    put_u64(header + 48, (uint64_t)groups);
+    if (builder->source_sha[0]) sha1_parse_hex(builder->source_sha, header + 56);
+    if (ok) {
+        ok = fseek(f, 0, SEEK_SET) == 0 && write_all(f, header, sizeof(header));
+    }
+
+    wtf_free(raw);
+    wtf_free(index);
+    bloom_free(&bloom);
+    if (fclose(f) != 0) ok = 0;
+    if (ok && rename(tmp_path, path) != 0) ok = 0;
+    if (!ok) remove(tmp_path);
+
+    // The trigram and phonetic indexes are optional: without them, `wtf find`
+    // and the sound-alike suggestions index the blocks themselves
+    char trigram_path[4096], phonetic_path[4096];
+    if (ok && block_store_trigram_path(path, trigram_path, sizeof(trigram_path)) &&
+        block_store_phonetic_path(path, phonetic_path, sizeof(phonetic_path))) {
+        TrigramIndex *trigrams = trigram_builder_build(&terms);
+        if (!trigrams || !trigram_index_write(trigrams, trigram_path)) remove(trigram_path);
+        sync_lock_heartbeat();
+        PhoneticIndex *phonetics = phonetic_index_build(trigrams);
+        if (!phonetics || !phonetic_index_write(phonetics, phonetic_path)) remove(phonetic_path);
+        phonetic_index_free(phonetics);
+        trigram_index_free(trigrams);
+    }
+    trigram_builder_free(&terms);
+    return ok;
+}
+
+void block_builder_free(BlockBuilder *builder) {
+    wtf_free(builder->arena);
+    wtf_free(builder->entries);
+    memset(builder, 0, sizeof(*builder));
+}
+
+// Convert a definitions.txt into a block store, recording the text's blob id
+int block_store_build_from_text(const char *text_path, const char *store_path) {
+    FILE *in = fopen(text_path, "r");
+    struct stat st;
+    if (!in) return 0;
+    if (fstat(fileno(in), &st) != 0) {
+        fclose(in);
+        return 0;
+    }
+
+    BlockBuilder builder;
+    block_builder_init(&builder);
+    Sha1 source;
+    git_blob_sha1_begin(&source, (uint64_t)st.st_size);
+
+    char buffer[64 * 1024];
+    size_t n;
+    uint64_t total = 0;
+    int ok = 1;
+    while (ok && (n = fread(buffer, 1, sizeof(buffer), in)) > 0) {
+        sync_lock_heartbeat();
+        sha1_update(&source, buffer, n);
+        total += n;
+        ok = block_builder_feed(&builder, buffer, n);
+    }
+    if (ferror(in)) ok = 0;
+    fclose(in);
+    // A file that changed size while being read gets no id rather than a wrong one
+    if (ok && total == (uint64_t)st.st_size) {
+        unsigned char digest[SHA1_DIGEST_SIZE];
+        sha1_final(&source, digest);
+        sha1_hex(digest, builder.source_sha);
+    }
+
+    if (ok) ok = block_builder_write(&builder, store_path);
+    block_builder_free(&builder);
+    return ok;
+}
@@ -0,0 +1,100 @@
+#ifndef BLOCK_STORE_H
+#define BLOCK_STORE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hash_table.h"
+#include "bloom.h"
+#include "trigram.h"
+#include "phonetic.h"
+#include "sha1.h"
+
+// definitions.wtfb: the base dictionary as independently zlib-compressed blocks
+// of "term:definition\n" lines sorted by folded term (casefold.h; versions 1 and
+// 2 folded ASCII only), followed by an index of the first term in each block.
+// A lookup inflates at most one block.
+//
+// Layout (integers little-endian):
+//   header  "WTFB" | u32 version | u32 codec | u32 block_count | u64 entries | u64 index_offset
+//           version 2+ adds: u64 bloom_offset | u32 bloom_blocks | u32 bloom_k | u64 bloom_terms
+//           version 4+ adds: u8[20] source | u32 reserved
+//   blocks  compressed data, back to back
+//   bloom   (version 2+) blocked Bloom filter over the folded terms
+//   index   per block: u64 offset | u32 compressed size | u32 raw size | u16 len | first term
+//
+// source is the git blob id of the definitions.txt the store was built from
+// (all zero when unknown), so a sync can tell it already has a version
+// without downloading it.
+//
+// Every store is written with a trigram index of its terms beside it (see
+// trigram.h), and a phonetic index over that (see phonetic.h).
+#define BLOCK_STORE_FILE "definitions.wtfb"
+#define BLOCK_STORE_MAGIC "WTFB"
+#define BLOCK_STORE_VERSION 4
+#define BLOCK_STORE_CODEC_ZLIB 1
+#define BLOCK_STORE_HEADER_SIZE_V1 32
+#define BLOCK_STORE_HEADER_SIZE_V2 56
+#define BLOCK_STORE_HEADER_SIZE 80
+#define BLOCK_STORE_BLOCK_SIZE (16 * 1024)  // target uncompressed bytes per block
+
+typedef struct {
+    uint64_t offset;
+    uint32_t compressed_size;
+    uint32_t raw_size;
+    const char *first;   // folded first term, points into BlockStore.names
+} BlockInfo;
+
+// Once the index is read (block_store_open(), or the first lookup after
+// block_store_open_lazy()), lookups only read the store, so threads may share
+// one; the counters below are bumped atomically.
+typedef struct {
+    int fd;
+    uint32_t block_count;
+    uint64_t entry_count;
+    uint64_t file_size;
+    uint64_t index_offset;
+    BlockInfo *blocks;     // NULL until the index is read
+    char *names;
+    uint64_t bytes_read;   // header, index and blocks read so far
+    uint64_t blocks_read;
+    BloomFilter bloom;     // mapped from the file; empty for version 1 stores
+    uint64_t bloom_terms;  // distinct folded terms the filter was built over
+    uint64_t bloom_rejects;
+    int ascii_folded;      // written before UTF-8 folding (version 1 or 2)
+    char source_sha[SHA1_HEX_SIZE];  // blob id of the text it was built from; "" when unknown
+    char *path;
+    TrigramIndex *trigrams;  // loaded by block_store_trigram_index()
+    PhoneticIndex *phonetics;  // loaded by block_store_phonetic_index()
+} BlockStore;
+
+// Collects entries (in any order) and writes them out as a block store
+typedef struct {
+    char *arena;          // "term\0definition\0" back to back
+    size_t arena_size;
+    size_t arena_capacity;
+    size_t *entries;      // arena offset of each term
+    size_t count;
+    size_t capacity;
+    char pending[256];    // partial line carried between block_builder_feed() calls
+    size_t pending_len;
+    char source_sha[SHA1_HEX_SIZE];  // written to the header when set
+} BlockBuilder;
+
+BlockStore* block_store_open(const char *path);
+BlockStore* block_store_open_lazy(const char *path);
+void block_store_close(BlockStore *store);
+int block_store_lookup_view(BlockStore *store, const char *term, LookupResult *out);
+int block_store_collect_terms(BlockStore *store, TrigramBuilder *builder);
+TrigramIndex* block_store_trigram_index(BlockStore *store);
+int block_store_trigram_path(const char *store_path, char *out, size_t size);
+PhoneticIndex* block_store_phonetic_index(BlockStore *store);
+int block_store_phonetic_path(const char *store_path, char *out, size_t size);
+
+void block_builder_init(BlockBuilder *builder);
+int block_builder_add(BlockBuilder *builder, const char *term, const char *definition);
+int block_builder_feed(BlockBuilder *builder, const char *data, size_t len);
+int block_builder_write(BlockBuilder *builder, const char *path);
+void block_builder_free(BlockBuilder *builder);
+int block_store_build_from_text(const char *text_path, const char *store_path);
+
+#endif
@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <sys/mman.h>
+#include "bloom.h"
+#include "casefold.h"
+#include "stats.h"
+
+#define BLOOM_BLOCK_BITS (BLOOM_BLOCK_BYTES * 8)
+
+// False-positive rate to size new filters for: WTF_BLOOM_FPR or 1%
+double bloom_target_fpr(void) {
+    const char *env = getenv("WTF_BLOOM_FPR");
+    if (env && *env) {
+        char *end;
+        double fpr = strtod(env, &end);
+        if (*end == '\0' && fpr > 0.0 && fpr < 1.0) {
+            if (fpr < 1e-6) fpr = 1e-6;
+            if (fpr > 0.5) fpr = 0.5;
+            return fpr;
+        }
+    }
+    return BLOOM_DEFAULT_FPR;
+}
+
+// casefold_hash() of the term (for ASCII, FNV-1a over the lowercased bytes as
+// in version 2 stores), finished with a murmur3 mix so both halves are usable
+uint64_t bloom_hash(const char *term) {
+    uint64_t h = casefold_hash(term);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Size for `expected` distinct terms at the given false-positive rate
+int bloom_init(BloomFilter *filter, size_t expected, double fpr) {
+    memset(filter, 0, sizeof(*filter));
+    if (expected == 0) expected = 1;
+
+    double bits_per_key = -log(fpr) / (M_LN2 * M_LN2);
+    double total_bits = bits_per_key * (double)expected;
+    uint64_t blocks = (uint64_t)ceil(total_bits / BLOOM_BLOCK_BITS);
+    if (blocks == 0) blocks = 1;
+    if (blocks > UINT32_MAX) return 0;
+
+    int k = (int)lround(bits_per_key * M_LN2);
+    if (k < 1) k = 1;
+    if (k > BLOOM_MAX_K) k = BLOOM_MAX_K;
+
+    filter->bits = wtf_calloc((size_t)blocks, BLOOM_BLOCK_BYTES);
+    if (!filter->bits) return 0;
+    filter->block_count = (uint32_t)blocks;
+    filter->k = (uint32_t)k;
+    return 1;
+}
+
+static const uint8_t* block_for(const BloomFilter *filter, uint64_t hash) {
+    uint64_t index = ((hash >> 32) * (uint64_t)filter->block_count) >> 32;
+    return filter->bits + index * BLOOM_BLOCK_BYTES;
+}
+
+void bloom_add(BloomFilter *filter, uint64_t hash) {
+    uint8_t *block = (uint8_t *)block_for(filter, hash);
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    for (uint32_t i = 0; i < filter->k; i++) {
+        uint32_t bit = (h1 + i * h2) % BLOOM_BLOCK_BITS;
+        block[bit >> 3] |= (uint8_t)(1u << (bit & 7));
+    }
+}
+
+// 0 means the term is definitely absent; 1 means it may be present
+int bloom_maybe_contains(const BloomFilter *filter, uint64_t hash) {
+    if (!filter->bits) return 1;
+    const uint8_t *block = block_for(filter, hash);
+    uint32_t h1 = (uint32_t)hash;
+    uint32_t h2 = (uint32_t)(hash >> 32) | 1;
+    for (uint32_t i = 0; i < filter->k; i++) {
+        uint32_t bit = (h1 + i * h2) % BLOOM_BLOCK_BITS;
+        if (!(block[bit >> 3] & (1u << (bit & 7)))) return 0;
+    }
+    return 1;
+}
+
+// Textbook estimate (1 - e^(-kn/m))^k; blocking adds a little on top
+double bloom_estimated_fpr(const BloomFilter *filter, size_t entries) {
+    if (!filter->bits || filter->block_count == 0) return 1.0;
+    double m = (double)filter->block_count * BLOOM_BLOCK_BITS;
+    return pow(1.0 - exp(-(double)filter->k * (double)entries / m), (double)filter->k);
+}
+
+void bloom_free(BloomFilter *filter) {
+    if (filter->map) {
+        munmap(filter->map, filter->map_size);
+    } else {
+        wtf_free(filter->bits);
+    }
+    memset(filter, 0, sizeof(*filter));
+}
+
+int bloom_keys_add(BloomKeys *keys, uint64_t hash) {
+    if (keys->count == keys->capacity) {
+        size_t capacity = keys->capacity ? keys->capacity * 2 : 1024;
+        uint64_t *grown = wtf_realloc(keys->hashes, capacity * sizeof(uint64_t));
+        if (!grown) return 0;
+        keys->hashes = grown;
+        keys->capacity = capacity;
+    }
+    keys->hashes[keys->count++] = hash;
+    return 1;
+}
+
+// Size a filter for every collected hash and add them. Sized per hash rather
+// than per distinct term, so repeated terms only make it more accurate.
+int bloom_build(BloomFilter *filter, const BloomKeys *keys, double fpr) {
+    if (!bloom_init(filter, keys->count, fpr)) return 0;
+    for (size_t i = 0; i < keys->count; i++) {
+        bloom_add(filter, keys->hashes[i]);
+    }
+    return 1;
+}
+
+void bloom_keys_free(BloomKeys *keys) {
+    wtf_free(keys->hashes);
+    memset(keys, 0, sizeof(*keys));
+}
@@ -0,0 +1,39 @@
+#ifndef BLOOM_H
+#define BLOOM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Blocked Bloom filter over case-folded terms. Every probe for a term lands in
+// one 64-byte block, so a negative answer touches a single cache line.
+#define BLOOM_BLOCK_BYTES 64
+#define BLOOM_DEFAULT_FPR 0.01
+#define BLOOM_MAX_K 16
+
+typedef struct {
+    uint8_t *bits;          // block_count * BLOOM_BLOCK_BYTES
+    uint32_t block_count;
+    uint32_t k;             // bits set per term
+    void *map;              // non-NULL when bits point into an mmap()ed block store
+    size_t map_size;
+} BloomFilter;
+
+// Term hashes collected while loading, turned into a filter once the count is known
+typedef struct {
+    uint64_t *hashes;
+    size_t count;
+    size_t capacity;
+} BloomKeys;
+
+double bloom_target_fpr(void);
+uint64_t bloom_hash(const char *term);
+int bloom_init(BloomFilter *filter, size_t expected, double fpr);
+void bloom_add(BloomFilter *filter, uint64_t hash);
+int bloom_maybe_contains(const BloomFilter *filter, uint64_t hash);
+double bloom_estimated_fpr(const BloomFilter *filter, size_t entries);
+void bloom_free(BloomFilter *filter);
+int bloom_keys_add(BloomKeys *keys, uint64_t hash);
+int bloom_build(BloomFilter *filter, const BloomKeys *keys, double fpr);
+void bloom_keys_free(BloomKeys *keys);
+
+#endif
@@ -0,0 +1,390 @@
+#include <string.h>
+#include "casefold.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+// Unicode 14 simple case folding (CaseFolding.txt, statuses C and S) for
+// everything above ASCII: cp folds to cp + delta when start <= cp and
+// cp = start + i * stride for some i < count. Sorted by start.
+typedef struct {
+    uint32_t start;
+    int32_t delta;
+    uint16_t count;
+    uint8_t stride;
+} FoldRange;
+
+static const FoldRange fold_ranges[] = {
+    {0x00B5, 775, 1, 1}, {0x00C0, 32, 23, 1}, {0x00D8, 32, 7, 1}, {0x0100, 1, 24, 2},
+    {0x0132, 1, 3, 2}, {0x0139, 1, 8, 2}, {0x014A, 1, 23, 2}, {0x0178, -121, 1, 1},
+    {0x0179, 1, 3, 2}, {0x017F, -268, 1, 1}, {0x0181, 210, 1, 1}, {0x0182, 1, 2, 2},
+    {0x0186, 206, 1, 1}, {0x0187, 1, 1, 1}, {0x0189, 205, 2, 1}, {0x018B, 1, 1, 1},
+    {0x018E, 79, 1, 1}, {0x018F, 202, 1, 1}, {0x0190, 203, 1, 1}, {0x0191, 1, 1, 1},
+    {0x0193, 205, 1, 1}, {0x0194, 207, 1, 1}, {0x0196, 211, 1, 1}, {0x0197, 209, 1, 1},
+    {0x0198, 1, 1, 1}, {0x019C, 211, 1, 1}, {0x019D, 213, 1, 1}, {0x019F, 214, 1, 1},
+    {0x01A0, 1, 3, 2}, {0x01A6, 218, 1, 1}, {0x01A7, 1, 1, 1}, {0x01A9, 218, 1, 1},
+    {0x01AC, 1, 1, 1}, {0x01AE, 218, 1, 1}, {0x01AF, 1, 1, 1}, {0x01B1, 217, 2, 1},
+    {0x01B3, 1, 2, 2}, {0x01B7, 219, 1, 1}, {0x01B8, 1, 1, 1}, {0x01BC, 1, 1, 1}, {0x01C4, 2, 1, 1},
+    {0x01C5, 1, 1, 1}, {0x01C7, 2, 1, 1}, {0x01C8, 1, 1, 1}, {0x01CA, 2, 1, 1}, {0x01CB, 1, 9, 2},
+    {0x01DE, 1, 9, 2}, {0x01F1, 2, 1, 1}, {0x01F2, 1, 2, 2}, {0x01F6, -97, 1, 1},
+    {0x01F7, -56, 1, 1}, {0x01F8, 1, 20, 2}, {0x0220, -130, 1, 1}, {0x0222, 1, 9, 2},
+    {0x023A, 10795, 1, 1}, {0x023B, 1, 1, 1}, {0x023D, -163, 1, 1}, {0x023E, 10792, 1, 1},
+    {0x0241, 1, 1, 1}, {0x0243, -195, 1, 1}, {0x0244, 69, 1, 1}, {0x0245, 71, 1, 1},
+    {0x0246, 1, 5, 2}, {0x0345, 116, 1, 1}, {0x0370, 1, 2, 2}, {0x0376, 1, 1, 1},
+    {0x037F, 116, 1, 1}, {0x0386, 38, 1, 1}, {0x0388, 37, 3, 1}, {0x038C, 64, 1, 1},
+    {0x038E, 63, 2, 1}, {0x0391, 32, 17, 1}, {0x03A3, 32, 9, 1}, {0x03C2, 1, 1, 1},
+    {0x03CF, 8, 1, 1}, {0x03D0, -30, 1, 1}, {0x03D1, -25, 1, 1}, {0x03D5, -15, 1, 1},
+    {0x03D6, -22, 1, 1}, {0x03D8, 1, 12, 2}, {0x03F0, -54, 1, 1}, {0x03F1, -48, 1, 1},
+    {0x03F4, -60, 1, 1}, {0x03F5, -64, 1, 1}, {0x03F7, 1, 1, 1}, {0x03F9, -7, 1, 1},
+    {0x03FA, 1, 1, 1}, {0x03FD, -130, 3, 1}, {0x0400, 80, 16, 1}, {0x0410, 32, 32, 1},
+    {0x0460, 1, 17, 2}, {0x048A, 1, 27, 2}, {0x04C0, 15, 1, 1}, {0x04C1, 1, 7, 2},
+    {0x04D0, 1, 48, 2}, {0x0531, 48, 38, 1}, {0x10A0, 7264, 38, 1}, {0x10C7, 7264, 1, 1},
+    {0x10CD, 7264, 1, 1}, {0x13F8, -8, 6, 1}, {0x1C80, -6222, 1, 1}, {0x1C81, -6221, 1, 1},
+    {0x1C82, -6212, 1, 1}, {0x1C83, -6210, 2, 1}, {0x1C85, -6211, 1, 1}, {0x1C86, -6204, 1, 1},
+    {0x1C87, -6180, 1, 1}, {0x1C88, 35267, 1, 1}, {0x1C90, -3008, 43, 1}, {0x1CBD, -3008, 3, 1},
+    {0x1E00, 1, 75, 2}, {0x1E9B, -58, 1, 1}, {0x1E9E, -7615, 1, 1}, {0x1EA0, 1, 48, 2},
+    {0x1F08, -8, 8, 1}, {0x1F18, -8, 6, 1}, {0x1F28, -8, 8, 1}, {0x1F38, -8, 8, 1},
+    {0x1F48, -8, 6, 1}, {0x1F59, -8, 4, 2}, {0x1F68, -8, 8, 1}, {0x1F88, -8, 8, 1},
+    {0x1F98, -8, 8, 1}, {0x1FA8, -8, 8, 1}, {0x1FB8, -8, 2, 1}, {0x1FBA, -74, 2, 1},
+    {0x1FBC, -9, 1, 1}, {0x1FBE, -7173, 1, 1}, {0x1FC8, -86, 4, 1}, {0x1FCC, -9, 1, 1},
+    {0x1FD8, -8, 2, 1}, {0x1FDA, -100, 2, 1}, {0x1FE8, -8, 2, 1}, {0x1FEA, -112, 2, 1},
+    {0x1FEC, -7, 1, 1}, {0x1FF8, -128, 2, 1}, {0x1FFA, -126, 2, 1}, {0x1FFC, -9, 1, 1},
+    {0x2126, -7517, 1, 1}, {0x212A, -8383, 1, 1}, {0x212B, -8262, 1, 1}, {0x2132, 28, 1, 1},
+    {0x2160, 16, 16, 1}, {0x2183, 1, 1, 1}, {0x24B6, 26, 26, 1}, {0x2C00, 48, 48, 1},
+    {0x2C60, 1, 1, 1}, {0x2C62, -10743, 1, 1}, {0x2C63, -3814, 1, 1}, {0x2C64, -10727, 1, 1},
+    {0x2C67, 1, 3, 2}, {0x2C6D, -10780, 1, 1}, {0x2C6E, -10749, 1, 1}, {0x2C6F, -10783, 1, 1},
+    {0x2C70, -10782, 1, 1}, {0x2C72, 1, 1, 1}, {0x2C75, 1, 1, 1}, {0x2C7E, -10815, 2, 1},
+    {0x2C80, 1, 50, 2}, {0x2CEB, 1, 2, 2}, {0x2CF2, 1, 1, 1}, {0xA640, 1, 23, 2},
+    {0xA680, 1, 14, 2}, {0xA722, 1, 7, 2}, {0xA732, 1, 31, 2}, {0xA779, 1, 2, 2},
+    {0xA77D, -35332, 1, 1}, {0xA77E, 1, 5, 2}, {0xA78B, 1, 1, 1}, {0xA78D, -42280, 1, 1},
+    {0xA790, 1, 2, 2}, {0xA796, 1, 10, 2}, {0xA7AA, -42308, 1, 1}, {0xA7AB, -42319, 1, 1},
+    {0xA7AC, -42315, 1, 1}, {0xA7AD, -42305, 1, 1}, {0xA7AE, -42308, 1, 1}, {0xA7B0, -42258, 1, 1},
+    {0xA7B1, -42282, 1, 1}, {0xA7B2, -42261, 1, 1}, {0xA7B3, 928, 1, 1}, {0xA7B4, 1, 8, 2},
+    {0xA7C4, -48, 1, 1}, {0xA7C5, -42307, 1, 1}, {0xA7C6, -35384, 1, 1}, {0xA7C7, 1, 2, 2},
+    {0xA7D0, 1, 1, 1}, {0xA7D6, 1, 2, 2}, {0xA7F5, 1, 1, 1}, {0xAB70, -38864, 80, 1},
+    {0xFF21, 32, 26, 1}, {0x10400, 40, 40, 1}, {0x104B0, 40, 36, 1}, {0x10570, 39, 11, 1},
+    {0x1057C, 39, 15, 1}, {0x1058C, 39, 7, 1}, {0x10594, 39, 2, 1}, {0x10C80, 64, 51, 1},
+    {0x118A0, 32, 32, 1}, {0x16E40, 32, 32, 1}, {0x1E900, 34, 34, 1},
+};
+
+#define FOLD_RANGE_COUNT (sizeof(fold_ranges) / sizeof(fold_ranges[0]))
+
+static inline unsigned char fold_ascii(unsigned char c) {
+    return (unsigned char)(c + (((unsigned)(c - 'A') < 26u) << 5));
+}
+
+uint32_t casefold_codepoint(uint32_t cp) {
+    if (cp < 0x80) return fold_ascii((unsigned char)cp);
+
+    // Last range starting at or before cp
+    size_t lo = 0, hi = FOLD_RANGE_COUNT;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (fold_ranges[mid].start <= cp) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    if (lo == 0) return cp;
+    const FoldRange *range = &fold_ranges[lo - 1];
+    uint32_t offset = cp - range->start;
+    if (offset < (uint32_t)range->count * range->stride && offset % range->stride == 0) {
+        return (uint32_t)((int32_t)cp + range->delta);
+    }
+    return cp;
+}
+
+// Decode one UTF-8 character from p (n bytes available). Returns its length,
+// or 0 when p does not start a valid, shortest-form sequence.
+static size_t decode_utf8(const unsigned char *p, size_t n, uint32_t *cp) {
+    unsigned char c = p[0];
+    if (c < 0xC2 || c > 0xF4) return 0;
+    if (c < 0xE0) {
+        if (n < 2 || (p[1] & 0xC0) != 0x80) return 0;
+        *cp = ((uint32_t)(c & 0x1F) << 6) | (p[1] & 0x3F);
+        return 2;
+    }
+    if (c < 0xF0) {
+        if (n < 3 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80) return 0;
+        if ((c == 0xE0 && p[1] < 0xA0) || (c == 0xED && p[1] >= 0xA0)) return 0;
+        *cp = ((uint32_t)(c & 0x0F) << 12) | ((uint32_t)(p[1] & 0x3F) << 6) | (p[2] & 0x3F);
+        return 3;
+    }
+    if (n < 4 || (p[1] & 0xC0) != 0x80 || (p[2] & 0xC0) != 0x80 || (p[3] & 0xC0) != 0x80) return 0;
+    if ((c == 0xF0 && p[1] < 0x90) || (c == 0xF4 && p[1] >= 0x90)) return 0;
+    *cp = ((uint32_t)(c & 0x07) << 18) | ((uint32_t)(p[1] & 0x3F) << 12) |
+          ((uint32_t)(p[2] & 0x3F) << 6) | (p[3] & 0x3F);
+    return 4;
+}
+
+static size_t encode_utf8(uint32_t cp, unsigned char *out) {
+    if (cp < 0x80) {
+        out[0] = (unsigned char)cp;
+        return 1;
+    }
+    if (cp < 0x800) {
+        out[0] = (unsigned char)(0xC0 | (cp >> 6));
+        out[1] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 2;
+    }
+    if (cp < 0x10000) {
+        out[0] = (unsigned char)(0xE0 | (cp >> 12));
+        out[1] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+        out[2] = (unsigned char)(0x80 | (cp & 0x3F));
+        return 3;
+    }
+    out[0] = (unsigned char)(0xF0 | (cp >> 18));
+    out[1] = (unsigned char)(0x80 | ((cp >> 12) & 0x3F));
+    out[2] = (unsigned char)(0x80 | ((cp >> 6) & 0x3F));
+    out[3] = (unsigned char)(0x80 | (cp & 0x3F));
+    return 4;
+}
+
+// Fold the character at p into out (up to 4 bytes). Sets *used to the bytes
+// consumed and returns the bytes written.
+static size_t fold_unit(const unsigned char *p, size_t n, unsigned char *out, size_t *used) {
+    if (p[0] < 0x80) {
+        out[0] = fold_ascii(p[0]);
+        *used = 1;
+        return 1;
+    }
+    uint32_t cp;
+    size_t len = decode_utf8(p, n, &cp);
+    if (len == 0) {
+        out[0] = p[0];
+        *used = 1;
+        return 1;
+    }
+    *used = len;
+    uint32_t folded = casefold_codepoint(cp);
+    if (folded == cp) {
+        memcpy(out, p, len);
+        return len;
+    }
+    return encode_utf8(folded, out);
+}
+
+// ASCII runs, a vector at a time. fold_vector() lowercases 'A'-'Z' and leaves
+// every other byte, including those >= 0x80, alone.
+#if defined(__AVX2__)
+#define FOLD_WIDTH 32
+#define FOLD_ALL_EQUAL 0xFFFFFFFFu
+typedef __m256i FoldVector;
+
+static inline FoldVector load_vector(const unsigned char *p) {
+    return _mm256_loadu_si256((const __m256i *)p);
+}
+
+static inline FoldVector fold_vector(FoldVector v) {
+    __m256i upper = _mm256_and_si256(_mm256_cmpgt_epi8(v, _mm256_set1_epi8('A' - 1)),
+                                     _mm256_cmpgt_epi8(_mm256_set1_epi8('Z' + 1), v));
+    return _mm256_add_epi8(v, _mm256_and_si256(upper, _mm256_set1_epi8(0x20)));
+}
+
+static inline uint32_t high_bits(FoldVector v) {
+    return (uint32_t)_mm256_movemask_epi8(v);
+}
+
+static inline uint32_t equal_bits(FoldVector a, FoldVector b) {
+    return (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(a, b));
+}
+
+static inline FoldVector or_vector(FoldVector a, FoldVector b) {
+    return _mm256_or_si256(a, b);
+}
+
+static inline void store_vector(unsigned char *p, FoldVector v) {
+    _mm256_storeu_si256((__m256i *)p, v);
+}
+#elif defined(__SSE2__)
+#define FOLD_WIDTH 16
+#define FOLD_ALL_EQUAL 0xFFFFu
+typedef __m128i FoldVector;
+
+static inline FoldVector load_vector(const unsigned char *p) {
+    return _mm_loadu_si128((const __m128i *)p);
+}
+
+static inline FoldVector fold_vector(FoldVector v) {
+    __m128i upper = _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8('A' - 1)),
+                                  _mm_cmplt_epi8(v, _mm_set1_epi8('Z' + 1)));
+    return _mm_add_epi8(v, _mm_and_si128(upper, _mm_set1_epi8(0x20)));
+}
+
+static inline uint32_t high_bits(FoldVector v) {
+    return (uint32_t)_mm_movemask_epi8(v);
+}
+
+static inline uint32_t equal_bits(FoldVector a, FoldVector b) {
+    return (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(a, b));
+}
+
+static inline FoldVector or_vector(FoldVector a, FoldVector b) {
+    return _mm_or_si128(a, b);
+}
+
+static inline void store_vector(unsigned char *p, FoldVector v) {
+    _mm_storeu_si128((__m128i *)p, v);
+}
+#endif
+
+// Fold len bytes of src into dst as a NUL-terminated string. Returns the
+// folded length; if that is >= size the output was cut short (at a character
+// boundary), like snprintf().
+size_t casefold_n(const char *src, size_t len, char *dst, size_t size) {
+    const unsigned char *in = (const unsigned char *)src;
+    unsigned char *out = (unsigned char *)dst;
+    size_t i = 0, o = 0;
+    int fits = size > 0;
+
+    while (i < len) {
+#ifdef FOLD_WIDTH
+        while (fits && len - i >= FOLD_WIDTH && o + FOLD_WIDTH < size) {
+            FoldVector v = load_vector(in + i);
+            if (high_bits(v)) break;
+            store_vector(out + o, fold_vector(v));
+            i += FOLD_WIDTH;
+            o += FOLD_WIDTH;
+        }
+        if (i == len) break;
+#endif
+        // ASCII shorter than a vector, one byte at a time without decoding
+        if (in[i] < 0x80) {
+            if (fits && o + 1 < size) {
+                out[o] = fold_ascii(in[i]);
+            } else if (fits) {
+                out[o] = '\0';
+                fits = 0;
+            }
+            i++;
+            o++;
+            continue;
+        }
+        unsigned char unit[4];
+        size_t used;
+        size_t n = fold_unit(in + i, len - i, unit, &used);
+        if (fits && o + n < size) {
+            memcpy(out + o, unit, n);
+        } else if (fits) {
+            out[o] = '\0';
+            fits = 0;
+        }
+        i += used;
+        o += n;
+    }
+    if (fits) out[o] = '\0';
+    return o;
+}
+
+size_t casefold(const char *src, char *dst, size_t size) {
+    return casefold_n(src, strlen(src), dst, size);
+}
+
+// Lowercase only 'A'-'Z', as stores written before UTF-8 folding expect.
+// Returns the length, or a value >= size when src does not fit.
+size_t casefold_ascii(const char *src, char *dst, size_t size) {
+    size_t len = strlen(src);
+    if (len >= size) return len;
+    const unsigned char *in = (const unsigned char *)src;
+    unsigned char *out = (unsigned char *)dst;
+    size_t i = 0;
+#ifdef FOLD_WIDTH
+    for (; len - i >= FOLD_WIDTH; i += FOLD_WIDTH) {
+        store_vector(out + i, fold_vector(load_vector(in + i)));
+    }
+#endif
+    for (; i < len; i++) out[i] = fold_ascii(in[i]);
+    out[len] = '\0';
+    return len;
+}
+
+int casefold_is_ascii(const char *str) {
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        if (*p >= 0x80) return 0;
+    }
+    return 1;
+}
+
+// Folded bytes of a string, one at a time
+typedef struct {
+    const unsigned char *p;
+    size_t left;
+    unsigned char unit[4];
+    size_t unit_len;
+    size_t unit_pos;
+} FoldStream;
+
+static int stream_next(FoldStream *s) {
+    if (s->unit_pos == s->unit_len) {
+        if (s->left == 0) return -1;
+        size_t used;
+        s->unit_len = fold_unit(s->p, s->left, s->unit, &used);
+        s->unit_pos = 0;
+        s->p += used;
+        s->left -= used;
+    }
+    return s->unit[s->unit_pos++];
+}
+
+// strcmp() of the folded forms, without building them
+int casefold_compare(const char *a, const char *b) {
+    FoldStream x = {(const unsigned char *)a, strlen(a), {0}, 0, 0};
+    FoldStream y = {(const unsigned char *)b, strlen(b), {0}, 0, 0};
+    for (;;) {
+#ifdef FOLD_WIDTH
+        // While both sides are plain ASCII, compare whole vectors
+        while (x.unit_pos == x.unit_len && y.unit_pos == y.unit_len &&
+               x.left >= FOLD_WIDTH && y.left >= FOLD_WIDTH) {
+            FoldVector va = load_vector(x.p), vb = load_vector(y.p);
+            if (high_bits(or_vector(va, vb))) break;
+            uint32_t same = equal_bits(fold_vector(va), fold_vector(vb));
+            if (same != FOLD_ALL_EQUAL) {
+                int at = __builtin_ctz(~same);
+                return (int)fold_ascii(x.p[at]) - (int)fold_ascii(y.p[at]);
+            }
+            x.p += FOLD_WIDTH;
+            x.left -= FOLD_WIDTH;
+            y.p += FOLD_WIDTH;
+            y.left -= FOLD_WIDTH;
+        }
+#endif
+        int c = stream_next(&x);
+        int d = stream_next(&y);
+        if (c != d) return c - d;
+        if (c < 0) return 0;
+    }
+}
+
+int casefold_equal(const char *a, const char *b) {
+    return casefold_compare(a, b) == 0;
+}
+
+// 64-bit FNV-1a over the folded bytes, so every spelling of a term hashes alike
+uint64_t casefold_hash(const char *str) {
+    uint64_t h = 14695981039346656037ULL;
+    const unsigned char *p = (const unsigned char *)str;
+    size_t left = strlen(str);
+    while (left > 0) {
+        if (*p < 0x80) {
+            h ^= fold_ascii(*p);
+            h *= 1099511628211ULL;
+            p++;
+            left--;
+            continue;
+        }
+        unsigned char unit[4];
+        size_t used;
+        size_t n = fold_unit(p, left, unit, &used);
+        for (size_t k = 0; k < n; k++) {
+            h ^= unit[k];
+            h *= 1099511628211ULL;
+        }
+        p += used;
+        left -= used;
+    }
+    return h;
+}
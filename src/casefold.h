@@ -0,0 +1,25 @@
+#ifndef CASEFOLD_H
+#define CASEFOLD_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Case-insensitive matching for terms: Unicode simple case folding over UTF-8
+// ("Ärger" = "ärger", "ΣΥΝ" = "συν"), with runs of ASCII folded 16 bytes at a
+// time (32 with AVX2). Bytes that are not valid UTF-8 are kept as they are.
+// Nothing here allocates.
+//
+// Folding can lengthen a string (U+023A folds to a 3-byte character), so a
+// buffer for the folded form of len bytes needs CASEFOLD_SIZE(len) bytes.
+#define CASEFOLD_SIZE(len) ((len) + (len) / 2 + 1)
+
+uint32_t casefold_codepoint(uint32_t cp);
+size_t casefold(const char *src, char *dst, size_t size);
+size_t casefold_n(const char *src, size_t len, char *dst, size_t size);
+size_t casefold_ascii(const char *src, char *dst, size_t size);
+int casefold_is_ascii(const char *str);
+int casefold_equal(const char *a, const char *b);
+int casefold_compare(const char *a, const char *b);
+uint64_t casefold_hash(const char *str);
+
+#endif
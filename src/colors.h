@@ -0,0 +1,17 @@
+#ifndef WTF_COLORS_H
+#define WTF_COLORS_H
+
+// ANSI color codes
+#define COLOR_GREEN "\033[0;32m"
+#define COLOR_UB_GREEN "\033[1;4;32m"
+#define COLOR_GRAY "\033[0;37m"
+#define COLOR_RED "\033[0;31m"
+#define COLOR_CYAN    "\033[0;36m"
+#define COLOR_YELLOW "\033[0;33m"
+// Define a minimal, monochromatic color palette
+#define COLOR_PRIMARY  "\033[0;38;5;75m"   // Main blue for structure
+#define COLOR_DIM     "\033[0;38;5;67m"    // Dimmed version for secondary text
+#define COLOR_SUCCESS "\033[0;38;5;78m"    // Subtle green only for checkmarks
+#define COLOR_RESET   "\033[0m"
+
+#endif
@@ -5,6 +5,8 @@
 #include "hash_table.h"
 #include "file_utils.h"
 #include "network_sync.h"
+#include "stats.h"
+#include "probes.h"
 #include <sys/ioctl.h>
 #include <sys/stat.h>
 #include <sys/types.h>
@@ -40,105 +42,303 @@ void print_wrapped_definition(const char* text, int indent_size, int term_width,
 }
 
 
-// Handle "wtf is <term>" command
-void handle_is_command(HashTable *dictionary, HashTable *removed_dict, char **args, int argc) {
-    
+// The words after the command, joined by spaces, as the term to look up
+void join_term_args(char **args, int argc, char *term, size_t size) {
+    size_t len = 0;
+    term[0] = '\0';
+    for (int i = 2; i < argc && len < size; i++) {
+        len += (size_t)snprintf(term + len, size - len, "%s%s", args[i], i < argc - 1 ? " " : "");
+    }
+}
+
+// Handle "wtf is <term>" command, remembering the answer in cache when given.
+// A miss offers terms that sound like it instead, and is not cached.
+void handle_is_command(Dictionary *dict, const char *term, const LookupPage *page, HotCache *cache) {
+    LookupResult definitions;
+    lookup_result_init(&definitions);
+    dictionary_lookup_view(dict, term, &definitions);
+    dictionary_filter_removed(dict, &definitions);
+    FindResult suggestions = {0};
+    if (definitions.count > 0) {
+        hot_cache_store(cache, term, &definitions);
+    } else if (dictionary_sounds_like(dict, term, &suggestions) < 0) {
+        suggestions.count = 0;
+    }
+    render_is_result(term, &definitions, page, &suggestions);
+    find_result_free(&suggestions);
+    lookup_result_free(&definitions);
+}
+
+// Print the (already filtered) answer for term, windowed by page; on a miss,
+// the first SUGGESTION_LIMIT suggestions (may be NULL)
+void render_is_result(const char *term, const LookupResult *definitions, const LookupPage *page,
+                      const FindResult *suggestions) {
     struct winsize w;
     ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
     int term_width = w.ws_col;
-    char term[256] = "";
-    for (int i = 2; i < argc; i++) {
-        strcat(term, args[i]);
-        if (i < argc - 1) strcat(term, " ");
+
+    STATS_BEGIN(render_started);
+    WTF_PROBE1(render__start, "is");
+    int def_count = definitions->count;
+
+    // Window selected by --offset/--limit
+    int first = page && page->offset > 0 ? page->offset : 0;
+    int last = def_count;
+    if (page && page->limit > 0 && first + page->limit < last) {
+        last = first + page->limit;
     }
     
-
-    DefinitionList *definitions = hash_table_lookup_all(dictionary, term);
-    if (definitions) {
-        int def_count = 0;
-        
-        // Count valid definitions
-        for (int i = 0; i < definitions->count; i++) {
-            if (!is_definition_removed(definitions->keys[i], definitions->definitions[i], removed_dict)) {
-                def_count++;
-            }
+    if (def_count > 0 && first < def_count) {
+        printf("\n%s╭─ Found %d definition%s for '%s%s%s'%s", 
+            COLOR_PRIMARY, def_count, 
+            (def_count > 1 ? "s" : ""),
+            COLOR_YELLOW, term, COLOR_PRIMARY,
+            COLOR_RESET);
+        if (first > 0 || last < def_count) {
+            printf(" %s(showing %d-%d)%s", COLOR_DIM, first + 1, last, COLOR_RESET);
         }
+        printf("\n%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
         
-        if (def_count > 0) {
-            printf("\n%s╭─ Found %d definition%s for '%s%s%s'%s\n", 
-                COLOR_PRIMARY, def_count, 
-                (def_count > 1 ? "s" : ""),
-                COLOR_YELLOW, term, COLOR_PRIMARY,
-                COLOR_RESET);
-            printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        for (int i = first; i < last; i++) {
+            const LookupMatch *match = &definitions->matches[i];
             
-            for (int i = 0; i < definitions->count; i++) {
-                if (!is_definition_removed(definitions->keys[i], definitions->definitions[i], removed_dict)) {
-                    
-                    // Calculate indent size (tree symbol + term + ": ")
-                    int indent_size = 4 + strlen(definitions->keys[i]) + 2;
-                    
-                    if (i == definitions->count - 1) {
-                        printf("%s╰─ %s%s%s: ", 
-                            COLOR_PRIMARY,
-                            COLOR_YELLOW,
-                            definitions->keys[i],
-                            COLOR_RESET);
-                    } else {
-                        printf("%s├─ %s%s%s: ", 
-                            COLOR_PRIMARY,
-                            COLOR_YELLOW,
-                            definitions->keys[i],
-                            COLOR_RESET);
-                    }
-                    print_wrapped_definition(definitions->definitions[i], 
-                                           indent_size, 
-                                           term_width, 
-                                           i == definitions->count - 1);
-                    if (i < definitions->count - 1) {
-                        printf("\n%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
-                    }
-                }
+            // Calculate indent size (tree symbol + term + ": ")
+            int indent_size = 4 + strlen(match->key) + 2;
+            
+            if (i == last - 1) {
+                printf("%s╰─ %s%s%s: ", 
+                    COLOR_PRIMARY,
+                    COLOR_YELLOW,
+                    match->key,
+                    COLOR_RESET);
+            } else {
+                printf("%s├─ %s%s%s: ", 
+                    COLOR_PRIMARY,
+                    COLOR_YELLOW,
+                    match->key,
+                    COLOR_RESET);
+            }
+            print_wrapped_definition(match->definition, 
+                                   indent_size, 
+                                   term_width, 
+                                   i == last - 1);
+            if (i < last - 1) {
+                printf("\n%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
             }
-            printf("\n");
-            printf("\n");
-        } else {
-            printf("%s│%s\n",COLOR_PRIMARY, COLOR_RESET);
-            printf("%s╰─%sLol.. I don't know what `%s%s%s` means\n\n", COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW, term, COLOR_RESET);
         }
-        
-        free_definition_list(definitions);
+        printf("\n");
+        printf("\n");
+    } else if (def_count > 0) {
+        printf("%s│%s\n",COLOR_PRIMARY, COLOR_RESET);
+        printf("%s╰─%s Only %d definition%s for `%s%s%s`\n\n", COLOR_PRIMARY, COLOR_RESET,
+               def_count, (def_count > 1 ? "s" : ""), COLOR_YELLOW, term, COLOR_RESET);
+    } else if (suggestions && suggestions->count > 0) {
+        printf("%s│%s\n",COLOR_PRIMARY, COLOR_RESET);
+        printf("%s├─%sLol.. I don't know what `%s%s%s` means\n", COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW, term, COLOR_RESET);
+        printf("%s╰─%s Sounds like: ", COLOR_PRIMARY, COLOR_RESET);
+        size_t shown = suggestions->count < SUGGESTION_LIMIT ? suggestions->count : SUGGESTION_LIMIT;
+        for (size_t i = 0; i < shown; i++) {
+            printf("%s%s%s%s", i ? ", " : "", COLOR_YELLOW, suggestions->terms[i], COLOR_RESET);
+        }
+        printf("\n\n");
     } else {
         printf("%s│%s\n",COLOR_PRIMARY, COLOR_RESET);
         printf("%s╰─%sLol.. I don't know what `%s%s%s` means\n\n", COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW, term, COLOR_RESET);
     }
+    STATS_END(STAT_RENDER, render_started);
+    WTF_PROBE2(render__done, "is", first < def_count ? last - first : 0);
 }
 
-// Handle "wtf add <term>:<definition>" command
-void handle_add_command(HashTable *dictionary, const char *added_path, const char *term, const char *definition) {
-    // First check if this exact definition already exists
-    DefinitionList *existing = hash_table_lookup_all(dictionary, term);
-    if (existing) {
-        for (int i = 0; i < existing->count; i++) {
-            if (strcmp(existing->definitions[i], definition) == 0) {
-                printf("This definition already exists.\n");
-                free_definition_list(existing);
-                return;
-            }
+// Handle "wtf find <pattern>": terms containing pattern, or matching it as a
+// glob when it has '*' or '?'. Shows FIND_DEFAULT_LIMIT terms unless --limit says otherwise.
+void handle_find_command(Dictionary *dict, const char *pattern, const LookupPage *page) {
+    FindResult found = {0};
+    int count = dictionary_find(dict, pattern, &found);
+    if (count < 0) {
+        printf("%s│%s\n", COLOR_RED, COLOR_RESET);
+        printf("%s╰─ Error%s: Could not search for '%s%s%s'\n\n", COLOR_RED, COLOR_RESET, COLOR_YELLOW, pattern, COLOR_RESET);
+        find_result_free(&found);
+        return;
+    }
+
+    STATS_BEGIN(render_started);
+    WTF_PROBE1(render__start, "find");
+    int first = page && page->offset > 0 ? page->offset : 0;
+    int limit = page && page->limit > 0 ? page->limit : FIND_DEFAULT_LIMIT;
+    int last = first + limit < count ? first + limit : count;
+
+    if (count > 0 && first < count) {
+        printf("\n%s╭─ Found %d term%s matching '%s%s%s'%s", COLOR_PRIMARY, count, count > 1 ? "s" : "",
+               COLOR_YELLOW, pattern, COLOR_PRIMARY, COLOR_RESET);
+        if (first > 0 || last < count) {
+            printf(" %s(showing %d-%d)%s", COLOR_DIM, first + 1, last, COLOR_RESET);
+        }
+        printf("\n%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        for (int i = first; i < last; i++) {
+            printf("%s%s %s%s%s\n", COLOR_PRIMARY, i == last - 1 ? "╰─" : "├─", COLOR_YELLOW, found.terms[i], COLOR_RESET);
         }
-        free_definition_list(existing);
+        printf("\n");
+    } else if (count > 0) {
+        printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        printf("%s╰─%s Only %d term%s match `%s%s%s`\n\n", COLOR_PRIMARY, COLOR_RESET,
+               count, count > 1 ? "s" : "", COLOR_YELLOW, pattern, COLOR_RESET);
+    } else {
+        printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        printf("%s╰─%s No terms match `%s%s%s`\n\n", COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW, pattern, COLOR_RESET);
+    }
+    STATS_END(STAT_RENDER, render_started);
+    WTF_PROBE2(render__done, "find", first < count ? last - first : 0);
+    find_result_free(&found);
+}
+
+// Handle "wtf is --sounds-like <word>": terms whose phonetic key matches the
+// word's, closest spelling first. Shows FIND_DEFAULT_LIMIT terms unless --limit says otherwise.
+void handle_sounds_like_command(Dictionary *dict, const char *word, const LookupPage *page) {
+    FindResult found = {0};
+    int count = dictionary_sounds_like(dict, word, &found);
+    if (count < 0) {
+        printf("%s│%s\n", COLOR_RED, COLOR_RESET);
+        printf("%s╰─ Error%s: Could not search for terms like '%s%s%s'\n\n", COLOR_RED, COLOR_RESET, COLOR_YELLOW, word, COLOR_RESET);
+        find_result_free(&found);
+        return;
     }
 
-    if (add_to_added(added_path, term, definition)) {
-        hash_table_insert(dictionary, term, definition);
+    STATS_BEGIN(render_started);
+    WTF_PROBE1(render__start, "sounds-like");
+    int first = page && page->offset > 0 ? page->offset : 0;
+    int limit = page && page->limit > 0 ? page->limit : FIND_DEFAULT_LIMIT;
+    int last = first + limit < count ? first + limit : count;
+
+    if (count > 0 && first < count) {
+        printf("\n%s╭─ Found %d term%s sounding like '%s%s%s'%s", COLOR_PRIMARY, count, count > 1 ? "s" : "",
+               COLOR_YELLOW, word, COLOR_PRIMARY, COLOR_RESET);
+        if (first > 0 || last < count) {
+            printf(" %s(showing %d-%d)%s", COLOR_DIM, first + 1, last, COLOR_RESET);
+        }
+        printf("\n%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        for (int i = first; i < last; i++) {
+            printf("%s%s %s%s%s\n", COLOR_PRIMARY, i == last - 1 ? "╰─" : "├─", COLOR_YELLOW, found.terms[i], COLOR_RESET);
+        }
+        printf("\n");
+    } else if (count > 0) {
+        printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        printf("%s╰─%s Only %d term%s sound%s like `%s%s%s`\n\n", COLOR_PRIMARY, COLOR_RESET,
+               count, count > 1 ? "s" : "", count > 1 ? "" : "s", COLOR_YELLOW, word, COLOR_RESET);
+    } else {
+        printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        printf("%s╰─%s No terms sound like `%s%s%s`\n\n", COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW, word, COLOR_RESET);
+    }
+    STATS_END(STAT_RENDER, render_started);
+    WTF_PROBE2(render__done, "sounds-like", first < count ? last - first : 0);
+    find_result_free(&found);
+}
+
+// Whether index was already picked from a "1 3, 4" selection
+static int is_selected(const int *selected, int count, int index) {
+    for (int i = 0; i < count; i++) {
+        if (selected[i] == index) return 1;
+    }
+    return 0;
+}
+
+// Handle "wtf add <term>:<definition>" command
+void handle_add_command(Dictionary *dict, const char *added_path, const char *term, const char *definition) {
+    int added = dictionary_add_definition(dict, added_path, term, definition);
+    if (added > 0) {
         printf("Definition added successfully.\n");
+    } else if (added == 0) {
+        printf("This definition already exists.\n");
     } else {
         printf("Error: Could not add definition.\n");
     }
 }
 
+// Handle "wtf packs" command: every installed pack, its format, size and last sync
+void handle_packs_command(const char *packs_dir) {
+    static PackSet all;
+    char unused[1];
+    pack_set_open(&all, packs_dir, NULL, unused, sizeof(unused));
+
+    if (all.count == 0) {
+        printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        printf("%s╰─%s No packs installed. Add one as %s%s/<name>/definitions.wtfb%s\n\n",
+               COLOR_PRIMARY, COLOR_RESET, COLOR_DIM, packs_dir, COLOR_RESET);
+        return;
+    }
+
+    printf("\n%s╭─ %d pack%s installed%s\n", COLOR_PRIMARY, all.count, all.count > 1 ? "s" : "", COLOR_RESET);
+    printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+    for (int i = 0; i < all.count; i++) {
+        Pack *pack = &all.packs[i];
+        const char *branch = i == all.count - 1 ? "╰─" : "├─";
+        if (!pack_open(pack)) {
+            printf("%s%s %s%s%s: %sno definitions.wtfb or definitions.txt%s\n", COLOR_PRIMARY, branch,
+                   COLOR_YELLOW, pack->name, COLOR_RESET, COLOR_RED, COLOR_RESET);
+            continue;
+        }
+
+        unsigned long long entries = 0;
+        if (pack->store) {
+            entries = (unsigned long long)pack->store->entry_count;
+        } else {
+            for (int b = 0; b < pack->table->size; b++) {
+                for (HashNode *node = pack->table->table[b]; node; node = node->next) entries++;
+            }
+        }
+
+        SyncMetadata meta;
+        load_sync_metadata(pack->dir, &meta);
+        char synced[32] = "never synced";
+        if (meta.last_sync > 0) {
+            time_t when = (time_t)meta.last_sync;
+            strftime(synced, sizeof(synced), "synced %Y-%m-%d", localtime(&when));
+        }
+        printf("%s%s %s%s%s: %llu definition%s, %s, %s%s%s\n", COLOR_PRIMARY, branch,
+               COLOR_YELLOW, pack->name, COLOR_RESET, entries, entries == 1 ? "" : "s",
+               pack->store ? "block store" : "text", COLOR_DIM, synced, COLOR_RESET);
+    }
+    printf("\n");
+    pack_set_close(&all);
+}
+
+// Handle "wtf cache [clear]" command: hot answer cache usage, or drop every entry
+void handle_cache_command(const char *config_dir, char **args, int argc) {
+    if (argc > 2 && strcmp(args[2], "clear") == 0) {
+        hot_cache_bump(config_dir);
+        printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        printf("%s╰─ %s✓%s Cache cleared%s\n\n", COLOR_PRIMARY, COLOR_SUCCESS, COLOR_PRIMARY, COLOR_RESET);
+        return;
+    }
+
+    HotCache *cache = hot_cache_open(config_dir);
+    if (!cache) {
+        printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+        printf("%s╰─%s The answer cache is disabled or %s/%s is not writable\n\n",
+               COLOR_PRIMARY, COLOR_RESET, config_dir, HOT_CACHE_FILE);
+        return;
+    }
+
+    const HotCacheHeader *header = cache->header;
+    int used = 0;
+    for (int i = 0; i < HOT_CACHE_SLOTS; i++) {
+        if (cache->slots[i].generation == header->generation) used++;
+    }
+    unsigned long long hits = (unsigned long long)header->hits;
+    unsigned long long misses = (unsigned long long)header->misses;
+    printf("\n%s╭─ Answer cache%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─%s Entries    : %s%d / %d%s\n", COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW, used, HOT_CACHE_SLOTS, COLOR_RESET);
+    printf("%s├─%s Hits       : %s%llu%s\n", COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW, hits, COLOR_RESET);
+    printf("%s├─%s Misses     : %s%llu%s\n", COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW, misses, COLOR_RESET);
+    printf("%s├─%s Hit rate   : %s%.1f%%%s\n", COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW,
+           hits + misses ? 100.0 * (double)hits / (double)(hits + misses) : 0.0, COLOR_RESET);
+    printf("%s╰─%s Generation : %s%llu%s\n\n", COLOR_PRIMARY, COLOR_RESET, COLOR_DIM,
+           (unsigned long long)header->generation, COLOR_RESET);
+    hot_cache_close(cache);
+}
+
 // Handle "wtf remove <term>" command
-void handle_remove_command(HashTable *dictionary, HashTable *removed_dict, const char *removed_path, char **args, int argc) {
+void handle_remove_command(Dictionary *dict, const char *removed_path, char **args, int argc) {
     struct winsize w;
     ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
     int term_width = w.ws_col;
@@ -149,43 +349,37 @@ void handle_remove_command(HashTable *dictionary, HashTable *removed_dict, const
         if (i < argc - 1) strcat(term, " ");
     }
 
-    DefinitionList *definitions = hash_table_lookup_all(dictionary, term);
-    if (!definitions) {
+    LookupResult filtered;
+    lookup_result_init(&filtered);
+    if (dictionary_lookup_view(dict, term, &filtered) == 0) {
         printf("%s│%s\n",COLOR_RED, COLOR_RESET);
         printf("\n%s╰─ Term '%s%s%s' not found in the dictionary%s\n\n", 
             COLOR_RED, COLOR_YELLOW, term, COLOR_RED, COLOR_RESET);
+        lookup_result_free(&filtered);
         return;
     }
 
     // Filter out already removed definitions
-    DefinitionList *filtered = create_definition_list();
-    for (int i = 0; i < definitions->count; i++) {
-        if (!is_definition_removed(definitions->keys[i], definitions->definitions[i], removed_dict)) {
-            add_to_definition_list(filtered, definitions->keys[i], definitions->definitions[i]);
-        }
-    }
-
-    if (filtered->count == 0) {
+    if (dictionary_filter_removed(dict, &filtered) == 0) {
         printf("\n%s╰─ No definitions available to remove%s\n\n", COLOR_RED, COLOR_RESET);
-        free_definition_list(definitions);
-        free_definition_list(filtered);
+        lookup_result_free(&filtered);
         return;
     }
 
-    if (filtered->count == 1) {
+    if (filtered.count == 1) {
         // Single definition case
         printf("\n%s╭─ Found definition for '%s%s%s'%s\n",
             COLOR_PRIMARY, COLOR_YELLOW, term, COLOR_PRIMARY, COLOR_RESET);
         printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
         
-        int indent_size = 4 + strlen(filtered->keys[0]) + 2;
+        int indent_size = 4 + strlen(filtered.matches[0].key) + 2;
         printf("%s╰─ %s%s%s: ", 
             COLOR_PRIMARY,
             COLOR_YELLOW,
-            filtered->keys[0],
+            filtered.matches[0].key,
             COLOR_RESET);
         
-        print_wrapped_definition(filtered->definitions[0], indent_size, term_width, 1);
+        print_wrapped_definition(filtered.matches[0].definition, indent_size, term_width, 1);
         printf("\n\n");
         
         printf("\n► Are you sure you want to remove this definition? [Y/n]: ");
@@ -194,8 +388,7 @@ void handle_remove_command(HashTable *dictionary, HashTable *removed_dict, const
         while (getchar() != '\n');
         
         if (response == 'Y' || response == 'y') {
-            if (add_to_removed(removed_path, filtered->keys[0], filtered->definitions[0])) {
-                hash_table_insert(removed_dict, filtered->keys[0], filtered->definitions[0]);
+            if (dictionary_remove_definitions(dict, removed_path, &filtered.matches[0], 1) > 0) {
                 printf("%s│%s\n",COLOR_SUCCESS, COLOR_RESET);
                 printf("%s╰─ Definition removed successfully%s\n\n", COLOR_SUCCESS, COLOR_RESET);
             }
@@ -205,39 +398,43 @@ void handle_remove_command(HashTable *dictionary, HashTable *removed_dict, const
         }
     } else {
         // Multiple definitions case
+        STATS_BEGIN(render_started);
+        WTF_PROBE1(render__start, "remove");
         printf("\n%s╭─ Found %d definitions for '%s%s%s'%s\n",
-            COLOR_PRIMARY, filtered->count,
+            COLOR_PRIMARY, filtered.count,
             COLOR_YELLOW, term, COLOR_PRIMARY, COLOR_RESET);
         printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
         
-        for (int i = 0; i < filtered->count; i++) {
+        for (int i = 0; i < filtered.count; i++) {
             // Calculate indent size (number + ". " + term + ": ")
             int number_width = snprintf(NULL, 0, "%d", i + 1);
-            int indent_size = 4 + number_width + 2 + strlen(filtered->keys[i]) + 2;
+            int indent_size = 4 + number_width + 2 + strlen(filtered.matches[i].key) + 2;
             
-            if (i == filtered->count - 1) {
+            if (i == filtered.count - 1) {
                 printf("%s╰─ %s%d. %s%s: ",
                     COLOR_PRIMARY,
                     COLOR_YELLOW,
                     i + 1,
-                    filtered->keys[i],
+                    filtered.matches[i].key,
                     COLOR_RESET);
             } else {
                 printf("%s├─ %s%d. %s%s: ",
                     COLOR_PRIMARY,
                     COLOR_YELLOW,
                     i + 1,
-                    filtered->keys[i],
+                    filtered.matches[i].key,
                     COLOR_RESET);
             }
             
-            print_wrapped_definition(filtered->definitions[i], indent_size, term_width, i == filtered->count - 1);
+            print_wrapped_definition(filtered.matches[i].definition, indent_size, term_width, i == filtered.count - 1);
             
-            if (i < filtered->count - 1) {
+            if (i < filtered.count - 1) {
                 printf("\n%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
             }
         }
         
+        STATS_END(STAT_RENDER, render_started);
+        WTF_PROBE2(render__done, "remove", filtered.count);
         printf("\n\n► Enter the numbers of definitions to remove %s(separated by space or comma)%s: ", COLOR_YELLOW, COLOR_RESET);
             
         char input[MAX_INPUT_LENGTH];
@@ -247,21 +444,21 @@ void handle_remove_command(HashTable *dictionary, HashTable *removed_dict, const
             while (getchar() != '\n');
             
             if (response == 'Y' || response == 'y') {
+                // Every selected definition goes to removed.txt in one write
                 char *token = strtok(input, " ,\n");
-                int removed = 0;
+                int selected[MAX_INPUT_LENGTH];
+                LookupMatch chosen[MAX_INPUT_LENGTH];
+                int selected_count = 0;
                 
                 while (token) {
                     int num = atoi(token);
-                    if (num > 0 && num <= filtered->count) {
-                        if (add_to_removed(removed_path, filtered->keys[num-1], 
-                                         filtered->definitions[num-1])) {
-                            hash_table_insert(removed_dict, filtered->keys[num-1], 
-                                           filtered->definitions[num-1]);
-                            removed++;
-                        }
+                    if (num > 0 && num <= filtered.count && !is_selected(selected, selected_count, num - 1)) {
+                        chosen[selected_count] = filtered.matches[num - 1];
+                        selected[selected_count++] = num - 1;
                     }
                     token = strtok(NULL, " ,\n");
                 }
+                int removed = dictionary_remove_definitions(dict, removed_path, chosen, selected_count);
                 
                 if (removed > 0) {
                     printf("%s│%s\n",COLOR_SUCCESS, COLOR_RESET);
@@ -279,11 +476,10 @@ void handle_remove_command(HashTable *dictionary, HashTable *removed_dict, const
         }
     }
     
-    free_definition_list(definitions);
-    free_definition_list(filtered);
+    lookup_result_free(&filtered);
 }
 
-void handle_recover_command(HashTable *removed_dict, const char *removed_path, char **args, int argc) {
+void handle_recover_command(Dictionary *dict, const char *removed_path, char **args, int argc) {
     struct winsize w;
     ioctl(STDOUT_FILENO, TIOCGWINSZ, &w);
     int term_width = w.ws_col;
@@ -294,7 +490,7 @@ void handle_recover_command(HashTable *removed_dict, const char *removed_path, c
         if (i < argc - 1) strcat(term, " ");
     }
 
-    DefinitionList *removed_defs = hash_table_lookup_all(removed_dict, term);
+    DefinitionList *removed_defs = hash_table_lookup_all(dict->removed, term);
     if (!removed_defs) {
         printf("%s│%s\n",COLOR_RED, COLOR_RESET);
         printf("%s╰─ Term '%s%s%s' not found in removed definitions%s\n\n", 
@@ -324,8 +520,8 @@ void handle_recover_command(HashTable *removed_dict, const char *removed_path, c
         while (getchar() != '\n');
         
         if (response == 'Y' || response == 'y') {
-            if (remove_from_removed(removed_path, removed_defs->keys[0], removed_defs->definitions[0])) {
-                hash_table_delete_single(removed_dict, removed_defs->keys[0], removed_defs->definitions[0]);
+            LookupMatch match = {removed_defs->keys[0], removed_defs->definitions[0]};
+            if (dictionary_recover_definitions(dict, removed_path, &match, 1) > 0) {
                 printf("%s│%s\n",COLOR_SUCCESS, COLOR_RESET);
                 printf("%s╰─ Definition recovered successfully%s\n\n", COLOR_SUCCESS, COLOR_RESET);
             } else {
@@ -338,6 +534,8 @@ void handle_recover_command(HashTable *removed_dict, const char *removed_path, c
         }
     } else {
         // Multiple definitions case
+        STATS_BEGIN(render_started);
+        WTF_PROBE1(render__start, "recover");
         printf("\n%s╭─ Found %d removed definitions for '%s%s%s'%s\n",
             COLOR_PRIMARY, removed_defs->count,
             COLOR_YELLOW, term, COLOR_PRIMARY, COLOR_RESET);
@@ -370,6 +568,8 @@ void handle_recover_command(HashTable *removed_dict, const char *removed_path, c
             }
         }
         
+        STATS_END(STAT_RENDER, render_started);
+        WTF_PROBE2(render__done, "recover", removed_defs->count);
         printf("\n\n► Enter the numbers of definitions to recover %s(separated by space or comma)%s: ", 
             COLOR_YELLOW, COLOR_RESET);
             
@@ -380,21 +580,22 @@ void handle_recover_command(HashTable *removed_dict, const char *removed_path, c
             while (getchar() != '\n');
             
             if (response == 'Y' || response == 'y') {
+                // One rewrite of removed.txt drops every selected definition
                 char *token = strtok(input, " ,\n");
-                int recovered = 0;
+                int selected[MAX_INPUT_LENGTH];
+                LookupMatch chosen[MAX_INPUT_LENGTH];
+                int selected_count = 0;
                 
                 while (token) {
                     int num = atoi(token);
-                    if (num > 0 && num <= removed_defs->count) {
-                        if (remove_from_removed(removed_path, removed_defs->keys[num-1], 
-                                             removed_defs->definitions[num-1])) {
-                            hash_table_delete_single(removed_dict, removed_defs->keys[num-1], 
-                                                   removed_defs->definitions[num-1]);
-                            recovered++;
-                        }
+                    if (num > 0 && num <= removed_defs->count && !is_selected(selected, selected_count, num - 1)) {
+                        chosen[selected_count].key = removed_defs->keys[num - 1];
+                        chosen[selected_count].definition = removed_defs->definitions[num - 1];
+                        selected[selected_count++] = num - 1;
                     }
                     token = strtok(NULL, " ,\n");
                 }
+                int recovered = dictionary_recover_definitions(dict, removed_path, chosen, selected_count);
                 
                 if (recovered > 0) {
                     printf("%s│%s\n",COLOR_SUCCESS, COLOR_RESET);
@@ -502,6 +703,23 @@ int handle_uninstall_command(void) {
         closedir(dir);
     }
 
+    // Remove the shared base: its seed and what `wtf sync --system` made of it
+    static const char *const shared_dirs[] = {WTF_SYSTEM_DIR, WTF_STATE_DIR};
+    for (size_t i = 0; i < sizeof(shared_dirs) / sizeof(shared_dirs[0]); i++) {
+        struct stat shared_st;
+        if (stat(shared_dirs[i], &shared_st) != 0 || !S_ISDIR(shared_st.st_mode)) continue;
+        char rm_cmd[PATH_MAX + 10];
+        snprintf(rm_cmd, sizeof(rm_cmd), "rm -rf %s", shared_dirs[i]);
+        if (system(rm_cmd) == 0) {
+            printf("%s├─ %s✓%s Removed %s%s\n", 
+                   COLOR_PRIMARY, COLOR_SUCCESS, COLOR_DIM, shared_dirs[i], COLOR_RESET);
+        } else {
+            printf("%s├─ %s✗%s Failed to remove %s%s\n", 
+                   COLOR_PRIMARY, COLOR_RED, COLOR_DIM, shared_dirs[i], COLOR_RESET);
+            removal_successful = false;
+        }
+    }
+
     // Check if the main binary still exists
     if (access("/usr/bin/wtf", F_OK) == 0) {
         removal_successful = false;
@@ -2,10 +2,28 @@
 #define COMMANDS_H
 
 #include "hash_table.h"
+#include "dictionary.h"
+#include "hot_cache.h"
 
-void handle_is_command(HashTable *dictionary, HashTable *removed_dict, char **args, int argc);
-void handle_add_command(HashTable *dictionary, const char *added_path, const char *term, const char *definition);
-void handle_remove_command(HashTable *dictionary, HashTable *removed_dict, const char *removed_path, char **args, int argc);
-void handle_recover_command(HashTable *removed_dict, const char *removed_path, char **args, int argc);
+// Window of results printed by `wtf is` (--offset/--limit); limit 0 shows everything
+typedef struct {
+    int offset;
+    int limit;
+} LookupPage;
+
+#define FIND_DEFAULT_LIMIT 50   // terms `wtf find` lists without --limit
+#define SUGGESTION_LIMIT 5      // sound-alike terms offered after a miss
+
+void join_term_args(char **args, int argc, char *term, size_t size);
+void handle_is_command(Dictionary *dict, const char *term, const LookupPage *page, HotCache *cache);
+void render_is_result(const char *term, const LookupResult *definitions, const LookupPage *page,
+                      const FindResult *suggestions);
+void handle_sounds_like_command(Dictionary *dict, const char *word, const LookupPage *page);
+void handle_find_command(Dictionary *dict, const char *pattern, const LookupPage *page);
+void handle_add_command(Dictionary *dict, const char *added_path, const char *term, const char *definition);
+void handle_remove_command(Dictionary *dict, const char *removed_path, char **args, int argc);
+void handle_recover_command(Dictionary *dict, const char *removed_path, char **args, int argc);
+void handle_packs_command(const char *packs_dir);
+void handle_cache_command(const char *config_dir, char **args, int argc);
 int handle_uninstall_command(void);
 #endif
\ No newline at end of file
@@ -0,0 +1,167 @@
+#include <string.h>
+#include <strings.h>
+#include <zlib.h>
+#include "content_decoder.h"
+#include "stats.h"
+#ifdef WTF_HAVE_ZSTD
+#include <zstd.h>
+#endif
+#ifdef WTF_HAVE_BROTLI
+#include <brotli/decode.h>
+#endif
+
+#define DECODER_CHUNK (64 * 1024)
+
+const char *content_decoder_accept(void) {
+#if defined(WTF_HAVE_ZSTD) && defined(WTF_HAVE_BROTLI)
+    return "zstd, br, gzip";
+#elif defined(WTF_HAVE_ZSTD)
+    return "zstd, gzip";
+#elif defined(WTF_HAVE_BROTLI)
+    return "br, gzip";
+#else
+    return "gzip";
+#endif
+}
+
+const char *content_decoder_name(DecoderKind kind) {
+    switch (kind) {
+        case DECODER_IDENTITY: return "identity";
+        case DECODER_GZIP: return "gzip";
+        case DECODER_ZSTD: return "zstd";
+        case DECODER_BROTLI: return "br";
+        default: return "none";
+    }
+}
+
+int content_decoder_init(ContentDecoder *decoder, const char *content_encoding) {
+    memset(decoder, 0, sizeof(*decoder));
+    if (strcasecmp(content_encoding, "identity") == 0) {
+        decoder->kind = DECODER_IDENTITY;
+        return 1;
+    }
+    if (strcasecmp(content_encoding, "gzip") == 0 || strcasecmp(content_encoding, "x-gzip") == 0) {
+        z_stream *strm = wtf_malloc(sizeof(z_stream));
+        if (!strm) return 0;
+        memset(strm, 0, sizeof(*strm));
+        if (inflateInit2(strm, 16 + MAX_WBITS) != Z_OK) {
+            wtf_free(strm);
+            return 0;
+        }
+        decoder->state = strm;
+        decoder->kind = DECODER_GZIP;
+        return 1;
+    }
+#ifdef WTF_HAVE_ZSTD
+    if (strcasecmp(content_encoding, "zstd") == 0) {
+        ZSTD_DStream *stream = ZSTD_createDStream();
+        if (!stream) return 0;
+        if (ZSTD_isError(ZSTD_initDStream(stream))) {
+            ZSTD_freeDStream(stream);
+            return 0;
+        }
+        decoder->state = stream;
+        decoder->kind = DECODER_ZSTD;
+        return 1;
+    }
+#endif
+#ifdef WTF_HAVE_BROTLI
+    if (strcasecmp(content_encoding, "br") == 0) {
+        BrotliDecoderState *state = BrotliDecoderCreateInstance(NULL, NULL, NULL);
+        if (!state) return 0;
+        decoder->state = state;
+        decoder->kind = DECODER_BROTLI;
+        return 1;
+    }
+#endif
+    return 0;
+}
+
+static int feed_gzip(ContentDecoder *decoder, const void *data, size_t len, DecoderSink sink, void *arg) {
+    unsigned char out[DECODER_CHUNK];
+    z_stream *strm = decoder->state;
+    strm->next_in = (Bytef *)data;
+    strm->avail_in = (uInt)len;
+    while (strm->avail_in > 0 && !decoder->done) {
+        strm->next_out = out;
+        strm->avail_out = sizeof(out);
+        int ret = inflate(strm, Z_NO_FLUSH);
+        if (ret != Z_OK && ret != Z_STREAM_END) return 0;
+        if (!sink(arg, (const char *)out, sizeof(out) - strm->avail_out)) return 0;
+        if (ret == Z_STREAM_END) decoder->done = true;
+    }
+    return 1;
+}
+
+#ifdef WTF_HAVE_ZSTD
+static int feed_zstd(ContentDecoder *decoder, const void *data, size_t len, DecoderSink sink, void *arg) {
+    unsigned char out[DECODER_CHUNK];
+    ZSTD_inBuffer in = {data, len, 0};
+    // A frame can end with output still buffered, so drain past the last input byte
+    while (!decoder->done) {
+        ZSTD_outBuffer o = {out, sizeof(out), 0};
+        size_t ret = ZSTD_decompressStream(decoder->state, &o, &in);
+        if (ZSTD_isError(ret)) return 0;
+        if (!sink(arg, (const char *)out, o.pos)) return 0;
+        if (ret == 0) decoder->done = true;
+        if (in.pos == in.size && o.pos < o.size) break;
+    }
+    return 1;
+}
+#endif
+
+#ifdef WTF_HAVE_BROTLI
+static int feed_brotli(ContentDecoder *decoder, const void *data, size_t len, DecoderSink sink, void *arg) {
+    unsigned char out[DECODER_CHUNK];
+    const uint8_t *next_in = data;
+    size_t avail_in = len;
+    while (!decoder->done) {
+        uint8_t *next_out = out;
+        size_t avail_out = sizeof(out);
+        BrotliDecoderResult ret = BrotliDecoderDecompressStream(decoder->state, &avail_in, &next_in,
+                                                                &avail_out, &next_out, NULL);
+        if (ret == BROTLI_DECODER_RESULT_ERROR) return 0;
+        if (!sink(arg, (const char *)out, sizeof(out) - avail_out)) return 0;
+        if (ret == BROTLI_DECODER_RESULT_SUCCESS) decoder->done = true;
+        if (ret == BROTLI_DECODER_RESULT_NEEDS_MORE_INPUT) break;
+    }
+    return 1;
+}
+#endif
+
+int content_decoder_feed(ContentDecoder *decoder, const void *data, size_t len, DecoderSink sink, void *arg) {
+    if (decoder->done || len == 0) return 1;
+    switch (decoder->kind) {
+        case DECODER_IDENTITY: return sink(arg, data, len);
+        case DECODER_GZIP: return feed_gzip(decoder, data, len, sink, arg);
+#ifdef WTF_HAVE_ZSTD
+        case DECODER_ZSTD: return feed_zstd(decoder, data, len, sink, arg);
+#endif
+#ifdef WTF_HAVE_BROTLI
+        case DECODER_BROTLI: return feed_brotli(decoder, data, len, sink, arg);
+#endif
+        default: return 0;
+    }
+}
+
+void content_decoder_free(ContentDecoder *decoder) {
+    switch (decoder->kind) {
+        case DECODER_GZIP:
+            inflateEnd(decoder->state);
+            wtf_free(decoder->state);
+            break;
+#ifdef WTF_HAVE_ZSTD
+        case DECODER_ZSTD:
+            ZSTD_freeDStream(decoder->state);
+            break;
+#endif
+#ifdef WTF_HAVE_BROTLI
+        case DECODER_BROTLI:
+            BrotliDecoderDestroyInstance(decoder->state);
+            break;
+#endif
+        default:
+            break;
+    }
+    memset(decoder, 0, sizeof(*decoder));
+}
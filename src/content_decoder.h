@@ -0,0 +1,40 @@
+#ifndef CONTENT_DECODER_H
+#define CONTENT_DECODER_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+// Streaming decoders for the Content-Encoding of the dictionary download.
+// gzip is always there; zstd and brotli are built in when the Makefile finds
+// their headers (WTF_HAVE_ZSTD, WTF_HAVE_BROTLI). Input is fed in whatever
+// chunks arrive and the decoded bytes are handed to a sink as they come out.
+// "identity", a response sent without Content-Encoding, passes through as is;
+// it has no end marker, so done is never set and the caller goes by length.
+typedef enum {
+    DECODER_NONE = 0,
+    DECODER_IDENTITY,
+    DECODER_GZIP,
+    DECODER_ZSTD,
+    DECODER_BROTLI,
+} DecoderKind;
+
+// Returns 0 to stop decoding
+typedef int (*DecoderSink)(void *arg, const char *data, size_t len);
+
+typedef struct {
+    DecoderKind kind;
+    void *state;        // z_stream, ZSTD_DStream or BrotliDecoderState; NULL for identity
+    bool done;          // the end of the stream was decoded
+} ContentDecoder;
+
+// Accept-Encoding value listing what this build decodes, best first
+const char *content_decoder_accept(void);
+// Returns 0 if content_encoding is not one this build decodes
+int content_decoder_init(ContentDecoder *decoder, const char *content_encoding);
+// Returns 0 on corrupt input or when the sink stops. Input after the end of
+// the stream is ignored.
+int content_decoder_feed(ContentDecoder *decoder, const void *data, size_t len, DecoderSink sink, void *arg);
+void content_decoder_free(ContentDecoder *decoder);
+const char *content_decoder_name(DecoderKind kind);
+
+#endif
@@ -0,0 +1,388 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "dictionary.h"
+#include "casefold.h"
+#include "embedded_dict.h"
+#include "file_utils.h"
+#include "store_writer.h"
+#include "stats.h"
+#include "probes.h"
+
+void dictionary_init(Dictionary *dict, HashTable *entries, HashTable *removed) {
+    dict->entries = entries;
+    dict->removed = removed;
+    dict->embedded_base = embedded_dict_size() > 0;
+    dict->store = NULL;
+    memset(&dict->filter, 0, sizeof(dict->filter));
+    memset(&dict->keys, 0, sizeof(dict->keys));
+    dict->packs = NULL;
+    dict->trigrams = NULL;
+    dict->phonetics = NULL;
+    dict->stream = NULL;
+}
+
+// True when the base definitions come from somewhere other than the entries table
+int dictionary_has_base(const Dictionary *dict) {
+    return dict->embedded_base || dict->store != NULL;
+}
+
+// Load a definitions file into entries, remembering its terms for the filter
+int dictionary_load(Dictionary *dict, const char *path) {
+    return load_definitions_hashed(path, dict->entries, &dict->keys);
+}
+
+// Build the Bloom filter over everything dictionary_load() has read, so that
+// terms it has never seen skip the table walk. Call once loading is done.
+int dictionary_build_filter(Dictionary *dict) {
+    STATS_BEGIN(started);
+    bloom_free(&dict->filter);
+    int ok = bloom_build(&dict->filter, &dict->keys, bloom_target_fpr());
+    size_t count = dict->keys.count;
+    bloom_keys_free(&dict->keys);
+    STATS_END(STAT_BLOOM_BUILD, started);
+
+    if (ok && wtf_stats_enabled) {
+        stats_note_bloom_filter(bloom_estimated_fpr(&dict->filter, count),
+                                (size_t)dict->filter.block_count * BLOOM_BLOCK_BYTES);
+    }
+    return ok;
+}
+
+// Insert into entries, keeping the filter in step
+void dictionary_add(Dictionary *dict, const char *term, const char *definition) {
+    hash_table_insert(dict->entries, term, definition);
+    if (dict->filter.bits) {
+        bloom_add(&dict->filter, bloom_hash(term));
+    }
+}
+
+// Release what the dictionary owns itself; the tables, store and packs belong to the caller
+void dictionary_free(Dictionary *dict) {
+    bloom_free(&dict->filter);
+    bloom_keys_free(&dict->keys);
+    phonetic_index_free(dict->phonetics);
+    dict->phonetics = NULL;
+    trigram_index_free(dict->trigrams);
+    dict->trigrams = NULL;
+}
+
+// Base layer first, then the user's additions, then any selected packs. Appends borrowed matches to out
+// (free with lookup_result_free()) and returns how many were added.
+int dictionary_lookup_view(Dictionary *dict, const char *term, LookupResult *out) {
+    if (!dict || !term || !out) return 0;
+    int before = out->count;
+    WTF_PROBE1(dict_lookup__start, term);
+
+    if (dict->embedded_base) {
+        embedded_dict_lookup_view(term, out);
+    } else if (dict->store) {
+        block_store_lookup_view(dict->store, term, out);
+    }
+
+    if (dict->stream) {
+        stream_lookup_view(dict->stream, term, out);
+    } else if (!dict->filter.bits) {
+        hash_table_lookup_view(dict->entries, term, out);
+    } else {
+        int maybe = bloom_maybe_contains(&dict->filter, bloom_hash(term));
+        if (wtf_stats_enabled) stats_note_bloom_check(maybe);
+        if (maybe && hash_table_lookup_view(dict->entries, term, out) == 0 && wtf_stats_enabled) {
+            stats_note_bloom_false_positive();
+        }
+    }
+    if (dict->packs) {
+        pack_set_lookup_view(dict->packs, term, out);
+    }
+    WTF_PROBE2(dict_lookup__done, term, out->count - before);
+    return out->count - before;
+}
+
+// Drop matches listed in removed.txt, keeping the order. Returns the new count.
+int dictionary_filter_removed(Dictionary *dict, LookupResult *result) {
+    int kept = 0;
+    for (int i = 0; i < result->count; i++) {
+        const LookupMatch *match = &result->matches[i];
+        int removed = dict->stream ? stream_lookup_removed(dict->stream, match->key, match->definition)
+                                   : is_definition_removed(match->key, match->definition, dict->removed);
+        if (!removed) {
+            result->matches[kept++] = result->matches[i];
+        }
+    }
+    result->count = kept;
+    return kept;
+}
+
+// `wtf add`: append term:definition to added_path unless the term already has
+// exactly this definition. Returns 1 when added, 0 when it was already there,
+// -1 when added_path could not be written.
+int dictionary_add_definition(Dictionary *dict, const char *added_path, const char *term, const char *definition) {
+    LookupResult existing;
+    lookup_result_init(&existing);
+    dictionary_lookup_view(dict, term, &existing);
+    // Matches from a plain entries table hold its pooled copy; only the
+    // others need strcmp
+    const char *pooled = dict->entries->codec ? NULL : intern_pool_find(&dict->entries->strings, definition);
+    int exists = 0;
+    for (int i = 0; !exists && i < existing.count; i++) {
+        const char *match = existing.matches[i].definition;
+        exists = match == pooled || strcmp(match, definition) == 0;
+    }
+    lookup_result_free(&existing);
+    if (exists) return 0;
+
+    if (!add_to_added(added_path, term, definition)) return -1;
+    dictionary_add(dict, term, definition);
+    return 1;
+}
+
+// `wtf remove`: list every match in removed_path with one write, then in the
+// removed table. Returns how many were removed, or -1 when the file could not
+// be written.
+int dictionary_remove_definitions(Dictionary *dict, const char *removed_path, const LookupMatch *matches, int count) {
+    if (count <= 0) return 0;
+    StoreWriter writer;
+    store_writer_init(&writer, removed_path);
+    int ok = 1;
+    for (int i = 0; ok && i < count; i++) {
+        ok = store_writer_add(&writer, matches[i].key, matches[i].definition);
+    }
+    ok = ok && store_writer_commit(&writer);
+    store_writer_free(&writer);
+    if (!ok) return -1;
+
+    for (int i = 0; i < count; i++) {
+        hash_table_insert(dict->removed, matches[i].key, matches[i].definition);
+    }
+    return count;
+}
+
+// `wtf recover`: drop the matches from removed_path with one rewrite, then from
+// the removed table. The matches must not point into that table; take them
+// from hash_table_lookup_all(). Returns how many were recovered, 0 when
+// removed_path had none of them or could not be rewritten.
+int dictionary_recover_definitions(Dictionary *dict, const char *removed_path, const LookupMatch *matches, int count) {
+    if (count <= 0) return 0;
+    StoreWriter writer;
+    store_writer_init(&writer, removed_path);
+    int ok = 1;
+    for (int i = 0; ok && i < count; i++) {
+        ok = store_writer_add(&writer, matches[i].key, matches[i].definition);
+    }
+    ok = ok && store_writer_remove(&writer) > 0;
+    store_writer_free(&writer);
+    if (!ok) return 0;
+
+    for (int i = 0; i < count; i++) {
+        hash_table_delete_single(dict->removed, matches[i].key, matches[i].definition);
+    }
+    return count;
+}
+
+static int find_result_add(FindResult *result, const char *term) {
+    if (result->count == result->capacity) {
+        size_t capacity = result->capacity ? result->capacity * 2 : 64;
+        const char **terms = wtf_realloc(result->terms, capacity * sizeof(const char *));
+        if (!terms) return 0;
+        result->terms = terms;
+        result->capacity = capacity;
+    }
+    result->terms[result->count++] = term;
+    return 1;
+}
+
+void find_result_free(FindResult *result) {
+    wtf_free(result->terms);
+    memset(result, 0, sizeof(*result));
+}
+
+// Add every id index matches to out as a term
+static int find_in_index(const TrigramIndex *index, const char *pattern, FindResult *out) {
+    if (!index) return 1;
+    TrigramMatches matches = {0};
+    int ok = trigram_index_search(index, pattern, &matches) >= 0;
+    for (size_t i = 0; ok && i < matches.count; i++) {
+        ok = find_result_add(out, trigram_index_term(index, matches.ids[i]));
+    }
+    trigram_matches_free(&matches);
+    return ok;
+}
+
+static int add_table_terms(HashTable *table, TrigramBuilder *builder) {
+    for (int i = 0; i < table->size; i++) {
+        for (HashNode *node = table->table[i]; node; node = node->next) {
+            if (!trigram_builder_add(builder, node->key)) return 0;
+        }
+    }
+    return 1;
+}
+
+// Folded order, then byte order as in trigram_builder_build()
+static int compare_found(const void *a, const void *b) {
+    const char *x = *(const char * const *)a;
+    const char *y = *(const char * const *)b;
+    int c = casefold_compare(x, y);
+    return c != 0 ? c : strcmp(x, y);
+}
+
+// A term stays listed unless removed.txt takes away every definition it has
+static int fully_removed(Dictionary *dict, const char *term) {
+    LookupResult result;
+    lookup_result_init(&result);
+    int removed = hash_table_lookup_view(dict->removed, term, &result) > 0;
+    lookup_result_free(&result);
+    if (!removed) return 0;
+
+    lookup_result_init(&result);
+    dictionary_lookup_view(dict, term, &result);
+    removed = dictionary_filter_removed(dict, &result) == 0;
+    lookup_result_free(&result);
+    return removed;
+}
+
+// Index the terms of entries and the embedded base, once
+static TrigramIndex *entry_terms(Dictionary *dict) {
+    if (!dict->trigrams) {
+        TrigramBuilder builder;
+        trigram_builder_init(&builder);
+        int ok = add_table_terms(dict->entries, &builder);
+        for (size_t i = 0; ok && dict->embedded_base && i < embedded_dict_size(); i++) {
+            ok = trigram_builder_add(&builder, embedded_dict_key(i));
+        }
+        if (ok) dict->trigrams = trigram_builder_build(&builder);
+        trigram_builder_free(&builder);
+    }
+    return dict->trigrams;
+}
+
+// Every term matching pattern (see trigram_pattern_normalize()) across the
+// base layer, the user's additions and the selected packs. Block stores use
+// the index written beside them; everything else is indexed on first use.
+// Returns the number of terms, or -1 on failure.
+int dictionary_find(Dictionary *dict, const char *pattern, FindResult *out) {
+    if (!dict || !pattern || !out) return -1;
+    if (!entry_terms(dict)) return -1;
+
+    int ok = 1;
+    if (dict->store) {
+        TrigramIndex *index = block_store_trigram_index(dict->store);
+        ok = index && find_in_index(index, pattern, out);
+    }
+    ok = ok && find_in_index(dict->trigrams, pattern, out);
+    for (int i = 0; ok && dict->packs && i < dict->packs->count; i++) {
+        Pack *pack = &dict->packs->packs[i];
+        if (pack_open(pack)) ok = find_in_index(pack_trigram_index(pack), pattern, out);
+    }
+    if (!ok) return -1;
+
+    qsort(out->terms, out->count, sizeof(const char *), compare_found);
+    size_t kept = 0;
+    for (size_t i = 0; i < out->count; i++) {
+        if (kept > 0 && casefold_equal(out->terms[kept - 1], out->terms[i])) continue;
+        if (fully_removed(dict, out->terms[i])) continue;
+        out->terms[kept++] = out->terms[i];
+    }
+    out->count = kept;
+    return (int)kept;
+}
+
+// Add every term of index filed under one of keys to out
+static int sounds_in_index(const TrigramIndex *terms, const PhoneticIndex *index, const uint64_t *keys,
+                           int key_count, FindResult *out) {
+    if (!terms || !index) return 0;
+    for (int k = 0; k < key_count; k++) {
+        const uint32_t *ids;
+        uint32_t count = phonetic_index_lookup(index, keys[k], &ids);
+        for (uint32_t i = 0; i < count; i++) {
+            if (!find_result_add(out, trigram_index_term(terms, ids[i]))) return 0;
+        }
+    }
+    return 1;
+}
+
+// Levenshtein distance between the folded forms of a and b (first 64 bytes)
+static int spelling_distance(const char *a, const char *b) {
+    char x[CASEFOLD_SIZE(64)], y[CASEFOLD_SIZE(64)];
+    size_t n = casefold(a, x, sizeof(x)), m = casefold(b, y, sizeof(y));
+    if (n > 64) n = 64;
+    if (m > 64) m = 64;
+    int row[65];
+    for (size_t j = 0; j <= m; j++) row[j] = (int)j;
+    for (size_t i = 1; i <= n; i++) {
+        int diagonal = row[0];
+        row[0] = (int)i;
+        for (size_t j = 1; j <= m; j++) {
+            int above = row[j];
+            int best = diagonal + (x[i - 1] != y[j - 1]);
+            if (above + 1 < best) best = above + 1;
+            if (row[j - 1] + 1 < best) best = row[j - 1] + 1;
+            row[j] = best;
+            diagonal = above;
+        }
+    }
+    return row[m];
+}
+
+typedef struct {
+    const char *term;
+    int distance;
+} Suggestion;
+
+static int compare_suggestions(const void *a, const void *b) {
+    const Suggestion *x = a, *y = b;
+    if (x->distance != y->distance) return x->distance - y->distance;
+    return compare_found(&x->term, &y->term);
+}
+
+// A one-shot `wtf is` only scanned the text files for its own term; sounding
+// out a miss needs all of them, so load them as a normal run would have
+static void leave_stream(Dictionary *dict) {
+    StreamLookup *stream = dict->stream;
+    if (!stream) return;
+    for (int i = 0; i < stream->path_count; i++) load_definitions(stream->paths[i], dict->entries);
+    if (stream->removed_path) load_definitions(stream->removed_path, dict->removed);
+    dict->stream = NULL;
+}
+
+// Every term whose phonetic key (see phonetic.h) matches one of word's, across
+// the base layer, the user's additions and the selected packs, closest
+// spelling first. Returns the number of terms, or -1 on failure.
+int dictionary_sounds_like(Dictionary *dict, const char *word, FindResult *out) {
+    if (!dict || !word || !out) return -1;
+    uint64_t keys[2];
+    int key_count = phonetic_keys(word, keys);
+    if (key_count == 0) return 0;
+
+    leave_stream(dict);
+    if (!entry_terms(dict)) return -1;
+    if (!dict->phonetics) dict->phonetics = phonetic_index_build(dict->trigrams);
+
+    int ok = 1;
+    if (dict->store) {
+        ok = sounds_in_index(block_store_trigram_index(dict->store), block_store_phonetic_index(dict->store),
+                             keys, key_count, out);
+    }
+    ok = ok && sounds_in_index(dict->trigrams, dict->phonetics, keys, key_count, out);
+    for (int i = 0; ok && dict->packs && i < dict->packs->count; i++) {
+        Pack *pack = &dict->packs->packs[i];
+        if (pack_open(pack)) ok = sounds_in_index(pack_trigram_index(pack), pack_phonetic_index(pack), keys, key_count, out);
+    }
+    if (!ok) return -1;
+
+    qsort(out->terms, out->count, sizeof(const char *), compare_found);
+    Suggestion *ranked = wtf_malloc((out->count ? out->count : 1) * sizeof(Suggestion));
+    if (!ranked) return -1;
+    size_t kept = 0;
+    for (size_t i = 0; i < out->count; i++) {
+        if (kept > 0 && casefold_equal(ranked[kept - 1].term, out->terms[i])) continue;
+        if (fully_removed(dict, out->terms[i])) continue;
+        ranked[kept].term = out->terms[i];
+        ranked[kept].distance = spelling_distance(word, out->terms[i]);
+        kept++;
+    }
+    qsort(ranked, kept, sizeof(Suggestion), compare_suggestions);
+    for (size_t i = 0; i < kept; i++) out->terms[i] = ranked[i].term;
+    out->count = kept;
+    wtf_free(ranked);
+    return (int)kept;
+}
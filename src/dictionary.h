@@ -0,0 +1,50 @@
+#ifndef DICTIONARY_H
+#define DICTIONARY_H
+
+#include "hash_table.h"
+#include "block_store.h"
+#include "bloom.h"
+#include "packs.h"
+#include "trigram.h"
+#include "phonetic.h"
+#include "stream_lookup.h"
+
+// Everything a lookup consults: an optional base layer plus the user overlays
+typedef struct {
+    HashTable *entries;   // definitions.txt (unless a base layer replaces it) and added.txt
+    HashTable *removed;   // removed.txt
+    int embedded_base;    // base definitions were compiled in by `make embed`
+    BlockStore *store;    // definitions.wtfb, when present and not embedded
+    BloomFilter filter;   // folded keys of entries, see dictionary_build_filter()
+    BloomKeys keys;       // hashes gathered by dictionary_load() until the filter is built
+    PackSet *packs;       // selected packs, consulted after the user's additions
+    TrigramIndex *trigrams;  // terms of entries and the embedded base, built by the first find
+    PhoneticIndex *phonetics;  // over trigrams, built by the first sound-alike search
+    StreamLookup *stream; // one-shot `wtf is`: scan the text files instead of entries and removed
+} Dictionary;
+
+// Terms matching a `wtf find` pattern in folded order, or sounding like a word
+// (closest spelling first), one spelling per term. The strings are borrowed
+// from the dictionary's indexes.
+typedef struct {
+    const char **terms;
+    size_t count;
+    size_t capacity;
+} FindResult;
+
+void dictionary_init(Dictionary *dict, HashTable *entries, HashTable *removed);
+int dictionary_has_base(const Dictionary *dict);
+int dictionary_load(Dictionary *dict, const char *path);
+int dictionary_build_filter(Dictionary *dict);
+void dictionary_add(Dictionary *dict, const char *term, const char *definition);
+void dictionary_free(Dictionary *dict);
+int dictionary_lookup_view(Dictionary *dict, const char *term, LookupResult *out);
+int dictionary_filter_removed(Dictionary *dict, LookupResult *result);
+int dictionary_add_definition(Dictionary *dict, const char *added_path, const char *term, const char *definition);
+int dictionary_remove_definitions(Dictionary *dict, const char *removed_path, const LookupMatch *matches, int count);
+int dictionary_recover_definitions(Dictionary *dict, const char *removed_path, const LookupMatch *matches, int count);
+int dictionary_find(Dictionary *dict, const char *pattern, FindResult *out);
+int dictionary_sounds_like(Dictionary *dict, const char *word, FindResult *out);
+void find_result_free(FindResult *result);
+
+#endif
@@ -0,0 +1,72 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "embedded_dict.h"
+#include "casefold.h"
+#include "stats.h"
+
+#ifdef WTF_EMBEDDED_DICT
+// Generated by tools/wtf_embed.c; defines embedded_entries[], embedded_groups[]
+// and embedded_codec, which the values are encoded with
+#include WTF_EMBEDDED_DICT
+#else
+static const EmbeddedEntry embedded_entries[1] = {{NULL, NULL, NULL}};
+static const EmbeddedGroup embedded_groups[1] = {{NULL, 0, 0}};
+static const FsstTable embedded_codec;
+#define EMBEDDED_ENTRY_COUNT 0
+#define EMBEDDED_GROUP_COUNT 0
+#endif
+
+size_t embedded_dict_size(void) {
+    return EMBEDDED_ENTRY_COUNT;
+}
+
+// Term of the index-th embedded line, index < embedded_dict_size()
+const char* embedded_dict_key(size_t index) {
+    return embedded_entries[index].key;
+}
+
+static int compare_group(const void *key, const void *elem) {
+    return strcmp((const char *)key, ((const EmbeddedGroup *)elem)->folded);
+}
+
+// Decode entry's definition into a buffer out keeps, and reference it
+static void add_entry(const EmbeddedEntry *entry, LookupResult *out) {
+    size_t size = fsst_decoded_length(&embedded_codec, entry->value) + 1;
+    char *decoded = wtf_malloc(size);
+    if (!decoded) return;
+    fsst_decode(&embedded_codec, entry->value, decoded, size);
+    if (lookup_result_add(out, entry->key, decoded)) {
+        lookup_result_keep(out, decoded);
+    } else {
+        wtf_free(decoded);
+    }
+}
+
+// Append every embedded definition for term (any case) to out, exact-case matches first.
+// Keys point into .rodata, definitions are decoded into buffers out owns.
+// Returns the number of definitions appended.
+int embedded_dict_lookup_view(const char *term, LookupResult *out) {
+    if (!term || !out || EMBEDDED_GROUP_COUNT == 0) return 0;
+
+    char folded[CASEFOLD_SIZE(256)];
+    if (strlen(term) >= 256 || casefold(term, folded, sizeof(folded)) >= sizeof(folded)) return 0;
+
+    const EmbeddedGroup *group = bsearch(folded, embedded_groups, EMBEDDED_GROUP_COUNT,
+                                         sizeof(EmbeddedGroup), compare_group);
+    if (!group) return 0;
+
+    int before = out->count;
+    // Walk each group backwards: the hash table prepends on insert, so the
+    // file-based path lists the last definition in the file first
+    for (int pass = 0; pass < 2; pass++) {
+        for (unsigned int i = group->first + group->count; i-- > group->first;) {
+            const EmbeddedEntry *entry = &embedded_entries[i];
+            int exact = strcmp(entry->key, term) == 0;
+            if ((pass == 0) == exact) {
+                add_entry(entry, out);
+            }
+        }
+    }
+    return out->count - before;
+}
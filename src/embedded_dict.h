@@ -0,0 +1,25 @@
+#ifndef EMBEDDED_DICT_H
+#define EMBEDDED_DICT_H
+
+#include <stddef.h>
+#include "hash_table.h"
+
+// One term:definition line compiled into the binary by `make embed`
+typedef struct {
+    const char *folded;   // casefold()ed key, the sort key
+    const char *key;
+    const char *value;    // FSST-encoded with embedded_codec
+} EmbeddedEntry;
+
+// Sorted index over distinct folded terms: entries[first .. first + count)
+typedef struct {
+    const char *folded;
+    unsigned int first;
+    unsigned int count;
+} EmbeddedGroup;
+
+size_t embedded_dict_size(void);
+int embedded_dict_lookup_view(const char *term, LookupResult *out);
+const char* embedded_dict_key(size_t index);
+
+#endif
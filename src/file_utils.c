@@ -1,25 +1,50 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <limits.h>
+#include <unistd.h>
 #include "file_utils.h"
 #include "hash_table.h"
+#include "block_store.h"
+#include "network_sync.h"
+#include "store_writer.h"
+#include "stats.h"
+#include "probes.h"
 
 // Load definitions from file into hash table
 int load_definitions(const char *filename, HashTable *table) {
+    return load_definitions_hashed(filename, table, NULL);
+}
+
+// Same, also collecting each term's Bloom hash into keys (when non-NULL)
+// while the line is still in cache
+int load_definitions_hashed(const char *filename, HashTable *table, BloomKeys *keys) {
+    STATS_BEGIN(started);
+    WTF_PROBE1(load__start, filename);
     FILE *file = fopen(filename, "r");
-    if (!file) return 0;
+    if (!file) {
+        STATS_END(STAT_LOAD_DEFINITIONS, started);
+        WTF_PROBE3(load__done, filename, 0L, 0);
+        return 0;
+    }
 
     char line[256];
+    long entries = 0;
     while (fgets(line, sizeof(line), file)) {
-        char *term = strtok(line, ":");
-        char *definition = strtok(NULL, "\n");
+        char *save = NULL;
+        char *term = strtok_r(line, ":", &save);
+        char *definition = strtok_r(NULL, "\n", &save);
         if (term && definition) {
             // Check if this is a new term or additional definition
             hash_table_insert(table, term, definition);
+            if (keys) bloom_keys_add(keys, bloom_hash(term));
+            entries++;
         }
     }
 
     fclose(file);
+    STATS_END(STAT_LOAD_DEFINITIONS, started);
+    WTF_PROBE3(load__done, filename, entries, 1);
     return 1;
 }
 
@@ -30,8 +55,9 @@ int load_removed_definitions(const char *filename, HashTable *removed_table) {
 
     char line[256];
     while (fgets(line, sizeof(line), file)) {
-        char *term = strtok(line, ":");
-        char *definition = strtok(NULL, "\n");
+        char *save = NULL;
+        char *term = strtok_r(line, ":", &save);
+        char *definition = strtok_r(NULL, "\n", &save);
         if (term && definition) {
             hash_table_insert(removed_table, term, definition);
         }
@@ -43,86 +69,39 @@ int load_removed_definitions(const char *filename, HashTable *removed_table) {
 
 // Check if a specific term:definition pair is in the removed list
 int is_definition_removed(const char *term, const char *definition, HashTable *removed_table) {
-    DefinitionList *removed_defs = hash_table_lookup_all(removed_table, term);
-    if (!removed_defs) return 0;
-
-    for (int i = 0; i < removed_defs->count; i++) {
-        if (strcmp(removed_defs->definitions[i], definition) == 0) {
-            free_definition_list(removed_defs);
-            return 1;
-        }
-    }
+    WTF_PROBE1(removed__start, term);
+    int removed = hash_table_contains(removed_table, term, definition);
+    WTF_PROBE2(removed__done, term, removed);
+    return removed;
+}
 
-    free_definition_list(removed_defs);
-    return 0;
+// Append one term:definition line under the file's lock
+static int append_record(const char *filename, const char *term, const char *definition) {
+    StoreWriter writer;
+    store_writer_init(&writer, filename);
+    int ok = store_writer_add(&writer, term, definition) && store_writer_commit(&writer);
+    store_writer_free(&writer);
+    return ok;
 }
 
 // Add a definition to the removed.txt file
 int add_to_removed(const char *filename, const char *term, const char *definition) {
-    FILE *file = fopen(filename, "a");
-    if (!file) return 0;
-
-    fprintf(file, "%s:%s\n", term, definition);
-    fclose(file);
-    return 1;
+    return append_record(filename, term, definition);
 }
 
 // Add a definition to the added.txt file
 int add_to_added(const char *filename, const char *term, const char *definition) {
-    FILE *file = fopen(filename, "a");
-    if (!file) return 0;
-
-    fprintf(file, "%s:%s\n", term, definition);
-    fclose(file);
-    return 1;
+    return append_record(filename, term, definition);
 }
 
 int remove_from_removed(const char *filename, const char *term, const char *definition) {
-    FILE *file = fopen(filename, "r");
-    if (!file) return 0;
-    
-    // Create a temporary file
-    FILE *temp = fopen("/tmp/wtf_temp", "w");
-    if (!temp) {
-        fclose(file);
-        return 0;
-    }
-    
-    char line[256];
-    int removed = 0;
-    
-    // Copy all lines except the one to be removed
-    while (fgets(line, sizeof(line), file)) {
-        char *curr_term = strdup(line);
-        char *curr_def = strchr(curr_term, ':');
-        if (curr_def) {
-            *curr_def = '\0';
-            curr_def++;
-            char *newline = strchr(curr_def, '\n');
-            if (newline) *newline = '\0';
-            
-            if (strcmp(curr_term, term) != 0 || strcmp(curr_def, definition) != 0) {
-                fprintf(temp, "%s", line);
-            } else {
-                removed = 1;
-            }
-        }
-        free(curr_term);
-    }
-    
-    fclose(file);
-    fclose(temp);
-    
-    // Replace original file with temporary file
-    if (removed) {
-        remove(filename);
-        rename("/tmp/wtf_temp", filename);
-        return 1;
-    }
-    
-    remove("/tmp/wtf_temp");
-    return 0;
+    StoreWriter writer;
+    store_writer_init(&writer, filename);
+    int removed = store_writer_add(&writer, term, definition) && store_writer_remove(&writer) > 0;
+    store_writer_free(&writer);
+    return removed;
 }
+
 int save_definitions(const char *filename, HashTable *table) {
     FILE *file = fopen(filename, "w");
     if (!file) {
@@ -130,14 +109,51 @@ int save_definitions(const char *filename, HashTable *table) {
     }
 
     // Iterate through the hash table and save each entry
-    for (int i = 0; i < table->size; i++) {
+    char *scratch = NULL;
+    size_t scratch_size = 0;
+    int ok = 1;
+    for (int i = 0; ok && i < table->size; i++) {
         HashNode *current = table->table[i];
-        while (current != NULL) {
-            fprintf(file, "%s:%s\n", current->key, current->value);
+        while (ok && current != NULL) {
+            const char *value = hash_table_node_value(table, current, &scratch, &scratch_size);
+            ok = value != NULL;
+            if (ok) fprintf(file, "%s:%s\n", current->key, value);
             current = current->next;
         }
     }
+    wtf_free(scratch);
 
     fclose(file);
-    return 1;
-}
\ No newline at end of file
+    return ok;
+}
+
+// The packaged seed dictionary: WTF_SYSTEM_DIR from the environment, else the built-in path
+const char *get_system_base_directory(void) {
+    const char *override = getenv("WTF_SYSTEM_DIR");
+    return override && *override ? override : WTF_SYSTEM_DIR;
+}
+
+// The shared base root syncs: WTF_STATE_DIR from the environment, else the built-in path
+const char *get_state_directory(void) {
+    const char *override = getenv("WTF_STATE_DIR");
+    return override && *override ? override : WTF_STATE_DIR;
+}
+
+// The plain-text base dictionary of base_dir: its own res/definitions.txt, or
+// for the shared state directory the seed in the system directory. Returns 1
+// if the file is base_dir's own and a sync may replace it; the seed belongs
+// to the package and is never written.
+int base_text_path(const char *base_dir, char *path, size_t size) {
+    int shared = strcmp(base_dir, get_state_directory()) == 0;
+    snprintf(path, size, "%s/res/definitions.txt", shared ? get_system_base_directory() : base_dir);
+    return !shared;
+}
+
+// True if dir (a ~/.wtf or the shared state directory) has a base dictionary
+int has_base_dictionary(const char *dir) {
+    char path[PATH_MAX];
+    snprintf(path, sizeof(path), "%s/res/%s", dir, BLOCK_STORE_FILE);
+    if (access(path, R_OK) == 0) return 1;
+    base_text_path(dir, path, sizeof(path));
+    return access(path, R_OK) == 0;
+}
@@ -2,8 +2,10 @@
 #define FILE_UTILS_H
 
 #include "hash_table.h"
+#include "bloom.h"
 
 int load_definitions(const char *filename, HashTable *table);
+int load_definitions_hashed(const char *filename, HashTable *table, BloomKeys *keys);
 int add_definition(const char *filename, const char *entry);
 int load_removed_definitions(const char *filename, HashTable *removed_table);
 int is_definition_removed(const char *term, const char *definition, HashTable *removed_table);
@@ -11,5 +13,9 @@ int add_to_removed(const char *filename, const char *term, const char *definitio
 int add_to_added(const char *filename, const char *term, const char *definition);
 int remove_from_removed(const char *filename, const char *term, const char *definition);
 int save_definitions(const char *filename, HashTable *table);
+const char *get_system_base_directory(void);
+const char *get_state_directory(void);
+int base_text_path(const char *base_dir, char *path, size_t size);
+int has_base_dictionary(const char *dir);
 
 #endif
\ No newline at end of file
@@ -0,0 +1,200 @@
+#include <stdlib.h>
+#include <string.h>
+#include "fsst.h"
+#include "stats.h"
+
+#define FSST_ROUNDS 5
+#define FSST_CANDIDATE_SLOTS (1u << 16)
+
+// A string of up to FSST_SYMBOL_MAX bytes seen while training, and how often
+typedef struct {
+    unsigned char bytes[FSST_SYMBOL_MAX];
+    uint32_t len;   // 0 when the slot is free
+    uint32_t count;
+} Candidate;
+
+// The first n bytes of a word, in memory order
+static const unsigned char prefix_masks[FSST_SYMBOL_MAX + 1][FSST_SYMBOL_MAX] = {
+    {0}, {0xff}, {0xff, 0xff}, {0xff, 0xff, 0xff}, {0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff}, {0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+    {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff}, {0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff},
+};
+
+// Longest symbol at p, or 0 when the byte has to be escaped. Candidates are
+// compared as one 8-byte word masked to their length.
+static int match_code(const FsstTable *table, const unsigned char *p, size_t left) {
+    uint64_t in = 0;
+    memcpy(&in, p, left < FSST_SYMBOL_MAX ? left : FSST_SYMBOL_MAX);
+    for (int k = table->first[*p]; k < table->first[*p + 1]; k++) {
+        int code = table->order[k];
+        size_t len = table->lengths[code];
+        if (len > left) continue;
+        uint64_t symbol, mask;
+        memcpy(&symbol, table->symbols[code], FSST_SYMBOL_MAX);
+        memcpy(&mask, prefix_masks[len], sizeof(mask));
+        if (((symbol ^ in) & mask) == 0) return code;
+    }
+    return 0;
+}
+
+static int compare_index(const void *a, const void *b, void *arg) {
+    const FsstTable *table = arg;
+    int x = *(const unsigned char *)a, y = *(const unsigned char *)b;
+    if (table->symbols[x][0] != table->symbols[y][0]) return table->symbols[x][0] - table->symbols[y][0];
+    if (table->lengths[x] != table->lengths[y]) return table->lengths[y] - table->lengths[x];
+    return x - y;
+}
+
+// Rebuild order and first from symbols, lengths and count
+void fsst_table_index(FsstTable *table) {
+    for (int code = 1; code <= table->count; code++) table->order[code - 1] = (unsigned char)code;
+    qsort_r(table->order, (size_t)table->count, 1, compare_index, table);
+
+    memset(table->first, 0, sizeof(table->first));
+    for (int k = 0; k < table->count; k++) table->first[table->symbols[table->order[k]][0] + 1]++;
+    for (int b = 0; b < 256; b++) table->first[b + 1] += table->first[b];
+}
+
+static void count_candidate(Candidate *slots, const unsigned char *bytes, size_t len) {
+    uint64_t h = 0;
+    memcpy(&h, bytes, len);
+    h = (h ^ len) * 0x9e3779b97f4a7c15ULL;
+    for (uint32_t i = (uint32_t)(h >> 48), probes = 0; probes < 64; i = (i + 1) & (FSST_CANDIDATE_SLOTS - 1), probes++) {
+        Candidate *c = &slots[i];
+        if (c->len == len && memcmp(c->bytes, bytes, len) == 0) {
+            c->count++;
+            return;
+        }
+        if (c->len == 0) {
+            memcpy(c->bytes, bytes, len);
+            c->len = (uint32_t)len;
+            c->count = 1;
+            return;
+        }
+    }
+    // Table crowded: a rare string is not worth a symbol anyway
+}
+
+// Highest gain (bytes a code would stand in for) first; ties by bytes so
+// training is deterministic
+static int compare_gain(const void *a, const void *b) {
+    const Candidate *x = a, *y = b;
+    uint64_t gx = (uint64_t)x->count * x->len, gy = (uint64_t)y->count * y->len;
+    if (gx != gy) return gx > gy ? -1 : 1;
+    if (x->len != y->len) return x->len > y->len ? -1 : 1;
+    return memcmp(x->bytes, y->bytes, FSST_SYMBOL_MAX);
+}
+
+// Learn a symbol table from samples (at most FSST_SAMPLE_BYTES of them, spread
+// over the array). Each round encodes the sample with the current table and
+// keeps the symbols, and pairs of adjacent symbols, that cover the most bytes.
+int fsst_train(FsstTable *table, const char *const *samples, size_t count) {
+    memset(table, 0, sizeof(*table));
+    size_t total = 0;
+    for (size_t i = 0; i < count; i++) total += strlen(samples[i]);
+    size_t stride = total > FSST_SAMPLE_BYTES ? total / FSST_SAMPLE_BYTES + 1 : 1;
+
+    Candidate *slots = wtf_malloc(FSST_CANDIDATE_SLOTS * sizeof(Candidate));
+    if (!slots) return 0;
+    for (int round = 0; round < FSST_ROUNDS; round++) {
+        memset(slots, 0, FSST_CANDIDATE_SLOTS * sizeof(Candidate));
+        for (size_t i = 0; i < count; i += stride) {
+            const unsigned char *s = (const unsigned char *)samples[i];
+            size_t left = strlen(samples[i]);
+            const unsigned char *prev = NULL;
+            size_t prev_len = 0;
+            while (left > 0) {
+                int code = match_code(table, s, left);
+                size_t len = code ? table->lengths[code] : 1;
+                count_candidate(slots, s, len);
+                if (prev && prev_len + len <= FSST_SYMBOL_MAX) count_candidate(slots, prev, prev_len + len);
+                prev = s;
+                prev_len = len;
+                s += len;
+                left -= len;
+            }
+        }
+
+        size_t used = 0;
+        for (size_t i = 0; i < FSST_CANDIDATE_SLOTS; i++) {
+            if (slots[i].len) slots[used++] = slots[i];
+        }
+        qsort(slots, used, sizeof(Candidate), compare_gain);
+
+        table->count = used < FSST_MAX_SYMBOLS ? (int)used : FSST_MAX_SYMBOLS;
+        for (int code = 1; code <= table->count; code++) {
+            memcpy(table->symbols[code], slots[code - 1].bytes, FSST_SYMBOL_MAX);
+            table->lengths[code] = (unsigned char)slots[code - 1].len;
+        }
+        fsst_table_index(table);
+    }
+    wtf_free(slots);
+    return 1;
+}
+
+// Encode str into out (FSST_ENCODED_SIZE(strlen(str)) bytes is always enough).
+// Returns the encoded length; out is left unterminated when that does not fit.
+size_t fsst_encode(const FsstTable *table, const char *str, char *out, size_t size) {
+    const unsigned char *s = (const unsigned char *)str;
+    size_t left = strlen(str), len = 0;
+    while (left > 0) {
+        int code = match_code(table, s, left);
+        if (code) {
+            if (len + 1 < size) out[len] = (char)code;
+            len++;
+            s += table->lengths[code];
+            left -= table->lengths[code];
+        } else {
+            if (len + 2 < size) {
+                out[len] = (char)FSST_ESCAPE;
+                out[len + 1] = (char)*s;
+            }
+            len += 2;
+            s++;
+            left--;
+        }
+    }
+    if (len < size) out[len] = '\0';
+    return len;
+}
+
+size_t fsst_decoded_length(const FsstTable *table, const char *encoded) {
+    const unsigned char *p = (const unsigned char *)encoded;
+    size_t len = 0;
+    while (*p) {
+        if (*p == FSST_ESCAPE) {
+            p += 2;
+            len++;
+        } else {
+            len += table->lengths[*p++];
+        }
+    }
+    return len;
+}
+
+// Decode into out (fsst_decoded_length() + 1 bytes). Returns the decoded
+// length; out is left unterminated when that does not fit.
+size_t fsst_decode(const FsstTable *table, const char *encoded, char *out, size_t size) {
+    const unsigned char *p = (const unsigned char *)encoded;
+    size_t len = 0;
+    while (*p) {
+        if (*p == FSST_ESCAPE) {
+            if (len + 1 < size) out[len] = (char)p[1];
+            len++;
+            p += 2;
+            continue;
+        }
+        // Copy all 8 symbol bytes while there is room: a fixed-size copy is
+        // one store, and the bytes past the symbol are overwritten next
+        size_t n = table->lengths[*p];
+        if (len + FSST_SYMBOL_MAX < size) {
+            memcpy(out + len, table->symbols[*p], FSST_SYMBOL_MAX);
+        } else if (len + n < size) {
+            memcpy(out + len, table->symbols[*p], n);
+        }
+        len += n;
+        p++;
+    }
+    if (len < size) out[len] = '\0';
+    return len;
+}
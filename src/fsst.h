@@ -0,0 +1,34 @@
+#ifndef FSST_H
+#define FSST_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Static symbol table compression for short strings, after FSST (Boncz,
+// Neumann, Leis, VLDB 2020). Up to 254 symbols of 1-8 bytes are trained on a
+// sample; each becomes a one-byte code (1..254) and bytes no symbol covers are
+// written as FSST_ESCAPE plus the byte. Codes are never 0, so an encoded
+// string is still a C string and can be hashed, interned and compared as one.
+#define FSST_SYMBOL_MAX 8
+#define FSST_MAX_SYMBOLS 254
+#define FSST_ESCAPE 255
+#define FSST_SAMPLE_BYTES (64 * 1024)
+
+// Worst case: every byte escaped, plus the terminator
+#define FSST_ENCODED_SIZE(len) (2 * (len) + 1)
+
+typedef struct {
+    unsigned char symbols[256][FSST_SYMBOL_MAX];   // by code; 0 and FSST_ESCAPE unused
+    unsigned char lengths[256];
+    int count;                  // codes 1..count are symbols
+    unsigned char order[256];   // codes by first byte, longest first
+    uint16_t first[257];        // order[first[b] .. first[b + 1]) start with byte b
+} FsstTable;
+
+int fsst_train(FsstTable *table, const char *const *samples, size_t count);
+void fsst_table_index(FsstTable *table);
+size_t fsst_encode(const FsstTable *table, const char *str, char *out, size_t size);
+size_t fsst_decoded_length(const FsstTable *table, const char *encoded);
+size_t fsst_decode(const FsstTable *table, const char *encoded, char *out, size_t size);
+
+#endif
@@ -1,48 +1,76 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
-#include <ctype.h>
 #include "hash_table.h"
+#include "casefold.h"
+#include "stats.h"
+#include "probes.h"
 
-// Hash function
+// Hash function. Keys are hashed folded, so every case variant of a term
+// lands in the same bucket.
 unsigned int hash_function(const char *key, int size) {
-    unsigned int hash = 0;
-    while (*key) {
-        hash = (hash * 31) + *key++;
-    }
-    return hash % size;
+    return (unsigned int)(casefold_hash(key) % (uint64_t)size);
 }
 
 // Create a hash table
 HashTable* create_hash_table(int size) {
-    HashTable *table = malloc(sizeof(HashTable));
+    HashTable *table = wtf_malloc(sizeof(HashTable));
     if (!table) return NULL;
     
     table->size = size;
-    table->table = calloc(size, sizeof(HashNode*));
+    table->table = wtf_calloc(size, sizeof(HashNode*));
     if (!table->table) {
-        free(table);
+        wtf_free(table);
         return NULL;
     }
-    
+    intern_pool_init(&table->strings);
+    table->codec = NULL;
+
     return table;
 }
 
+// value as the table stores it: as is, or encoded into buf (or an allocation
+// left in *heap when buf is too small) in a compressed table
+static const char *stored_form(const HashTable *table, const char *value, char *buf, size_t size, char **heap) {
+    *heap = NULL;
+    if (!table->codec) return value;
+    size_t need = FSST_ENCODED_SIZE(strlen(value));
+    if (need > size) {
+        buf = *heap = wtf_malloc(need);
+        if (!buf) return NULL;
+        size = need;
+    }
+    fsst_encode(table->codec, value, buf, size);
+    return buf;
+}
+
+// The pool's copy of value's stored form, or NULL when no node has it
+static const char *find_value(const HashTable *table, const char *value) {
+    char buf[512], *heap;
+    const char *stored = stored_form(table, value, buf, sizeof(buf), &heap);
+    const char *pooled = stored ? intern_pool_find(&table->strings, stored) : NULL;
+    wtf_free(heap);
+    return pooled;
+}
+
 // Insert a key-value pair
 void hash_table_insert(HashTable *table, const char *key, const char *value) {
     if (!table || !key || !value) return;
 
     unsigned int index = hash_function(key, table->size);
-    HashNode *new_node = malloc(sizeof(HashNode));
+    HashNode *new_node = wtf_malloc(sizeof(HashNode));
     if (!new_node) return;
 
-    new_node->key = strdup(key);
-    new_node->value = strdup(value);
-    
+    // Terms repeat once per definition and stock definitions across terms:
+    // the pool keeps one copy of each
+    char buf[512], *heap;
+    const char *stored = stored_form(table, value, buf, sizeof(buf), &heap);
+    new_node->key = intern_pool_add(&table->strings, key);
+    new_node->value = stored ? intern_pool_add(&table->strings, stored) : NULL;
+    wtf_free(heap);
+
     if (!new_node->key || !new_node->value) {
-        free(new_node->key);
-        free(new_node->value);
-        free(new_node);
+        wtf_free(new_node);
         return;
     }
 
@@ -50,63 +78,99 @@ void hash_table_insert(HashTable *table, const char *key, const char *value) {
     table->table[index] = new_node;
 }
 
-// Lookup a single key
-char* hash_table_lookup(HashTable *table, const char *key) {
-    if (!table || !key) return NULL;
-
-    unsigned int index = hash_function(key, table->size);
-    HashNode *node = table->table[index];
-    
-    // Create a lowercase version of the input key
-    char *lower_key = strdup(key);
-    if (!lower_key) return NULL;
+// Re-store every value FSST-encoded with a symbol table trained on them, and
+// encode later inserts the same way. For long-lived tables: lookups then
+// decode only the definitions they return. Returns 1 on success; on failure
+// the table is left as it was.
+int hash_table_compress(HashTable *table) {
+    if (!table || table->codec) return 0;
 
-    for (int i = 0; lower_key[i]; i++) {
-        lower_key[i] = tolower((unsigned char)lower_key[i]);
+    size_t count = 0;
+    for (int i = 0; i < table->size; i++) {
+        for (HashNode *node = table->table[i]; node; node = node->next) count++;
+    }
+    const char **values = wtf_malloc((count ? count : 1) * 2 * sizeof(const char *));
+    FsstTable *codec = wtf_malloc(sizeof(FsstTable));
+    if (!values || !codec) {
+        wtf_free(values);
+        wtf_free(codec);
+        return 0;
+    }
+    size_t n = 0;
+    for (int i = 0; i < table->size; i++) {
+        for (HashNode *node = table->table[i]; node; node = node->next) values[n++] = node->value;
     }
 
-    while (node) {
-        // Create a lowercase version of the node's key
-        char *lower_node_key = strdup(node->key);
-        if (!lower_node_key) {
-            free(lower_key);
-            return NULL;
-        }
-
-        for (int i = 0; lower_node_key[i]; i++) {
-            lower_node_key[i] = tolower((unsigned char)lower_node_key[i]);
+    // A fresh pool with the keys and the encoded values; nodes are only
+    // repointed once all of it is in place
+    InternPool fresh;
+    intern_pool_init(&fresh);
+    int ok = fsst_train(codec, values, count);
+    table->codec = codec;
+    n = 0;
+    for (int i = 0; ok && i < table->size; i++) {
+        for (HashNode *node = table->table[i]; ok && node; node = node->next) {
+            char buf[512], *heap;
+            const char *stored = stored_form(table, node->value, buf, sizeof(buf), &heap);
+            values[2 * n] = intern_pool_add(&fresh, node->key);
+            values[2 * n + 1] = stored ? intern_pool_add(&fresh, stored) : NULL;
+            wtf_free(heap);
+            ok = values[2 * n] && values[2 * n + 1];
+            n++;
         }
+    }
+    if (!ok) {
+        table->codec = NULL;
+        intern_pool_free(&fresh);
+        wtf_free(codec);
+        wtf_free(values);
+        return 0;
+    }
 
-        if (strcmp(lower_node_key, lower_key) == 0) {
-            free(lower_key);
-            free(lower_node_key);
-            return node->value;
+    n = 0;
+    for (int i = 0; i < table->size; i++) {
+        for (HashNode *node = table->table[i]; node; node = node->next, n++) {
+            node->key = values[2 * n];
+            node->value = values[2 * n + 1];
         }
-
-        free(lower_node_key);
-        node = node->next;
     }
+    intern_pool_free(&table->strings);
+    table->strings = fresh;
+    wtf_free(values);
+    return 1;
+}
 
-    free(lower_key);
-    return NULL;
+// node's definition as text: node->value itself, or decoded into *scratch
+// (grown as needed; free it when done) in a compressed table
+const char* hash_table_node_value(const HashTable *table, const HashNode *node, char **scratch, size_t *scratch_size) {
+    if (!table->codec) return node->value;
+    size_t need = fsst_decoded_length(table->codec, node->value) + 1;
+    if (need > *scratch_size) {
+        char *grown = wtf_realloc(*scratch, need);
+        if (!grown) return NULL;
+        *scratch = grown;
+        *scratch_size = need;
+    }
+    fsst_decode(table->codec, node->value, *scratch, *scratch_size);
+    return *scratch;
 }
 
 // Add these functions to hash_table.c
 
 DefinitionList* create_definition_list(void) {
-    DefinitionList *list = malloc(sizeof(DefinitionList));
+    DefinitionList *list = wtf_malloc(sizeof(DefinitionList));
     if (!list) return NULL;
     
     list->count = 0;
     list->capacity = 10;  // Initial capacity
     
-    list->keys = malloc(list->capacity * sizeof(char*));
-    list->definitions = malloc(list->capacity * sizeof(char*));
+    list->keys = wtf_malloc(list->capacity * sizeof(char*));
+    list->definitions = wtf_malloc(list->capacity * sizeof(char*));
     
     if (!list->keys || !list->definitions) {
-        free(list->keys);
-        free(list->definitions);
-        free(list);
+        wtf_free(list->keys);
+        wtf_free(list->definitions);
+        wtf_free(list);
         return NULL;
     }
     
@@ -119,13 +183,13 @@ void add_to_definition_list(DefinitionList *list, const char *key, const char *d
     // Check if we need to expand the arrays
     if (list->count >= list->capacity) {
         size_t new_capacity = list->capacity * 2;
-        char **new_keys = realloc(list->keys, new_capacity * sizeof(char*));
-        char **new_definitions = realloc(list->definitions, new_capacity * sizeof(char*));
+        char **new_keys = wtf_realloc(list->keys, new_capacity * sizeof(char*));
+        char **new_definitions = wtf_realloc(list->definitions, new_capacity * sizeof(char*));
         
         if (!new_keys || !new_definitions) {
             // Handle realloc failure
-            free(new_keys);
-            free(new_definitions);
+            wtf_free(new_keys);
+            wtf_free(new_definitions);
             return;
         }
         
@@ -135,13 +199,13 @@ void add_to_definition_list(DefinitionList *list, const char *key, const char *d
     }
     
     // Add the new entry
-    list->keys[list->count] = strdup(key);
-    list->definitions[list->count] = strdup(definition);
+    list->keys[list->count] = wtf_strdup(key);
+    list->definitions[list->count] = wtf_strdup(definition);
     
     if (!list->keys[list->count] || !list->definitions[list->count]) {
         // Handle strdup failure
-        free(list->keys[list->count]);
-        free(list->definitions[list->count]);
+        wtf_free(list->keys[list->count]);
+        wtf_free(list->definitions[list->count]);
         return;
     }
     
@@ -151,33 +215,36 @@ void add_to_definition_list(DefinitionList *list, const char *key, const char *d
 // Safer lowercase conversion function
 char* safe_lowercase(const char *str) {
     if (!str) return NULL;
-    
-    char *lower = strdup(str);
+
+    size_t len = strlen(str);
+    char *lower = wtf_malloc(CASEFOLD_SIZE(len));
     if (!lower) return NULL;
-    
-    for (int i = 0; lower[i]; i++) {
-        lower[i] = tolower((unsigned char)lower[i]);
-    }
+    casefold_n(str, len, lower, CASEFOLD_SIZE(len));
     return lower;
 }
 
+// Node strings stay in the pool until the table is cleared or freed: another
+// node may share them, and callers may still hold them
 int hash_table_delete_single(HashTable *table, const char *key, const char *value) {
     if (!table || !key || !value) return 0;
 
+    // Not in the pool means no node has it
+    key = intern_pool_find(&table->strings, key);
+    value = find_value(table, value);
+    if (!key || !value) return 0;
+
     unsigned int index = hash_function(key, table->size);
     HashNode *current = table->table[index];
     HashNode *prev = NULL;
 
     while (current) {
-        if (strcmp(current->key, key) == 0 && strcmp(current->value, value) == 0) {
+        if (current->key == key && current->value == value) {
             if (prev) {
                 prev->next = current->next;
             } else {
                 table->table[index] = current->next;
             }
-            free(current->key);
-            free(current->value);
-            free(current);
+            wtf_free(current);
             return 1;
         }
         prev = current;
@@ -188,6 +255,8 @@ int hash_table_delete_single(HashTable *table, const char *key, const char *valu
 
 int hash_table_delete_key(HashTable *table, const char *key) {
     if (!table || !key) return 0;
+    key = intern_pool_find(&table->strings, key);
+    if (!key) return 0;
 
     unsigned int index = hash_function(key, table->size);
     HashNode *current = table->table[index];
@@ -196,15 +265,13 @@ int hash_table_delete_key(HashTable *table, const char *key) {
 
     while (current) {
         HashNode *next = current->next;
-        if (strcmp(current->key, key) == 0) {
+        if (current->key == key) {
             if (prev) {
                 prev->next = next;
             } else {
                 table->table[index] = next;
             }
-            free(current->key);
-            free(current->value);
-            free(current);
+            wtf_free(current);
             deleted++;
         } else {
             prev = current;
@@ -214,131 +281,162 @@ int hash_table_delete_key(HashTable *table, const char *key) {
     return deleted;
 }
 
-// Updated hash_table_lookup_all function
-// Modify the hash_table_lookup_all function in after_hash_table.c
-DefinitionList* hash_table_lookup_all(HashTable *table, const char *key) {
-    if (!table || !key) return NULL;
-
-    // Dynamically allocate unique definitions and keys
-    char **unique_definitions = calloc(100, sizeof(char*));
-    char **unique_keys = calloc(100, sizeof(char*));
-    if (!unique_definitions || !unique_keys) {
-        free(unique_definitions);
-        free(unique_keys);
-        return NULL;
+void lookup_result_init(LookupResult *result) {
+    result->matches = result->inline_matches;
+    result->count = 0;
+    result->capacity = LOOKUP_INLINE_MATCHES;
+    result->owned = NULL;
+    result->owned_count = 0;
+}
+
+// Reference key:definition unless the exact pair is already listed. Returns 1 if added.
+// Pairs from one table are interned, so a repeat is usually caught by pointer.
+int lookup_result_add(LookupResult *result, const char *key, const char *definition) {
+    for (int i = 0; i < result->count; i++) {
+        const LookupMatch *m = &result->matches[i];
+        if ((m->definition == definition || strcmp(m->definition, definition) == 0) &&
+            (m->key == key || strcmp(m->key, key) == 0)) {
+            return 0;
+        }
     }
 
-    int unique_count = 0;
+    if (result->count == result->capacity) {
+        int capacity = result->capacity * 2;
+        LookupMatch *grown;
+        if (result->matches == result->inline_matches) {
+            grown = wtf_malloc(capacity * sizeof(LookupMatch));
+            if (grown) memcpy(grown, result->matches, result->count * sizeof(LookupMatch));
+        } else {
+            grown = wtf_realloc(result->matches, capacity * sizeof(LookupMatch));
+        }
+        if (!grown) return 0;
+        result->matches = grown;
+        result->capacity = capacity;
+    }
 
-    // Lowercase version of the search key
-    char *lower_search_key = safe_lowercase(key);
-    if (!lower_search_key) {
-        free(unique_definitions);
-        free(unique_keys);
-        return NULL;
+    result->matches[result->count].key = key;
+    result->matches[result->count].definition = definition;
+    result->count++;
+    return 1;
+}
+
+// Hand a buffer that matches point into over to the result. Earlier buffers
+// stay alive: a lookup can hit several block stores (base and packs).
+void lookup_result_keep(LookupResult *result, char *buffer) {
+    char **grown = wtf_realloc(result->owned, (size_t)(result->owned_count + 1) * sizeof(char *));
+    if (!grown) return;
+    result->owned = grown;
+    result->owned[result->owned_count++] = buffer;
+}
+
+void lookup_result_free(LookupResult *result) {
+    if (result->matches != result->inline_matches) {
+        wtf_free(result->matches);
     }
+    for (int i = 0; i < result->owned_count; i++) wtf_free(result->owned[i]);
+    wtf_free(result->owned);
+    lookup_result_init(result);
+}
 
-    // Two-pass approach to handle different case variations
-    for (int pass = 0; pass < 2; pass++) {
-        for (int index = 0; index < table->size; index++) {
-            for (HashNode *current = table->table[index]; current != NULL; current = current->next) {
-                // Safely convert current key to lowercase
-                char *lower_current_key = safe_lowercase(current->key);
-                if (!lower_current_key) continue;
-
-                // Determine match based on pass
-                int match = 0;
-                if (pass == 0) {
-                    match = (strcmp(current->key, key) == 0);
-                } else {
-                    match = (strcmp(lower_current_key, lower_search_key) == 0 && 
-                             strcmp(current->key, key) != 0);
-                }
-
-                if (match) {
-                    // Check for duplicates
-                    int is_duplicate = 0;
-                    for (int j = 0; j < unique_count; j++) {
-                        if (strcmp(unique_definitions[j], current->value) == 0 &&
-                            strcmp(unique_keys[j], current->key) == 0) {
-                            is_duplicate = 1;
-                            break;
-                        }
-                    }
-
-                    // If not a duplicate and we have space
-                    if (!is_duplicate && unique_count < 100) {
-                        unique_definitions[unique_count] = strdup(current->value);
-                        unique_keys[unique_count] = strdup(current->key);
-                        
-                        // Ensure successful allocation
-                        if (!unique_definitions[unique_count] || !unique_keys[unique_count]) {
-                            // Clean up in case of allocation failure
-                            for (int k = 0; k < unique_count; k++) {
-                                free(unique_definitions[k]);
-                                free(unique_keys[k]);
-                            }
-                            free(unique_definitions);
-                            free(unique_keys);
-                            free(lower_current_key);
-                            free(lower_search_key);
-                            return NULL;
-                        }
-                        
-                        unique_count++;
-                    }
-                }
-
-                free(lower_current_key);
-            }
+// Reference node's pair in out; a compressed value is decoded into a buffer the result keeps
+static void add_node(HashTable *table, const HashNode *node, LookupResult *out) {
+    if (!table->codec) {
+        lookup_result_add(out, node->key, node->value);
+        return;
+    }
+    char *decoded = NULL;
+    size_t size = 0;
+    if (!hash_table_node_value(table, node, &decoded, &size)) return;
+    if (lookup_result_add(out, node->key, decoded)) {
+        lookup_result_keep(out, decoded);
+    } else {
+        wtf_free(decoded);
+    }
+}
+
+static int lookup_view_unmeasured(HashTable *table, const char *key, LookupResult *out) {
+    if (!table || !key || !out) return 0;
+    int before = out->count;
+
+    // Every case variant shares the key's bucket: exact matches first. Those
+    // carry the pool's copy of key, so both passes tell them apart by pointer.
+    HashNode *bucket = table->table[hash_function(key, table->size)];
+    const char *exact = intern_pool_find(&table->strings, key);
+    for (HashNode *current = bucket; exact && current != NULL; current = current->next) {
+        if (current->key == exact) {
+            add_node(table, current, out);
         }
     }
+    for (HashNode *current = bucket; current != NULL; current = current->next) {
+        if (current->key != exact && casefold_equal(current->key, key)) {
+            add_node(table, current, out);
+        }
+    }
+    return out->count - before;
+}
 
-    free(lower_search_key);
+// Append references to every definition of key (exact case first, then other
+// case variants) to out. Returns the number of matches appended.
+int hash_table_lookup_view(HashTable *table, const char *key, LookupResult *out) {
+    STATS_BEGIN(started);
+    WTF_PROBE1(lookup__start, key);
+    int added = lookup_view_unmeasured(table, key, out);
+    STATS_END(STAT_LOOKUP_ALL, started);
+    WTF_PROBE2(lookup__done, key, added);
+    return added;
+}
 
-    // If no definitions found
-    if (unique_count == 0) {
-        free(unique_definitions);
-        free(unique_keys);
+// Copying form of hash_table_lookup_view() for callers that modify the table
+// while holding the results. Returns NULL when nothing matches.
+DefinitionList* hash_table_lookup_all(HashTable *table, const char *key) {
+    LookupResult view;
+    lookup_result_init(&view);
+    if (hash_table_lookup_view(table, key, &view) == 0) {
+        lookup_result_free(&view);
         return NULL;
     }
 
-    // Prepare final list
-    DefinitionList *result = malloc(sizeof(DefinitionList));
-    if (!result) {
-        // Clean up if allocation fails
-        for (int i = 0; i < unique_count; i++) {
-            free(unique_definitions[i]);
-            free(unique_keys[i]);
+    DefinitionList *result = create_definition_list();
+    if (result) {
+        for (int i = 0; i < view.count; i++) {
+            add_to_definition_list(result, view.matches[i].key, view.matches[i].definition);
         }
-        free(unique_definitions);
-        free(unique_keys);
-        return NULL;
     }
-    
-    result->definitions = unique_definitions;
-    result->keys = unique_keys;  // Ensure keys are set
-    result->count = unique_count;
-    result->capacity = 100;
-    
+    lookup_result_free(&view);
     return result;
 }
 
+// True if key (any case) has exactly this definition. Compressed values are
+// compared encoded, without decoding any.
+int hash_table_contains(HashTable *table, const char *key, const char *definition) {
+    if (!table || !key || !definition) return 0;
+    definition = find_value(table, definition);
+    if (!definition) return 0;
+
+    unsigned int index = hash_function(key, table->size);
+    for (HashNode *current = table->table[index]; current != NULL; current = current->next) {
+        if (current->value == definition && casefold_equal(current->key, key)) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
 // Updated free_definition_list to safely free memory
 void free_definition_list(DefinitionList *list) {
     if (list) {
         // Free individual definitions and keys
         for (int i = 0; i < list->count; i++) {
-            free(list->definitions[i]);
-            free(list->keys[i]);
+            wtf_free(list->definitions[i]);
+            wtf_free(list->keys[i]);
         }
         
         // Free the arrays of definitions and keys
-        free(list->definitions);
-        free(list->keys);
+        wtf_free(list->definitions);
+        wtf_free(list->keys);
         
         // Free the list structure itself
-        free(list);
+        wtf_free(list);
     }
 }
 
@@ -351,13 +449,13 @@ void free_hash_table(HashTable *table) {
         while (node) {
             HashNode *temp = node;
             node = node->next;
-            free(temp->key);
-            free(temp->value);
-            free(temp);
+            wtf_free(temp);
         }
     }
-    free(table->table);
-    free(table);
+    intern_pool_free(&table->strings);
+    wtf_free(table->codec);
+    wtf_free(table->table);
+    wtf_free(table);
 }
 
 void hash_table_clear(HashTable *table) {
@@ -369,10 +467,9 @@ void hash_table_clear(HashTable *table) {
         while (node) {
             HashNode *temp = node;
             node = node->next;
-            free(temp->key);
-            free(temp->value);
-            free(temp);
+            wtf_free(temp);
         }
         table->table[i] = NULL;  // Clear the bucket
     }
+    intern_pool_free(&table->strings);
 }
\ No newline at end of file
@@ -1,10 +1,16 @@
 #ifndef HASH_TABLE_H
 #define HASH_TABLE_H
 
-// Typedef for the hash node structure
+#include <stddef.h>
+#include "intern.h"
+#include "fsst.h"
+
+// Typedef for the hash node structure. key and value point into the table's
+// string pool, so equal strings in one table share one pointer. In a
+// compressed table (see hash_table_compress()) value is FSST-encoded.
 typedef struct HashNode {
-    char *key;
-    char *value;
+    const char *key;
+    const char *value;
     struct HashNode *next;
 } HashNode;
 
@@ -12,6 +18,8 @@ typedef struct HashNode {
 typedef struct {
     int size;
     HashNode **table;
+    InternPool strings;  // every key and value, kept until the table is cleared or freed
+    FsstTable *codec;    // non-NULL once values are stored compressed
 } HashTable;
 
 //to hold multiple definitions
@@ -23,14 +31,32 @@ typedef struct {
 } DefinitionList;
 
 
+#define LOOKUP_INLINE_MATCHES 16
 
+// One match borrowed from a table or base layer; valid until that source changes
+typedef struct {
+    const char *key;
+    const char *definition;
+} LookupMatch;
+
+// Every match for a term in display order. Only references are stored, so a
+// lookup costs no allocation per match and has no upper bound on results.
+typedef struct {
+    LookupMatch *matches;
+    int count;
+    int capacity;
+    char **owned;  // buffers matches point into (decompressed blocks), freed with the result
+    int owned_count;
+    LookupMatch inline_matches[LOOKUP_INLINE_MATCHES];
+} LookupResult;
 
 // Function prototypes
 DefinitionList* create_definition_list(void);
 unsigned int hash_function(const char *key, int size);
 HashTable* create_hash_table(int size);
 void hash_table_insert(HashTable *table, const char *key, const char *value);
-char* hash_table_lookup(HashTable *table, const char *key);
+int hash_table_compress(HashTable *table);
+const char* hash_table_node_value(const HashTable *table, const HashNode *node, char **scratch, size_t *scratch_size);
 void free_hash_table(HashTable *table);
 char* safe_lowercase(const char *str);
 int hash_table_delete_single(HashTable *table, const char *key, const char *value);
@@ -43,5 +69,13 @@ void add_to_definition_list(DefinitionList *list, const char *key, const char *d
 int hash_table_delete(HashTable *table, const char *key);
 void hash_table_clear(HashTable *table);
 
+// Borrowed-view lookups
+void lookup_result_init(LookupResult *result);
+int lookup_result_add(LookupResult *result, const char *key, const char *definition);
+void lookup_result_keep(LookupResult *result, char *buffer);
+void lookup_result_free(LookupResult *result);
+int hash_table_lookup_view(HashTable *table, const char *key, LookupResult *out);
+int hash_table_contains(HashTable *table, const char *key, const char *definition);
+
 
 #endif // HASH_TABLE_H
\ No newline at end of file
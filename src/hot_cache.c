@@ -0,0 +1,278 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "hot_cache.h"
+#include "casefold.h"
+#include "stats.h"
+
+#define HOT_CACHE_SIZE (HOT_CACHE_DATA_OFFSET + (size_t)HOT_CACHE_SLOTS * HOT_CACHE_SLOT_SIZE)
+
+static uint64_t mix(uint64_t h, uint64_t v) {
+    h ^= v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2);
+    return h;
+}
+
+static uint64_t hash_bytes(const char *data, size_t len) {
+    uint64_t h = 14695981039346656037ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)data[i];
+        h *= 1099511628211ULL;
+    }
+    return h ? h : 1;
+}
+
+// Fold a source file's identity (inode, size, mtime) into stamp; a missing
+// file counts too, so creating one changes the stamp
+uint64_t hot_cache_stamp_file(uint64_t stamp, const char *path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return mix(stamp, 0);
+    stamp = mix(stamp, (uint64_t)st.st_ino);
+    stamp = mix(stamp, (uint64_t)st.st_size);
+    stamp = mix(stamp, (uint64_t)st.st_mtim.tv_sec);
+    return mix(stamp, (uint64_t)st.st_mtim.tv_nsec);
+}
+
+// Open (creating if needed) and map the cache. Returns NULL when caching is
+// disabled with WTF_HOT_CACHE=0 or the file cannot be used.
+HotCache* hot_cache_open(const char *config_dir) {
+    const char *env = getenv("WTF_HOT_CACHE");
+    if (env && strcmp(env, "0") == 0) return NULL;
+
+    char path[4096];
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", config_dir, HOT_CACHE_FILE) >= sizeof(path)) return NULL;
+    int fd = open(path, O_RDWR | O_CREAT, 0644);
+    if (fd < 0) return NULL;
+
+    // A new or foreign file is (re)initialised under the exclusive lock
+    struct stat st;
+    flock(fd, LOCK_EX);
+    if (fstat(fd, &st) != 0) {
+        flock(fd, LOCK_UN);
+        close(fd);
+        return NULL;
+    }
+    int fresh = (size_t)st.st_size != HOT_CACHE_SIZE;
+    if (!fresh) {
+        HotCacheHeader header;
+        fresh = pread(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header) ||
+                memcmp(header.magic, HOT_CACHE_MAGIC, 4) != 0 ||
+                header.version != HOT_CACHE_VERSION ||
+                header.slot_count != HOT_CACHE_SLOTS || header.slot_size != HOT_CACHE_SLOT_SIZE;
+    }
+    if (fresh) {
+        HotCacheHeader header = {0};
+        memcpy(header.magic, HOT_CACHE_MAGIC, 4);
+        header.version = HOT_CACHE_VERSION;
+        header.generation = 1;
+        header.slot_count = HOT_CACHE_SLOTS;
+        header.slot_size = HOT_CACHE_SLOT_SIZE;
+        // Truncating to zero first clears every slot; the file stays sparse
+        if (ftruncate(fd, 0) != 0 || ftruncate(fd, (off_t)HOT_CACHE_SIZE) != 0 ||
+            pwrite(fd, &header, sizeof(header), 0) != (ssize_t)sizeof(header)) {
+            flock(fd, LOCK_UN);
+            close(fd);
+            return NULL;
+        }
+    }
+    flock(fd, LOCK_UN);
+
+    void *map = mmap(NULL, HOT_CACHE_SIZE, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (map == MAP_FAILED) {
+        close(fd);
+        return NULL;
+    }
+
+    HotCache *cache = wtf_calloc(1, sizeof(HotCache));
+    if (!cache) {
+        munmap(map, HOT_CACHE_SIZE);
+        close(fd);
+        return NULL;
+    }
+    cache->fd = fd;
+    cache->map = map;
+    cache->map_size = HOT_CACHE_SIZE;
+    cache->header = (HotCacheHeader *)map;
+    cache->slots = (HotCacheSlot *)(cache->map + HOT_CACHE_TABLE_OFFSET);
+    cache->scope = "";
+    return cache;
+}
+
+void hot_cache_close(HotCache *cache) {
+    if (!cache) return;
+    munmap(cache->map, cache->map_size);
+    close(cache->fd);
+    wtf_free(cache);
+}
+
+// "<term>\n<scope>\n<kind>" into buf, with term case-folded for a shared
+// answer ('*') and as typed otherwise ('='); 0 if it does not fit
+static size_t build_key(const HotCache *cache, const char *term, int shared, char *buf, size_t size) {
+    size_t term_len = shared ? casefold(term, buf, size) : (size_t)snprintf(buf, size, "%s", term);
+    if (term_len >= size) return 0;
+    size_t len = term_len + (size_t)snprintf(buf + term_len, size - term_len, "\n%s\n%c", cache->scope,
+                                             shared ? '*' : '=');
+    return len < size ? len : 0;
+}
+
+// True if every match is spelled the same, so the order does not depend on
+// the case of the term looked up
+static int one_spelling(const LookupResult *result) {
+    for (int n = 1; n < result->count; n++) {
+        if (strcmp(result->matches[n].key, result->matches[0].key) != 0) return 0;
+    }
+    return 1;
+}
+
+static unsigned char* slot_data(const HotCache *cache, uint32_t slot) {
+    return cache->map + HOT_CACHE_DATA_OFFSET + (size_t)slot * HOT_CACHE_SLOT_SIZE;
+}
+
+static long find_slot(const HotCache *cache, const char *key, size_t key_len, uint64_t key_hash) {
+    for (uint32_t i = 0; i < HOT_CACHE_SLOTS; i++) {
+        const HotCacheSlot *slot = &cache->slots[i];
+        if (slot->key_hash == key_hash && slot->generation == cache->header->generation &&
+            slot->stamp == cache->stamp && slot->length > key_len &&
+            memcmp(slot_data(cache, i), key, key_len + 1) == 0) {
+            return (long)i;
+        }
+    }
+    return -1;
+}
+
+// A private copy of the slot holding key, NULL when there is none
+static char *copy_slot(HotCache *cache, const char *key, size_t key_len, uint32_t *length) {
+    uint64_t key_hash = hash_bytes(key, key_len);
+    flock(cache->fd, LOCK_SH);
+    long i = find_slot(cache, key, key_len, key_hash);
+    char *copy = NULL;
+    if (i >= 0) {
+        *length = cache->slots[i].length;
+        copy = wtf_malloc(*length);
+        if (copy) memcpy(copy, slot_data(cache, (uint32_t)i), *length);
+        __atomic_store_n(&cache->slots[i].referenced, 1, __ATOMIC_RELAXED);
+    }
+    flock(cache->fd, LOCK_UN);
+    return copy;
+}
+
+// Fill out with the cached answer for term: the one every case shares, else
+// the one for term as typed. The matches point into a private copy owned by
+// out. Returns 1 on a hit.
+int hot_cache_lookup(HotCache *cache, const char *term, LookupResult *out) {
+    if (!cache || !term || !out) return 0;
+
+    char key[512];
+    char *copy = NULL;
+    size_t key_len = 0;
+    uint32_t length = 0;
+    for (int shared = 1; !copy && shared >= 0; shared--) {
+        key_len = build_key(cache, term, shared, key, sizeof(key));
+        if (key_len > 0) copy = copy_slot(cache, key, key_len, &length);
+    }
+
+    if (!copy) {
+        __atomic_fetch_add(&cache->header->misses, 1, __ATOMIC_RELAXED);
+        if (wtf_stats_enabled) stats_note_cache(0);
+        return 0;
+    }
+    __atomic_fetch_add(&cache->header->hits, 1, __ATOMIC_RELAXED);
+    if (wtf_stats_enabled) stats_note_cache(1);
+
+    size_t pos = key_len + 1;
+    uint32_t count;
+    memcpy(&count, copy + pos, sizeof(count));
+    pos += sizeof(count);
+    for (uint32_t n = 0; n < count && pos < length; n++) {
+        const char *match_key = copy + pos;
+        pos += strlen(match_key) + 1;
+        const char *definition = copy + pos;
+        pos += strlen(definition) + 1;
+        lookup_result_add(out, match_key, definition);
+    }
+    lookup_result_keep(out, copy);
+    return 1;
+}
+
+// Remember result as the answer for term. Answers larger than a slot are not cached.
+int hot_cache_store(HotCache *cache, const char *term, const LookupResult *result) {
+    if (!cache || !term || !result) return 0;
+
+    char key[512];
+    size_t key_len = build_key(cache, term, one_spelling(result), key, sizeof(key));
+    if (key_len == 0) return 0;
+
+    size_t length = key_len + 1 + sizeof(uint32_t);
+    for (int n = 0; n < result->count; n++) {
+        length += strlen(result->matches[n].key) + 1 + strlen(result->matches[n].definition) + 1;
+    }
+    if (length > HOT_CACHE_SLOT_SIZE) return 0;
+    uint64_t key_hash = hash_bytes(key, key_len);
+
+    flock(cache->fd, LOCK_EX);
+    HotCacheHeader *header = cache->header;
+    long i = find_slot(cache, key, key_len, key_hash);
+    if (i < 0) {
+        // Prefer a slot that is empty or stale, otherwise sweep the CLOCK hand
+        for (uint32_t s = 0; s < HOT_CACHE_SLOTS && i < 0; s++) {
+            if (cache->slots[s].generation != header->generation) i = (long)s;
+        }
+        while (i < 0) {
+            uint32_t hand = header->clock_hand % HOT_CACHE_SLOTS;
+            header->clock_hand = (hand + 1) % HOT_CACHE_SLOTS;
+            if (cache->slots[hand].referenced) {
+                cache->slots[hand].referenced = 0;
+            } else {
+                i = (long)hand;
+            }
+        }
+    }
+
+    HotCacheSlot *slot = &cache->slots[i];
+    slot->generation = 0;  // readers skip the slot while its data changes
+    unsigned char *data = slot_data(cache, (uint32_t)i);
+    size_t pos = key_len + 1;
+    memcpy(data, key, pos);
+    uint32_t count = (uint32_t)result->count;
+    memcpy(data + pos, &count, sizeof(count));
+    pos += sizeof(count);
+    for (int n = 0; n < result->count; n++) {
+        size_t k = strlen(result->matches[n].key) + 1;
+        size_t d = strlen(result->matches[n].definition) + 1;
+        memcpy(data + pos, result->matches[n].key, k);
+        memcpy(data + pos + k, result->matches[n].definition, d);
+        pos += k + d;
+    }
+    slot->key_hash = key_hash;
+    slot->stamp = cache->stamp;
+    slot->length = (uint32_t)length;
+    slot->referenced = 1;
+    slot->generation = header->generation;
+    flock(cache->fd, LOCK_UN);
+    return 1;
+}
+
+// Invalidate every cached answer; called after anything that changes definitions
+void hot_cache_bump(const char *config_dir) {
+    char path[4096];
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", config_dir, HOT_CACHE_FILE) >= sizeof(path)) return;
+    int fd = open(path, O_RDWR);
+    if (fd < 0) return;  // nothing cached yet
+
+    flock(fd, LOCK_EX);
+    HotCacheHeader header;
+    if (pread(fd, &header, sizeof(header), 0) == (ssize_t)sizeof(header) &&
+        memcmp(header.magic, HOT_CACHE_MAGIC, 4) == 0) {
+        header.generation++;
+        if (pwrite(fd, &header.generation, sizeof(header.generation),
+                   (off_t)offsetof(HotCacheHeader, generation)) != (ssize_t)sizeof(header.generation)) {
+            fprintf(stderr, "Warning: Could not invalidate %s\n", path);
+        }
+    }
+    flock(fd, LOCK_UN);
+    close(fd);
+}
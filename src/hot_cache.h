@@ -0,0 +1,66 @@
+#ifndef HOT_CACHE_H
+#define HOT_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "hash_table.h"
+
+// ~/.wtf/hot.cache: a fixed-size, memory-mapped cache of recent `wtf is`
+// answers (already filtered by removed.txt) so a repeat lookup never loads the
+// dictionary. An entry is used only while both the cache generation (bumped by
+// sync, add, remove and recover) and the stamp of the source files it was built
+// from still match. Slots are reused in CLOCK order.
+//
+// Matches are listed exact case first, per source, so only an answer whose
+// matches all share one spelling reads the same whichever case was typed.
+// Such an answer is keyed on the folded term ("*"), any other on the term as
+// typed ("=").
+//
+// Layout: header | slot table (HOT_CACHE_SLOTS × HotCacheSlot) | slot data
+// Slot data: key ("<term>\n<packs>\n<* or =>") \0 | u32 count | count × (key \0 definition \0)
+#define HOT_CACHE_FILE "hot.cache"
+#define HOT_CACHE_MAGIC "WTFC"
+#define HOT_CACHE_VERSION 3   // 3: folded keys only for answers with one spelling
+#define HOT_CACHE_SLOTS 128
+#define HOT_CACHE_SLOT_SIZE 4096
+#define HOT_CACHE_TABLE_OFFSET 64
+#define HOT_CACHE_DATA_OFFSET 8192
+
+typedef struct {
+    char magic[4];
+    uint32_t version;
+    uint64_t generation;
+    uint64_t hits;
+    uint64_t misses;
+    uint32_t slot_count;
+    uint32_t slot_size;
+    uint32_t clock_hand;
+    uint32_t reserved;
+} HotCacheHeader;
+
+typedef struct {
+    uint64_t key_hash;
+    uint64_t generation;   // 0 for an empty slot
+    uint64_t stamp;
+    uint32_t length;       // bytes of slot data in use
+    uint32_t referenced;   // CLOCK bit, set on every hit
+} HotCacheSlot;
+
+typedef struct {
+    int fd;
+    unsigned char *map;
+    size_t map_size;
+    HotCacheHeader *header;
+    HotCacheSlot *slots;
+    const char *scope;     // selected packs, part of every key
+    uint64_t stamp;        // of the files the answers come from, see hot_cache_stamp_file()
+} HotCache;
+
+HotCache* hot_cache_open(const char *config_dir);
+void hot_cache_close(HotCache *cache);
+uint64_t hot_cache_stamp_file(uint64_t stamp, const char *path);
+int hot_cache_lookup(HotCache *cache, const char *term, LookupResult *out);
+int hot_cache_store(HotCache *cache, const char *term, const LookupResult *result);
+void hot_cache_bump(const char *config_dir);
+
+#endif
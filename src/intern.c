@@ -0,0 +1,116 @@
+#include <string.h>
+#include "intern.h"
+#include "stats.h"
+
+#define INTERN_MIN_SLOTS 256
+
+// FNV-1a over the exact bytes, finished so the low bits pick the slot well.
+// Sets *len to the string's length on the way.
+static uint64_t intern_hash(const char *str, size_t *len) {
+    uint64_t h = 14695981039346656037ULL;
+    const unsigned char *p = (const unsigned char *)str;
+    for (; *p; p++) {
+        h ^= *p;
+        h *= 1099511628211ULL;
+    }
+    *len = (size_t)(p - (const unsigned char *)str);
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return h;
+}
+
+void intern_pool_init(InternPool *pool) {
+    memset(pool, 0, sizeof(*pool));
+}
+
+static size_t find_slot(const InternPool *pool, uint64_t hash, const char *str, size_t len) {
+    size_t mask = pool->capacity - 1;
+    size_t i = (size_t)hash & mask;
+    while (pool->slots[i].str) {
+        if (pool->slots[i].hash == hash && memcmp(pool->slots[i].str, str, len + 1) == 0) break;
+        i = (i + 1) & mask;
+    }
+    return i;
+}
+
+static int grow_slots(InternPool *pool) {
+    size_t capacity = pool->capacity ? pool->capacity * 2 : INTERN_MIN_SLOTS;
+    InternSlot *slots = wtf_calloc(capacity, sizeof(InternSlot));
+    if (!slots) return 0;
+    for (size_t i = 0; i < pool->capacity; i++) {
+        if (!pool->slots[i].str) continue;
+        size_t j = (size_t)pool->slots[i].hash & (capacity - 1);
+        while (slots[j].str) j = (j + 1) & (capacity - 1);
+        slots[j] = pool->slots[i];
+    }
+    wtf_free(pool->slots);
+    pool->slots = slots;
+    pool->capacity = capacity;
+    return 1;
+}
+
+// Room for bytes more in the arena. Strings longer than a chunk get one of
+// their own, behind the current chunk so its free space is not abandoned.
+static char *arena_alloc(InternPool *pool, size_t bytes) {
+    InternChunk *chunk = pool->chunks;
+    if (chunk && chunk->size - chunk->used >= bytes) {
+        char *p = chunk->data + chunk->used;
+        chunk->used += bytes;
+        return p;
+    }
+
+    size_t size = bytes > INTERN_CHUNK_BYTES ? bytes : INTERN_CHUNK_BYTES;
+    InternChunk *fresh = wtf_malloc(sizeof(InternChunk) + size);
+    if (!fresh) return NULL;
+    fresh->size = size;
+    fresh->used = bytes;
+    if (chunk && size == bytes) {
+        fresh->next = chunk->next;
+        chunk->next = fresh;
+    } else {
+        fresh->next = chunk;
+        pool->chunks = fresh;
+    }
+    return fresh->data;
+}
+
+// The pool's copy of str, made on first sight. NULL when out of memory.
+const char *intern_pool_add(InternPool *pool, const char *str) {
+    if (!str) return NULL;
+    if (pool->unique * 2 >= pool->capacity && !grow_slots(pool)) return NULL;
+
+    size_t len;
+    uint64_t hash = intern_hash(str, &len);
+    size_t i = find_slot(pool, hash, str, len);
+    if (!pool->slots[i].str) {
+        char *copy = arena_alloc(pool, len + 1);
+        if (!copy) return NULL;
+        memcpy(copy, str, len + 1);
+        pool->slots[i].hash = hash;
+        pool->slots[i].str = copy;
+        pool->unique++;
+        pool->bytes_stored += len + 1;
+    }
+    pool->interned++;
+    pool->bytes_in += len + 1;
+    return pool->slots[i].str;
+}
+
+// The pool's copy of str, or NULL when it holds no such string
+const char *intern_pool_find(const InternPool *pool, const char *str) {
+    if (!str || pool->capacity == 0) return NULL;
+    size_t len;
+    uint64_t hash = intern_hash(str, &len);
+    return pool->slots[find_slot(pool, hash, str, len)].str;
+}
+
+void intern_pool_free(InternPool *pool) {
+    while (pool->chunks) {
+        InternChunk *next = pool->chunks->next;
+        wtf_free(pool->chunks);
+        pool->chunks = next;
+    }
+    wtf_free(pool->slots);
+    intern_pool_init(pool);
+}
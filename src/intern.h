@@ -0,0 +1,39 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Each distinct string stored once. The copies live in arena chunks owned by
+// the pool and stay valid until intern_pool_free(), so two strings interned
+// in the same pool are equal exactly when their pointers are.
+#define INTERN_CHUNK_BYTES 65536
+
+typedef struct InternChunk {
+    struct InternChunk *next;
+    size_t used;
+    size_t size;
+    char data[];
+} InternChunk;
+
+typedef struct {
+    uint64_t hash;
+    const char *str;   // NULL when the slot is free
+} InternSlot;
+
+typedef struct {
+    InternSlot *slots;     // open addressing, capacity is a power of two
+    size_t capacity;
+    size_t unique;         // distinct strings stored
+    InternChunk *chunks;
+    size_t interned;       // intern_pool_add() calls that succeeded
+    size_t bytes_in;       // what separate copies of each of those would hold
+    size_t bytes_stored;   // what the pool holds, terminators included
+} InternPool;
+
+void intern_pool_init(InternPool *pool);
+const char *intern_pool_add(InternPool *pool, const char *str);
+const char *intern_pool_find(const InternPool *pool, const char *str);
+void intern_pool_free(InternPool *pool);
+
+#endif
@@ -0,0 +1,208 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <pthread.h>
+#include "wtf.h"
+#include "dictionary.h"
+#include "file_utils.h"
+#include "stats.h"
+
+struct WtfHandle {
+    pthread_rwlock_t lock;   // shared by lookups, exclusive for add/remove/recover
+    int lock_ready;
+    HashTable *entries;
+    HashTable *removed;
+    BlockStore *store;
+    Dictionary dict;
+    char added_path[PATH_MAX];
+    char removed_path[PATH_MAX];
+};
+
+// Copies of a lookup's matches: strings[2i] is the term, strings[2i + 1] its
+// definition, all in the same allocation as the struct
+struct WtfResults {
+    int count;
+    const char **strings;
+};
+
+int wtf_api_version(void) {
+    return WTF_API_VERSION;
+}
+
+void wtf_close(WtfHandle *handle) {
+    if (!handle) return;
+    dictionary_free(&handle->dict);
+    block_store_close(handle->store);
+    if (handle->entries) free_hash_table(handle->entries);
+    if (handle->removed) free_hash_table(handle->removed);
+    if (handle->lock_ready) pthread_rwlock_destroy(&handle->lock);
+    wtf_free(handle);
+}
+
+WtfHandle *wtf_open(const char *config_dir) {
+    char default_dir[PATH_MAX];
+    if (!config_dir) {
+        const char *home = getenv("WTF_HOME");
+        if (!home || !*home) home = getenv("HOME");
+        if (!home || (size_t)snprintf(default_dir, sizeof(default_dir), "%s/.wtf", home) >= sizeof(default_dir)) {
+            return NULL;
+        }
+        config_dir = default_dir;
+    }
+
+    // The same base `wtf` reads: the user's own, else the shared one
+    const char *state_dir = get_state_directory();
+    const char *base_dir = !has_base_dictionary(config_dir) && has_base_dictionary(state_dir) ? state_dir : config_dir;
+    char definitions_path[PATH_MAX], store_path[PATH_MAX];
+    base_text_path(base_dir, definitions_path, sizeof(definitions_path));
+    if ((size_t)snprintf(store_path, sizeof(store_path), "%s/res/%s", base_dir, BLOCK_STORE_FILE) >= sizeof(store_path)) {
+        return NULL;
+    }
+
+    WtfHandle *handle = wtf_calloc(1, sizeof(WtfHandle));
+    if (!handle) return NULL;
+    if ((size_t)snprintf(handle->added_path, sizeof(handle->added_path), "%s/res/added.txt", config_dir) >= sizeof(handle->added_path) ||
+        (size_t)snprintf(handle->removed_path, sizeof(handle->removed_path), "%s/res/removed.txt", config_dir) >= sizeof(handle->removed_path) ||
+        pthread_rwlock_init(&handle->lock, NULL) != 0) {
+        wtf_close(handle);
+        return NULL;
+    }
+    handle->lock_ready = 1;
+
+    handle->entries = create_hash_table(100);
+    handle->removed = create_hash_table(100);
+    if (!handle->entries || !handle->removed) {
+        wtf_close(handle);
+        return NULL;
+    }
+    dictionary_init(&handle->dict, handle->entries, handle->removed);
+
+    // The store's index is read up front rather than by the first lookup,
+    // so lookups never change the handle and can share it
+    if (!handle->dict.embedded_base) {
+        handle->store = block_store_open(store_path);
+        handle->dict.store = handle->store;
+        if (!handle->store && !dictionary_load(&handle->dict, definitions_path)) {
+            wtf_close(handle);
+            return NULL;
+        }
+    }
+    dictionary_load(&handle->dict, handle->added_path);
+    // The handle lives long and prints little: keep definitions compressed
+    // (left plain if that fails)
+    hash_table_compress(handle->entries);
+    dictionary_build_filter(&handle->dict);
+    load_definitions(handle->removed_path, handle->removed);
+    return handle;
+}
+
+static WtfResults *copy_results(const LookupResult *view) {
+    size_t bytes = 0;
+    for (int i = 0; i < view->count; i++) {
+        bytes += strlen(view->matches[i].key) + strlen(view->matches[i].definition) + 2;
+    }
+    size_t pointers = (size_t)view->count * 2 * sizeof(const char *);
+    WtfResults *results = wtf_malloc(sizeof(WtfResults) + pointers + bytes);
+    if (!results) return NULL;
+
+    results->count = view->count;
+    results->strings = (const char **)(results + 1);
+    char *p = (char *)results->strings + pointers;
+    for (int i = 0; i < view->count; i++) {
+        const char *fields[2] = {view->matches[i].key, view->matches[i].definition};
+        for (int f = 0; f < 2; f++) {
+            size_t len = strlen(fields[f]) + 1;
+            memcpy(p, fields[f], len);
+            results->strings[2 * i + f] = p;
+            p += len;
+        }
+    }
+    return results;
+}
+
+int wtf_lookup(WtfHandle *handle, const char *term, WtfResults **results) {
+    if (!results) return -1;
+    *results = NULL;
+    if (!handle || !term) return -1;
+
+    LookupResult view;
+    lookup_result_init(&view);
+    pthread_rwlock_rdlock(&handle->lock);
+    dictionary_lookup_view(&handle->dict, term, &view);
+    dictionary_filter_removed(&handle->dict, &view);
+    WtfResults *copy = copy_results(&view);
+    pthread_rwlock_unlock(&handle->lock);
+    lookup_result_free(&view);
+    if (!copy) return -1;
+
+    *results = copy;
+    return copy->count;
+}
+
+int wtf_results_count(const WtfResults *results) {
+    return results ? results->count : 0;
+}
+
+const char *wtf_results_term(const WtfResults *results, int i) {
+    return results && i >= 0 && i < results->count ? results->strings[2 * i] : NULL;
+}
+
+const char *wtf_results_definition(const WtfResults *results, int i) {
+    return results && i >= 0 && i < results->count ? results->strings[2 * i + 1] : NULL;
+}
+
+void wtf_results_free(WtfResults *results) {
+    wtf_free(results);
+}
+
+// A pair `wtf add` could have written: one line that load_definitions() reads back whole
+static int valid_record(const char *term, const char *definition) {
+    if (!term || !definition || !*term || !*definition) return 0;
+    if (strpbrk(term, ":\n") || strchr(definition, '\n')) return 0;
+    return strlen(term) + strlen(definition) + 2 < 256;
+}
+
+int wtf_add(WtfHandle *handle, const char *term, const char *definition) {
+    if (!handle || !valid_record(term, definition)) return -1;
+    pthread_rwlock_wrlock(&handle->lock);
+    int added = dictionary_add_definition(&handle->dict, handle->added_path, term, definition);
+    pthread_rwlock_unlock(&handle->lock);
+    return added;
+}
+
+int wtf_remove(WtfHandle *handle, const char *term, const char *definition) {
+    if (!handle || !term || !definition) return -1;
+    pthread_rwlock_wrlock(&handle->lock);
+    LookupResult view;
+    lookup_result_init(&view);
+    dictionary_lookup_view(&handle->dict, term, &view);
+    dictionary_filter_removed(&handle->dict, &view);
+    int removed = 0;
+    for (int i = 0; i < view.count; i++) {
+        if (strcmp(view.matches[i].definition, definition) == 0) {
+            removed = dictionary_remove_definitions(&handle->dict, handle->removed_path, &view.matches[i], 1);
+            break;
+        }
+    }
+    lookup_result_free(&view);
+    pthread_rwlock_unlock(&handle->lock);
+    return removed;
+}
+
+int wtf_recover(WtfHandle *handle, const char *term, const char *definition) {
+    if (!handle || !term || !definition) return -1;
+    pthread_rwlock_wrlock(&handle->lock);
+    int recovered = 0;
+    DefinitionList *removed = hash_table_lookup_all(handle->removed, term);
+    for (int i = 0; removed && i < removed->count; i++) {
+        if (strcmp(removed->definitions[i], definition) == 0) {
+            LookupMatch match = {removed->keys[i], removed->definitions[i]};
+            recovered = dictionary_recover_definitions(&handle->dict, handle->removed_path, &match, 1) > 0 ? 1 : -1;
+            break;
+        }
+    }
+    if (removed) free_definition_list(removed);
+    pthread_rwlock_unlock(&handle->lock);
+    return recovered;
+}
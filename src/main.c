@@ -7,11 +7,17 @@
 #include "network_sync.h"
 #include "version.h"
 #include "commands.h"
+#include "stats.h"
+#include "dictionary.h"
+#include "embedded_dict.h"
+#include "hot_cache.h"
+#include "sync_lock.h"
 #include <limits.h>
 #include <unistd.h>
 #include <libgen.h>
 #include <pwd.h>
 #include <sys/types.h>
+#include <sys/stat.h>
 
 #define MAX_INPUT_LENGTH 256
 
@@ -41,6 +47,18 @@ void print_help() {
     printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s├─%s wtf is <term>\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s│  └─ Get the definition of a term%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─%s wtf is <term> --limit <n> --offset <n>\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s│  └─ Show only part of a long list of definitions%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─%s wtf is <term> --pack <name>[,<name>...]\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s│  └─ Search only these packs (default: $WTF_PACKS, or every pack)%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─%s wtf is --sounds-like <word>\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s│  └─ List terms that sound like a word heard but not seen%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─%s wtf find <text> | wtf find '<glob>'\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s│  └─ List terms containing text, or matching a pattern with * and ?%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─%s wtf packs\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s│  └─ List installed dictionary packs%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─%s wtf cache [clear]\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s│  └─ Show answer cache hits and misses, or empty it%s\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s├─%s wtf add <term>:<definition>\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s│  └─ Add a new term and definition to the dictionary%s\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s├─%s wtf remove <term>\n", COLOR_PRIMARY, COLOR_RESET);
@@ -51,6 +69,10 @@ void print_help() {
     printf("%s│  └─ Sync dictionary with latest updates%s\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s├─%s wtf sync --force\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s│  └─ Force sync dictionary with latest updates%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─%s sudo wtf sync --system [--force]\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s│  └─ Sync the base dictionary shared by every user%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─%s wtf <command> --stats\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s│  └─ Print per-phase timings and allocations to stderr%s\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s├─%s sudo wtf uninstall | --uninstall\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s│  └─ Uninstall WTF from your system%s\n", COLOR_PRIMARY, COLOR_RESET);
     printf("%s╰─%s wtf -h | --help\n", COLOR_PRIMARY, COLOR_RESET);
@@ -93,6 +115,12 @@ int getString(char *buffer, size_t bufferSize) {
 }
 
 char *get_real_home_directory() {
+    // WTF_HOME points wtf at another home (benchmarks, throwaway stores)
+    char *override = getenv("WTF_HOME");
+    if (override && *override) {
+        return override;
+    }
+
     // Get the SUDO_USER environment variable
     const char *sudo_user = getenv("SUDO_USER");
     struct passwd *pw;
@@ -113,28 +141,133 @@ char *get_real_home_directory() {
     return getenv("HOME");
 }
 
+// The update check after `is` and `add`. Only the process holding the sync
+// lock runs it; the rest skip straight away instead of downloading the same
+// dictionary. Returns 1 if a check ran.
+static int check_for_updates_once(const char *base_dir, HashTable *dictionary) {
+    SyncLock lock;
+    if (!sync_lock_acquire(&lock, base_dir, 0)) return 0;
+    // A sync may have finished between reading sync.meta and taking the lock
+    SyncMetadata metadata;
+    load_sync_metadata(base_dir, &metadata);
+    int due = (time(NULL) - metadata.last_sync) >= SYNC_INTERVAL && time(NULL) >= metadata.next_check;
+    if (due) {
+        printf("%s► Checking for updates...%s\n\n", COLOR_DIM, COLOR_RESET);
+        STATS_BEGIN(sync_started);
+        check_and_sync(base_dir, dictionary, false);
+        STATS_END(STAT_SYNC_CHECK, sync_started);
+    }
+    sync_lock_release(&lock);
+    return due;
+}
+
+// Shown instead of the update check to users who cannot write the shared
+// base, when the daily `wtf sync --system` job has not kept it current
+static void print_shared_base_stale(const char *base_dir) {
+    printf("%s► The shared dictionary in %s is over %d days old; run `sudo wtf sync --system` to update it%s\n\n",
+           COLOR_DIM, base_dir, SYNC_INTERVAL / 86400, COLOR_RESET);
+}
+
+// Identity of every file a `wtf is` answer is built from, so a cached answer
+// is never served after one of them changes behind the cache's back
+static uint64_t answer_stamp(const Dictionary *dict, const PackSet *packs, const char *store_path,
+                             const char *definitions_path, const char *added_path, const char *removed_path) {
+    uint64_t stamp = dict->embedded_base ? (uint64_t)embedded_dict_size() : 0;
+    stamp = hot_cache_stamp_file(stamp, store_path);
+    stamp = hot_cache_stamp_file(stamp, definitions_path);
+    stamp = hot_cache_stamp_file(stamp, added_path);
+    stamp = hot_cache_stamp_file(stamp, removed_path);
+
+    char path[PATH_MAX];
+    for (int i = 0; i < packs->count; i++) {
+        snprintf(path, sizeof(path), "%s/%s", packs->packs[i].dir, BLOCK_STORE_FILE);
+        stamp = hot_cache_stamp_file(stamp, path);
+        snprintf(path, sizeof(path), "%s/definitions.txt", packs->packs[i].dir);
+        stamp = hot_cache_stamp_file(stamp, path);
+    }
+    return stamp;
+}
+
 int main(int argc, char *argv[]) {
     
     int exit_code = 0; 
     
+    // `--stats`, `--sounds-like`, `--limit N`, `--offset N` and `--pack a,b` may
+    // appear anywhere; strip them so commands never see them
+    int show_stats = 0;
+    int sounds_like = 0;
+    LookupPage page = {0, 0};
+    const char *pack_selection = getenv("WTF_PACKS");
+    int kept = 1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stats") == 0) {
+            show_stats = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--sounds-like") == 0) {
+            sounds_like = 1;
+            continue;
+        }
+        if (strcmp(argv[i], "--pack") == 0) {
+            if (i + 1 >= argc) {
+                printf("%s│%s\n", COLOR_RED, COLOR_RESET);
+                printf("%s╰─ Error%s: --pack expects a comma-separated list of pack names\n\n", COLOR_RED, COLOR_RESET);
+                return 1;
+            }
+            pack_selection = argv[++i];
+            continue;
+        }
+        if (strcmp(argv[i], "--limit") == 0 || strcmp(argv[i], "--offset") == 0) {
+            char *end = NULL;
+            long value = i + 1 < argc ? strtol(argv[i + 1], &end, 10) : -1;
+            if (!end || *end != '\0' || value < 0 || value > INT_MAX) {
+                printf("%s│%s\n", COLOR_RED, COLOR_RESET);
+                printf("%s╰─ Error%s: %s expects a non-negative number\n\n", COLOR_RED, COLOR_RESET, argv[i]);
+                return 1;
+            }
+            if (argv[i][2] == 'l') {
+                page.limit = (int)value;
+            } else {
+                page.offset = (int)value;
+            }
+            i++;
+            continue;
+        }
+        argv[kept++] = argv[i];
+    }
+    argc = kept;
+    stats_init(show_stats, getenv("WTF_TRACE"));
+    
     // Get home directory first
+    STATS_BEGIN(home_started);
     char *home_dir = get_real_home_directory();
+    STATS_END(STAT_HOME_DIR, home_started);
     if (home_dir == NULL) {
         fprintf(stderr, "%s│%s\n", COLOR_RED, COLOR_RESET);
         fprintf(stderr, "%s╰─ Error%s: Could not determine user's home directory\n\n", 
                 COLOR_RED, COLOR_RESET);
+        stats_finish(argc > 1 ? argv[1] : "", 1);
         return 1;  // Return directly since we haven't allocated anything yet
     }
 
     
     char config_dir[PATH_MAX];
     char definitions_path[PATH_MAX];
+    char store_path[PATH_MAX];
+    char packs_path[PATH_MAX];
     char added_path[PATH_MAX];
     char removed_path[PATH_MAX];
     
     // Initialize pointers to NULL at declaration
     HashTable *dictionary = NULL;
     HashTable *removed_dict = NULL;
+    BlockStore *store = NULL;
+    Dictionary dict = {0};
+    static PackSet packs;
+    static char pack_scope[PACK_MAX * PACK_NAME_MAX];
+    HotCache *cache = NULL;
+    StreamLookup stream;
+    stream_lookup_init(&stream, NULL);
     
     // Fix sign comparison warnings by storing snprintf result in size_t
     size_t written;
@@ -145,13 +278,45 @@ int main(int argc, char *argv[]) {
         return 1;
     }
     
-    written = (size_t)snprintf(definitions_path, sizeof(definitions_path), 
-                                "%s/res/definitions.txt", config_dir);
-    if (written >= sizeof(definitions_path)) {
+    // The base dictionary comes from ~/.wtf/res when the user keeps one there.
+    // Otherwise it comes from the shared state directory, which one privileged
+    // `wtf sync` keeps current for everyone; until that first sync, the
+    // packaged text stands in. added.txt, removed.txt, packs and the answer
+    // cache always stay in ~/.wtf.
+    bool sync_system = false;
+    bool is_force_sync = false;
+    if (argc > 1 && strcmp(argv[1], "sync") == 0) {
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--system") == 0) sync_system = true;
+            if (strcmp(argv[i], "--force") == 0) is_force_sync = true;
+        }
+    }
+    const char *state_dir = get_state_directory();
+    bool shared_base = sync_system || (!has_base_dictionary(config_dir) && has_base_dictionary(state_dir));
+    const char *base_dir = shared_base ? state_dir : config_dir;
+    // Users who cannot write the shared base leave its updates to root
+    bool base_writable = !shared_base || geteuid() == 0 || access(base_dir, W_OK) == 0;
+
+    base_text_path(base_dir, definitions_path, sizeof(definitions_path));
+    if (strlen(definitions_path) + 1 >= sizeof(definitions_path)) {
         fprintf(stderr, "Error: Path too long for definitions file.\n");
         return 1;
     }
     
+    written = (size_t)snprintf(store_path, sizeof(store_path), 
+                                "%s/res/%s", base_dir, BLOCK_STORE_FILE);
+    if (written >= sizeof(store_path)) {
+        fprintf(stderr, "Error: Path too long for definitions store.\n");
+        return 1;
+    }
+    
+    written = (size_t)snprintf(packs_path, sizeof(packs_path), 
+                                "%s/res/%s", config_dir, PACKS_DIR);
+    if (written >= sizeof(packs_path)) {
+        fprintf(stderr, "Error: Path too long for packs directory.\n");
+        return 1;
+    }
+    
     written = (size_t)snprintf(added_path, sizeof(added_path), 
                                 "%s/res/added.txt", config_dir);
     if (written >= sizeof(added_path)) {
@@ -169,9 +334,12 @@ int main(int argc, char *argv[]) {
     // Check for update only once at startup and only if:
     // 1. It's been more than interval since last check
     // 2. This is the first command of the day
+    // 3. No rate limit or backoff after a failed check holds it back
     time_t current_time = time(NULL);
     SyncMetadata metadata;
-    load_sync_metadata(config_dir, &metadata);
+    load_sync_metadata(base_dir, &metadata);
+    bool base_stale = (current_time - metadata.last_sync) >= SYNC_INTERVAL;
+    bool update_due = base_writable && base_stale && current_time >= metadata.next_check;
       
     
     if (argc < 2) {
@@ -211,22 +379,86 @@ int main(int argc, char *argv[]) {
         goto cleanup;
     }
     
-    bool is_force_sync = (argc > 2 && strcmp(argv[1], "sync") == 0 && strcmp(argv[2], "--force") == 0);
+    dictionary_init(&dict, dictionary, removed_dict);
+
+    // Packs are only selected here; each is opened by the first lookup that reaches it
+    char bad_pack[PACK_NAME_MAX + 16];
+    if (!pack_set_open(&packs, packs_path, pack_selection, bad_pack, sizeof(bad_pack))) {
+        printf("%s│%s\n", COLOR_RED, COLOR_RESET);
+        printf("%s╰─ Error%s: No pack named '%s%s%s'. Use `%swtf packs%s` to list installed packs\n\n",
+               COLOR_RED, COLOR_RESET, COLOR_YELLOW, bad_pack, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
+        exit_code = 1;
+        goto cleanup;
+    }
+    dict.packs = &packs;
+
+    // A repeat `wtf is` is answered from the hot cache before anything is loaded,
+    // unless an update check is due
+    char lookup_term[256] = "";
+    if (strcmp(argv[1], "is") == 0 && argc >= 3) join_term_args(argv, argc, lookup_term, sizeof(lookup_term));
+    if (strcmp(argv[1], "is") == 0 && argc >= 3 && !sounds_like) {
+        STATS_BEGIN(cache_started);
+        cache = hot_cache_open(config_dir);
+        int hit = 0;
+        LookupResult cached;
+        lookup_result_init(&cached);
+        if (cache) {
+            pack_set_describe(&packs, pack_scope, sizeof(pack_scope));
+            cache->scope = pack_scope;
+            cache->stamp = answer_stamp(&dict, &packs, store_path, definitions_path, added_path, removed_path);
+            hit = (dict.embedded_base || !update_due) &&
+                  hot_cache_lookup(cache, lookup_term, &cached);
+        }
+        STATS_END(STAT_HOT_CACHE, cache_started);
+        if (hit) {
+            render_is_result(lookup_term, &cached, &page, NULL);
+            lookup_result_free(&cached);
+            goto cleanup;
+        }
+    }
     
-    // Only try to load definitions if we're not doing a force sync
-    if (!is_force_sync) {
-        if (!load_definitions(definitions_path, dictionary)) {
+    // A one-shot `wtf is` with no block store scans the text files once for
+    // its term instead of loading them into tables (WTF_STREAM=0 turns this off)
+    const char *stream_env = getenv("WTF_STREAM");
+    bool streaming = strcmp(argv[1], "is") == 0 && argc >= 3 && !sounds_like && !dict.embedded_base &&
+                     !(stream_env && strcmp(stream_env, "0") == 0) &&
+                     access(store_path, F_OK) != 0 && access(definitions_path, R_OK) == 0;
+    if (streaming) {
+        stream_lookup_init(&stream, removed_path);
+        stream_lookup_add_file(&stream, definitions_path);
+        stream_lookup_add_file(&stream, added_path);
+        dict.stream = &stream;
+    }
+
+    // Only try to load definitions if we're not doing a force sync, and only when
+    // they were not compiled into the binary
+    if (!streaming && !is_force_sync && !dict.embedded_base) {
+        // Prefer the block store written by sync; only its header is read up front,
+        // the index waits for a lookup its filter lets through
+        STATS_BEGIN(main_started);
+        store = block_store_open_lazy(store_path);
+        dict.store = store;
+        int loaded = store != NULL || dictionary_load(&dict, definitions_path);
+        STATS_END(STAT_LOAD_MAIN, main_started);
+        if (!loaded) {
             fprintf(stderr,"%s│%s\n",COLOR_RED, COLOR_RESET);
             fprintf(stderr, "%s╰─ Error%s: Could not load main definitions. try running `%swtf sync --force%s`\n\n", COLOR_RED, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
             goto cleanup;
         }
     }
     
-    // Load user-added definitions
-    load_definitions(added_path, dictionary);   
-    
-    // Load removed definitions
-    load_definitions(removed_path, removed_dict);
+    if (!streaming) {
+        // Load user-added definitions
+        STATS_BEGIN(added_started);
+        dictionary_load(&dict, added_path);
+        STATS_END(STAT_LOAD_ADDED, added_started);
+        dictionary_build_filter(&dict);
+        
+        // Load removed definitions
+        STATS_BEGIN(removed_started);
+        load_definitions(removed_path, removed_dict);
+        STATS_END(STAT_LOAD_REMOVED, removed_started);
+    }
 
     // Handle commands
     if (strcmp(argv[1], "is") == 0) {
@@ -235,13 +467,18 @@ int main(int argc, char *argv[]) {
             printf("%s╰─ Error%s: No term provided. Use `%swtf is <term>%s`\n\n", COLOR_RED, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
             goto cleanup;
         }
-        handle_is_command(dictionary, removed_dict, argv, argc);
+        if (sounds_like) {
+            handle_sounds_like_command(&dict, lookup_term, &page);
+        } else {
+            handle_is_command(&dict, lookup_term, &page, cache);
+        }
         
         // Show definition immediately without checking for updates
         // After showing the definition, check for updates in background
-        if ((current_time - metadata.last_sync) >= SYNC_INTERVAL) {
-            printf("%s► Checking for updates...%s\n\n", COLOR_DIM, COLOR_RESET);
-            check_and_sync(config_dir, dictionary, false);
+        if (!dict.embedded_base && update_due && check_for_updates_once(base_dir, dictionary)) {
+            hot_cache_bump(config_dir);
+        } else if (!dict.embedded_base && base_stale && !base_writable) {
+            print_shared_base_stale(base_dir);
         }
             
     } else if (strcmp(argv[1], "remove") == 0) {
@@ -250,7 +487,8 @@ int main(int argc, char *argv[]) {
             printf("%s╰─ Error%s: No term provided. Use `%swtf remove <term>%s`\n\n", COLOR_RED, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
             goto cleanup;
         }
-        handle_remove_command(dictionary, removed_dict, removed_path, argv, argc);
+        handle_remove_command(&dict, removed_path, argv, argc);
+        hot_cache_bump(config_dir);
     }
     else if (strcmp(argv[1], "add") == 0) {
         if (argc < 3) {
@@ -274,48 +512,127 @@ int main(int argc, char *argv[]) {
             goto cleanup;
         }
         
-        handle_add_command(dictionary, added_path, term, definition);
+        handle_add_command(&dict, added_path, term, definition);
+        hot_cache_bump(config_dir);
         // Check for updates after adding
-        if ((current_time - metadata.last_sync) >= SYNC_INTERVAL) {
-            printf("%s► Checking for updates...%s\n\n", COLOR_DIM, COLOR_RESET);
-            check_and_sync(config_dir, dictionary, false);
+        if (!dict.embedded_base && update_due && check_for_updates_once(base_dir, dictionary)) {
+            hot_cache_bump(config_dir);
+        } else if (!dict.embedded_base && base_stale && !base_writable) {
+            print_shared_base_stale(base_dir);
+        }
+    } else if (strcmp(argv[1], "find") == 0) {
+        if (argc < 3) {
+            printf("%s│%s\n",COLOR_RED, COLOR_RESET);
+            printf("%s╰─ Error%s: No pattern provided. Use `%swtf find <pattern>%s`\n\n", COLOR_RED, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
+            goto cleanup;
         }
+        char pattern[256];
+        join_term_args(argv, argc, pattern, sizeof(pattern));
+        handle_find_command(&dict, pattern, &page);
+    } else if (strcmp(argv[1], "cache") == 0) {
+        if (argc > 3 || (argc == 3 && strcmp(argv[2], "clear") != 0)) {
+            printf("%s│%s\n",COLOR_RED, COLOR_RESET);
+            printf("%s╰─ Error%s: Invalid parameter '%s%s%s'. Use `%swtf cache%s` or `%swtf cache clear%s`\n\n", COLOR_RED, COLOR_RESET, COLOR_YELLOW, argv[argc - 1], COLOR_RESET, COLOR_PRIMARY, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
+            goto cleanup;
+        }
+        handle_cache_command(config_dir, argv, argc);
+    } else if (strcmp(argv[1], "packs") == 0) {
+        if (argc > 2) {
+            printf("%s│%s\n",COLOR_RED, COLOR_RESET);
+            printf("%s╰─ Error%s: Invalid parameter '%s%s%s'. Use `%swtf packs%s`\n\n", COLOR_RED, COLOR_RESET, COLOR_YELLOW, argv[2], COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
+            goto cleanup;
+        }
+        handle_packs_command(packs_path);
     } else if (strcmp(argv[1], "recover") == 0) {
         if (argc < 3) {
             printf("%s│%s\n",COLOR_RED, COLOR_RESET);
             printf("%s╰─ Error%s: No term provided. Use `%swtf recover <term>%s`\n\n", COLOR_RED, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
             goto cleanup;
         }
-        handle_recover_command(removed_dict, removed_path, argv, argc);
+        handle_recover_command(&dict, removed_path, argv, argc);
+        hot_cache_bump(config_dir);
     } // Only check for updates if:
     // 1. It's a new day and this is the first command
     // 2. Explicit sync --force command is used
     else if (strcmp(argv[1], "sync") == 0) {
-        // Force sync when explicit command is used
-        bool force_sync = false;
-        // Check if there are additional parameters
-        if (argc > 3) {
-            printf("\n%s╭─ Error%s: Invalid parameter %s'%s'%s\n", COLOR_RED, COLOR_RESET, COLOR_YELLOW, argv[3], COLOR_RESET);
+        if (dict.embedded_base) {
+            printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+            printf("%s╰─ %s!%s This build has its dictionary compiled in; rebuild with `%smake embed%s` to update it\n\n",
+                   COLOR_PRIMARY, COLOR_YELLOW, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
+            goto cleanup;
+        }
+        // --force and --system, in any order
+        for (int i = 2; i < argc; i++) {
+            if (strcmp(argv[i], "--force") == 0 || strcmp(argv[i], "--system") == 0) continue;
+            printf("\n%s╭─ Error%s: Invalid parameter %s'%s'%s\n", COLOR_RED, COLOR_RESET, COLOR_YELLOW, argv[i], COLOR_RESET);
             printf("%s│%s\n",COLOR_RED, COLOR_RESET);
             printf("%s├─%s Did you mean: %swtf sync --force%s\n",COLOR_RED, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
             printf("%s│%s\n",COLOR_RED, COLOR_RESET);
             printf("%s╰─%s It force syncs dictionary with remote repository\n\n",COLOR_RED, COLOR_RESET);
             goto cleanup;
-        } else if (argc > 2) {
-            if (strcmp(argv[2], "--force") == 0) {
-                force_sync = true;
-            } else {
-                // Invalid parameter
-                printf("\n%s╭─ Error%s: Invalid parameter %s'%s'%s\n", COLOR_RED, COLOR_RESET, COLOR_YELLOW, argv[2], COLOR_RESET);
-                printf("%s│%s\n",COLOR_RED, COLOR_RESET);
-                printf("%s├─%s Did you mean: %swtf sync --force%s\n",COLOR_RED, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
-                printf("%s│%s\n",COLOR_RED, COLOR_RESET);
-                printf("%s╰─%s It force syncs dictionary with remote repository \n\n",COLOR_RED, COLOR_RESET);
+        }
+        if (!base_writable) {
+            printf("%s│%s\n", COLOR_RED, COLOR_RESET);
+            printf("%s╰─ Error%s: The dictionary is shared from %s%s%s; run `%ssudo wtf sync%s` to update it\n\n",
+                   COLOR_RED, COLOR_RESET, COLOR_YELLOW, base_dir, COLOR_RESET, COLOR_PRIMARY, COLOR_RESET);
+            exit_code = 1;
+            goto cleanup;
+        }
+
+        // Only --force creates the base directory, and the lock lives in it
+        struct stat base_st;
+        if (!is_force_sync && (stat(base_dir, &base_st) != 0 || !S_ISDIR(base_st.st_mode))) {
+            printf("%s│%s\n", COLOR_RED, COLOR_RESET);
+            printf("%s╰─ Error%s: Directory structure not found in %s%s%s. Use `%swtf sync %s--force%s` to create it\n\n",
+                   COLOR_RED, COLOR_RESET, COLOR_YELLOW, base_dir, COLOR_RESET, COLOR_PRIMARY,
+                   sync_system ? "--system " : "", COLOR_RESET);
+            exit_code = 1;
+            goto cleanup;
+        }
+
+        // One sync at a time: wait a while for one already running, and if it
+        // brought the dictionary up to date meanwhile, there is nothing left to do
+        if (is_force_sync) mkdir(base_dir, 0755);
+        time_t wait_started = time(NULL);
+        SyncLock lock;
+        bool locked = sync_lock_acquire(&lock, base_dir, 0);
+        bool was_busy = !locked && lock.busy;
+        if (was_busy) {
+            printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+            printf("%s├─ %s►%s Waiting for the sync already running (pid %ld)...%s\n",
+                   COLOR_PRIMARY, COLOR_YELLOW, COLOR_DIM, (long)lock.owner, COLOR_RESET);
+            fflush(stdout);
+            locked = sync_lock_acquire(&lock, base_dir, SYNC_LOCK_WAIT);
+            if (!locked && lock.busy) {
+                printf("%s╰─ Error%s: pid %ld is still syncing; try again later\n\n",
+                       COLOR_RED, COLOR_RESET, (long)lock.owner);
+                exit_code = 1;
+                goto cleanup;
+            }
+        }
+        // Without the lock file there is no telling whether another sync runs
+        if (!locked) {
+            printf("%s│%s\n", COLOR_RED, COLOR_RESET);
+            printf("%s╰─ Error%s: Could not open the sync lock %s%s%s\n\n",
+                   COLOR_RED, COLOR_RESET, COLOR_YELLOW, lock.path, COLOR_RESET);
+            exit_code = 1;
+            goto cleanup;
+        }
+        if (was_busy) {
+            SyncMetadata synced;
+            load_sync_metadata(base_dir, &synced);
+            if (synced.last_sync >= wait_started) {
+                sync_lock_release(&lock);
+                printf("%s╰─ %s✓%s Dictionary is up-to-date!%s\n\n", COLOR_PRIMARY, COLOR_SUCCESS, COLOR_PRIMARY, COLOR_RESET);
+                hot_cache_bump(config_dir);
                 goto cleanup;
-            } 
+            }
         }
-        char current_sha[41] = {0};
-        SyncStatus status = check_and_sync(config_dir, dictionary, force_sync);
+
+        STATS_BEGIN(sync_started);
+        SyncStatus status = check_and_sync(base_dir, dictionary, is_force_sync);
+        STATS_END(STAT_SYNC_CHECK, sync_started);
+        hot_cache_bump(config_dir);
     
         switch(status) {
             case SYNC_NOT_NEEDED:
@@ -327,6 +644,16 @@ int main(int argc, char *argv[]) {
                 printf("%s│%s\n", COLOR_RED, COLOR_RESET);
                 printf("%s╰─ %s! Check Your Internet Connection!\n\n", COLOR_RED, COLOR_RESET);
                 break;
+            case SYNC_RATE_LIMITED: {
+                SyncMetadata limited;
+                load_sync_metadata(base_dir, &limited);
+                char when[16];
+                strftime(when, sizeof(when), "%H:%M", localtime(&limited.next_check));
+                printf("%s│%s\n", COLOR_RED, COLOR_RESET);
+                printf("%s╰─ %s! GitHub API rate limit reached; try again after %s%s%s\n\n",
+                       COLOR_RED, COLOR_RESET, COLOR_YELLOW, when, COLOR_RESET);
+                break;
+            }
             case SYNC_NEEDED:
                 break;
             case SYNC_ERROR:
@@ -334,15 +661,8 @@ int main(int argc, char *argv[]) {
                 printf("%s╰─ Error%s: Could not sync dictionary\n\n", COLOR_RED, COLOR_RESET);
                 break;
         }
-        
-        if (status == SYNC_NEEDED) {
-            SyncMetadata metadata;
-            metadata.last_sync = time(NULL);
-            check_for_updates(config_dir, current_sha);
-            strncpy(metadata.last_sha, current_sha, sizeof(metadata.last_sha) - 1);
-            metadata.last_sha[sizeof(metadata.last_sha) - 1] = '\0';
-            save_sync_metadata(config_dir, &metadata);
-        }
+
+        sync_lock_release(&lock);
     }
     else if (strcmp(argv[1], "uninstall") == 0 || strcmp(argv[1], "--uninstall") == 0) {
         if (argc > 2) {
@@ -374,6 +694,14 @@ int main(int argc, char *argv[]) {
     }
     
     cleanup:
+        hot_cache_close(cache);
+        dictionary_free(&dict);
+        stream_lookup_free(&stream);
+        pack_set_close(&packs);
+        if (store) {
+            block_store_close(store);
+            store = NULL;
+        }
         if (dictionary) {
             free_hash_table(dictionary);
             dictionary = NULL;
@@ -382,5 +710,6 @@ int main(int argc, char *argv[]) {
             free_hash_table(removed_dict);
             removed_dict = NULL;
         }
+        stats_finish(argc > 1 ? argv[1] : "", exit_code);
         return exit_code;
     }
\ No newline at end of file
@@ -1,11 +1,16 @@
 #include "network_sync.h"
 #include "file_utils.h"
+#include "stats.h"
+#include "block_store.h"
+#include "sha1.h"
+#include "sync_lock.h"
+#include "probes.h"
+#include "content_decoder.h"
+#include <curl/curl.h>
 #include <ctype.h>
 #include <sys/stat.h>
 #include <time.h>
-#include <zlib.h>
 #include <errno.h>
-#include <pwd.h>
 #include <unistd.h>
 
 #define COLOR_BLUE    "\033[0;34m"
@@ -13,34 +18,228 @@
 #define COLOR_YELLOW  "\033[0;33m"
 #define COLOR_CYAN_BOLD    "\033[1;36m"
 
+// A download in progress keeps the body as received in res/PARTIAL_FILE, and
+// what it is a download of in PARTIAL_INFO_FILE ("<blob sha> <content
+// encoding> <etag>", "-" for a missing one), so an interrupted one resumes
+// with a Range request instead of starting over
+#define PARTIAL_FILE "definitions.part"
+#define PARTIAL_INFO_FILE "definitions.part.info"
+
+// A download slower than DOWNLOAD_LOW_SPEED bytes/s for DOWNLOAD_LOW_SPEED_TIME
+// seconds is given up and resumed by the next sync. It stops well within
+// SYNC_LOCK_STALE, so a stalled transfer never leaves a silent holder whose
+// lock another sync breaks while it still writes PARTIAL_FILE.
+#define DOWNLOAD_CONNECT_TIMEOUT 10
+#define DOWNLOAD_LOW_SPEED 1024
+#define DOWNLOAD_LOW_SPEED_TIME (SYNC_LOCK_STALE / 2)
+
+// Rate limit headers of the last response
+typedef struct {
+    long status;          // HTTP status code
+    long remaining;       // X-RateLimit-Remaining, -1 when absent
+    time_t reset;         // X-RateLimit-Reset, 0 when absent
+    time_t retry_after;   // Retry-After as a time, 0 when absent
+} RateLimit;
+
+typedef struct {
+    char *data;
+    size_t size;
+    size_t total_size;
+    double speed;
+    time_t started;          // first chunk of this transfer, for the speed
+    CURL *curl;
+    bool show_progress;
+    bool force_sync; 
+    ContentDecoder decoder;  // picked from Content-Encoding when the body starts
+    BlockBuilder *builder;   // when set, the body is decoded into it instead of kept
+    bool stream_done;
+    Sha1 *content_hash;      // blob id of the decoded body, checked before it is installed
+    uint64_t content_size;
+    uint64_t expected_size;  // the decoded body's size, from the API
+    RateLimit limits;
+    FILE *partial;           // the body as received, for resuming
+    const char *partial_info_path;
+    const char *sha;         // the version being downloaded
+    uint64_t resume_from;    // body bytes already on disk when the request went out
+    uint64_t received;       // body bytes received over the network
+    uint64_t retransferred;  // of those, bytes that were already on disk
+    bool body_started;
+    bool discard_partial;    // what is on disk cannot be resumed
+    char etag[128];          // of this response
+    char encoding[32];
+    char partial_encoding[32];
+    long long range_start;   // from Content-Range, -1 when absent
+} NetworkResponse;
+
+// The dictionary's current version upstream: its git blob id and size
+typedef struct {
+    char sha[SHA1_HEX_SIZE];
+    uint64_t size;
+} RemoteVersion;
+
+size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp);
+int is_network_available(void);
+int sync_dictionary(const char *config_dir, HashTable *dictionary, const RemoteVersion *remote, bool force_sync);
+void display_progress(size_t current, size_t total, double speed, bool force_sync);
+size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata);
+
+// Decoded bytes of the download: hashed and parsed into the block builder
+static int take_decoded(void *arg, const char *data, size_t len) {
+    NetworkResponse *resp = (NetworkResponse *)arg;
+    sha1_update(resp->content_hash, data, len);
+    resp->content_size += len;
+    return block_builder_feed(resp->builder, data, len);
+}
+
+// Decode one chunk of the download straight into the block builder
+static int feed_download(NetworkResponse *resp, const void *contents, size_t len) {
+    STATS_BEGIN(started);
+    WTF_PROBE1(inflate__start, len);
+    uint64_t before = resp->content_size;
+    int ok = content_decoder_feed(&resp->decoder, contents, len, take_decoded, resp);
+    // A plain body ends at the size the API reported
+    resp->stream_done = resp->decoder.done ||
+                        (resp->decoder.kind == DECODER_IDENTITY && resp->content_size >= resp->expected_size);
+    STATS_END(STAT_NET_DECOMPRESS, started);
+    WTF_PROBE3(inflate__done, len, resp->content_size - before, ok);
+    return ok;
+}
+
+// Start the body over: nothing decoded, nothing on disk. begin_body() picks
+// the decoder again.
+static int restart_body(NetworkResponse *resp) {
+    content_decoder_free(&resp->decoder);
+    block_builder_free(resp->builder);
+    block_builder_init(resp->builder);
+    git_blob_sha1_begin(resp->content_hash, resp->expected_size);
+    resp->content_size = 0;
+    resp->stream_done = false;
+    resp->resume_from = 0;
+    resp->size = 0;
+    resp->total_size = 0;
+    return fflush(resp->partial) == 0 &&
+           ftruncate(fileno(resp->partial), 0) == 0 && fseek(resp->partial, 0, SEEK_SET) == 0;
+}
+
+static int save_partial_info(const NetworkResponse *resp) {
+    FILE *f = fopen(resp->partial_info_path, "w");
+    if (!f) return 0;
+    fprintf(f, "%s %s %s\n", resp->sha, resp->encoding[0] ? resp->encoding : "-",
+            resp->etag[0] ? resp->etag : "-");
+    return fclose(f) == 0;
+}
+
+// The first bytes of a response: carry on after the partial body if the
+// server sent the range asked for, start over if it sent the whole body.
+// An error leaves the partial body for the next attempt.
+static int begin_body(NetworkResponse *resp) {
+    resp->body_started = true;
+    long status = 0;
+    curl_easy_getinfo(resp->curl, CURLINFO_RESPONSE_CODE, &status);
+    if (status == 416) resp->discard_partial = true;
+    if (status != 200 && status != 206) return 0;
+    if (resp->resume_from > 0) {
+        if (status == 206) {
+            if (resp->range_start != (long long)resp->resume_from ||
+                strcmp(resp->encoding, resp->partial_encoding) != 0) {
+                resp->discard_partial = true;
+                return 0;
+            }
+        } else {
+            resp->retransferred += resp->resume_from;
+            if (!restart_body(resp)) return 0;
+        }
+    } else if (status == 206) {
+        // A range nobody asked for
+        return 0;
+    }
+    if (resp->resume_from == 0) {
+        content_decoder_free(&resp->decoder);
+        if (!content_decoder_init(&resp->decoder, resp->encoding[0] ? resp->encoding : "identity")) {
+            printf("%s├─ Error: Unsupported Content-Encoding '%s'%s\n", COLOR_RED, resp->encoding, COLOR_RESET);
+            return 0;
+        }
+    }
+    return save_partial_info(resp);
+}
+
+// Open the partial body at path, feeding what an interrupted download of the
+// same version left there through the decoder. etag gets the ETag it came with.
+static FILE *open_partial(NetworkResponse *resp, const char *path, char *etag, size_t etag_size) {
+    char sha[SHA1_HEX_SIZE], encoding[32], saved_etag[128];
+    FILE *info = fopen(resp->partial_info_path, "r");
+    bool same = info && fscanf(info, "%40s %31s %127s", sha, encoding, saved_etag) == 3 &&
+                strcmp(sha, resp->sha) == 0;
+    if (info) fclose(info);
+    etag[0] = '\0';
+    bool plain = same && strcmp(encoding, "-") == 0;
+    FILE *f = same && content_decoder_init(&resp->decoder, plain ? "identity" : encoding) ? fopen(path, "r+b") : NULL;
+    if (!f) return fopen(path, "w+b");
+
+    // restart_body() truncates resp->partial if what is there does not decode
+    resp->partial = f;
+    unsigned char buf[64 * 1024];
+    size_t n;
+    int ok = 1;
+    while (ok && !resp->stream_done && (n = fread(buf, 1, sizeof(buf), f)) > 0) {
+        ok = feed_download(resp, buf, n);
+        resp->resume_from += n;
+    }
+    if (!ok || ferror(f) || fseek(f, 0, SEEK_END) != 0 || (uint64_t)ftell(f) != resp->resume_from) {
+        if (!restart_body(resp)) {
+            fclose(f);
+            return NULL;
+        }
+        return f;
+    }
+    resp->size = resp->resume_from;
+    snprintf(resp->partial_encoding, sizeof(resp->partial_encoding), "%s", strcmp(encoding, "-") ? encoding : "");
+    snprintf(etag, etag_size, "%s", strcmp(saved_etag, "-") ? saved_etag : "");
+    return f;
+}
+
 size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp) {
     size_t realsize = size * nmemb;
     NetworkResponse *resp = (NetworkResponse *)userp;
     
-    // Get total size on first call if not set
+    if (resp->builder && !resp->body_started && !begin_body(resp)) return 0;
+    
+    // Get total size on first call if not set; a resumed body counts what is on disk
     if (resp->total_size == 0) {
         curl_off_t cl;
         curl_easy_getinfo(resp->curl, CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &cl);
         if (cl > 0) {
-            resp->total_size = cl;
+            resp->total_size = cl + resp->resume_from;
         }
     }
     
-    char *ptr = realloc(resp->data, resp->size + realsize + 1);
-    if (!ptr) return 0;
-    
-    resp->data = ptr;
-    memcpy(&(resp->data[resp->size]), contents, realsize);
-    resp->size += realsize;
-    resp->data[resp->size] = 0;
+    // Tell processes waiting on the sync lock this download is alive
+    sync_lock_heartbeat();
+
+    if (resp->builder) {
+        if (fwrite(contents, 1, realsize, resp->partial) != realsize) return 0;
+        if (!feed_download(resp, contents, realsize)) {
+            resp->discard_partial = true;
+            return 0;
+        }
+        resp->size += realsize;
+        resp->received += realsize;
+    } else {
+        char *ptr = wtf_realloc(resp->data, resp->size + realsize + 1);
+        if (!ptr) return 0;
+        
+        resp->data = ptr;
+        memcpy(&(resp->data[resp->size]), contents, realsize);
+        resp->size += realsize;
+        resp->data[resp->size] = 0;
+    }
     
     // Calculate speed
-    static time_t start_time = 0;
-    if (start_time == 0) start_time = time(NULL);
     time_t current_time = time(NULL);
-    double elapsed = difftime(current_time, start_time);
+    if (resp->started == 0) resp->started = current_time;
+    double elapsed = difftime(current_time, resp->started);
     if (elapsed > 0) {
-        resp->speed = (double)resp->size / elapsed;
+        resp->speed = (double)(resp->size - resp->resume_from) / elapsed;
     }
     
     if (resp->show_progress) {
@@ -113,11 +312,23 @@ void display_progress(size_t current, size_t total, double speed, bool force_syn
     }
 }
 
+// WTF_API_BASE and WTF_RAW_BASE point sync at another server, such as the
+// stand-in the benchmarks run
+static const char *api_base(void) {
+    const char *base = getenv("WTF_API_BASE");
+    return base && *base ? base : GITHUB_API_BASE;
+}
+
+static const char *raw_base(void) {
+    const char *base = getenv("WTF_RAW_BASE");
+    return base && *base ? base : GITHUB_RAW_BASE;
+}
+
 int is_network_available(void) {
     CURL *curl = curl_easy_init();
     if (!curl) return 0;
     
-    curl_easy_setopt(curl, CURLOPT_URL, GITHUB_API_BASE);
+    curl_easy_setopt(curl, CURLOPT_URL, api_base());
     curl_easy_setopt(curl, CURLOPT_NOBODY, 1L);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 1L);        // Reduced timeout to 1 second
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 1L); // Add connect timeout
@@ -130,37 +341,19 @@ int is_network_available(void) {
     return (res == CURLE_OK);
 }
 
-void load_sync_metadata(const char *config_dir, SyncMetadata *metadata) {
-    char path[512];
-    snprintf(path, sizeof(path), "%s/%s", config_dir, SYNC_METADATA_FILE);
-    
-    FILE *f = fopen(path, "r");
-    if (!f) {
-        metadata->last_sync = 0;
-        metadata->last_sha[0] = '\0';
-        return;
-    }
-    
-    if (fscanf(f, "%ld %40s", &metadata->last_sync, metadata->last_sha) != 2) {
-        metadata->last_sync = 0;
-        metadata->last_sha[0] = '\0';
-    }
-    
-    fclose(f);
+static void watch_rate_limit(CURL *curl, NetworkResponse *resp) {
+    resp->limits.remaining = -1;
+    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
+    curl_easy_setopt(curl, CURLOPT_HEADERDATA, resp);
 }
 
-void save_sync_metadata(const char *config_dir, const SyncMetadata *metadata) {
-    char path[512];
-    snprintf(path, sizeof(path), "%s/%s", config_dir, SYNC_METADATA_FILE);
-    
-    FILE *f = fopen(path, "w");
-    if (!f) return;
-    
-    fprintf(f, "%ld %s", metadata->last_sync, metadata->last_sha);
-    fclose(f);
+// Refused for going over the rate limit, rather than failed
+static bool rate_limited(const RateLimit *limits) {
+    return limits->status == 429 ||
+           (limits->status == 403 && (limits->remaining == 0 || limits->retry_after != 0));
 }
 
-SyncStatus check_for_updates(const char *config_dir, char *current_sha) {
+static SyncStatus check_for_updates_unmeasured(const char *config_dir, RemoteVersion *remote, RateLimit *limits) {
     // Load current metadata
     SyncMetadata metadata;
     load_sync_metadata(config_dir, &metadata);
@@ -170,10 +363,10 @@ SyncStatus check_for_updates(const char *config_dir, char *current_sha) {
     
     char url[512];
     snprintf(url, sizeof(url), "%s/repos/%s/contents/%s", 
-             GITHUB_API_BASE, GITHUB_REPO, DEFINITIONS_PATH);
+             api_base(), GITHUB_REPO, DEFINITIONS_PATH);
     
     NetworkResponse response = {0};
-    response.data = malloc(1);
+    response.data = wtf_malloc(1);
     response.show_progress = false; // Don't show progress for update check
     
     struct curl_slist *headers = NULL;
@@ -186,47 +379,151 @@ SyncStatus check_for_updates(const char *config_dir, char *current_sha) {
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
     curl_easy_setopt(curl, CURLOPT_TIMEOUT, 2L);         // 2 second timeout
     curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, 1L);  // 1 second connect timeout
+    watch_rate_limit(curl, &response);
     
     CURLcode res = curl_easy_perform(curl);
+    curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.limits.status);
     curl_slist_free_all(headers);
     curl_easy_cleanup(curl);
+    *limits = response.limits;
     
-    if (res != CURLE_OK) {
-        free(response.data);
-        return SYNC_ERROR;
+    if (res != CURLE_OK || response.limits.status != 200) {
+        wtf_free(response.data);
+        return res == CURLE_OK && rate_limited(limits) ? SYNC_RATE_LIMITED : SYNC_ERROR;
     }
     
-    // Parse JSON response to get SHA
+    // Parse JSON response to get the blob SHA, and the size the download is checked against
     char *sha_start = strstr(response.data, "\"sha\":\"");
-    if (!sha_start) {
-        free(response.data);
+    char *size_start = strstr(response.data, "\"size\":");
+    unsigned char digest[SHA1_DIGEST_SIZE];
+    if (!sha_start || !size_start || !sha1_parse_hex(sha_start + 7, digest)) {
+        wtf_free(response.data);
         return SYNC_ERROR;
     }
     
-    sha_start += 7;  // Skip \"sha\":\"
-    strncpy(current_sha, sha_start, 40);
-    current_sha[40] = '\0';
+    sha1_hex(digest, remote->sha);
+    remote->size = strtoull(size_start + 7, NULL, 10);
     
     // Compare with last known SHA
     int needs_update = (metadata.last_sha[0] == '\0' || 
-                       strcmp(current_sha, metadata.last_sha) != 0);
+                       strcmp(remote->sha, metadata.last_sha) != 0);
     
-    free(response.data);
+    wtf_free(response.data);
     return needs_update ? SYNC_NEEDED : SYNC_NOT_NEEDED;
 }
 
+// Jitter only has to differ between processes and hosts
+static time_t random_below(time_t n) {
+    struct timespec now;
+    clock_gettime(CLOCK_REALTIME, &now);
+    uint64_t x = ((uint64_t)now.tv_nsec << 20) ^ (uint64_t)now.tv_sec ^ ((uint64_t)getpid() << 40);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    return n > 0 ? (time_t)(x % (uint64_t)n) : 0;
+}
+
+// Record in sync.meta when the next update check may run: after a rate limit
+// refusal, once GitHub allows it; after a failure, exponentially later
+static void schedule_next_check(const char *config_dir, SyncStatus status, const RateLimit *limits) {
+    SyncMetadata metadata;
+    load_sync_metadata(config_dir, &metadata);
+    time_t now = time(NULL);
+    if (status == SYNC_RATE_LIMITED) {
+        time_t until = limits->retry_after > limits->reset ? limits->retry_after : limits->reset;
+        if (until <= now) until = now + SYNC_BACKOFF_BASE;
+        metadata.next_check = until + random_below(SYNC_RESET_JITTER + 1);
+        metadata.failures = 0;
+    } else if (status == SYNC_ERROR || status == SYNC_NO_INTERNET) {
+        if (metadata.failures < 16) metadata.failures++;
+        time_t delay = (time_t)SYNC_BACKOFF_BASE << (metadata.failures - 1);
+        if (delay > SYNC_BACKOFF_MAX) delay = SYNC_BACKOFF_MAX;
+        metadata.next_check = now + delay / 2 + random_below(delay / 2 + 1);
+    } else {
+        metadata.failures = 0;
+        // Nothing left this window: a check before the reset would only be refused
+        metadata.next_check = limits->remaining == 0 && limits->reset > now ? limits->reset : 0;
+    }
+    save_sync_metadata(config_dir, &metadata);
+}
+
+static SyncStatus check_remote_version(const char *config_dir, RemoteVersion *remote) {
+    STATS_BEGIN(started);
+    WTF_PROBE1(check_updates__start, config_dir);
+    RateLimit limits = {0, -1, 0, 0};
+    SyncStatus status = check_for_updates_unmeasured(config_dir, remote, &limits);
+    schedule_next_check(config_dir, status, &limits);
+    STATS_END(STAT_NET_CHECK_UPDATES, started);
+    WTF_PROBE2(check_updates__done, config_dir, (int)status);
+    return status;
+}
+
+static SyncStatus net_check_for_updates(const char *config_dir, char *current_sha) {
+    RemoteVersion remote;
+    SyncStatus status = check_remote_version(config_dir, &remote);
+    if (status == SYNC_NEEDED || status == SYNC_NOT_NEEDED) memcpy(current_sha, remote.sha, SHA1_HEX_SIZE);
+    return status;
+}
+
+// Keeps the check schedule
+static void record_version(const char *config_dir, const char *sha) {
+    SyncMetadata metadata;
+    load_sync_metadata(config_dir, &metadata);
+    metadata.last_sync = time(NULL);
+    snprintf(metadata.last_sha, sizeof(metadata.last_sha), "%s", sha);
+    save_sync_metadata(config_dir, &metadata);
+}
+
+// Copy the value of header line (not terminated) into value if it is name's
+static bool header_value(const char *line, size_t len, const char *name, char *value, size_t size) {
+    size_t name_len = strlen(name);
+    if (len <= name_len || line[name_len] != ':' || strncasecmp(line, name, name_len) != 0) return false;
+    const char *p = line + name_len + 1, *end = line + len;
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    while (end > p && isspace((unsigned char)end[-1])) end--;
+    size_t n = (size_t)(end - p) < size - 1 ? (size_t)(end - p) : size - 1;
+    memcpy(value, p, n);
+    value[n] = '\0';
+    return true;
+}
+
 size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata) {
-    (void)userdata;
+    NetworkResponse *resp = (NetworkResponse *)userdata;
     size_t bytes = size * nitems;
-    // Check for Content-Encoding header
-    if (strncasecmp(buffer, "Content-Encoding:", 16) == 0) {
-        // For debugging if needed
-        // printf("Content-Encoding: %.*s", (int)bytes - 16, buffer + 16);
+    RateLimit *limits = &resp->limits;
+    char value[64];
+    if (bytes > 5 && strncmp(buffer, "HTTP/", 5) == 0) {
+        // A new response (after a redirect): forget the last one's headers
+        limits->remaining = -1;
+        limits->reset = 0;
+        limits->retry_after = 0;
+        resp->etag[0] = '\0';
+        resp->encoding[0] = '\0';
+        resp->range_start = -1;
+    } else if (header_value(buffer, bytes, "ETag", resp->etag, sizeof(resp->etag)) ||
+               header_value(buffer, bytes, "Content-Encoding", resp->encoding, sizeof(resp->encoding))) {
+        // kept as they are
+    } else if (header_value(buffer, bytes, "Content-Range", value, sizeof(value))) {
+        // bytes <start>-<end>/<total>
+        resp->range_start = strncmp(value, "bytes ", 6) == 0 ? strtoll(value + 6, NULL, 10) : -1;
+    } else if (header_value(buffer, bytes, "X-RateLimit-Remaining", value, sizeof(value))) {
+        limits->remaining = strtol(value, NULL, 10);
+    } else if (header_value(buffer, bytes, "X-RateLimit-Reset", value, sizeof(value))) {
+        limits->reset = (time_t)strtoll(value, NULL, 10);
+    } else if (header_value(buffer, bytes, "Retry-After", value, sizeof(value))) {
+        // Seconds, or an HTTP date
+        char *end;
+        long long seconds = strtoll(value, &end, 10);
+        limits->retry_after = *end == '\0' && end != value ? time(NULL) + (time_t)seconds : curl_getdate(value, NULL);
+        if (limits->retry_after < 0) limits->retry_after = 0;
     }
     return bytes;
 }
 
-int sync_dictionary(const char *config_dir, HashTable *dictionary, const char *new_sha, bool force_sync) {
+// Download, decode and store the dictionary. downloaded and entries report
+// the compressed bytes received and the definitions parsed from them.
+static int sync_dictionary_unprobed(const char *config_dir, const RemoteVersion *remote, bool force_sync,
+                                    size_t *downloaded, size_t *entries) {
     if (force_sync) {
         printf("\n%s╭─ %sForce update initiated!%s\n", COLOR_PRIMARY, COLOR_RED, COLOR_RESET);
         printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
@@ -238,23 +535,96 @@ int sync_dictionary(const char *config_dir, HashTable *dictionary, const char *n
         printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
     }
     
+    // Prepare paths
+    char res_dir[512], def_path[512], store_path[512], part_path[512], info_path[512];
+    snprintf(res_dir, sizeof(res_dir), "%s/res", config_dir);
+    snprintf(store_path, sizeof(store_path), "%s/res/%s", config_dir, BLOCK_STORE_FILE);
+    snprintf(part_path, sizeof(part_path), "%s/res/%s", config_dir, PARTIAL_FILE);
+    snprintf(info_path, sizeof(info_path), "%s/res/%s", config_dir, PARTIAL_INFO_FILE);
+
+    // Check if directories exist; the partial download lives in res/
+    struct stat st = {0};
+    bool dirs_exist = (stat(config_dir, &st) != -1) && (stat(res_dir, &st) != -1);
+
+    // Handle directory creation based on force_sync
+    if (!dirs_exist) {
+        if (!force_sync) {
+            printf("%s Error: Directory structure not found. Use --force to create directories%s\n", 
+                   COLOR_RED, COLOR_RESET);
+            return 0;
+        }
+
+        // Create directories when force_sync is true
+        if (mkdir(config_dir, 0755) != 0 && errno != EEXIST) {
+            printf("%s├─ Error: Could not create .wtf directory%s\n", COLOR_RED, COLOR_RESET);
+            return 0;
+        }
+
+        if (mkdir(res_dir, 0755) != 0 && errno != EEXIST) {
+            printf("%s├─ Error: Could not create res directory%s\n", COLOR_RED, COLOR_RESET);
+            return 0;
+        }
+
+        printf("%s├─ %s✓%s Created directory structure%s\n", 
+               COLOR_PRIMARY, COLOR_SUCCESS, COLOR_DIM, COLOR_RESET);
+    }
+    
     CURL *curl = curl_easy_init();
     if (!curl) return 0;
     
     char url[512];
-    snprintf(url, sizeof(url), "https://raw.githubusercontent.com/%s/main/%s", 
-             GITHUB_REPO, DEFINITIONS_PATH);
+    snprintf(url, sizeof(url), "%s/%s/main/%s", 
+             raw_base(), GITHUB_REPO, DEFINITIONS_PATH);
+    
+    // The body is decoded and parsed as it arrives; nothing but the parsed
+    // entries is held in memory and no plain-text copy is written
+    BlockBuilder builder;
+    block_builder_init(&builder);
+    Sha1 content_hash;
+    git_blob_sha1_begin(&content_hash, remote->size);
     
     NetworkResponse response = {0};
-    response.data = malloc(1);
     response.size = 0;
     response.total_size = 0;
     response.curl = curl;
     response.show_progress = true;
     response.force_sync = force_sync;
+    response.builder = &builder;
+    response.content_hash = &content_hash;
+    response.expected_size = remote->size;
+    response.sha = remote->sha;
+    response.partial_info_path = info_path;
+    response.range_start = -1;
+
+    // Pick up where an interrupted download of this version stopped
+    char etag[128];
+    response.partial = open_partial(&response, part_path, etag, sizeof(etag));
+    if (!response.partial) {
+        printf("%s├─ Error: Could not write %s%s\n", COLOR_RED, part_path, COLOR_RESET);
+        content_decoder_free(&response.decoder);
+        block_builder_free(&builder);
+        curl_easy_cleanup(curl);
+        return 0;
+    }
+    uint64_t resumed_from = response.resume_from;
+    if (resumed_from > 0) {
+        printf("%s├─ %s✓%s Resuming download at %.1f KB%s\n", COLOR_PRIMARY, COLOR_SUCCESS, COLOR_DIM,
+               (double)resumed_from / 1024.0, COLOR_RESET);
+    }
     
     struct curl_slist *headers = NULL;
-    headers = curl_slist_append(headers, "Accept-Encoding: gzip");
+    char accept[64], range[32], if_range[160];
+    snprintf(accept, sizeof(accept), "Accept-Encoding: %s", content_decoder_accept());
+    headers = curl_slist_append(headers, accept);
+    if (resumed_from > 0) {
+        snprintf(range, sizeof(range), "%llu-", (unsigned long long)resumed_from);
+        curl_easy_setopt(curl, CURLOPT_RANGE, range);
+        // Only a strong validator says the bytes on disk are the same bytes
+        if (etag[0] && strncmp(etag, "W/", 2) != 0) {
+            snprintf(if_range, sizeof(if_range), "If-Range: %s", etag);
+            headers = curl_slist_append(headers, if_range);
+        }
+    }
     
     curl_easy_setopt(curl, CURLOPT_URL, url);
     curl_easy_setopt(curl, CURLOPT_USERAGENT, USER_AGENT);
@@ -262,186 +632,162 @@ int sync_dictionary(const char *config_dir, HashTable *dictionary, const char *n
     curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, write_callback);
     curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void *)&response);
     curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-    
-    curl_easy_setopt(curl, CURLOPT_HEADERFUNCTION, header_callback);
-    curl_easy_setopt(curl, CURLOPT_HEADERDATA, &response);
-    
-    CURLcode res = curl_easy_perform(curl);
+    curl_easy_setopt(curl, CURLOPT_CONNECTTIMEOUT, (long)DOWNLOAD_CONNECT_TIMEOUT);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_LIMIT, (long)DOWNLOAD_LOW_SPEED);
+    curl_easy_setopt(curl, CURLOPT_LOW_SPEED_TIME, (long)DOWNLOAD_LOW_SPEED_TIME);
+    
+    watch_rate_limit(curl, &response);
+    
+    // Everything may already be on disk, if the last attempt died after the
+    // body arrived
+    CURLcode res = CURLE_OK;
+    if (!response.stream_done) {
+        STATS_BEGIN(download_started);
+        res = curl_easy_perform(curl);
+        STATS_END(STAT_NET_DOWNLOAD, download_started);
+        curl_easy_getinfo(curl, CURLINFO_RESPONSE_CODE, &response.limits.status);
+    }
     
     curl_slist_free_all(headers);
     curl_easy_cleanup(curl);
-    
-    if (res != CURLE_OK) {
-        printf("%sError occurred while updating%s\n", COLOR_RED, COLOR_RESET);
-        free(response.data);
-        return 0;
-    }
-    
-    unsigned char *uncompressed_data = NULL;
-    size_t uncompressed_size = 0;
-    
-    z_stream strm = {0};
-    strm.zalloc = Z_NULL;
-    strm.zfree = Z_NULL;
-    strm.opaque = Z_NULL;
-    
-    if (inflateInit2(&strm, 16 + MAX_WBITS) != Z_OK) {
-        printf("%sError initializing decompression%s\n", COLOR_RED, COLOR_RESET);
-        free(response.data);
-        return 0;
-    }
-    
-    strm.next_in = (Bytef *)response.data;
-    strm.avail_in = response.size;
-    
-    size_t out_buf_size = response.size * 4;
-    uncompressed_data = malloc(out_buf_size);
-    if (!uncompressed_data) {
-        printf("%sMemory allocation error%s\n", COLOR_RED, COLOR_RESET);
-        inflateEnd(&strm);
-        free(response.data);
-        return 0;
+    content_decoder_free(&response.decoder);
+    long kept = fflush(response.partial) == 0 ? ftell(response.partial) : -1;
+    fclose(response.partial);
+    *downloaded = response.received;
+    *entries = builder.count;
+    WTF_PROBE3(download__done, response.received, resumed_from, response.retransferred);
+
+    if (response.retransferred > 0) {
+        printf("%s├─ %sServer ignored the resume request; %.1f KB sent again%s\n", COLOR_PRIMARY, COLOR_YELLOW,
+               (double)response.retransferred / 1024.0, COLOR_RESET);
     }
-    
-    strm.next_out = uncompressed_data;
-    strm.avail_out = out_buf_size;
-    
-    int ret;
-    while ((ret = inflate(&strm, Z_FINISH)) != Z_STREAM_END) {
-        if (ret == Z_OK) {
-            size_t current_size = out_buf_size;
-            out_buf_size *= 2;
-            unsigned char *temp = realloc(uncompressed_data, out_buf_size);
-            if (!temp) {
-                printf("%sMemory allocation error%s\n", COLOR_RED, COLOR_RESET);
-                inflateEnd(&strm);
-                free(uncompressed_data);
-                free(response.data);
-                return 0;
-            }
-            uncompressed_data = temp;
-            strm.next_out = uncompressed_data + current_size;
-            strm.avail_out = current_size;
+    if (res != CURLE_OK || !response.stream_done) {
+        block_builder_free(&builder);
+        if (kept > 0 && !response.discard_partial) {
+            printf("%s├─ Error: Download interrupted; %.1f KB kept, `wtf sync` resumes it%s\n",
+                   COLOR_RED, (double)kept / 1024.0, COLOR_RESET);
         } else {
-            printf("%sError decompressing data%s\n", COLOR_RED, COLOR_RESET);
-            inflateEnd(&strm);
-            free(uncompressed_data);
-            free(response.data);
-            return 0;
+            printf("%sError occurred while updating%s\n", COLOR_RED, COLOR_RESET);
+            unlink(part_path);
+            unlink(info_path);
         }
+        return 0;
     }
-    
-    uncompressed_size = strm.total_out;
-    inflateEnd(&strm);
+    unlink(part_path);
+    unlink(info_path);
 
-    // Get home directory
-    const char *home = getenv("HOME");
-    if (!home) {
-        struct passwd *pw = getpwuid(getuid());
-        if (pw) {
-            home = pw->pw_dir;
-        }
+    // Install only what the API said this version is
+    unsigned char digest[SHA1_DIGEST_SIZE];
+    sha1_final(&content_hash, digest);
+    sha1_hex(digest, builder.source_sha);
+    if (response.content_size != remote->size || strcmp(builder.source_sha, remote->sha) != 0) {
+        printf("%s├─ Error: Download does not match version %.7s; dictionary left unchanged%s\n",
+               COLOR_RED, remote->sha, COLOR_RESET);
+        block_builder_free(&builder);
+        return 0;
     }
 
-    if (!home) {
-        printf("%sError: Could not determine home directory%s\n", COLOR_RED, COLOR_RESET);
-        free(response.data);
-        free(uncompressed_data);
+    // Sort and compress the entries into the block store
+    STATS_BEGIN(write_started);
+    int written = block_builder_write(&builder, store_path);
+    block_builder_free(&builder);
+    STATS_END(STAT_NET_WRITE, write_started);
+    if (!written) {
+        printf("%s├─ Error: Could not create definitions file%s\n", COLOR_RED, COLOR_RESET);
         return 0;
     }
+    // The block store supersedes a plain-text copy in ~/.wtf; the seed a
+    // package installed for the shared base stays as it is
+    if (base_text_path(config_dir, def_path, sizeof(def_path))) unlink(def_path);
+    
+    record_version(config_dir, remote->sha);
+    
+    printf("%s╰─ %s✓%s update successful%s\n\n", COLOR_PRIMARY, COLOR_SUCCESS, COLOR_PRIMARY, COLOR_RESET);
+    
+    // Make sure the new store opens before reporting success
+    STATS_BEGIN(reload_started);
+    BlockStore *store = block_store_open(store_path);
+    if (!store) {
+        printf("%sWarning: Downloaded definitions file but failed to load it%s\n", COLOR_YELLOW, COLOR_RESET);
+    }
+    block_store_close(store);
+    STATS_END(STAT_NET_RELOAD, reload_started);
+    return 1;
+}
 
-    // Prepare paths
-    char wtf_dir[512], res_dir[512], def_path[512];
-    snprintf(wtf_dir, sizeof(wtf_dir), "%s/.wtf", home);
-    snprintf(res_dir, sizeof(res_dir), "%s/.wtf/res", home);
-    snprintf(def_path, sizeof(def_path), "%s/.wtf/res/definitions.txt", home);
-
-    // Check if directories exist
-    struct stat st = {0};
-    bool dirs_exist = (stat(wtf_dir, &st) != -1) && (stat(res_dir, &st) != -1);
-
-    // Handle directory creation based on force_sync
-    if (!dirs_exist) {
-        if (!force_sync) {
-            printf("%s Error: Directory structure not found. Use --force to create directories%s\n", 
-                   COLOR_RED, COLOR_RESET);
-            free(response.data);
-            free(uncompressed_data);
-            return 0;
-        }
+int sync_dictionary(const char *config_dir, HashTable *dictionary, const RemoteVersion *remote, bool force_sync) {
+    (void)dictionary;  // lookups read the new block store; nothing to reload in memory
+    WTF_PROBE2(sync__start, config_dir, (int)force_sync);
+    size_t downloaded = 0, entries = 0;
+    int ok = sync_dictionary_unprobed(config_dir, remote, force_sync, &downloaded, &entries);
+    WTF_PROBE4(sync__done, config_dir, ok, downloaded, entries);
+    return ok;
+}
 
-        // Create directories when force_sync is true
-        if (mkdir(wtf_dir, 0755) != 0 && errno != EEXIST) {
-            printf("%s├─ Error: Could not create .wtf directory%s\n", COLOR_RED, COLOR_RESET);
-            free(response.data);
-            free(uncompressed_data);
-            return 0;
-        }
+// True if config_dir's definitions.txt (the packaged seed, for the shared
+// base) is the blob sha
+static bool local_text_matches(const char *config_dir, const char *sha) {
+    char path[512], local_sha[SHA1_HEX_SIZE];
+    base_text_path(config_dir, path, sizeof(path));
+    return git_blob_sha1_file(path, local_sha) && strcmp(local_sha, sha) == 0;
+}
 
-        if (mkdir(res_dir, 0755) != 0 && errno != EEXIST) {
-            printf("%s├─ Error: Could not create res directory%s\n", COLOR_RED, COLOR_RESET);
-            free(response.data);
-            free(uncompressed_data);
-            return 0;
-        }
+// True if config_dir's block store was built from the blob sha
+static bool local_store_matches(const char *config_dir, const char *sha) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/res/%s", config_dir, BLOCK_STORE_FILE);
+    BlockStore *store = block_store_open_lazy(path);
+    bool matches = store && strcmp(store->source_sha, sha) == 0;
+    block_store_close(store);
+    return matches;
+}
 
-        printf("%s├─ %s✓%s Created directory structure%s\n", 
-               COLOR_PRIMARY, COLOR_SUCCESS, COLOR_DIM, COLOR_RESET);
+// The definitions.txt on disk already is the latest version: convert it
+// locally, as a download would have been, instead of fetching it again
+static int install_local_text(const char *config_dir, const RemoteVersion *remote, bool force_sync) {
+    if (force_sync) {
+        printf("\n%s╭─ %sForce update initiated!%s\n", COLOR_PRIMARY, COLOR_RED, COLOR_RESET);
+    } else {
+        printf("\n%s╭─ Dictionary Update%s\n", COLOR_PRIMARY, COLOR_RESET);
     }
+    printf("%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+    printf("%s├─ %s✓%s Local copy matches version %.7s, download skipped%s\n",
+           COLOR_PRIMARY, COLOR_SUCCESS, COLOR_DIM, remote->sha, COLOR_RESET);
 
-    // Try to open and write the file
-    FILE *f = fopen(def_path, "w");
-    if (!f) {
+    char def_path[512], store_path[512];
+    int own_text = base_text_path(config_dir, def_path, sizeof(def_path));
+    snprintf(store_path, sizeof(store_path), "%s/res/%s", config_dir, BLOCK_STORE_FILE);
+    STATS_BEGIN(write_started);
+    int written = block_store_build_from_text(def_path, store_path);
+    STATS_END(STAT_NET_WRITE, write_started);
+    if (!written) {
         printf("%s├─ Error: Could not create definitions file%s\n", COLOR_RED, COLOR_RESET);
-        free(response.data);
-        free(uncompressed_data);
         return 0;
     }
-    
-    fwrite(uncompressed_data, 1, uncompressed_size, f);
-    fclose(f);
-    
-    // Update metadata
-    SyncMetadata metadata;
-    metadata.last_sync = time(NULL);
-    strncpy(metadata.last_sha, new_sha, sizeof(metadata.last_sha) - 1);
-    save_sync_metadata(config_dir, &metadata);
-    
+    if (own_text) unlink(def_path);
+    record_version(config_dir, remote->sha);
     printf("%s╰─ %s✓%s update successful%s\n\n", COLOR_PRIMARY, COLOR_SUCCESS, COLOR_PRIMARY, COLOR_RESET);
-    
-    // Clear and reload dictionary
-    hash_table_clear(dictionary);
-    if (!load_definitions(def_path, dictionary)) {
-        printf("%sWarning: Downloaded definitions file but failed to load it%s\n", COLOR_YELLOW, COLOR_RESET);
-    }
-    
-    // Clean up
-    free(response.data);
-    free(uncompressed_data);
     return 1;
 }
 
-SyncStatus check_and_sync(const char *config_dir, HashTable *dictionary, bool force_sync) {
-    if (!is_network_available()) {
-        return SYNC_NO_INTERNET;
-    }
-    
+static SyncStatus net_check_and_sync(const char *config_dir, HashTable *dictionary, bool force_sync) {
     SyncMetadata metadata;
     load_sync_metadata(config_dir, &metadata);
     time_t current_time = time(NULL);
     
-    if (force_sync) {
-        char current_sha[41];
-        // Get current SHA just for updating metadata
-        if (check_for_updates(config_dir, current_sha) == SYNC_ERROR) {
-            return SYNC_ERROR;
-        }
-        // Force sync regardless of SHA
-        if (sync_dictionary(config_dir, dictionary, current_sha, true)) {
-            return SYNC_NEEDED;
-        } else {
-            return SYNC_ERROR;
-        }
+    // GitHub asked for no requests until next_check. The backoff after a
+    // failure only holds back automatic checks; their callers skip them.
+    if (metadata.failures == 0 && current_time < metadata.next_check) {
+        return SYNC_RATE_LIMITED;
+    }
+    
+    STATS_BEGIN(probe_started);
+    int online = is_network_available();
+    STATS_END(STAT_NET_PROBE, probe_started);
+    if (!online) {
+        RateLimit none = {0, -1, 0, 0};
+        schedule_next_check(config_dir, SYNC_NO_INTERNET, &none);
+        return SYNC_NO_INTERNET;
     }
     
     // Only check interval if not forcing sync
@@ -450,25 +796,43 @@ SyncStatus check_and_sync(const char *config_dir, HashTable *dictionary, bool fo
     }
     
     // Always check for updates when we get here
-    char current_sha[41];
-    SyncStatus status = check_for_updates(config_dir, current_sha);
+    RemoteVersion remote;
+    SyncStatus checked = check_remote_version(config_dir, &remote);
+    if (checked == SYNC_ERROR || checked == SYNC_RATE_LIMITED) {
+        return checked;
+    }
+    load_sync_metadata(config_dir, &metadata);   // with the schedule the check left
     
-    if (status == SYNC_ERROR) {
-        return SYNC_ERROR;
+    if (!force_sync && strcmp(remote.sha, metadata.last_sha) == 0) {
+        // No update needed, but update last sync time
+        metadata.last_sync = current_time;
+        save_sync_metadata(config_dir, &metadata);
+        return SYNC_NOT_NEEDED;
     }
     
-    // Compare SHA with last known SHA
-    if (strcmp(current_sha, metadata.last_sha) != 0) {
-        // SHA different - update needed
-        if (sync_dictionary(config_dir, dictionary, current_sha, false)) {
-            return SYNC_NEEDED;  // Successfully updated
-        } else {
-            return SYNC_ERROR;   // Update failed
-        }
+    // sync.meta is missing, behind or ignored (--force). The files on disk
+    // may still be this version: a freshly installed definitions.txt, or a
+    // store built from it. --force trusts only the text, since rebuilding
+    // the store is what it is for.
+    if (local_text_matches(config_dir, remote.sha)) {
+        return install_local_text(config_dir, &remote, force_sync) ? SYNC_NEEDED : SYNC_ERROR;
+    }
+    if (!force_sync && local_store_matches(config_dir, remote.sha)) {
+        record_version(config_dir, remote.sha);
+        return SYNC_NOT_NEEDED;
     }
     
-    // No update needed, but update last sync time
-    metadata.last_sync = current_time;
-    save_sync_metadata(config_dir, &metadata);
-    return SYNC_NOT_NEEDED;
-}
\ No newline at end of file
+    if (sync_dictionary(config_dir, dictionary, &remote, force_sync)) {
+        return SYNC_NEEDED;  // Successfully updated
+    }
+    RateLimit none = {0, -1, 0, 0};
+    schedule_next_check(config_dir, SYNC_ERROR, &none);
+    return SYNC_ERROR;   // Update failed
+}
+
+// Looked up by load_sync_module() after dlopen()
+const SyncModule wtf_sync_module = {
+    SYNC_MODULE_ABI_VERSION,
+    net_check_for_updates,
+    net_check_and_sync
+};
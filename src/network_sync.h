@@ -5,61 +5,75 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdbool.h>
-#include <curl/curl.h>
 #include <time.h>
 #include "hash_table.h"
+#include "colors.h"
 
 #define USER_AGENT "WTF-Dictionary/1.0"
 #define GITHUB_API_BASE "https://api.github.com"
+#define GITHUB_RAW_BASE "https://raw.githubusercontent.com"
 #define GITHUB_REPO "AnuragBhaskarya/wtf"
 #define DEFINITIONS_PATH ".wtf/res/definitions.txt"
 #define SYNC_METADATA_FILE "sync.meta"
 #define SYNC_INTERVAL  172800  // 2 Days interval
 
-// ANSI color codes
-#define COLOR_GREEN "\033[0;32m"
-#define COLOR_UB_GREEN "\033[1;4;32m"
-#define COLOR_GRAY "\033[0;37m"
-#define COLOR_RED "\033[0;31m"
-#define COLOR_CYAN    "\033[0;36m"
-#define COLOR_YELLOW "\033[0;33m"
-// Define a minimal, monochromatic color palette
-#define COLOR_PRIMARY  "\033[0;38;5;75m"   // Main blue for structure
-#define COLOR_DIM     "\033[0;38;5;67m"    // Dimmed version for secondary text
-#define COLOR_SUCCESS "\033[0;38;5;78m"    // Subtle green only for checkmarks
-#define COLOR_RESET   "\033[0m"
+// After a failed check, wait SYNC_BACKOFF_BASE << (failures - 1) seconds (at
+// most SYNC_BACKOFF_MAX, half of it random) before the next; after hitting the
+// API rate limit, until GitHub says, plus up to SYNC_RESET_JITTER seconds so
+// hosts behind one address do not all come back at the same moment
+#define SYNC_BACKOFF_BASE 60
+#define SYNC_BACKOFF_MAX 3600
+#define SYNC_RESET_JITTER 60
 
-typedef struct {
-    char *data;
-    size_t size;
-    size_t total_size;
-    double speed;
-    CURL *curl;
-    bool show_progress;
-    bool force_sync; 
-} NetworkResponse;
+// The curl-based sync code lives in a separate shared object that is only
+// loaded when a sync actually runs, so lookups never pay for libcurl.
+#define SYNC_MODULE_NAME "wtf_sync.so"
+#define SYNC_MODULE_SYMBOL "wtf_sync_module"
+#define SYNC_MODULE_ABI_VERSION 5   // 5: shared base synced into WTF_STATE_DIR, seed text left alone
+
+#ifndef WTF_LIBDIR
+#define WTF_LIBDIR "/usr/lib/wtf"
+#endif
+
+// Base dictionary shared by every user. The package ships res/definitions.txt
+// in WTF_SYSTEM_DIR as read-only seed data that nothing but dpkg touches; root's
+// `wtf sync` writes what it produces (res/definitions.wtfb and its indexes,
+// sync.meta, sync.lock, the partial download) to WTF_STATE_DIR, laid out like
+// a ~/.wtf. Both can be overridden from the environment.
+#ifndef WTF_SYSTEM_DIR
+#define WTF_SYSTEM_DIR "/usr/share/wtf"
+#endif
+#ifndef WTF_STATE_DIR
+#define WTF_STATE_DIR "/var/lib/wtf"
+#endif
 
 typedef struct {
     time_t last_sync;
     char last_sha[41];  // SHA-1 hash is 40 chars + null terminator
+    time_t next_check;  // no update check before this (rate limit or backoff)
+    int failures;       // checks failed in a row; 0 when next_check is GitHub's rate limit
 } SyncMetadata;
 
 typedef enum {
     SYNC_NOT_NEEDED,
     SYNC_NEEDED,
     SYNC_ERROR,
-    SYNC_NO_INTERNET
+    SYNC_NO_INTERNET,
+    SYNC_RATE_LIMITED
 } SyncStatus;
 
+// Entry points exported by the sync module
+typedef struct {
+    int abi_version;
+    SyncStatus (*check_for_updates)(const char *config_dir, char *current_sha);
+    SyncStatus (*check_and_sync)(const char *config_dir, HashTable *dictionary, bool force_sync);
+} SyncModule;
+
 // Function declarations
-size_t write_callback(void *contents, size_t size, size_t nmemb, void *userp);
-int is_network_available(void);
 void load_sync_metadata(const char *config_dir, SyncMetadata *metadata);
 void save_sync_metadata(const char *config_dir, const SyncMetadata *metadata);
 SyncStatus check_for_updates(const char *config_dir, char *current_sha);
-int sync_dictionary(const char *config_dir, HashTable *dictionary, const char *new_sha, bool force_sync);
 SyncStatus check_and_sync(const char *config_dir, HashTable *dictionary, bool force_sync);
-void display_progress(size_t current, size_t total, double speed, bool force_sync);
-size_t header_callback(char *buffer, size_t size, size_t nitems, void *userdata);
+const SyncModule *load_sync_module(void);
 
-#endif
\ No newline at end of file
+#endif
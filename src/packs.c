@@ -0,0 +1,207 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <dirent.h>
+#include <sys/stat.h>
+#include "packs.h"
+#include "file_utils.h"
+#include "stats.h"
+
+// Letters, digits, '-', '_' and '.', not starting with '.'
+int pack_name_valid(const char *name) {
+    size_t len = strlen(name);
+    if (len == 0 || len >= PACK_NAME_MAX || name[0] == '.') return 0;
+    for (const char *c = name; *c; c++) {
+        if (!((*c >= 'a' && *c <= 'z') || (*c >= 'A' && *c <= 'Z') || (*c >= '0' && *c <= '9') ||
+              *c == '-' || *c == '_' || *c == '.')) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static int is_directory(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 && S_ISDIR(st.st_mode);
+}
+
+static int add_pack(PackSet *set, const char *packs_dir, const char *name) {
+    for (int i = 0; i < set->count; i++) {
+        if (strcmp(set->packs[i].name, name) == 0) return 1;  // listed twice
+    }
+    if (set->count == PACK_MAX) return 0;
+
+    Pack *pack = &set->packs[set->count];
+    memset(pack, 0, sizeof(*pack));
+    snprintf(pack->name, sizeof(pack->name), "%s", name);
+    if ((size_t)snprintf(pack->dir, sizeof(pack->dir), "%s/%s", packs_dir, name) >= sizeof(pack->dir) ||
+        !is_directory(pack->dir)) {
+        return 0;
+    }
+    set->count++;
+    return 1;
+}
+
+static int compare_names(const void *a, const void *b) {
+    return strcmp(*(const char * const *)a, *(const char * const *)b);
+}
+
+// Every pack directory, in name order
+static int add_all_packs(PackSet *set, const char *packs_dir) {
+    DIR *dir = opendir(packs_dir);
+    if (!dir) return 1;  // no packs installed
+
+    char *names[PACK_MAX];
+    int count = 0;
+    struct dirent *entry;
+    while ((entry = readdir(dir)) != NULL && count < PACK_MAX) {
+        if (!pack_name_valid(entry->d_name)) continue;
+        names[count] = wtf_strdup(entry->d_name);
+        if (names[count]) count++;
+    }
+    closedir(dir);
+
+    qsort(names, (size_t)count, sizeof(char *), compare_names);
+    for (int i = 0; i < count; i++) {
+        add_pack(set, packs_dir, names[i]);  // skips plain files
+        wtf_free(names[i]);
+    }
+    return 1;
+}
+
+// Select packs by a comma-separated list of names, or every installed pack when
+// selection is NULL or empty. Nothing is opened yet. On an unknown name returns
+// 0 with the name copied to bad_name.
+int pack_set_open(PackSet *set, const char *packs_dir, const char *selection, char *bad_name, size_t bad_len) {
+    set->count = 0;
+    if (!selection || !*selection) {
+        return add_all_packs(set, packs_dir);
+    }
+
+    const char *start = selection;
+    while (*start) {
+        const char *end = strchr(start, ',');
+        size_t len = end ? (size_t)(end - start) : strlen(start);
+        char name[PACK_NAME_MAX];
+        if (len > 0) {
+            snprintf(name, sizeof(name), "%.*s", (int)(len < sizeof(name) ? len : sizeof(name) - 1), start);
+            if (len >= sizeof(name) || !pack_name_valid(name) || !add_pack(set, packs_dir, name)) {
+                snprintf(bad_name, bad_len, "%.*s", (int)len, start);
+                pack_set_close(set);
+                return 0;
+            }
+        }
+        if (!end) break;
+        start = end + 1;
+    }
+    return 1;
+}
+
+// Open a pack's dictionary: the block store's header and filter, or the whole
+// text file. Returns 0 if the pack has neither.
+int pack_open(Pack *pack) {
+    if (pack->state != PACK_UNOPENED) return pack->state == PACK_OPEN;
+    pack->state = PACK_FAILED;
+
+    char path[PATH_MAX];
+    if ((size_t)snprintf(path, sizeof(path), "%s/%s", pack->dir, BLOCK_STORE_FILE) >= sizeof(path)) return 0;
+    pack->store = block_store_open_lazy(path);
+    if (pack->store) {
+        pack->state = PACK_OPEN;
+        return 1;
+    }
+
+    if ((size_t)snprintf(path, sizeof(path), "%s/definitions.txt", pack->dir) >= sizeof(path)) return 0;
+    HashTable *table = create_hash_table(100);
+    BloomKeys keys = {0};
+    if (!table || !load_definitions_hashed(path, table, &keys) ||
+        !bloom_build(&pack->filter, &keys, bloom_target_fpr())) {
+        bloom_keys_free(&keys);
+        free_hash_table(table);
+        return 0;
+    }
+    if (wtf_stats_enabled) {
+        stats_note_bloom_filter(bloom_estimated_fpr(&pack->filter, keys.count),
+                                (size_t)pack->filter.block_count * BLOOM_BLOCK_BYTES);
+    }
+    bloom_keys_free(&keys);
+    pack->table = table;
+    pack->state = PACK_OPEN;
+    return 1;
+}
+
+// Append matches from each selected pack in order, opening packs on first use.
+// Returns the number of matches appended.
+int pack_set_lookup_view(PackSet *set, const char *term, LookupResult *out) {
+    if (!set || !term || !out) return 0;
+    int before = out->count;
+
+    for (int i = 0; i < set->count; i++) {
+        Pack *pack = &set->packs[i];
+        if (!pack_open(pack)) continue;
+        pack->lookups++;
+
+        if (pack->store) {
+            uint64_t rejects = pack->store->bloom_rejects;
+            block_store_lookup_view(pack->store, term, out);
+            if (pack->store->bloom_rejects != rejects) pack->skipped++;
+            continue;
+        }
+
+        int maybe = bloom_maybe_contains(&pack->filter, bloom_hash(term));
+        if (wtf_stats_enabled) stats_note_bloom_check(maybe);
+        if (!maybe) {
+            pack->skipped++;
+        } else if (hash_table_lookup_view(pack->table, term, out) == 0 && wtf_stats_enabled) {
+            stats_note_bloom_false_positive();
+        }
+    }
+    return out->count - before;
+}
+
+// Index of an open pack's terms: the store's own, or one built over its table
+TrigramIndex* pack_trigram_index(Pack *pack) {
+    if (pack->store) return block_store_trigram_index(pack->store);
+    if (!pack->table) return NULL;
+    if (pack->trigrams) return pack->trigrams;
+
+    TrigramBuilder builder;
+    trigram_builder_init(&builder);
+    int ok = 1;
+    for (int i = 0; ok && i < pack->table->size; i++) {
+        for (HashNode *node = pack->table->table[i]; ok && node; node = node->next) {
+            ok = trigram_builder_add(&builder, node->key);
+        }
+    }
+    if (ok) pack->trigrams = trigram_builder_build(&builder);
+    trigram_builder_free(&builder);
+    return pack->trigrams;
+}
+
+// Sound-alike index of an open pack's terms, over pack_trigram_index()'s ids
+PhoneticIndex* pack_phonetic_index(Pack *pack) {
+    if (pack->store) return block_store_phonetic_index(pack->store);
+    if (!pack->phonetics) pack->phonetics = phonetic_index_build(pack_trigram_index(pack));
+    return pack->phonetics;
+}
+
+// Selected pack names, comma-separated
+void pack_set_describe(const PackSet *set, char *buf, size_t size) {
+    size_t len = 0;
+    buf[0] = '\0';
+    for (int i = 0; i < set->count && len < size; i++) {
+        len += (size_t)snprintf(buf + len, size - len, "%s%s", i ? "," : "", set->packs[i].name);
+    }
+}
+
+void pack_set_close(PackSet *set) {
+    for (int i = 0; i < set->count; i++) {
+        Pack *pack = &set->packs[i];
+        block_store_close(pack->store);
+        if (pack->table) free_hash_table(pack->table);
+        bloom_free(&pack->filter);
+        trigram_index_free(pack->trigrams);
+        phonetic_index_free(pack->phonetics);
+    }
+    set->count = 0;
+}
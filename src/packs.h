@@ -0,0 +1,52 @@
+#ifndef PACKS_H
+#define PACKS_H
+
+#include <limits.h>
+#include "hash_table.h"
+#include "block_store.h"
+#include "bloom.h"
+#include "trigram.h"
+#include "phonetic.h"
+
+// Optional extra dictionaries under ~/.wtf/res/packs/<name>/, each holding a
+// definitions.wtfb (or definitions.txt) and its own sync.meta. Nothing in a
+// pack is read until a lookup reaches it, and a .wtfb pack whose filter
+// rejects the term costs one header read and one mapped page.
+#define PACKS_DIR "packs"
+#define PACK_NAME_MAX 64
+#define PACK_MAX 32
+
+typedef enum {
+    PACK_UNOPENED,
+    PACK_OPEN,
+    PACK_FAILED
+} PackState;
+
+typedef struct {
+    char name[PACK_NAME_MAX];
+    char dir[PATH_MAX];
+    PackState state;
+    BlockStore *store;     // definitions.wtfb
+    HashTable *table;      // definitions.txt when there is no .wtfb
+    BloomFilter filter;    // over table
+    TrigramIndex *trigrams;  // over table, built by the first find
+    PhoneticIndex *phonetics;  // over trigrams, built by the first sound-alike search
+    uint64_t lookups;
+    uint64_t skipped;      // lookups the filter answered without touching the pack
+} Pack;
+
+typedef struct {
+    Pack packs[PACK_MAX];
+    int count;
+} PackSet;
+
+int pack_name_valid(const char *name);
+int pack_set_open(PackSet *set, const char *packs_dir, const char *selection, char *bad_name, size_t bad_len);
+int pack_set_lookup_view(PackSet *set, const char *term, LookupResult *out);
+int pack_open(Pack *pack);
+TrigramIndex* pack_trigram_index(Pack *pack);
+PhoneticIndex* pack_phonetic_index(Pack *pack);
+void pack_set_describe(const PackSet *set, char *buf, size_t size);
+void pack_set_close(PackSet *set);
+
+#endif
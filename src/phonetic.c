@@ -0,0 +1,374 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "phonetic.h"
+#include "casefold.h"
+#include "stats.h"
+#include "sync_lock.h"
+
+#define PHONETIC_WORD_MAX 256   // letters of a term that can reach its key
+
+// A key being written: sounds from the top byte down
+typedef struct {
+    uint64_t key;
+    int len;
+    char last;     // previous sound, 0 after a vowel so "bob" keeps both b's
+} KeyBuf;
+
+static void emit(KeyBuf *k, char sound) {
+    if (sound == k->last || k->len >= PHONETIC_KEY_MAX) return;
+    k->key |= (uint64_t)(unsigned char)sound << (8 * (PHONETIC_KEY_MAX - 1 - k->len));
+    k->len++;
+    k->last = sound;
+}
+
+// The same sound in both keys, or one each where the spelling reads two ways
+static void emit2(KeyBuf k[2], char primary, char alternate) {
+    emit(&k[0], primary);
+    emit(&k[1], alternate);
+}
+
+// Sets of lower-case letters, one bit per letter
+#define VOWELS ((1u << ('a' - 'a')) | (1u << ('e' - 'a')) | (1u << ('i' - 'a')) | \
+                (1u << ('o' - 'a')) | (1u << ('u' - 'a')) | (1u << ('y' - 'a')))
+#define SOFTENERS ((1u << ('e' - 'a')) | (1u << ('i' - 'a')) | (1u << ('y' - 'a')))
+
+static int in_set(char c, uint32_t set) {
+    return c >= 'a' && c <= 'z' && (set >> (c - 'a')) & 1;
+}
+
+static int is_vowel(char c) {
+    return in_set(c, VOWELS);
+}
+
+// e, i and y soften a c or g before them
+static int is_soft(char c) {
+    return in_set(c, SOFTENERS);
+}
+
+// The ASCII letters and digits of the folded term; separators and anything
+// else drop out, so "node js" and "NodeJS" read alike. ASCII is folded here;
+// from the first other byte on, casefold() takes over (U+212A KELVIN SIGN
+// folds to 'k').
+static size_t spelling(const char *term, char *out) {
+    size_t n = 0;
+    const char *p = term;
+    for (; *p && !((unsigned char)*p & 0x80) && n < PHONETIC_WORD_MAX; p++) {
+        char c = *p >= 'A' && *p <= 'Z' ? (char)(*p - 'A' + 'a') : *p;
+        if ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9')) out[n++] = c;
+    }
+    if (*p && n < PHONETIC_WORD_MAX) {
+        char folded[CASEFOLD_SIZE(PHONETIC_WORD_MAX)];
+        casefold(p, folded, sizeof(folded));
+        for (const char *f = folded; *f && n < PHONETIC_WORD_MAX; f++) {
+            if ((*f >= 'a' && *f <= 'z') || (*f >= '0' && *f <= '9')) out[n++] = *f;
+        }
+    }
+    memset(out + n, 0, 4);   // room to look a few letters past the end
+    return n;
+}
+
+// Primary key and, when some spelling reads two ways, an alternate one.
+// Returns how many keys were written: 0 for a term with no letters or digits.
+int phonetic_keys(const char *term, uint64_t keys[2]) {
+    char w[PHONETIC_WORD_MAX + 4];
+    size_t n = spelling(term, w);
+    KeyBuf k[2] = {{0, 0, 0}, {0, 0, 0}};
+
+    size_t i = 0;
+    // Silent first letters
+    if (n >= 2 && ((w[0] == 'k' && w[1] == 'n') || (w[0] == 'g' && w[1] == 'n') ||
+                   (w[0] == 'p' && w[1] == 'n') || (w[0] == 'w' && w[1] == 'r'))) {
+        i = 1;
+    }
+    for (; i < n && k[0].len < PHONETIC_KEY_MAX; i++) {
+        char c = w[i], next = w[i + 1], prev = i > 0 ? w[i - 1] : '\0';
+        if (is_vowel(c)) {
+            if (i == 0) emit2(k, 'A', 'A');
+            k[0].last = k[1].last = '\0';
+            continue;
+        }
+        switch (c) {
+            case 'b':
+                if (!(prev == 'm' && next == '\0')) emit2(k, 'B', 'B');
+                break;
+            case 'c':
+                if (next == 'i' && w[i + 2] == 'a') {
+                    emit2(k, 'X', 'X');
+                } else if (next == 'h') {
+                    if (prev == 's') {
+                        emit2(k, 'K', 'K');
+                    } else {
+                        emit2(k, 'X', 'K');
+                    }
+                    i++;
+                } else if (is_soft(next)) {
+                    emit2(k, 'S', 'S');
+                } else {
+                    emit2(k, 'K', 'K');
+                    if (next == 'k' || next == 'q') i++;
+                }
+                break;
+            case 'd':
+                if (next == 'g' && is_soft(w[i + 2])) {
+                    emit2(k, 'J', 'J');
+                    i++;
+                } else {
+                    emit2(k, 'T', 'T');
+                }
+                break;
+            case 'f':
+            case 'v':
+                emit2(k, 'F', 'F');
+                break;
+            case 'g':
+                if (next == 'h') {
+                    // "gh" is silent unless a vowel follows ("ghost", not "night")
+                    if (i == 0 || is_vowel(w[i + 2])) emit2(k, 'K', 'K');
+                    i++;
+                } else if (next == 'n' && (w[i + 2] == '\0' || (w[i + 2] == 'e' && w[i + 3] == 'd' && w[i + 4] == '\0'))) {
+                    // "sign", "signed"
+                } else if (is_soft(next)) {
+                    emit2(k, 'J', 'K');
+                } else {
+                    emit2(k, 'K', 'K');
+                    if (next == 'g') i++;
+                }
+                break;
+            case 'h':
+                if (is_vowel(next) && !(prev != '\0' && strchr("cgpstw", prev))) emit2(k, 'H', 'H');
+                break;
+            case 'j':
+                emit2(k, 'J', 'J');
+                break;
+            case 'k':
+            case 'q':
+                emit2(k, 'K', 'K');
+                break;
+            case 'p':
+                if (next == 'h') {
+                    emit2(k, 'F', 'F');
+                    i++;
+                } else {
+                    emit2(k, 'P', 'P');
+                }
+                break;
+            case 's':
+                if (next == 'h') {
+                    emit2(k, 'X', 'X');
+                    i++;
+                } else if (next == 'i' && (w[i + 2] == 'o' || w[i + 2] == 'a')) {
+                    emit2(k, 'X', 'X');
+                } else {
+                    emit2(k, 'S', 'S');
+                }
+                break;
+            case 't':
+                if (next == 'i' && (w[i + 2] == 'o' || w[i + 2] == 'a')) {
+                    emit2(k, 'X', 'X');
+                } else if (next == 'h') {
+                    emit2(k, '0', '0');
+                    i++;
+                } else if (!(next == 'c' && w[i + 2] == 'h')) {
+                    emit2(k, 'T', 'T');
+                }
+                break;
+            case 'w':
+                if (next == 'h') {
+                    emit2(k, 'W', 'W');
+                    i++;
+                } else if (is_vowel(next)) {
+                    emit2(k, 'W', 'W');
+                }
+                break;
+            case 'x':
+                if (i == 0) {
+                    emit2(k, 'S', 'S');
+                } else {
+                    emit2(k, 'K', 'K');
+                    emit2(k, 'S', 'S');
+                }
+                break;
+            case 'z':
+                emit2(k, 'S', 'S');
+                break;
+            default:
+                // l, m, n, r and digits sound as written
+                emit2(k, (char)(c >= 'a' ? c - 'a' + 'A' : c), (char)(c >= 'a' ? c - 'a' + 'A' : c));
+                break;
+        }
+    }
+
+    if (k[0].len == 0) return 0;
+    keys[0] = k[0].key;
+    keys[1] = k[1].key;
+    return k[1].key != k[0].key ? 2 : 1;
+}
+
+// Point the section pointers into data; 0 if the sizes do not add up
+static int attach(PhoneticIndex *index, void *data, size_t size) {
+    const unsigned char *base = data;
+    if (size < PHONETIC_HEADER_SIZE || memcmp(base, PHONETIC_MAGIC, 4) != 0) return 0;
+    const uint32_t *header = (const uint32_t *)base;
+    if (header[1] != PHONETIC_VERSION) return 0;
+
+    uint64_t terms = header[2], keys = header[3], postings = header[4];
+    uint64_t need = PHONETIC_HEADER_SIZE + 8 * keys + 4 * ((keys + 1) + postings);
+    if (need != size) return 0;
+
+    index->term_count = (uint32_t)terms;
+    index->key_count = (uint32_t)keys;
+    index->posting_count = (uint32_t)postings;
+    index->keys = (const uint64_t *)(base + PHONETIC_HEADER_SIZE);
+    index->post_offsets = (const uint32_t *)(index->keys + keys);
+    index->postings = index->post_offsets + keys + 1;
+    if (index->post_offsets[keys] != postings) return 0;
+    for (uint64_t i = 0; i < postings; i++) {
+        if (index->postings[i] >= terms) return 0;
+    }
+    index->data = data;
+    index->size = size;
+    return 1;
+}
+
+typedef struct {
+    uint64_t key;
+    uint32_t id;
+} KeyedTerm;
+
+static int compare_keyed(const void *a, const void *b) {
+    const KeyedTerm *x = a, *y = b;
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return (x->id > y->id) - (x->id < y->id);
+}
+
+// Key every term of a trigram index; ids in the result are that index's
+PhoneticIndex* phonetic_index_build(const TrigramIndex *terms) {
+    if (!terms) return NULL;
+    STATS_BEGIN(started);
+    KeyedTerm *pairs = wtf_malloc(((size_t)terms->term_count * 2 + 1) * sizeof(KeyedTerm));
+    if (!pairs) {
+        STATS_END(STAT_PHONETIC_BUILD, started);
+        return NULL;
+    }
+    size_t n = 0;
+    for (uint32_t id = 0; id < terms->term_count; id++) {
+        SYNC_LOCK_PULSE(id);
+        uint64_t keys[2];
+        int count = phonetic_keys(trigram_index_term(terms, id), keys);
+        for (int k = 0; k < count; k++) pairs[n++] = (KeyedTerm){keys[k], id};
+    }
+    qsort(pairs, n, sizeof(KeyedTerm), compare_keyed);
+
+    size_t key_count = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || pairs[i].key != pairs[i - 1].key) key_count++;
+    }
+    size_t size = PHONETIC_HEADER_SIZE + 8 * key_count + 4 * ((key_count + 1) + n);
+    unsigned char *data = wtf_calloc(1, size);
+    PhoneticIndex *index = wtf_calloc(1, sizeof(PhoneticIndex));
+    if (!data || !index || size > UINT32_MAX) {
+        wtf_free(data);
+        wtf_free(index);
+        wtf_free(pairs);
+        STATS_END(STAT_PHONETIC_BUILD, started);
+        return NULL;
+    }
+
+    uint32_t *header = (uint32_t *)data;
+    memcpy(data, PHONETIC_MAGIC, 4);
+    header[1] = PHONETIC_VERSION;
+    header[2] = terms->term_count;
+    header[3] = (uint32_t)key_count;
+    header[4] = (uint32_t)n;
+
+    uint64_t *keys = (uint64_t *)(data + PHONETIC_HEADER_SIZE);
+    uint32_t *post_offsets = (uint32_t *)(keys + key_count);
+    uint32_t *postings = post_offsets + key_count + 1;
+    size_t k = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || pairs[i].key != pairs[i - 1].key) {
+            keys[k] = pairs[i].key;
+            post_offsets[k] = (uint32_t)i;
+            k++;
+        }
+        postings[i] = pairs[i].id;
+    }
+    post_offsets[key_count] = (uint32_t)n;
+    wtf_free(pairs);
+
+    attach(index, data, size);
+    STATS_END(STAT_PHONETIC_BUILD, started);
+    return index;
+}
+
+// Map a definitions.wtfp. Returns NULL if it is missing, malformed or was not
+// built over terms (its term count disagrees).
+PhoneticIndex* phonetic_index_open(const char *path, const TrigramIndex *terms) {
+    if (!terms) return NULL;
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < PHONETIC_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    PhoneticIndex *index = wtf_calloc(1, sizeof(PhoneticIndex));
+    if (!index || !attach(index, map, (size_t)st.st_size) || index->term_count != terms->term_count) {
+        wtf_free(index);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    index->mapped = 1;
+    return index;
+}
+
+// Write via a per-process temporary file so readers never map a partial index
+int phonetic_index_write(const PhoneticIndex *index, const char *path) {
+    char tmp_path[4096];
+    if ((size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid()) >= sizeof(tmp_path)) return 0;
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return 0;
+    int ok = fwrite(index->data, 1, index->size, f) == index->size;
+    if (fclose(f) != 0) ok = 0;
+    if (ok && rename(tmp_path, path) != 0) ok = 0;
+    if (!ok) remove(tmp_path);
+    return ok;
+}
+
+void phonetic_index_free(PhoneticIndex *index) {
+    if (!index) return;
+    if (index->mapped) {
+        munmap(index->data, index->size);
+    } else {
+        wtf_free(index->data);
+    }
+    wtf_free(index);
+}
+
+// Points ids at the ascending term ids filed under key; returns how many
+uint32_t phonetic_index_lookup(const PhoneticIndex *index, uint64_t key, const uint32_t **ids) {
+    long lo = 0, hi = (long)index->key_count - 1;
+    while (lo <= hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (index->keys[mid] == key) {
+            *ids = index->postings + index->post_offsets[mid];
+            return index->post_offsets[mid + 1] - index->post_offsets[mid];
+        }
+        if (index->keys[mid] < key) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    *ids = NULL;
+    return 0;
+}
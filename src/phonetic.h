@@ -0,0 +1,49 @@
+#ifndef PHONETIC_H
+#define PHONETIC_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include "trigram.h"
+
+// Sound-alike lookup for `wtf is --sounds-like` and the suggestions after a
+// miss: "nginks" finds nginx, "kubernetees" finds kubernetes. Each term's
+// folded form (casefold.h) is reduced to a Metaphone-style key: consonant
+// sounds only, with a leading vowel kept as 'A', digits kept, runs of one
+// sound collapsed and at most PHONETIC_KEY_MAX sounds. Spellings English
+// reads two ways ("gi", "ch") also get an alternate key, as in Double
+// Metaphone. Bytes outside ASCII are skipped.
+//
+// The index maps keys to the ids of a trigram index (trigram.h), so it only
+// means something next to the one it was built from. definitions.wtfp sits
+// next to each definitions.wtft and holds the same bytes an in-memory index
+// uses (integers in host order, 8-byte aligned):
+//   header   "WTFP" | u32 version | u32 terms | u32 keys | u32 postings | u32 0 | u64 0
+//   u64 keys[keys]                sorted, one sound per byte from the top
+//   u32 post_offsets[keys + 1]    into postings
+//   u32 postings[postings]        ascending term ids
+#define PHONETIC_MAGIC "WTFP"
+#define PHONETIC_VERSION 1
+#define PHONETIC_HEADER_SIZE 32
+#define PHONETIC_KEY_MAX 8
+
+typedef struct {
+    uint32_t term_count;   // of the trigram index the ids belong to
+    uint32_t key_count;
+    uint32_t posting_count;
+    const uint64_t *keys;
+    const uint32_t *post_offsets;
+    const uint32_t *postings;
+    void *data;            // the whole index, mmap()ed or allocated
+    size_t size;
+    int mapped;
+} PhoneticIndex;
+
+int phonetic_keys(const char *term, uint64_t keys[2]);
+
+PhoneticIndex* phonetic_index_build(const TrigramIndex *terms);
+PhoneticIndex* phonetic_index_open(const char *path, const TrigramIndex *terms);
+int phonetic_index_write(const PhoneticIndex *index, const char *path);
+void phonetic_index_free(PhoneticIndex *index);
+uint32_t phonetic_index_lookup(const PhoneticIndex *index, uint64_t key, const uint32_t **ids);
+
+#endif
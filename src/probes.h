@@ -0,0 +1,37 @@
+#ifndef WTF_PROBES_H
+#define WTF_PROBES_H
+
+// USDT probes (provider "wtf") for bpftrace and perf, see tools/*.bt. Each is
+// a nop until a tracer attaches. They need <sys/sdt.h> (systemtap-sdt-dev);
+// without it, or with -DWTF_NO_PROBES, they compile to nothing.
+//
+//   load__start(path)                  load__done(path, entries, ok)
+//   dict_lookup__start(term)           dict_lookup__done(term, matches)
+//   lookup__start(term)                lookup__done(term, matches)       hash table only
+//   removed__start(term)               removed__done(term, removed)
+//   render__start(kind)                render__done(kind, shown)         kind: "is", "find", ...
+//   check_updates__start(dir)          check_updates__done(dir, status)  SyncStatus
+//   sync__start(dir, force)            sync__done(dir, ok, bytes, entries)
+//   inflate__start(bytes_in)           inflate__done(bytes_in, bytes_out, ok)  any Content-Encoding
+//   download__done(received, resumed_from, retransferred)             bytes
+#if !defined(WTF_NO_PROBES) && defined(__has_include)
+#if __has_include(<sys/sdt.h>)
+#include <sys/sdt.h>
+#define WTF_PROBES 1
+#endif
+#endif
+
+#ifdef WTF_PROBES
+#define WTF_PROBE1(name, a) DTRACE_PROBE1(wtf, name, a)
+#define WTF_PROBE2(name, a, b) DTRACE_PROBE2(wtf, name, a, b)
+#define WTF_PROBE3(name, a, b, c) DTRACE_PROBE3(wtf, name, a, b, c)
+#define WTF_PROBE4(name, a, b, c, d) DTRACE_PROBE4(wtf, name, a, b, c, d)
+#else
+// Arguments are still evaluated (they are plain values) so nothing goes unused
+#define WTF_PROBE1(name, a) do { (void)(a); } while (0)
+#define WTF_PROBE2(name, a, b) do { (void)(a); (void)(b); } while (0)
+#define WTF_PROBE3(name, a, b, c) do { (void)(a); (void)(b); (void)(c); } while (0)
+#define WTF_PROBE4(name, a, b, c, d) do { (void)(a); (void)(b); (void)(c); (void)(d); } while (0)
+#endif
+
+#endif
@@ -0,0 +1,189 @@
+#include <stdio.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include "sha1.h"
+
+#if defined(__SHA__) && defined(__SSE4_1__)
+#include <immintrin.h>
+
+// Four rounds of group g (0..19), with the message schedule for the groups
+// ahead worked in between as the instructions expect
+#define SHA1_GROUP(g, f, e_in, e_out) do {                                        \
+    __m128i cur = msg[(g) % 4];                                                   \
+    e_in = (g) == 0 ? _mm_add_epi32(e_in, cur) : _mm_sha1nexte_epu32(e_in, cur);  \
+    e_out = abcd;                                                                 \
+    if ((g) >= 3 && (g) <= 18) msg[((g) + 1) % 4] = _mm_sha1msg2_epu32(msg[((g) + 1) % 4], cur); \
+    abcd = _mm_sha1rnds4_epu32(abcd, e_in, f);                                    \
+    if ((g) >= 1 && (g) <= 16) msg[((g) + 3) % 4] = _mm_sha1msg1_epu32(msg[((g) + 3) % 4], cur); \
+    if ((g) >= 2 && (g) <= 17) msg[((g) + 2) % 4] = _mm_xor_si128(msg[((g) + 2) % 4], cur);       \
+} while (0)
+
+static void sha1_blocks(uint32_t state[5], const unsigned char *data, size_t blocks) {
+    const __m128i byte_swap = _mm_set_epi64x(0x0001020304050607ULL, 0x08090a0b0c0d0e0fULL);
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1b);
+    __m128i e0 = _mm_set_epi32((int)state[4], 0, 0, 0), e1;
+
+    for (; blocks > 0; blocks--, data += 64) {
+        __m128i abcd_saved = abcd, e0_saved = e0;
+        __m128i msg[4];
+        for (int i = 0; i < 4; i++) {
+            msg[i] = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(data + 16 * i)), byte_swap);
+        }
+        SHA1_GROUP(0, 0, e0, e1);   SHA1_GROUP(1, 0, e1, e0);
+        SHA1_GROUP(2, 0, e0, e1);   SHA1_GROUP(3, 0, e1, e0);
+        SHA1_GROUP(4, 0, e0, e1);   SHA1_GROUP(5, 1, e1, e0);
+        SHA1_GROUP(6, 1, e0, e1);   SHA1_GROUP(7, 1, e1, e0);
+        SHA1_GROUP(8, 1, e0, e1);   SHA1_GROUP(9, 1, e1, e0);
+        SHA1_GROUP(10, 2, e0, e1);  SHA1_GROUP(11, 2, e1, e0);
+        SHA1_GROUP(12, 2, e0, e1);  SHA1_GROUP(13, 2, e1, e0);
+        SHA1_GROUP(14, 2, e0, e1);  SHA1_GROUP(15, 3, e1, e0);
+        SHA1_GROUP(16, 3, e0, e1);  SHA1_GROUP(17, 3, e1, e0);
+        SHA1_GROUP(18, 3, e0, e1);  SHA1_GROUP(19, 3, e1, e0);
+        e0 = _mm_sha1nexte_epu32(e0, e0_saved);
+        abcd = _mm_add_epi32(abcd, abcd_saved);
+    }
+
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1b));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+#else
+#define ROL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+static void sha1_blocks(uint32_t state[5], const unsigned char *data, size_t blocks) {
+    for (; blocks > 0; blocks--, data += 64) {
+        uint32_t w[80];
+        for (int i = 0; i < 16; i++) {
+            w[i] = (uint32_t)data[4 * i] << 24 | (uint32_t)data[4 * i + 1] << 16 |
+                   (uint32_t)data[4 * i + 2] << 8 | (uint32_t)data[4 * i + 3];
+        }
+        for (int i = 16; i < 80; i++) w[i] = ROL(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+
+        // One loop per round function, so no round branches on i
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+#define SHA1_ROUND(f, k, i) do {                                  \
+        uint32_t t = ROL(a, 5) + (f) + e + (k) + w[i];            \
+        e = d;                                                    \
+        d = c;                                                    \
+        c = ROL(b, 30);                                           \
+        b = a;                                                    \
+        a = t;                                                    \
+    } while (0)
+        for (int i = 0; i < 20; i++) SHA1_ROUND(d ^ (b & (c ^ d)), 0x5a827999, i);
+        for (int i = 20; i < 40; i++) SHA1_ROUND(b ^ c ^ d, 0x6ed9eba1, i);
+        for (int i = 40; i < 60; i++) SHA1_ROUND((b & c) | (d & (b | c)), 0x8f1bbcdc, i);
+        for (int i = 60; i < 80; i++) SHA1_ROUND(b ^ c ^ d, 0xca62c1d6, i);
+#undef SHA1_ROUND
+        state[0] += a;
+        state[1] += b;
+        state[2] += c;
+        state[3] += d;
+        state[4] += e;
+    }
+}
+#endif
+
+void sha1_init(Sha1 *ctx) {
+    static const uint32_t initial[5] = {0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0};
+    memcpy(ctx->state, initial, sizeof(initial));
+    ctx->length = 0;
+    ctx->buffered = 0;
+}
+
+void sha1_update(Sha1 *ctx, const void *data, size_t len) {
+    const unsigned char *p = data;
+    ctx->length += len;
+    if (ctx->buffered > 0) {
+        size_t take = 64 - ctx->buffered < len ? 64 - ctx->buffered : len;
+        memcpy(ctx->buffer + ctx->buffered, p, take);
+        ctx->buffered += take;
+        p += take;
+        len -= take;
+        if (ctx->buffered < 64) return;
+        sha1_blocks(ctx->state, ctx->buffer, 1);
+        ctx->buffered = 0;
+    }
+    // Whole blocks straight from the caller's buffer
+    sha1_blocks(ctx->state, p, len / 64);
+    p += len / 64 * 64;
+    len %= 64;
+    memcpy(ctx->buffer, p, len);
+    ctx->buffered = len;
+}
+
+void sha1_final(Sha1 *ctx, unsigned char digest[SHA1_DIGEST_SIZE]) {
+    uint64_t bits = ctx->length * 8;
+    unsigned char pad[72] = {0x80};
+    size_t pad_len = (ctx->buffered < 56 ? 56 : 120) - ctx->buffered;
+    for (int i = 0; i < 8; i++) pad[pad_len + i] = (unsigned char)(bits >> (56 - 8 * i));
+    sha1_update(ctx, pad, pad_len + 8);
+    for (int i = 0; i < 5; i++) {
+        digest[4 * i] = (unsigned char)(ctx->state[i] >> 24);
+        digest[4 * i + 1] = (unsigned char)(ctx->state[i] >> 16);
+        digest[4 * i + 2] = (unsigned char)(ctx->state[i] >> 8);
+        digest[4 * i + 3] = (unsigned char)ctx->state[i];
+    }
+}
+
+void sha1_hex(const unsigned char digest[SHA1_DIGEST_SIZE], char hex[SHA1_HEX_SIZE]) {
+    static const char digits[] = "0123456789abcdef";
+    for (int i = 0; i < SHA1_DIGEST_SIZE; i++) {
+        hex[2 * i] = digits[digest[i] >> 4];
+        hex[2 * i + 1] = digits[digest[i] & 15];
+    }
+    hex[SHA1_HEX_SIZE - 1] = '\0';
+}
+
+static int hex_digit(char c) {
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// Returns 0 unless hex starts with 40 hex digits
+int sha1_parse_hex(const char *hex, unsigned char digest[SHA1_DIGEST_SIZE]) {
+    for (int i = 0; i < SHA1_DIGEST_SIZE; i++) {
+        int hi = hex_digit(hex[2 * i]);
+        int lo = hi < 0 ? -1 : hex_digit(hex[2 * i + 1]);
+        if (lo < 0) return 0;
+        digest[i] = (unsigned char)(hi << 4 | lo);
+    }
+    return 1;
+}
+
+void git_blob_sha1_begin(Sha1 *ctx, uint64_t size) {
+    char header[32];
+    int len = snprintf(header, sizeof(header), "blob %llu", (unsigned long long)size);
+    sha1_init(ctx);
+    sha1_update(ctx, header, (size_t)len + 1);   // the terminator is part of the header
+}
+
+// The id git (and the GitHub API) gives path's contents. Returns 0 if it cannot be read.
+int git_blob_sha1_file(const char *path, char hex[SHA1_HEX_SIZE]) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return 0;
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return 0;
+    }
+
+    Sha1 ctx;
+    git_blob_sha1_begin(&ctx, (uint64_t)st.st_size);
+    unsigned char buf[128 * 1024];
+    uint64_t total = 0;
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        sha1_update(&ctx, buf, (size_t)n);
+        total += (uint64_t)n;
+    }
+    close(fd);
+    if (n < 0 || total != (uint64_t)st.st_size) return 0;
+
+    unsigned char digest[SHA1_DIGEST_SIZE];
+    sha1_final(&ctx, digest);
+    sha1_hex(digest, hex);
+    return 1;
+}
@@ -0,0 +1,30 @@
+#ifndef SHA1_H
+#define SHA1_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Streaming SHA-1, for checking the dictionary against the git blob id the
+// GitHub API reports. Builds with SHA extensions (e.g. -march=native on a CPU
+// that has them) use the SHA-NI instructions.
+#define SHA1_DIGEST_SIZE 20
+#define SHA1_HEX_SIZE 41
+
+typedef struct {
+    uint32_t state[5];
+    uint64_t length;            // bytes hashed so far
+    unsigned char buffer[64];   // partial block
+    size_t buffered;
+} Sha1;
+
+void sha1_init(Sha1 *ctx);
+void sha1_update(Sha1 *ctx, const void *data, size_t len);
+void sha1_final(Sha1 *ctx, unsigned char digest[SHA1_DIGEST_SIZE]);
+void sha1_hex(const unsigned char digest[SHA1_DIGEST_SIZE], char hex[SHA1_HEX_SIZE]);
+int sha1_parse_hex(const char *hex, unsigned char digest[SHA1_DIGEST_SIZE]);
+
+// A git blob id hashes "blob <size>\0" and then the content
+void git_blob_sha1_begin(Sha1 *ctx, uint64_t size);
+int git_blob_sha1_file(const char *path, char hex[SHA1_HEX_SIZE]);
+
+#endif
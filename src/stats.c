@@ -0,0 +1,218 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "stats.h"
+#include "colors.h"
+#include "bloom.h"
+
+int wtf_stats_enabled = 0;
+
+static const char *phase_names[STAT_PHASE_COUNT] = {
+    "home_dir",
+    "load_main",
+    "load_added",
+    "load_removed",
+    "load_definitions",
+    "hash_table_lookup_all",
+    "render",
+    "sync_check",
+    "net_probe",
+    "net_check_updates",
+    "net_download",
+    "net_decompress",
+    "net_write",
+    "net_reload",
+    "block_read",
+    "bloom_build",
+    "hot_cache",
+    "trigram_build",
+    "trigram_search",
+    "phonetic_build",
+    "store_write",
+    "stream_scan"
+};
+
+typedef struct {
+    uint64_t count;
+    uint64_t total_ns;
+} PhaseTotals;
+
+static PhaseTotals phases[STAT_PHASE_COUNT];
+static uint64_t start_ns;
+static int print_summary;
+static const char *trace_file;
+
+static uint64_t alloc_count;
+static uint64_t alloc_bytes;
+static uint64_t free_count;
+static uint64_t live_bytes;
+static uint64_t peak_bytes;
+
+static uint64_t read_count;
+static uint64_t read_bytes;
+
+static int bloom_filters;
+static double bloom_estimated;    // worst estimate among the loaded filters
+static uint64_t bloom_bytes;
+static uint64_t bloom_checks;
+static uint64_t bloom_rejects;
+static uint64_t bloom_false_positives;
+
+static uint64_t cache_hits;
+static uint64_t cache_misses;
+
+uint64_t stats_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+// Enable instrumentation. Summary goes to stderr and/or a JSON line appended to trace_path.
+void stats_init(int summary, const char *trace_path) {
+    print_summary = summary;
+    trace_file = (trace_path && *trace_path) ? trace_path : NULL;
+    wtf_stats_enabled = print_summary || trace_file;
+    if (wtf_stats_enabled) {
+        start_ns = stats_clock_ns();
+    }
+}
+
+void stats_record(StatPhase phase, uint64_t begin_ns) {
+    phases[phase].count++;
+    phases[phase].total_ns += stats_clock_ns() - begin_ns;
+}
+
+void stats_note_alloc(size_t size) {
+    alloc_count++;
+    alloc_bytes += size;
+    live_bytes += size;
+    if (live_bytes > peak_bytes) peak_bytes = live_bytes;
+}
+
+void stats_note_free(size_t size) {
+    free_count++;
+    live_bytes = live_bytes > size ? live_bytes - size : 0;
+}
+
+// Bytes pulled from disk by the block store (header, index and blocks)
+void stats_note_read(size_t size) {
+    read_count++;
+    read_bytes += size;
+}
+
+// A Bloom filter in front of a lookup layer, with its expected false-positive rate
+void stats_note_bloom_filter(double estimated_fpr, size_t bytes) {
+    bloom_filters++;
+    if (estimated_fpr > bloom_estimated) bloom_estimated = estimated_fpr;
+    bloom_bytes += bytes;
+}
+
+void stats_note_bloom_check(int maybe_present) {
+    bloom_checks++;
+    if (!maybe_present) bloom_rejects++;
+}
+
+// The filter let a term through but the layer behind it had nothing
+void stats_note_bloom_false_positive(void) {
+    bloom_false_positives++;
+}
+
+// One probe of the hot answer cache
+void stats_note_cache(int hit) {
+    if (hit) {
+        cache_hits++;
+    } else {
+        cache_misses++;
+    }
+}
+
+// False positives over every check for an absent term
+static double bloom_observed_fpr(void) {
+    uint64_t negatives = bloom_rejects + bloom_false_positives;
+    return negatives ? (double)bloom_false_positives / (double)negatives : 0.0;
+}
+
+static void print_stats_summary(const char *command, uint64_t total_ns) {
+    fflush(stdout);  // keep the summary after the command's own output
+    fprintf(stderr, "\n%s╭─ Stats for '%s%s%s'%s\n", COLOR_PRIMARY, COLOR_YELLOW, command, COLOR_PRIMARY, COLOR_RESET);
+    fprintf(stderr, "%s│%s\n", COLOR_PRIMARY, COLOR_RESET);
+    for (int i = 0; i < STAT_PHASE_COUNT; i++) {
+        if (phases[i].count == 0) continue;
+        fprintf(stderr, "%s├─%s %-22s %s%4llu×%s %10.3f ms\n",
+                COLOR_PRIMARY, COLOR_RESET, phase_names[i],
+                COLOR_DIM, (unsigned long long)phases[i].count, COLOR_RESET,
+                phases[i].total_ns / 1e6);
+    }
+    fprintf(stderr, "%s├─%s allocations %s%llu%s (%.1f KB), frees %s%llu%s, peak %.1f KB\n",
+            COLOR_PRIMARY, COLOR_RESET,
+            COLOR_YELLOW, (unsigned long long)alloc_count, COLOR_RESET, alloc_bytes / 1024.0,
+            COLOR_YELLOW, (unsigned long long)free_count, COLOR_RESET, peak_bytes / 1024.0);
+    if (read_count > 0) {
+        fprintf(stderr, "%s├─%s disk reads %s%llu%s (%.1f KB)\n",
+                COLOR_PRIMARY, COLOR_RESET,
+                COLOR_YELLOW, (unsigned long long)read_count, COLOR_RESET, read_bytes / 1024.0);
+    }
+    if (bloom_filters > 0) {
+        fprintf(stderr, "%s├─%s bloom %s%d%s filter(s), %.1f KB, target fpr %.3f%%, estimated %.3f%%\n",
+                COLOR_PRIMARY, COLOR_RESET, COLOR_YELLOW, bloom_filters, COLOR_RESET,
+                bloom_bytes / 1024.0, bloom_target_fpr() * 100.0, bloom_estimated * 100.0);
+        fprintf(stderr, "%s├─%s bloom checks %s%llu%s, rejected %s%llu%s, false positives %s%llu%s (observed %.3f%%)\n",
+                COLOR_PRIMARY, COLOR_RESET,
+                COLOR_YELLOW, (unsigned long long)bloom_checks, COLOR_RESET,
+                COLOR_YELLOW, (unsigned long long)bloom_rejects, COLOR_RESET,
+                COLOR_YELLOW, (unsigned long long)bloom_false_positives, COLOR_RESET,
+                bloom_observed_fpr() * 100.0);
+    }
+    if (cache_hits + cache_misses > 0) {
+        fprintf(stderr, "%s├─%s hot cache %s%s%s\n", COLOR_PRIMARY, COLOR_RESET,
+                COLOR_YELLOW, cache_hits ? "hit" : "miss", COLOR_RESET);
+    }
+    fprintf(stderr, "%s╰─%s total %.3f ms\n\n", COLOR_PRIMARY, COLOR_RESET, total_ns / 1e6);
+}
+
+static void append_trace(const char *command, int exit_code, uint64_t total_ns) {
+    FILE *f = fopen(trace_file, "a");
+    if (!f) return;
+
+    fprintf(f, "{\"ts\":%ld,\"command\":\"", (long)time(NULL));
+    for (const char *c = command; *c; c++) {
+        if (*c == '"' || *c == '\\') fputc('\\', f);
+        if ((unsigned char)*c >= 0x20) fputc(*c, f);
+    }
+    fprintf(f, "\",\"exit\":%d,\"total_ns\":%llu,\"phases\":{", exit_code, (unsigned long long)total_ns);
+    int first = 1;
+    for (int i = 0; i < STAT_PHASE_COUNT; i++) {
+        if (phases[i].count == 0) continue;
+        fprintf(f, "%s\"%s\":{\"count\":%llu,\"ns\":%llu}", first ? "" : ",", phase_names[i],
+                (unsigned long long)phases[i].count, (unsigned long long)phases[i].total_ns);
+        first = 0;
+    }
+    fprintf(f, "},\"alloc\":{\"count\":%llu,\"bytes\":%llu,\"frees\":%llu,\"peak_bytes\":%llu}",
+            (unsigned long long)alloc_count, (unsigned long long)alloc_bytes,
+            (unsigned long long)free_count, (unsigned long long)peak_bytes);
+    fprintf(f, ",\"io\":{\"reads\":%llu,\"bytes\":%llu}",
+            (unsigned long long)read_count, (unsigned long long)read_bytes);
+    fprintf(f, ",\"bloom\":{\"filters\":%d,\"bytes\":%llu,\"target_fpr\":%g,\"estimated_fpr\":%g,"
+               "\"checks\":%llu,\"rejects\":%llu,\"false_positives\":%llu,\"observed_fpr\":%g}",
+            bloom_filters, (unsigned long long)bloom_bytes, bloom_target_fpr(), bloom_estimated,
+            (unsigned long long)bloom_checks, (unsigned long long)bloom_rejects,
+            (unsigned long long)bloom_false_positives, bloom_observed_fpr());
+    fprintf(f, ",\"cache\":{\"hits\":%llu,\"misses\":%llu}}\n",
+            (unsigned long long)cache_hits, (unsigned long long)cache_misses);
+    fclose(f);
+}
+
+// Report everything collected since stats_init()
+void stats_finish(const char *command, int exit_code) {
+    if (!wtf_stats_enabled) return;
+    uint64_t total_ns = stats_clock_ns() - start_ns;
+    if (!command) command = "";
+
+    if (print_summary) {
+        print_stats_summary(command, total_ns);
+    }
+    if (trace_file) {
+        append_trace(command, exit_code, total_ns);
+    }
+}
@@ -0,0 +1,108 @@
+#ifndef WTF_STATS_H
+#define WTF_STATS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+// Phases timed by the opt-in instrumentation (`--stats` / WTF_TRACE)
+typedef enum {
+    STAT_HOME_DIR,
+    STAT_LOAD_MAIN,
+    STAT_LOAD_ADDED,
+    STAT_LOAD_REMOVED,
+    STAT_LOAD_DEFINITIONS,
+    STAT_LOOKUP_ALL,
+    STAT_RENDER,
+    STAT_SYNC_CHECK,
+    STAT_NET_PROBE,
+    STAT_NET_CHECK_UPDATES,
+    STAT_NET_DOWNLOAD,
+    STAT_NET_DECOMPRESS,
+    STAT_NET_WRITE,
+    STAT_NET_RELOAD,
+    STAT_BLOCK_READ,
+    STAT_BLOOM_BUILD,
+    STAT_HOT_CACHE,
+    STAT_TRIGRAM_BUILD,
+    STAT_TRIGRAM_SEARCH,
+    STAT_PHONETIC_BUILD,
+    STAT_STORE_WRITE,
+    STAT_STREAM_SCAN,
+    STAT_PHASE_COUNT
+} StatPhase;
+
+#ifdef WTF_NO_STATS
+// libwtf (make lib) is built without instrumentation: it keeps no counters
+// and prints nothing, and every wtf_stats_enabled check folds away
+#define wtf_stats_enabled 0
+
+static inline void stats_init(int print_summary, const char *trace_path) { (void)print_summary; (void)trace_path; }
+static inline uint64_t stats_clock_ns(void) { return 0; }
+static inline void stats_record(StatPhase phase, uint64_t start_ns) { (void)phase; (void)start_ns; }
+static inline void stats_note_alloc(size_t bytes) { (void)bytes; }
+static inline void stats_note_free(size_t bytes) { (void)bytes; }
+static inline void stats_note_read(size_t bytes) { (void)bytes; }
+static inline void stats_note_bloom_filter(double estimated_fpr, size_t bytes) { (void)estimated_fpr; (void)bytes; }
+static inline void stats_note_bloom_check(int maybe_present) { (void)maybe_present; }
+static inline void stats_note_bloom_false_positive(void) {}
+static inline void stats_note_cache(int hit) { (void)hit; }
+static inline void stats_finish(const char *command, int exit_code) { (void)command; (void)exit_code; }
+#else
+// Checked once per phase boundary; everything else lives behind it
+extern int wtf_stats_enabled;
+
+void stats_init(int print_summary, const char *trace_path);
+uint64_t stats_clock_ns(void);
+void stats_record(StatPhase phase, uint64_t start_ns);
+void stats_note_alloc(size_t bytes);
+void stats_note_free(size_t bytes);
+void stats_note_read(size_t bytes);
+void stats_note_bloom_filter(double estimated_fpr, size_t bytes);
+void stats_note_bloom_check(int maybe_present);
+void stats_note_bloom_false_positive(void);
+void stats_note_cache(int hit);
+void stats_finish(const char *command, int exit_code);
+#endif
+
+#define STATS_BEGIN(var) uint64_t var = wtf_stats_enabled ? stats_clock_ns() : 0
+#define STATS_END(phase, var) do { if (wtf_stats_enabled) stats_record((phase), (var)); } while (0)
+
+// Counting allocator used by the core modules
+static inline void *wtf_malloc(size_t size) {
+    void *ptr = malloc(size);
+    if (wtf_stats_enabled && ptr) stats_note_alloc(malloc_usable_size(ptr));
+    return ptr;
+}
+
+static inline void *wtf_calloc(size_t count, size_t size) {
+    void *ptr = calloc(count, size);
+    if (wtf_stats_enabled && ptr) stats_note_alloc(malloc_usable_size(ptr));
+    return ptr;
+}
+
+static inline void *wtf_realloc(void *old, size_t size) {
+    if (!wtf_stats_enabled) return realloc(old, size);
+
+    size_t old_size = old ? malloc_usable_size(old) : 0;
+    void *ptr = realloc(old, size);
+    if (ptr) {
+        if (old) stats_note_free(old_size);
+        stats_note_alloc(malloc_usable_size(ptr));
+    }
+    return ptr;
+}
+
+static inline char *wtf_strdup(const char *str) {
+    char *copy = strdup(str);
+    if (wtf_stats_enabled && copy) stats_note_alloc(malloc_usable_size(copy));
+    return copy;
+}
+
+static inline void wtf_free(void *ptr) {
+    if (wtf_stats_enabled && ptr) stats_note_free(malloc_usable_size(ptr));
+    free(ptr);
+}
+
+#endif
@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "store_writer.h"
+#include "stats.h"
+
+void store_writer_init(StoreWriter *writer, const char *path) {
+    memset(writer, 0, sizeof(*writer));
+    writer->path = path;
+}
+
+void store_writer_free(StoreWriter *writer) {
+    wtf_free(writer->buffer);
+    writer->buffer = NULL;
+    writer->length = writer->capacity = writer->records = 0;
+}
+
+// Queue one record for the next commit or removal
+int store_writer_add(StoreWriter *writer, const char *term, const char *definition) {
+    size_t term_len = strlen(term), def_len = strlen(definition);
+    size_t need = writer->length + term_len + def_len + 2;
+    if (need > writer->capacity) {
+        size_t capacity = writer->capacity ? writer->capacity * 2 : 256;
+        while (capacity < need) capacity *= 2;
+        char *grown = wtf_realloc(writer->buffer, capacity);
+        if (!grown) return 0;
+        writer->buffer = grown;
+        writer->capacity = capacity;
+    }
+    char *p = writer->buffer + writer->length;
+    memcpy(p, term, term_len);
+    p[term_len] = ':';
+    memcpy(p + term_len + 1, definition, def_len);
+    p[term_len + 1 + def_len] = '\n';
+    writer->length = need;
+    writer->records++;
+    return 1;
+}
+
+static int write_all(int fd, const char *data, size_t len) {
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return 0;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 1;
+}
+
+// Open path and take an exclusive lock on it. A removal may have renamed a
+// new file over path while we waited, in which case the lock we got is on the
+// old one: start again. Returns the descriptor, or -1.
+static int open_locked(const char *path, int flags) {
+    for (;;) {
+        int fd = open(path, flags | O_CLOEXEC, 0644);
+        if (fd < 0) return -1;
+        while (flock(fd, LOCK_EX) != 0) {
+            if (errno != EINTR) {
+                close(fd);
+                return -1;
+            }
+        }
+        struct stat held, current;
+        if (fstat(fd, &held) == 0 && stat(path, &current) == 0 &&
+            held.st_dev == current.st_dev && held.st_ino == current.st_ino) {
+            return fd;
+        }
+        close(fd);
+        if (!(flags & O_CREAT) && access(path, F_OK) != 0) return -1;
+    }
+}
+
+// Append every queued record to the file with one write(2) and clear the queue
+int store_writer_commit(StoreWriter *writer) {
+    if (writer->records == 0) return 1;
+    STATS_BEGIN(started);
+    int fd = open_locked(writer->path, O_WRONLY | O_APPEND | O_CREAT);
+    if (fd < 0) {
+        STATS_END(STAT_STORE_WRITE, started);
+        return 0;
+    }
+    int ok = write_all(fd, writer->buffer, writer->length);
+    close(fd);
+    if (ok) writer->length = writer->records = 0;
+    STATS_END(STAT_STORE_WRITE, started);
+    return ok;
+}
+
+static int is_queued(const StoreWriter *writer, const char *line, size_t len) {
+    const char *record = writer->buffer, *end = writer->buffer + writer->length;
+    while (record < end) {
+        const char *newline = memchr(record, '\n', (size_t)(end - record));
+        if ((size_t)(newline - record) == len && memcmp(record, line, len) == 0) return 1;
+        record = newline + 1;
+    }
+    return 0;
+}
+
+static int read_locked(int fd, char **out, size_t *len) {
+    struct stat st;
+    if (fstat(fd, &st) != 0) return 0;
+    char *data = wtf_malloc((size_t)st.st_size + 1);
+    if (!data) return 0;
+    size_t got = 0;
+    while (got < (size_t)st.st_size) {
+        ssize_t n = read(fd, data + got, (size_t)st.st_size - got);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        got += (size_t)n;
+    }
+    data[got] = '\0';
+    *out = data;
+    *len = got;
+    return 1;
+}
+
+// Rewrite the file without any line equal to a queued record, then clear the
+// queue. The new contents go to path.<pid>.tmp and are renamed into place
+// while the lock is held. Returns the number of lines dropped (0 when none
+// matched or the file could not be rewritten).
+int store_writer_remove(StoreWriter *writer) {
+    if (writer->records == 0) return 0;
+    STATS_BEGIN(started);
+    int dropped = 0;
+    int fd = open_locked(writer->path, O_RDWR);
+    char *data = NULL;
+    size_t len = 0;
+    if (fd >= 0 && read_locked(fd, &data, &len)) {
+        // Compact the kept lines in place; the result is never longer
+        size_t kept = 0;
+        for (size_t pos = 0; pos < len;) {
+            char *newline = memchr(data + pos, '\n', len - pos);
+            size_t line_len = newline ? (size_t)(newline - (data + pos)) : len - pos;
+            if (is_queued(writer, data + pos, line_len)) {
+                dropped++;
+            } else {
+                memmove(data + kept, data + pos, line_len);
+                kept += line_len;
+                data[kept++] = '\n';
+            }
+            pos += line_len + 1;
+        }
+
+        char tmp_path[4096];
+        struct stat st;
+        if (dropped > 0 && fstat(fd, &st) == 0 &&
+            (size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", writer->path, (long)getpid()) < sizeof(tmp_path)) {
+            int tmp = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, st.st_mode & 0777);
+            int ok = tmp >= 0 && write_all(tmp, data, kept);
+            if (tmp >= 0 && close(tmp) != 0) ok = 0;
+            if (ok && rename(tmp_path, writer->path) != 0) ok = 0;
+            if (!ok) {
+                if (tmp >= 0) unlink(tmp_path);
+                dropped = 0;
+            }
+        }
+    }
+    wtf_free(data);
+    if (fd >= 0) close(fd);
+    writer->length = writer->records = 0;
+    STATS_END(STAT_STORE_WRITE, started);
+    return dropped;
+}
@@ -0,0 +1,27 @@
+#ifndef STORE_WRITER_H
+#define STORE_WRITER_H
+
+#include <stddef.h>
+
+// Batched, multi-process safe writes to the user's term:definition files
+// (added.txt, removed.txt). Records are queued in memory; a commit appends all
+// of them with a single write(2) on an O_APPEND descriptor, and a removal
+// rewrites the file through a per-process temporary that is renamed over it.
+// Both hold an exclusive flock() on the file, so concurrent `wtf add` and
+// `wtf remove` processes never interleave partial lines or lose each other's
+// records.
+typedef struct {
+    const char *path;
+    char *buffer;      // queued "term:definition\n" records
+    size_t length;
+    size_t capacity;
+    size_t records;
+} StoreWriter;
+
+void store_writer_init(StoreWriter *writer, const char *path);
+int store_writer_add(StoreWriter *writer, const char *term, const char *definition);
+int store_writer_commit(StoreWriter *writer);
+int store_writer_remove(StoreWriter *writer);
+void store_writer_free(StoreWriter *writer);
+
+#endif
@@ -0,0 +1,242 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "stream_lookup.h"
+#include "casefold.h"
+#include "stats.h"
+
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+void stream_lookup_init(StreamLookup *stream, const char *removed_path) {
+    memset(stream, 0, sizeof(*stream));
+    stream->removed_path = removed_path;
+}
+
+int stream_lookup_add_file(StreamLookup *stream, const char *path) {
+    if (stream->path_count == STREAM_MAX_FILES) return 0;
+    stream->paths[stream->path_count++] = path;
+    return 1;
+}
+
+void stream_lookup_free(StreamLookup *stream) {
+    wtf_free(stream->tombstones);
+    stream->tombstones = NULL;
+    stream->tombstones_size = 0;
+}
+
+// What a scan looks for: the folded term, and which bytes a line holding it
+// can start with. An ASCII letter can start with either case; a non-ASCII
+// character can fold from a different lead byte, and so can 'k' (KELVIN SIGN)
+// and 's' (LONG S), so those also accept every byte >= 0x80.
+typedef struct {
+    char folded[CASEFOLD_SIZE(256)];
+    size_t folded_len;
+    unsigned char first[2];
+    int any_high;
+} ScanTarget;
+
+static int scan_target_init(ScanTarget *target, const char *term) {
+    if (strlen(term) >= 256) return 0;  // longer than any line load_definitions() accepts
+    target->folded_len = casefold(term, target->folded, sizeof(target->folded));
+    if (target->folded_len == 0 || target->folded_len >= sizeof(target->folded)) return 0;
+    unsigned char c = (unsigned char)target->folded[0];
+    target->first[0] = c;
+    target->first[1] = (c >= 'a' && c <= 'z') ? (unsigned char)(c - 32) : c;
+    target->any_high = c >= 0x80 || c == 'k' || c == 's';
+    return 1;
+}
+
+static int is_candidate(const ScanTarget *target, unsigned char c) {
+    return c == target->first[0] || c == target->first[1] || (target->any_high && c >= 0x80);
+}
+
+// Copies of the matching lines, "key\0definition\0" each, in file order
+typedef struct {
+    char *arena;
+    size_t size;
+    size_t capacity;
+    size_t *offsets;
+    size_t count;
+    size_t capacity_offsets;
+} ScanHits;
+
+static int hits_add(ScanHits *hits, const char *key, size_t key_len, const char *def, size_t def_len) {
+    size_t need = hits->size + key_len + def_len + 2;
+    if (need > hits->capacity) {
+        size_t capacity = hits->capacity ? hits->capacity * 2 : 1024;
+        while (capacity < need) capacity *= 2;
+        char *grown = wtf_realloc(hits->arena, capacity);
+        if (!grown) return 0;
+        hits->arena = grown;
+        hits->capacity = capacity;
+    }
+    if (hits->count == hits->capacity_offsets) {
+        size_t capacity = hits->capacity_offsets ? hits->capacity_offsets * 2 : 16;
+        size_t *grown = wtf_realloc(hits->offsets, capacity * sizeof(size_t));
+        if (!grown) return 0;
+        hits->offsets = grown;
+        hits->capacity_offsets = capacity;
+    }
+    hits->offsets[hits->count++] = hits->size;
+    char *p = hits->arena + hits->size;
+    memcpy(p, key, key_len);
+    p[key_len] = '\0';
+    memcpy(p + key_len + 1, def, def_len);
+    p[key_len + 1 + def_len] = '\0';
+    hits->size = need;
+    return 1;
+}
+
+// The line at start is a candidate; keep it if its key folds to the term.
+// Lines are split as load_definitions() does: key up to the first ':', and
+// no line without a definition.
+static int check_line(const char *data, size_t size, size_t start, const ScanTarget *target, ScanHits *hits) {
+    const char *line = data + start;
+    const char *end = memchr(line, '\n', size - start);
+    if (!end) end = data + size;
+    const char *colon = memchr(line, ':', (size_t)(end - line));
+    if (!colon || colon == line || colon + 1 == end) return 1;
+
+    size_t key_len = (size_t)(colon - line);
+    if (key_len >= 256) return 1;
+    char folded[CASEFOLD_SIZE(256)];
+    size_t folded_len = casefold_n(line, key_len, folded, sizeof(folded));
+    if (folded_len != target->folded_len || memcmp(folded, target->folded, folded_len) != 0) return 1;
+    return hits_add(hits, line, key_len, colon + 1, (size_t)(end - colon - 1));
+}
+
+// Visit every line start whose first byte is a candidate. The vector loop
+// looks at W newlines and the W bytes after them at once, so lines that cannot
+// match cost no branch of their own.
+static int scan_lines(const char *data, size_t size, const ScanTarget *target, ScanHits *hits) {
+    if (size > 0 && is_candidate(target, (unsigned char)data[0]) && !check_line(data, size, 0, target, hits)) {
+        return 0;
+    }
+    size_t pos = 0;
+#if defined(__AVX2__)
+    const __m256i newline = _mm256_set1_epi8('\n');
+    const __m256i first0 = _mm256_set1_epi8((char)target->first[0]);
+    const __m256i first1 = _mm256_set1_epi8((char)target->first[1]);
+    for (; pos + 33 <= size; pos += 32) {
+        __m256i here = _mm256_loadu_si256((const __m256i *)(data + pos));
+        __m256i next = _mm256_loadu_si256((const __m256i *)(data + pos + 1));
+        uint32_t starts = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(here, newline));
+        if (!starts) continue;
+        __m256i want = _mm256_or_si256(_mm256_cmpeq_epi8(next, first0), _mm256_cmpeq_epi8(next, first1));
+        uint32_t hits_mask = (uint32_t)_mm256_movemask_epi8(want);
+        if (target->any_high) hits_mask |= (uint32_t)_mm256_movemask_epi8(next);
+        for (uint32_t m = starts & hits_mask; m; m &= m - 1) {
+            if (!check_line(data, size, pos + (size_t)__builtin_ctz(m) + 1, target, hits)) return 0;
+        }
+    }
+#elif defined(__SSE2__)
+    const __m128i newline = _mm_set1_epi8('\n');
+    const __m128i first0 = _mm_set1_epi8((char)target->first[0]);
+    const __m128i first1 = _mm_set1_epi8((char)target->first[1]);
+    for (; pos + 17 <= size; pos += 16) {
+        __m128i here = _mm_loadu_si128((const __m128i *)(data + pos));
+        __m128i next = _mm_loadu_si128((const __m128i *)(data + pos + 1));
+        uint32_t starts = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(here, newline));
+        if (!starts) continue;
+        __m128i want = _mm_or_si128(_mm_cmpeq_epi8(next, first0), _mm_cmpeq_epi8(next, first1));
+        uint32_t hits_mask = (uint32_t)_mm_movemask_epi8(want);
+        if (target->any_high) hits_mask |= (uint32_t)_mm_movemask_epi8(next);
+        for (uint32_t m = starts & hits_mask; m; m &= m - 1) {
+            if (!check_line(data, size, pos + (size_t)__builtin_ctz(m) + 1, target, hits)) return 0;
+        }
+    }
+#endif
+    // The rest (everything, without SIMD): hop from newline to newline
+    while (pos < size) {
+        const char *nl = memchr(data + pos, '\n', size - pos);
+        if (!nl) break;
+        size_t start = (size_t)(nl - data) + 1;
+        if (start < size && is_candidate(target, (unsigned char)data[start]) &&
+            !check_line(data, size, start, target, hits)) {
+            return 0;
+        }
+        pos = start;
+    }
+    return 1;
+}
+
+// Map path and collect its matching lines into hits. A missing or empty file has none.
+static int scan_file(const char *path, const ScanTarget *target, ScanHits *hits) {
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return 1;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size == 0) {
+        close(fd);
+        return 1;
+    }
+    size_t size = (size_t)st.st_size;
+    void *map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return 0;
+    madvise(map, size, MADV_SEQUENTIAL);
+    if (wtf_stats_enabled) stats_note_read(size);
+    int ok = scan_lines(map, size, target, hits);
+    munmap(map, size);
+    return ok;
+}
+
+// Append every definition of term (any case) from the files, in the order a
+// table loaded from them would list them: exact-case matches first, later
+// lines before earlier ones. Also picks up removed.txt's lines for the term
+// for stream_lookup_removed(). The matches point into a buffer out keeps.
+// Returns the number appended.
+int stream_lookup_view(StreamLookup *stream, const char *term, LookupResult *out) {
+    if (!stream || !term || !out) return 0;
+    ScanTarget target;
+    if (!scan_target_init(&target, term)) return 0;
+
+    STATS_BEGIN(started);
+    ScanHits hits = {0};
+    int ok = 1;
+    for (int i = 0; ok && i < stream->path_count; i++) ok = scan_file(stream->paths[i], &target, &hits);
+
+    ScanHits removed = {0};
+    if (ok && stream->removed_path) ok = scan_file(stream->removed_path, &target, &removed);
+    wtf_free(stream->tombstones);
+    wtf_free(removed.offsets);
+    stream->tombstones = removed.arena;
+    stream->tombstones_size = ok ? removed.size : 0;
+
+    int before = out->count;
+    for (int pass = 0; ok && pass < 2; pass++) {
+        for (size_t i = hits.count; i-- > 0;) {
+            const char *key = hits.arena + hits.offsets[i];
+            if ((pass == 0) == (strcmp(key, term) == 0)) {
+                lookup_result_add(out, key, key + strlen(key) + 1);
+            }
+        }
+    }
+    wtf_free(hits.offsets);
+    if (out->count > before) {
+        lookup_result_keep(out, hits.arena);
+    } else {
+        wtf_free(hits.arena);
+    }
+    STATS_END(STAT_STREAM_SCAN, started);
+    return out->count - before;
+}
+
+// True if removed.txt lists key (any case) with exactly this definition.
+// Only knows about the term of the last stream_lookup_view().
+int stream_lookup_removed(const StreamLookup *stream, const char *key, const char *definition) {
+    const char *p = stream->tombstones, *end = stream->tombstones + stream->tombstones_size;
+    while (p < end) {
+        const char *def = p + strlen(p) + 1;
+        if (strcmp(def, definition) == 0 && casefold_equal(p, key)) return 1;
+        p = def + strlen(def) + 1;
+    }
+    return 0;
+}
@@ -0,0 +1,28 @@
+#ifndef STREAM_LOOKUP_H
+#define STREAM_LOOKUP_H
+
+#include <stddef.h>
+#include "hash_table.h"
+
+#define STREAM_MAX_FILES 4
+
+// One-shot `wtf is` straight from the text files, for homes without a block
+// store. Each file is mapped and scanned once: only lines starting with a
+// byte the folded term can start with are looked at, and only matching lines
+// (and removed.txt's tombstones for the term) are copied out. No table is
+// built, so the cost is one pass over the bytes.
+typedef struct {
+    const char *paths[STREAM_MAX_FILES];   // in load order, e.g. definitions.txt then added.txt
+    int path_count;
+    const char *removed_path;
+    char *tombstones;        // "term\0definition\0" pairs from removed.txt for the last term looked up
+    size_t tombstones_size;
+} StreamLookup;
+
+void stream_lookup_init(StreamLookup *stream, const char *removed_path);
+int stream_lookup_add_file(StreamLookup *stream, const char *path);
+int stream_lookup_view(StreamLookup *stream, const char *term, LookupResult *out);
+int stream_lookup_removed(const StreamLookup *stream, const char *key, const char *definition);
+void stream_lookup_free(StreamLookup *stream);
+
+#endif
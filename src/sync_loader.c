@@ -0,0 +1,87 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dlfcn.h>
+#include "network_sync.h"
+
+#ifdef WTF_STATIC_SYNC
+// Monolithic build: the module is linked straight into the binary
+extern const SyncModule wtf_sync_module;
+
+const SyncModule *load_sync_module(void) {
+    return &wtf_sync_module;
+}
+#else
+static const SyncModule *loaded_module = NULL;
+
+static const SyncModule *try_module(const char *path) {
+    void *handle = dlopen(path, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) return NULL;
+
+    const SyncModule *module = dlsym(handle, SYNC_MODULE_SYMBOL);
+    if (!module || module->abi_version != SYNC_MODULE_ABI_VERSION) {
+        dlclose(handle);
+        return NULL;
+    }
+    return module;
+}
+
+// Look next to the executable first (in-tree builds), then in WTF_LIBDIR.
+// WTF_SYNC_MODULE overrides both.
+const SyncModule *load_sync_module(void) {
+    if (loaded_module) return loaded_module;
+
+    const char *override = getenv("WTF_SYNC_MODULE");
+    if (override && *override) {
+        loaded_module = try_module(override);
+    }
+
+    char exe[PATH_MAX];
+    ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    if (!loaded_module && len > 0) {
+        exe[len] = '\0';
+        char *slash = strrchr(exe, '/');
+        if (slash) {
+            char path[PATH_MAX + 64];
+            const char *name = slash + 1;
+            *slash = '\0';
+
+            snprintf(path, sizeof(path), "%s/%s", exe, SYNC_MODULE_NAME);
+            loaded_module = try_module(path);
+
+            // build/wtf_amd64 pairs with build/wtf_sync_amd64.so
+            if (!loaded_module && strncmp(name, "wtf_", 4) == 0) {
+                snprintf(path, sizeof(path), "%s/wtf_sync_%s.so", exe, name + 4);
+                loaded_module = try_module(path);
+            }
+        }
+    }
+
+    if (!loaded_module) {
+        loaded_module = try_module(WTF_LIBDIR "/" SYNC_MODULE_NAME);
+    }
+
+    if (!loaded_module) {
+        const char *reason = dlerror();
+        fprintf(stderr, "%s│%s\n", COLOR_RED, COLOR_RESET);
+        fprintf(stderr, "%s├─ Error%s: Sync module %s%s%s not found (%s)\n",
+                COLOR_RED, COLOR_RESET, COLOR_YELLOW, SYNC_MODULE_NAME, COLOR_RESET,
+                reason ? reason : "no usable candidate");
+    }
+    return loaded_module;
+}
+#endif
+
+SyncStatus check_for_updates(const char *config_dir, char *current_sha) {
+    const SyncModule *module = load_sync_module();
+    if (!module) return SYNC_ERROR;
+    return module->check_for_updates(config_dir, current_sha);
+}
+
+SyncStatus check_and_sync(const char *config_dir, HashTable *dictionary, bool force_sync) {
+    const SyncModule *module = load_sync_module();
+    if (!module) return SYNC_ERROR;
+    return module->check_and_sync(config_dir, dictionary, force_sync);
+}
@@ -0,0 +1,136 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include "sync_lock.h"
+
+// "<pid> <heartbeat>\n", fixed width so a heartbeat overwrites it in place
+#define SYNC_LOCK_RECORD 32
+
+static SyncLock *held = NULL;
+static time_t last_beat = 0;
+
+static void write_record(int fd, time_t now) {
+    char record[SYNC_LOCK_RECORD + 1];
+    snprintf(record, sizeof(record), "%-10ld %-20lld", (long)getpid(), (long long)now);
+    record[SYNC_LOCK_RECORD - 1] = '\n';
+    pwrite(fd, record, SYNC_LOCK_RECORD, 0);
+}
+
+// The holder's PID and last heartbeat, or 0 while the file is empty
+static int read_record(int fd, pid_t *pid, time_t *beat) {
+    char record[SYNC_LOCK_RECORD + 1];
+    ssize_t n = pread(fd, record, SYNC_LOCK_RECORD, 0);
+    if (n <= 0) return 0;
+    record[n] = '\0';
+    long p;
+    long long b;
+    if (sscanf(record, "%ld %lld", &p, &b) != 2) return 0;
+    *pid = (pid_t)p;
+    *beat = (time_t)b;
+    return 1;
+}
+
+static int same_file(int fd, const char *path) {
+    struct stat held_st, current;
+    return fstat(fd, &held_st) == 0 && stat(path, &current) == 0 &&
+           held_st.st_dev == current.st_dev && held_st.st_ino == current.st_ino;
+}
+
+// fd is the lock file as we found it, with a heartbeat of beat. Unlink it if
+// it is still at path and still has that heartbeat. Breakers hold a lock on
+// the directory, so two of them never judge and remove different files.
+// Returns 1 if the caller should try again right away.
+static int break_stale(const char *path, int fd, time_t beat) {
+    char dir[4096];
+    snprintf(dir, sizeof(dir), "%s", path);
+    char *slash = strrchr(dir, '/');
+    if (!slash) return 0;
+    *slash = '\0';
+
+    int dir_fd = open(dir[0] ? dir : "/", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (dir_fd < 0) return 0;
+    int retry = 0;
+    if (flock(dir_fd, LOCK_EX) == 0) {
+        pid_t pid;
+        time_t again;
+        if (!same_file(fd, path)) {
+            retry = 1;  // someone else broke it first
+        } else if (read_record(fd, &pid, &again) && again == beat) {
+            retry = unlink(path) == 0;
+        }
+    }
+    close(dir_fd);
+    return retry;
+}
+
+// Take <config_dir>/sync.lock, waiting up to wait_seconds for another holder
+// (0: give up at once). Returns 1 when held; on 0, busy says whether another
+// process had it (and owner which) rather than the file being unusable.
+int sync_lock_acquire(SyncLock *lock, const char *config_dir, int wait_seconds) {
+    memset(lock, 0, sizeof(*lock));
+    lock->fd = -1;
+    lock->started = time(NULL);
+    if ((size_t)snprintf(lock->path, sizeof(lock->path), "%s/%s", config_dir, SYNC_LOCK_FILE) >= sizeof(lock->path)) {
+        return 0;
+    }
+
+    for (;;) {
+        int fd = open(lock->path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+        if (fd < 0) return 0;
+        if (flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            if (!same_file(fd, lock->path)) {
+                close(fd);  // unlinked as stale while we opened it
+                continue;
+            }
+            lock->fd = fd;
+            lock->busy = 0;
+            held = lock;
+            last_beat = 0;
+            sync_lock_heartbeat();
+            return 1;
+        }
+        if (errno != EWOULDBLOCK && errno != EINTR) {
+            close(fd);
+            return 0;
+        }
+
+        lock->busy = 1;
+        pid_t pid = 0;
+        time_t beat = 0, now = time(NULL);
+        if (read_record(fd, &pid, &beat)) lock->owner = pid;
+        int retry = beat != 0 && now - beat > SYNC_LOCK_STALE && break_stale(lock->path, fd, beat);
+        close(fd);
+        if (retry) continue;
+        if (now - lock->started >= wait_seconds) return 0;
+
+        lock->waited = 1;
+        struct timespec pause = {0, 100 * 1000 * 1000};
+        nanosleep(&pause, NULL);
+    }
+}
+
+// Refresh the holder's heartbeat, if this process holds the lock. Called per
+// downloaded chunk and through the store and index builds, so it only writes
+// once a second.
+void sync_lock_heartbeat(void) {
+    if (!held) return;
+    time_t now = time(NULL);
+    if (now == last_beat) return;
+    last_beat = now;
+    write_record(held->fd, now);
+}
+
+// Drop the lock. The record is cleared first so the next holder is never
+// judged by this one's heartbeat; the file itself stays for the next sync.
+void sync_lock_release(SyncLock *lock) {
+    if (lock->fd < 0) return;
+    if (held == lock) held = NULL;
+    ftruncate(lock->fd, 0);
+    close(lock->fd);
+    lock->fd = -1;
+}
@@ -0,0 +1,44 @@
+#ifndef SYNC_LOCK_H
+#define SYNC_LOCK_H
+
+#include <sys/types.h>
+#include <time.h>
+
+#define SYNC_LOCK_FILE "sync.lock"
+#define SYNC_LOCK_STALE 60   // seconds without a heartbeat before a holder counts as hung
+#define SYNC_LOCK_WAIT 30    // seconds `wtf sync` waits for a sync already running
+
+// Single-flight sync: whoever holds an exclusive flock() on <config_dir>/sync.lock
+// is the one process checking and downloading; everyone else skips or waits.
+// The file records the holder's PID and a heartbeat that the download and
+// the store and index builds after it refresh.
+// A holder that dies drops the lock with its descriptor, so a crash never
+// blocks later syncs. A holder whose heartbeat is older than SYNC_LOCK_STALE
+// is presumed hung: the lock file is unlinked (under a lock on the directory,
+// so only the judged file goes) and the next sync starts on a fresh one.
+typedef struct {
+    int fd;
+    char path[4096];
+    int busy;           // another process held the lock at the last attempt
+    pid_t owner;        // that process, when its record could be read
+    int waited;         // acquiring had to wait for another holder
+    time_t started;     // when acquiring began
+} SyncLock;
+
+// Long loops call SYNC_LOCK_PULSE(i) with their counter, which beats every
+// SYNC_LOCK_PULSE_EVERY iterations rather than reading the clock on each
+#define SYNC_LOCK_PULSE_EVERY 4096
+#define SYNC_LOCK_PULSE(i) \
+    do { if (((i) & (SYNC_LOCK_PULSE_EVERY - 1)) == 0) sync_lock_heartbeat(); } while (0)
+
+#ifdef WTF_NO_SYNC_LOCK
+// libwtf (make lib) never syncs, so the builders it shares with wtf have no
+// lock to keep alive and the library holds no lock state
+static inline void sync_lock_heartbeat(void) {}
+#else
+int sync_lock_acquire(SyncLock *lock, const char *config_dir, int wait_seconds);
+void sync_lock_heartbeat(void);
+void sync_lock_release(SyncLock *lock);
+#endif
+
+#endif
@@ -0,0 +1,44 @@
+#include <stdio.h>
+#include <string.h>
+#include "network_sync.h"
+
+void load_sync_metadata(const char *config_dir, SyncMetadata *metadata) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", config_dir, SYNC_METADATA_FILE);
+    
+    metadata->next_check = 0;
+    metadata->failures = 0;
+    FILE *f = fopen(path, "r");
+    if (!f) {
+        metadata->last_sync = 0;
+        metadata->last_sha[0] = '\0';
+        return;
+    }
+    
+    if (fscanf(f, "%ld %40s", &metadata->last_sync, metadata->last_sha) != 2) {
+        metadata->last_sync = 0;
+        metadata->last_sha[0] = '\0';
+    } else {
+        if (strcmp(metadata->last_sha, "-") == 0) metadata->last_sha[0] = '\0';
+        if (fscanf(f, "%ld %d", &metadata->next_check, &metadata->failures) != 2) {
+            // Written before checks were scheduled
+            metadata->next_check = 0;
+            metadata->failures = 0;
+        }
+    }
+    
+    fclose(f);
+}
+
+void save_sync_metadata(const char *config_dir, const SyncMetadata *metadata) {
+    char path[512];
+    snprintf(path, sizeof(path), "%s/%s", config_dir, SYNC_METADATA_FILE);
+    
+    FILE *f = fopen(path, "w");
+    if (!f) return;
+    
+    // Older versions read the first two fields and ignore the rest
+    fprintf(f, "%ld %s %ld %d", metadata->last_sync, metadata->last_sha[0] ? metadata->last_sha : "-",
+            metadata->next_check, metadata->failures);
+    fclose(f);
+}
@@ -0,0 +1,496 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "trigram.h"
+#include "casefold.h"
+#include "stats.h"
+#include "sync_lock.h"
+
+#define TRIGRAM_RADIX_BITS 12
+#define TRIGRAM_RADIX (1u << TRIGRAM_RADIX_BITS)
+
+void trigram_builder_init(TrigramBuilder *builder) {
+    memset(builder, 0, sizeof(*builder));
+}
+
+int trigram_builder_add(TrigramBuilder *builder, const char *term) {
+    size_t len = strlen(term) + 1;
+    if (builder->arena_size + len > UINT32_MAX) return 0;
+
+    if (builder->arena_size + len > builder->arena_capacity) {
+        size_t capacity = builder->arena_capacity ? builder->arena_capacity : 64 * 1024;
+        while (builder->arena_size + len > capacity) capacity *= 2;
+        char *arena = wtf_realloc(builder->arena, capacity);
+        if (!arena) return 0;
+        builder->arena = arena;
+        builder->arena_capacity = capacity;
+    }
+    if (builder->count == builder->capacity) {
+        size_t capacity = builder->capacity ? builder->capacity * 2 : 4096;
+        uint32_t *offsets = wtf_realloc(builder->offsets, capacity * sizeof(uint32_t));
+        if (!offsets) return 0;
+        builder->offsets = offsets;
+        builder->capacity = capacity;
+    }
+
+    builder->offsets[builder->count++] = (uint32_t)builder->arena_size;
+    memcpy(builder->arena + builder->arena_size, term, len);
+    builder->arena_size += len;
+    return 1;
+}
+
+void trigram_builder_free(TrigramBuilder *builder) {
+    wtf_free(builder->arena);
+    wtf_free(builder->offsets);
+    memset(builder, 0, sizeof(*builder));
+}
+
+typedef struct {
+    uint64_t prefix;   // first 8 folded bytes, big-endian, so most comparisons stop here
+    uint32_t offset;
+} SortKey;
+
+// Folded order; spellings of one term in byte order, so the one kept does not
+// depend on the order terms were added in. arena is the builder's (qsort_r()).
+static int compare_terms(const void *a, const void *b, void *arena) {
+    const SortKey *x = a, *y = b;
+    if (x->prefix != y->prefix) return x->prefix < y->prefix ? -1 : 1;
+    const char *sort_arena = arena;
+    const char *p = sort_arena + x->offset;
+    const char *q = sort_arena + y->offset;
+    int c = casefold_compare(p, q);
+    return c != 0 ? c : strcmp(p, q);
+}
+
+static uint64_t folded_prefix(const char *term) {
+    // Output is only cut at a character boundary, so 64 bytes always hold the first 8
+    char folded[64];
+    casefold(term, folded, sizeof(folded));
+    uint64_t prefix = 0;
+    int i = 0;
+    for (; i < 8 && folded[i]; i++) prefix = (prefix << 8) | (unsigned char)folded[i];
+    return prefix << (8 * (8 - i));
+}
+
+static int same_folded(const char *a, const char *b) {
+    return casefold_equal(a, b);
+}
+
+// Trigrams are taken over folded bytes, so a multibyte character spans several
+static uint32_t gram_at(const char *s) {
+    return ((uint32_t)(unsigned char)s[0] << 16) |
+           ((uint32_t)(unsigned char)s[1] << 8) |
+           (uint32_t)(unsigned char)s[2];
+}
+
+// Fold term into buf, or into a new allocation when it does not fit. Returns
+// the folded term (free it if it is not buf) and its length, or NULL.
+static char *fold_term(const char *term, char *buf, size_t size, size_t *len) {
+    *len = casefold(term, buf, size);
+    if (*len < size) return buf;
+    char *folded = wtf_malloc(*len + 1);
+    if (folded) casefold(term, folded, *len + 1);
+    return folded;
+}
+
+// Point the section pointers into data; 0 if the sizes do not add up
+static int attach(TrigramIndex *index, void *data, size_t size) {
+    const unsigned char *base = data;
+    if (size < TRIGRAM_HEADER_SIZE || memcmp(base, TRIGRAM_MAGIC, 4) != 0) return 0;
+    const uint32_t *header = (const uint32_t *)base;
+    if (header[1] != TRIGRAM_VERSION) return 0;
+
+    uint64_t terms = header[2], grams = header[3], postings = header[4], names = header[5];
+    uint64_t need = TRIGRAM_HEADER_SIZE + 4 * ((terms + 1) + grams + (grams + 1) + postings) + names;
+    if (need != size) return 0;
+
+    index->term_count = (uint32_t)terms;
+    index->gram_count = (uint32_t)grams;
+    index->posting_count = (uint32_t)postings;
+    index->term_offsets = (const uint32_t *)(base + TRIGRAM_HEADER_SIZE);
+    index->grams = index->term_offsets + terms + 1;
+    index->post_offsets = index->grams + grams;
+    index->postings = index->post_offsets + grams + 1;
+    index->names = (const char *)(index->postings + postings);
+    if (index->term_offsets[terms] != names || index->post_offsets[grams] != postings ||
+        (names > 0 && index->names[names - 1] != '\0')) {
+        return 0;
+    }
+    index->data = data;
+    index->size = size;
+    return 1;
+}
+
+// Stable LSD radix sort of (gram << 32 | id) pairs by gram. Pairs are produced
+// in id order, so each gram's ids come out ascending.
+static int sort_pairs(uint64_t *pairs, size_t count) {
+    uint64_t *tmp = wtf_malloc((count ? count : 1) * sizeof(uint64_t));
+    size_t *buckets = wtf_malloc(TRIGRAM_RADIX * sizeof(size_t));
+    if (!tmp || !buckets) {
+        wtf_free(tmp);
+        wtf_free(buckets);
+        return 0;
+    }
+
+    uint64_t *src = pairs, *dst = tmp;
+    for (int shift = 32; shift < 56; shift += TRIGRAM_RADIX_BITS) {
+        memset(buckets, 0, TRIGRAM_RADIX * sizeof(size_t));
+        for (size_t i = 0; i < count; i++) buckets[(src[i] >> shift) & (TRIGRAM_RADIX - 1)]++;
+        size_t sum = 0;
+        for (uint32_t b = 0; b < TRIGRAM_RADIX; b++) {
+            size_t n = buckets[b];
+            buckets[b] = sum;
+            sum += n;
+        }
+        for (size_t i = 0; i < count; i++) dst[buckets[(src[i] >> shift) & (TRIGRAM_RADIX - 1)]++] = src[i];
+        uint64_t *swap = src;
+        src = dst;
+        dst = swap;
+    }
+    // An even number of passes leaves the result back in pairs
+    wtf_free(tmp);
+    wtf_free(buckets);
+    return 1;
+}
+
+// Deduplicate the collected terms (ignoring case) and index them
+TrigramIndex* trigram_builder_build(TrigramBuilder *builder) {
+    STATS_BEGIN(started);
+    SortKey *keys = wtf_malloc((builder->count ? builder->count : 1) * sizeof(SortKey));
+    if (!keys) {
+        STATS_END(STAT_TRIGRAM_BUILD, started);
+        return NULL;
+    }
+    for (size_t i = 0; i < builder->count; i++) {
+        keys[i].prefix = folded_prefix(builder->arena + builder->offsets[i]);
+        keys[i].offset = builder->offsets[i];
+    }
+    qsort_r(keys, builder->count, sizeof(SortKey), compare_terms, builder->arena);
+    sync_lock_heartbeat();
+    for (size_t i = 0; i < builder->count; i++) builder->offsets[i] = keys[i].offset;
+    wtf_free(keys);
+
+    size_t terms = 0, names_size = 0, pair_count = 0;
+    for (size_t i = 0; i < builder->count; i++) {
+        const char *term = builder->arena + builder->offsets[i];
+        if (i > 0 && same_folded(term, builder->arena + builder->offsets[terms - 1])) continue;
+        builder->offsets[terms++] = builder->offsets[i];
+        names_size += strlen(term) + 1;
+        size_t len = casefold(term, NULL, 0);
+        pair_count += len >= 3 ? len - 2 : 0;
+    }
+
+    uint64_t *pairs = wtf_malloc((pair_count ? pair_count : 1) * sizeof(uint64_t));
+    if (!pairs) {
+        STATS_END(STAT_TRIGRAM_BUILD, started);
+        return NULL;
+    }
+    size_t n = 0;
+    int folded_all = 1;
+    for (size_t id = 0; id < terms && folded_all; id++) {
+        SYNC_LOCK_PULSE(id);
+        char buf[CASEFOLD_SIZE(256)];
+        size_t len;
+        char *term = fold_term(builder->arena + builder->offsets[id], buf, sizeof(buf), &len);
+        if (!term) {
+            folded_all = 0;
+            break;
+        }
+        size_t first = n;
+        for (size_t i = 0; i + 3 <= len; i++) {
+            uint64_t pair = ((uint64_t)gram_at(term + i) << 32) | id;
+            // A term lists each trigram once
+            int seen = 0;
+            for (size_t k = first; k < n && !seen; k++) seen = pairs[k] == pair;
+            if (!seen) pairs[n++] = pair;
+        }
+        if (term != buf) wtf_free(term);
+    }
+    sync_lock_heartbeat();
+    if (!folded_all || !sort_pairs(pairs, n)) {
+        wtf_free(pairs);
+        STATS_END(STAT_TRIGRAM_BUILD, started);
+        return NULL;
+    }
+
+    size_t grams = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || (pairs[i] >> 32) != (pairs[i - 1] >> 32)) grams++;
+    }
+
+    size_t size = TRIGRAM_HEADER_SIZE + 4 * ((terms + 1) + grams + (grams + 1) + n) + names_size;
+    unsigned char *data = wtf_calloc(1, size);
+    TrigramIndex *index = wtf_calloc(1, sizeof(TrigramIndex));
+    if (!data || !index || size > UINT32_MAX) {
+        wtf_free(data);
+        wtf_free(index);
+        wtf_free(pairs);
+        STATS_END(STAT_TRIGRAM_BUILD, started);
+        return NULL;
+    }
+
+    uint32_t *header = (uint32_t *)data;
+    memcpy(data, TRIGRAM_MAGIC, 4);
+    header[1] = TRIGRAM_VERSION;
+    header[2] = (uint32_t)terms;
+    header[3] = (uint32_t)grams;
+    header[4] = (uint32_t)n;
+    header[5] = (uint32_t)names_size;
+
+    uint32_t *term_offsets = (uint32_t *)(data + TRIGRAM_HEADER_SIZE);
+    uint32_t *gram_keys = term_offsets + terms + 1;
+    uint32_t *post_offsets = gram_keys + grams;
+    uint32_t *postings = post_offsets + grams + 1;
+    char *names = (char *)(postings + n);
+
+    size_t pos = 0;
+    for (size_t id = 0; id < terms; id++) {
+        const char *term = builder->arena + builder->offsets[id];
+        size_t len = strlen(term) + 1;
+        term_offsets[id] = (uint32_t)pos;
+        memcpy(names + pos, term, len);
+        pos += len;
+    }
+    term_offsets[terms] = (uint32_t)pos;
+
+    size_t g = 0;
+    for (size_t i = 0; i < n; i++) {
+        uint32_t gram = (uint32_t)(pairs[i] >> 32);
+        if (i == 0 || gram != (uint32_t)(pairs[i - 1] >> 32)) {
+            gram_keys[g] = gram;
+            post_offsets[g] = (uint32_t)i;
+            g++;
+        }
+        postings[i] = (uint32_t)pairs[i];
+    }
+    post_offsets[grams] = (uint32_t)n;
+    wtf_free(pairs);
+
+    attach(index, data, size);
+    STATS_END(STAT_TRIGRAM_BUILD, started);
+    return index;
+}
+
+// Map a definitions.wtft. Returns NULL if it is missing or malformed.
+TrigramIndex* trigram_index_open(const char *path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return NULL;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < TRIGRAM_HEADER_SIZE) {
+        close(fd);
+        return NULL;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) return NULL;
+
+    TrigramIndex *index = wtf_calloc(1, sizeof(TrigramIndex));
+    if (!index || !attach(index, map, (size_t)st.st_size)) {
+        wtf_free(index);
+        munmap(map, (size_t)st.st_size);
+        return NULL;
+    }
+    index->mapped = 1;
+    return index;
+}
+
+// Write via a per-process temporary file so readers never map a partial index
+int trigram_index_write(const TrigramIndex *index, const char *path) {
+    char tmp_path[4096];
+    if ((size_t)snprintf(tmp_path, sizeof(tmp_path), "%s.%ld.tmp", path, (long)getpid()) >= sizeof(tmp_path)) return 0;
+    FILE *f = fopen(tmp_path, "wb");
+    if (!f) return 0;
+    int ok = fwrite(index->data, 1, index->size, f) == index->size;
+    if (fclose(f) != 0) ok = 0;
+    if (ok && rename(tmp_path, path) != 0) ok = 0;
+    if (!ok) remove(tmp_path);
+    return ok;
+}
+
+void trigram_index_free(TrigramIndex *index) {
+    if (!index) return;
+    if (index->mapped) {
+        munmap(index->data, index->size);
+    } else {
+        wtf_free(index->data);
+    }
+    wtf_free(index);
+}
+
+const char* trigram_index_term(const TrigramIndex *index, uint32_t id) {
+    return index->names + index->term_offsets[id];
+}
+
+static int matches_add(TrigramMatches *matches, uint32_t id) {
+    if (matches->count == matches->capacity) {
+        size_t capacity = matches->capacity ? matches->capacity * 2 : 64;
+        uint32_t *ids = wtf_realloc(matches->ids, capacity * sizeof(uint32_t));
+        if (!ids) return 0;
+        matches->ids = ids;
+        matches->capacity = capacity;
+    }
+    matches->ids[matches->count++] = id;
+    return 1;
+}
+
+void trigram_matches_free(TrigramMatches *matches) {
+    wtf_free(matches->ids);
+    memset(matches, 0, sizeof(*matches));
+}
+
+// Fold the pattern; one without wildcards is a substring search
+int trigram_pattern_normalize(const char *pattern, char *out, size_t size) {
+    int glob = strpbrk(pattern, "*?") != NULL;
+    if (size < 3) return 0;
+
+    size_t pos = 0;
+    if (!glob) out[pos++] = '*';
+    size_t len = casefold(pattern, out + pos, size - pos - 1);
+    if (len >= size - pos - 1) return 0;
+    pos += len;
+    if (!glob) out[pos++] = '*';
+    out[pos] = '\0';
+    return 1;
+}
+
+static int glob_match_folded(const char *glob, const char *term) {
+    const char *star = NULL, *resume = NULL;
+    while (*term) {
+        if (*glob == '?') {
+            // One character, not one byte
+            glob++;
+            term++;
+            while (((unsigned char)*term & 0xC0) == 0x80) term++;
+        } else if (*glob != '*' && *glob == *term) {
+            glob++;
+            term++;
+        } else if (*glob == '*') {
+            star = glob++;
+            resume = term;
+        } else if (star) {
+            glob = star + 1;
+            resume++;
+            while (((unsigned char)*resume & 0xC0) == 0x80) resume++;
+            term = resume;
+        } else {
+            return 0;
+        }
+    }
+    while (*glob == '*') glob++;
+    return *glob == '\0';
+}
+
+// Whole-term match of a folded glob ('*' any run, '?' any one character),
+// ignoring the term's case
+int trigram_glob_match(const char *glob, const char *term) {
+    char buf[CASEFOLD_SIZE(256)];
+    size_t len;
+    char *folded = fold_term(term, buf, sizeof(buf), &len);
+    if (!folded) return 0;
+    int match = glob_match_folded(glob, folded);
+    if (folded != buf) wtf_free(folded);
+    return match;
+}
+
+static long find_gram(const TrigramIndex *index, uint32_t gram) {
+    long lo = 0, hi = (long)index->gram_count - 1;
+    while (lo <= hi) {
+        long mid = lo + (hi - lo) / 2;
+        if (index->grams[mid] == gram) return mid;
+        if (index->grams[mid] < gram) {
+            lo = mid + 1;
+        } else {
+            hi = mid - 1;
+        }
+    }
+    return -1;
+}
+
+typedef struct {
+    const uint32_t *ids;
+    uint32_t count;
+} Posting;
+
+static int compare_postings(const void *a, const void *b) {
+    uint32_t x = ((const Posting *)a)->count, y = ((const Posting *)b)->count;
+    return (x > y) - (x < y);
+}
+
+// First position in ids[from..count) holding a value >= id (galloping search)
+static uint32_t seek(const uint32_t *ids, uint32_t from, uint32_t count, uint32_t id) {
+    uint32_t step = 1, lo = from, hi = from;
+    while (hi < count && ids[hi] < id) {
+        lo = hi + 1;
+        hi += step;
+        step *= 2;
+    }
+    if (hi > count) hi = count;
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        if (ids[mid] < id) {
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+    return lo;
+}
+
+// Append the ids of every term matching pattern (see trigram_pattern_normalize())
+// to out. Returns the number appended, or -1 on allocation failure.
+int trigram_index_search(const TrigramIndex *index, const char *pattern, TrigramMatches *out) {
+    char glob[512];
+    if (!index || !trigram_pattern_normalize(pattern, glob, sizeof(glob))) return 0;
+    STATS_BEGIN(started);
+    size_t before = out->count;
+
+    // Trigrams of the literal runs between wildcards
+    Posting postings[64];
+    int posting_count = 0;
+    int impossible = 0;
+    for (const char *run = glob; *run && !impossible;) {
+        size_t len = strcspn(run, "*?");
+        for (size_t i = 0; i + 3 <= len && posting_count < 64; i++) {
+            long g = find_gram(index, gram_at(run + i));
+            if (g < 0) {
+                impossible = 1;
+                break;
+            }
+            uint32_t start = index->post_offsets[g];
+            postings[posting_count].ids = index->postings + start;
+            postings[posting_count].count = index->post_offsets[g + 1] - start;
+            posting_count++;
+        }
+        run += len;
+        while (*run == '*' || *run == '?') run++;
+    }
+
+    int ok = 1;
+    if (impossible) {
+        // Some trigram appears in no term
+    } else if (posting_count == 0) {
+        // Too short to use the index: check every term
+        for (uint32_t id = 0; id < index->term_count && ok; id++) {
+            if (trigram_glob_match(glob, trigram_index_term(index, id))) ok = matches_add(out, id);
+        }
+    } else {
+        // Walk the rarest list, confirming each id in the others
+        qsort(postings, (size_t)posting_count, sizeof(Posting), compare_postings);
+        uint32_t cursor[64] = {0};
+        for (uint32_t i = 0; i < postings[0].count && ok; i++) {
+            uint32_t id = postings[0].ids[i];
+            int all = 1;
+            for (int p = 1; p < posting_count && all; p++) {
+                cursor[p] = seek(postings[p].ids, cursor[p], postings[p].count, id);
+                all = cursor[p] < postings[p].count && postings[p].ids[cursor[p]] == id;
+            }
+            if (all && trigram_glob_match(glob, trigram_index_term(index, id))) ok = matches_add(out, id);
+        }
+    }
+    STATS_END(STAT_TRIGRAM_SEARCH, started);
+    return ok ? (int)(out->count - before) : -1;
+}
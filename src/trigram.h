@@ -0,0 +1,71 @@
+#ifndef TRIGRAM_H
+#define TRIGRAM_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+// Trigram index over the distinct terms of a dictionary, for `wtf find`. Every
+// 3-byte window of a term's folded form (casefold.h) maps to the ascending ids of the terms that
+// contain it; a pattern's candidates are the intersection of its trigrams'
+// postings, which are then checked against the pattern itself.
+//
+// definitions.wtft sits next to each definitions.wtfb and holds the same bytes
+// an in-memory index uses (integers in host order, 4-byte aligned):
+//   header   "WTFT" | u32 version | u32 terms | u32 grams | u32 postings | u32 names_size | u64 0
+//   u32 term_offsets[terms + 1]   into names
+//   u32 grams[grams]              sorted keys, (a << 16) | (b << 8) | c
+//   u32 post_offsets[grams + 1]   into postings
+//   u32 postings[postings]
+//   char names[names_size]        terms sorted by folded form, NUL-terminated; of several spellings the
+//                                 bytewise smallest (e.g. "ABC" over "Abc")
+#define TRIGRAM_MAGIC "WTFT"
+#define TRIGRAM_VERSION 2
+#define TRIGRAM_HEADER_SIZE 32
+
+typedef struct {
+    uint32_t term_count;
+    uint32_t gram_count;
+    uint32_t posting_count;
+    const uint32_t *term_offsets;
+    const char *names;
+    const uint32_t *grams;
+    const uint32_t *post_offsets;
+    const uint32_t *postings;
+    void *data;            // the whole index, mmap()ed or allocated
+    size_t size;
+    int mapped;
+} TrigramIndex;
+
+// Terms (any order, repeats allowed) collected before building
+typedef struct {
+    char *arena;
+    size_t arena_size;
+    size_t arena_capacity;
+    uint32_t *offsets;
+    size_t count;
+    size_t capacity;
+} TrigramBuilder;
+
+// Matching term ids, ascending (so in folded order)
+typedef struct {
+    uint32_t *ids;
+    size_t count;
+    size_t capacity;
+} TrigramMatches;
+
+void trigram_builder_init(TrigramBuilder *builder);
+int trigram_builder_add(TrigramBuilder *builder, const char *term);
+TrigramIndex* trigram_builder_build(TrigramBuilder *builder);
+void trigram_builder_free(TrigramBuilder *builder);
+
+TrigramIndex* trigram_index_open(const char *path);
+int trigram_index_write(const TrigramIndex *index, const char *path);
+void trigram_index_free(TrigramIndex *index);
+const char* trigram_index_term(const TrigramIndex *index, uint32_t id);
+int trigram_index_search(const TrigramIndex *index, const char *pattern, TrigramMatches *out);
+void trigram_matches_free(TrigramMatches *matches);
+
+int trigram_pattern_normalize(const char *pattern, char *out, size_t size);
+int trigram_glob_match(const char *glob, const char *term);
+
+#endif
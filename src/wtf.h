@@ -0,0 +1,68 @@
+#ifndef WTF_H
+#define WTF_H
+
+// libwtf: the dictionary behind `wtf`, for programs that would otherwise run
+// the binary once per lookup. Build it with `make lib` (build/libwtf.so and
+// build/libwtf.a) and link with -lwtf -lz -pthread.
+//
+// A handle serves one ~/.wtf: the base dictionary (definitions.wtfb or
+// definitions.txt, from the directory or the shared system base, as `wtf`
+// picks it) plus the user's added.txt and removed.txt. Nothing is printed,
+// nothing is prompted for and no sync is started. The library keeps no state
+// outside its handles, and one handle may be used from several threads at
+// once: lookups run side by side, changes wait for them and run one at a time.
+//
+// Functions returning int return -1 on error (bad arguments, allocation or
+// I/O failure) unless noted otherwise.
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#if defined(__GNUC__)
+#define WTF_API __attribute__((visibility("default")))
+#else
+#define WTF_API
+#endif
+
+// Bumped whenever a declaration below changes incompatibly
+#define WTF_API_VERSION 1
+
+typedef struct WtfHandle WtfHandle;
+typedef struct WtfResults WtfResults;
+
+WTF_API int wtf_api_version(void);
+
+// Open the dictionary kept in config_dir (e.g. "/home/me/.wtf"). NULL means
+// $WTF_HOME/.wtf, else $HOME/.wtf. Returns NULL if no base dictionary can be
+// read there or from the system base.
+WTF_API WtfHandle *wtf_open(const char *config_dir);
+WTF_API void wtf_close(WtfHandle *handle);
+
+// Every definition of term (any case) that has not been removed, exact-case
+// matches first, as `wtf is` lists them. On success *results holds copies
+// that stay valid after the handle changes or closes; free them with
+// wtf_results_free(). Returns the number of definitions.
+WTF_API int wtf_lookup(WtfHandle *handle, const char *term, WtfResults **results);
+
+WTF_API int wtf_results_count(const WtfResults *results);
+// The term as spelled in the dictionary, and its definition; NULL when i is out of range
+WTF_API const char *wtf_results_term(const WtfResults *results, int i);
+WTF_API const char *wtf_results_definition(const WtfResults *results, int i);
+WTF_API void wtf_results_free(WtfResults *results);
+
+// Add term:definition to added.txt. Returns 1 when added, 0 when the term
+// already had this definition.
+WTF_API int wtf_add(WtfHandle *handle, const char *term, const char *definition);
+// List term's definition in removed.txt. Returns 1 when removed, 0 when the
+// term has no such definition left to remove.
+WTF_API int wtf_remove(WtfHandle *handle, const char *term, const char *definition);
+// Take term's definition back out of removed.txt. Returns 1 when recovered,
+// 0 when it was not removed.
+WTF_API int wtf_recover(WtfHandle *handle, const char *term, const char *definition);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
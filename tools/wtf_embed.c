@@ -0,0 +1,185 @@
+// Turns a definitions.txt into C source for src/embedded_dict.c.
+//
+//   wtf_embed <definitions.txt> <output.inc>
+//
+// Entries are sorted by folded term (src/casefold.c) (stable, so file order is kept within a
+// term) and a sorted group index over the distinct terms is emitted alongside,
+// so the runtime can binary-search straight into .rodata. Definitions are
+// stored FSST-encoded (src/fsst.c) with a symbol table trained on all of
+// them, and decoded only when a lookup returns them.
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "casefold.h"
+#include "fsst.h"
+
+typedef struct {
+    char *folded;
+    char *key;
+    char *value;
+    size_t order;
+} Entry;
+
+static int compare_entries(const void *a, const void *b) {
+    const Entry *x = a;
+    const Entry *y = b;
+    int cmp = strcmp(x->folded, y->folded);
+    if (cmp != 0) return cmp;
+    return (x->order > y->order) - (x->order < y->order);
+}
+
+static char *fold(const char *str) {
+    size_t size = casefold(str, NULL, 0) + 1;
+    char *out = malloc(size);
+    if (out) casefold(str, out, size);
+    return out;
+}
+
+// Write str as a C string literal. '?' is escaped so no trigraph can form.
+static void emit_literal(FILE *out, const char *str) {
+    fputc('"', out);
+    for (const unsigned char *p = (const unsigned char *)str; *p; p++) {
+        if (*p == '"' || *p == '\\' || *p == '?') {
+            fprintf(out, "\\%c", *p);
+        } else if (*p < 0x20 || *p >= 0x7f) {
+            fprintf(out, "\\%03o", *p);
+        } else {
+            fputc(*p, out);
+        }
+    }
+    fputc('"', out);
+}
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <definitions.txt> <output.inc>\n", argv[0]);
+        return 2;
+    }
+
+    FILE *in = fopen(argv[1], "r");
+    if (!in) {
+        perror(argv[1]);
+        return 1;
+    }
+
+    Entry *entries = NULL;
+    size_t count = 0, capacity = 0;
+
+    // Parse exactly like load_definitions() so both paths see the same data
+    char line[256];
+    while (fgets(line, sizeof(line), in)) {
+        char *term = strtok(line, ":");
+        char *definition = strtok(NULL, "\n");
+        if (!term || !definition) continue;
+
+        if (count >= capacity) {
+            capacity = capacity ? capacity * 2 : 1024;
+            Entry *tmp = realloc(entries, capacity * sizeof(Entry));
+            if (!tmp) {
+                fprintf(stderr, "wtf_embed: out of memory\n");
+                return 1;
+            }
+            entries = tmp;
+        }
+        entries[count].folded = fold(term);
+        entries[count].key = strdup(term);
+        entries[count].value = strdup(definition);
+        entries[count].order = count;
+        if (!entries[count].folded || !entries[count].key || !entries[count].value) {
+            fprintf(stderr, "wtf_embed: out of memory\n");
+            return 1;
+        }
+        count++;
+    }
+    fclose(in);
+
+    qsort(entries, count, sizeof(Entry), compare_entries);
+
+    static FsstTable codec;
+    const char **values = malloc((count ? count : 1) * sizeof(const char *));
+    for (size_t i = 0; values && i < count; i++) values[i] = entries[i].value;
+    if (!values || !fsst_train(&codec, values, count)) {
+        fprintf(stderr, "wtf_embed: out of memory\n");
+        return 1;
+    }
+    free(values);
+    size_t plain_bytes = 0, encoded_bytes = 0;
+    for (size_t i = 0; i < count; i++) {
+        size_t len = strlen(entries[i].value);
+        char *encoded = malloc(FSST_ENCODED_SIZE(len));
+        if (!encoded) {
+            fprintf(stderr, "wtf_embed: out of memory\n");
+            return 1;
+        }
+        encoded_bytes += fsst_encode(&codec, entries[i].value, encoded, FSST_ENCODED_SIZE(len)) + 1;
+        plain_bytes += len + 1;
+        free(entries[i].value);
+        entries[i].value = encoded;
+    }
+
+    FILE *out = fopen(argv[2], "w");
+    if (!out) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    fprintf(out, "// Generated by tools/wtf_embed from %s. Do not edit.\n\n", argv[1]);
+    fprintf(out, "static const EmbeddedEntry embedded_entries[] = {\n");
+    for (size_t i = 0; i < count; i++) {
+        fputs("    {", out);
+        emit_literal(out, entries[i].folded);
+        fputs(", ", out);
+        emit_literal(out, entries[i].key);
+        fputs(", ", out);
+        emit_literal(out, entries[i].value);
+        fputs("},\n", out);
+    }
+    if (count == 0) fputs("    {0, 0, 0}\n", out);
+    fputs("};\n\n", out);
+
+    size_t groups = 0;
+    fprintf(out, "static const EmbeddedGroup embedded_groups[] = {\n");
+    for (size_t i = 0; i < count;) {
+        size_t j = i + 1;
+        while (j < count && strcmp(entries[j].folded, entries[i].folded) == 0) j++;
+        fputs("    {", out);
+        emit_literal(out, entries[i].folded);
+        fprintf(out, ", %zu, %zu},\n", i, j - i);
+        groups++;
+        i = j;
+    }
+    if (groups == 0) fputs("    {0, 0, 0}\n", out);
+    fputs("};\n\n", out);
+
+    fprintf(out, "static const FsstTable embedded_codec = {\n    {");
+    for (int code = 0; code < 256; code++) {
+        fputs(code ? ", {" : "{", out);
+        for (int b = 0; b < FSST_SYMBOL_MAX; b++) fprintf(out, b ? ", %u" : "%u", codec.symbols[code][b]);
+        fputc('}', out);
+    }
+    fputs("},\n    {", out);
+    for (int code = 0; code < 256; code++) fprintf(out, code ? ", %u" : "%u", codec.lengths[code]);
+    fprintf(out, "},\n    %d,\n    {", codec.count);
+    for (int k = 0; k < 256; k++) fprintf(out, k ? ", %u" : "%u", codec.order[k]);
+    fputs("},\n    {", out);
+    for (int b = 0; b < 257; b++) fprintf(out, b ? ", %u" : "%u", codec.first[b]);
+    fputs("}\n};\n\n", out);
+
+    fprintf(out, "#define EMBEDDED_ENTRY_COUNT %zu\n", count);
+    fprintf(out, "#define EMBEDDED_GROUP_COUNT %zu\n", groups);
+
+    if (fclose(out) != 0) {
+        perror(argv[2]);
+        return 1;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        free(entries[i].folded);
+        free(entries[i].key);
+        free(entries[i].value);
+    }
+    free(entries);
+    fprintf(stderr, "wtf_embed: %zu definitions, %zu terms, definitions %zu -> %zu bytes\n",
+            count, groups, plain_bytes, encoded_bytes);
+    return 0;
+}
@@ -0,0 +1,28 @@
+// Converts a definitions.txt into the block store read by wtf.
+//
+//   wtf_pack <definitions.txt> <definitions.wtfb>
+#include <stdio.h>
+#include "block_store.h"
+
+int main(int argc, char *argv[]) {
+    if (argc != 3) {
+        fprintf(stderr, "Usage: %s <definitions.txt> <definitions.wtfb>\n", argv[0]);
+        return 2;
+    }
+
+    if (!block_store_build_from_text(argv[1], argv[2])) {
+        fprintf(stderr, "wtf_pack: could not convert %s\n", argv[1]);
+        return 1;
+    }
+
+    BlockStore *store = block_store_open(argv[2]);
+    if (!store) {
+        fprintf(stderr, "wtf_pack: %s was written but does not open\n", argv[2]);
+        return 1;
+    }
+    fprintf(stderr, "wtf_pack: %llu definitions in %u blocks, %llu bytes\n",
+            (unsigned long long)store->entry_count, store->block_count,
+            (unsigned long long)store->file_size);
+    block_store_close(store);
+    return 0;
+}